@@ -0,0 +1,167 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "include/crate.h"
+
+namespace rxdaq {
+
+/// type of step in batch plan
+enum class BatchStepType {
+	kBoot = 0,
+	kWrite,
+	kTask,
+	kImport,
+	kExport,
+	kRun
+};
+
+
+/// a step in batch plan
+struct BatchStep {
+	BatchStepType type;
+	// parameter name, task name, or path to import or export
+	std::string name;
+	unsigned short module;
+	// kChannelNum for module parameter
+	unsigned short channel;
+	double value;
+	// fast boot
+	bool fast;
+	// seconds of run, 0 for infinite
+	unsigned int seconds;
+	// run number of the first run, -1 to read from config
+	int run;
+	// times to repeat the run
+	unsigned int repeat;
+};
+
+
+/// batch plan, a sequence of steps and the stop conditions
+struct BatchPlan {
+	std::vector<BatchStep> steps;
+	// stop before next step if this file exists, empty to disable
+	std::string stop_file;
+	// stop before next step after these seconds, 0 to disable
+	unsigned int max_seconds;
+	// stop after this number of runs, 0 to disable
+	unsigned int max_runs;
+	// continue if a step failed
+	bool keep_going;
+};
+
+
+/// @brief parse batch plan from json
+///
+/// The plan looks like
+/// {
+/// 	"stop": {"file": "stop", "seconds": 36000, "runs": 100},
+/// 	"keepGoing": false,
+/// 	"steps": [
+/// 		{"type": "boot", "module": 13, "fast": true},
+/// 		{"type": "import", "path": "parameters.json"},
+/// 		{"type": "write", "name": "TAU", "value": 1.5, "module": 0, "channel": 3},
+/// 		{"type": "task", "name": "adjust_offsets", "module": 13},
+/// 		{"type": "run", "module": 13, "seconds": 600, "run": -1, "repeat": 3},
+/// 		{"type": "export", "path": "final.json"}
+/// 	]
+/// }
+/// Module is 13(all modules) by default, and write step without channel
+/// writes module parameter.
+///
+/// @param[in] json json of plan
+/// @returns batch plan
+///
+/// @throws UserError if the plan is invalid
+///
+BatchPlan ParseBatchPlan(const nlohmann::json &json);
+
+
+/// @brief read batch plan from json file
+///
+/// @param[in] path path of plan file
+/// @returns batch plan
+///
+/// @throws UserError if failed to read file or the plan is invalid
+///
+BatchPlan ReadBatchPlan(const std::string &path);
+
+
+/// This class executes the batch plan through the Crate interface. Output
+/// files of the next run are prepared in background while a run is taking
+/// data, so the next run can start at once.
+class BatchRunner {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] crate crate to control
+	///
+	BatchRunner(std::shared_ptr<Crate> crate) noexcept;
+
+
+	/// @brief default destructor
+	///
+	~BatchRunner() = default;
+
+
+	/// @brief execute the plan until finished or stop conditions reached
+	///
+	/// @param[in] plan plan to execute
+	/// @returns number of failed steps, always 0 if not keep going
+	///
+	/// @throws any error thrown by crate if not keep going
+	///
+	size_t Run(const BatchPlan &plan);
+
+
+	/// @brief get the number of runs finished in last Run()
+	///
+	/// @returns number of finished runs
+	///
+	inline unsigned int FinishedRuns() const noexcept {
+		return finished_runs_;
+	}
+
+private:
+
+	/// @brief execute a step except for run
+	///
+	/// @param[in] step step to execute
+	///
+	void Execute(const BatchStep &step);
+
+
+	/// @brief execute the runs of a step and prepare the next run
+	///
+	/// @param[in] plan the whole plan
+	/// @param[in] index index of the run step
+	///
+	void ExecuteRun(const BatchPlan &plan, size_t index);
+
+
+	/// @brief check stop conditions
+	///
+	/// @param[in] plan plan with stop conditions
+	/// @returns true if should stop
+	///
+	bool ShouldStop(const BatchPlan &plan) const;
+
+	std::shared_ptr<Crate> crate_;
+	std::chrono::steady_clock::time_point start_time_;
+	unsigned int finished_runs_;
+	// preparing the next run in background
+	std::future<void> preparing_;
+	// run number prepared for the next run, -1 if not prepared
+	int next_run_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __BATCH_H__
@@ -0,0 +1,122 @@
+#ifndef __BOOT_PLAN_H__
+#define __BOOT_PLAN_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include/config.h"
+
+namespace rxdaq {
+
+// parameter hash of module never imported, or modified after import
+const uint64_t kUnknownParameterHash = 0;
+// parameter hash of module without parameters in file, or the file can't be
+// read, only for target states, such module is always imported and then
+// recorded with kUnknownParameterHash
+const uint64_t kMissingParameterHash = 1;
+
+
+/// boot action of a module
+enum class BootAction {
+	kNone = 0,
+	kImport,
+	kBoot
+};
+/// boot action - boot action name
+const std::map<BootAction, std::string> kBootActionNames = {
+	{BootAction::kNone, "none"},
+	{BootAction::kImport, "import"},
+	{BootAction::kBoot, "boot"}
+};
+
+
+/// boot related state of a module, used to compare the module running state
+/// with the target state described by the config file
+struct ModuleBootState {
+	// whether the module is online (booted)
+	bool online;
+	// identity of firmware, see FirmwareIdentity()
+	std::string firmware;
+	// hash of the parameters imported to this module, kUnknownParameterHash
+	// for nothing imported
+	uint64_t parameter_hash;
+};
+
+
+/// boot plan of a single module
+struct ModuleBootPlan {
+	unsigned short module;
+	BootAction action;
+	std::string reason;
+};
+
+typedef std::vector<ModuleBootPlan> BootPlan;
+
+
+/// @brief compare current states with target states and plan the boot
+///
+/// @param[in] current current states of modules in crate
+/// @param[in] target target states of modules from config
+/// @param[in] modules modules to plan
+/// @param[in] force true to boot the modules no matter what the states are
+/// @returns boot plan of the modules
+///
+/// @throws RXError if sizes of current and target states don't match
+///
+BootPlan PlanBoot(
+	const std::vector<ModuleBootState> &current,
+	const std::vector<ModuleBootState> &target,
+	const std::vector<unsigned short> &modules,
+	bool force
+);
+
+
+/// @brief get the modules in boot plan with specific action
+///
+/// @param[in] plan boot plan
+/// @param[in] action action to select, modules with kBoot action are also
+/// 	selected if action is kImport since booted modules should be imported
+/// @returns list of modules
+///
+std::vector<unsigned short> PlannedModules(
+	const BootPlan &plan,
+	BootAction action
+);
+
+
+/// @brief generate boot plan information
+///
+/// @param[in] plan boot plan to display
+/// @returns boot plan information in string
+///
+std::string BootPlanInfo(const BootPlan &plan);
+
+
+/// @brief generate the firmware identity of a module from config
+///
+/// @param[in] config config of the crate
+/// @param[in] index index of module
+/// @returns firmware identity in string
+///
+std::string FirmwareIdentity(const Config &config, size_t index);
+
+
+/// @brief hash the parameters of each module in the parameter setting file
+///
+/// @param[in] path path of the parameter setting file
+/// @param[in] module_num number of modules
+/// @returns list of hash of module parameters, all modules share the hash
+///		of the whole file if the file is not a json array of modules,
+///		kMissingParameterHash for modules not in file or if failed to read
+///		the file
+///
+std::vector<uint64_t> ParameterHashes(
+	const std::string &path,
+	unsigned short module_num
+);
+
+}		// namespace rxdaq
+
+#endif		// __BOOT_PLAN_H__
@@ -0,0 +1,211 @@
+#ifndef __COLUMNAR_H__
+#define __COLUMNAR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+
+namespace rxdaq {
+
+// values in a block of encoded column
+const size_t kColumnBlockValues = 128;
+// default words of data file in a chunk, 64 MiB
+const size_t kDefaultChunkWords = size_t(16) << 20;
+
+
+/// columns of converted events, in the order they are stored in chunk file
+enum class Column : uint32_t {
+	kTime = 0,
+	kCrate,
+	kSlot,
+	kChannel,
+	kEnergy,
+	kCfd,
+	kFinishCode,
+	kTraceOffset,
+	kTraceLength
+};
+
+// names of columns, in the same order as Column
+extern const std::vector<std::string> kColumnNames;
+
+
+/// events in columns
+struct EventColumns {
+	std::vector<uint64_t> time;
+	std::vector<uint8_t> crate;
+	std::vector<uint8_t> slot;
+	std::vector<uint8_t> channel;
+	std::vector<uint16_t> energy;
+	std::vector<uint16_t> cfd;
+	std::vector<uint8_t> finish_code;
+	// offset of trace in source data file in bytes
+	std::vector<uint64_t> trace_offset;
+	std::vector<uint16_t> trace_length;
+
+
+	/// @brief get number of events
+	///
+	/// @returns number of events
+	///
+	inline size_t Size() const noexcept {
+		return time.size();
+	}
+};
+
+
+/// minimum and maximum values of a column
+struct ColumnStats {
+	uint64_t min;
+	uint64_t max;
+};
+
+
+/// @brief encode values losslessly, append the encoded words to output
+///
+/// The values are split into blocks of 128. Each block starts with a word
+/// of bit width and two words of the minimum value, followed by the values
+/// minus minimum packed in width bits. Timestamps of a block are close, so
+/// they are packed in much fewer bits than 48.
+///
+/// @param[in] values values to encode
+/// @param[in] size number of values
+/// @param[out] output vector to append encoded words
+/// @returns number of words appended
+///
+size_t EncodeColumn(
+	const uint64_t *values,
+	size_t size,
+	std::vector<uint32_t> &output
+);
+
+
+/// @brief decode values encoded by EncodeColumn
+///
+/// @param[in] words encoded words
+/// @param[in] size number of words available
+/// @param[in] values number of values to decode
+/// @param[out] output place to store decoded values
+/// @returns number of words decoded
+///
+/// @throws RXError if the words are truncated or invalid
+///
+size_t DecodeColumn(
+	const uint32_t *words,
+	size_t size,
+	size_t values,
+	uint64_t *output
+);
+
+
+/// part of data file split at event boundary, in words
+struct FileChunk {
+	uint64_t begin;
+	uint64_t end;
+};
+
+
+/// @brief split list mode data into chunks of complete events by walking
+/// 	through the headers
+///
+/// @param[in] words list mode data
+/// @param[in] size number of words
+/// @param[in] chunk_words target words of a chunk, a chunk is larger if an
+/// 	event crosses the target
+/// @returns chunks in order, the incomplete event at the end is excluded
+///
+/// @throws RXError if the header is invalid
+///
+std::vector<FileChunk> SplitChunks(
+	const uint32_t *words,
+	size_t size,
+	size_t chunk_words = kDefaultChunkWords
+);
+
+
+/// @brief decode events of chunk into columns
+///
+/// @param[in] words list mode data of whole file
+/// @param[in] chunk chunk to decode
+/// @returns events in columns
+///
+/// @throws RXError if the data can't be decoded
+///
+EventColumns DecodeChunk(const uint32_t *words, const FileChunk &chunk);
+
+
+/// @brief get statistics of all columns
+///
+/// @param[in] columns events
+/// @returns minimum and maximum of each column, in the order of Column
+///
+std::vector<ColumnStats> ComputeStats(const EventColumns &columns);
+
+
+/// @brief write events to chunk file, statistics of columns are written in
+/// 	the header so readers can skip the chunk without decoding
+///
+/// @param[in] path path of chunk file
+/// @param[in] columns events to write
+/// @returns bytes written
+///
+/// @throws RXError if failed to write file
+///
+uint64_t WriteColumnChunk(const std::string &path, const EventColumns &columns);
+
+
+/// @brief read statistics of columns in chunk file
+///
+/// @param[in] path path of chunk file
+/// @returns statistics in the order of Column
+///
+/// @throws RXError if failed to read file or it's not a chunk file
+///
+std::vector<ColumnStats> ReadChunkStats(const std::string &path);
+
+
+/// @brief read events in chunk file
+///
+/// @param[in] path path of chunk file
+/// @returns events in columns
+///
+/// @throws RXError if failed to read file or it's not a chunk file
+///
+EventColumns ReadColumnChunk(const std::string &path);
+
+
+/// summary of conversion
+struct ConvertResult {
+	uint64_t files;
+	uint64_t chunks;
+	uint64_t events;
+	uint64_t input_bytes;
+	uint64_t output_bytes;
+};
+
+
+/// @brief convert list mode data files into columnar chunk files, chunks are
+/// 	decoded and encoded in parallel, and the chunks with their statistics
+/// 	are listed in manifest.json of output directory
+///
+/// @param[in] files data files written in raw or packed format
+/// @param[in] output output directory, created if not exists
+/// @param[in] threads number of threads, 0 to use all cores
+/// @param[in] chunk_words target words of data file in a chunk
+/// @returns summary of conversion
+///
+/// @throws RXError if failed to read or write files
+///
+ConvertResult ConvertRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	unsigned int threads = 0,
+	size_t chunk_words = kDefaultChunkWords
+);
+
+}		// namespace rxdaq
+
+#endif		// __COLUMNAR_H__
@@ -4,6 +4,7 @@
 // #include <unistd.h>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "nlohmann/json.hpp"
 
@@ -13,13 +14,51 @@ const unsigned short kModuleNum = 13;
 
 namespace rxdaq {
 
-/// This class reads the json format config file for a crate. 
+const unsigned short kChannelNum = 16;
+
+// default seconds between samples of module run statistics in runs
+const double kStatsInterval = 1.0;
+
+// maximum number of fill marks of module FIFO
+const size_t kMaxFifoMarks = 4;
+
+/// firmware information and boot files of a module, with template resolved
+struct ModuleConfig {
+	unsigned short slot;
+	unsigned short revision;
+	unsigned short rate;
+	unsigned short bits;
+	std::string version;
+	std::string ldr;
+	std::string var;
+	std::string fippi;
+	std::string sys;
+};
+
+
+/// run settings
+struct RunConfig {
+	std::string data_path;
+	std::string data_file;
+	unsigned int number;
+	// raw, or packed to encode traces
+	std::string format;
+	// seconds between samples of module run statistics, 0 not to sample
+	double stats_interval;
+	// ascending fill marks of module FIFO in fraction, warn when crossed
+	std::vector<double> fifo_marks;
+};
+
+
+/// This class reads the json format config file for a crate. The json is
+/// parsed and checked once in ReadFromFile() and extracted to typed members,
+/// so the accessors are plain field reads.
 class Config {
 public:
 
-	/// @brief default constructor
+	/// @brief constructor
 	///
-	Config() = default;
+	Config() noexcept;
 
 
 	/// @brief default destructor
@@ -49,8 +88,8 @@ public:
 	///
 	/// @returns message level
 	///
-	inline std::string MessageLevel() const {
-		return json_["messageLevel"];
+	inline const std::string& MessageLevel() const noexcept {
+		return message_level_;
 	}
 
 
@@ -58,8 +97,8 @@ public:
 	///
 	/// @returns xia log level in string
 	///
-	inline std::string XiaLogLevel() const {
-		return json_["xiaLogLevel"];
+	inline const std::string& XiaLogLevel() const noexcept {
+		return xia_log_level_;
 	}
 
 	//-------------------------------------------------------------------------
@@ -70,8 +109,18 @@ public:
 	///
 	/// @returns module number
 	///
-	inline unsigned short ModuleNum() const {
-		return json_["modules"].size();
+	inline unsigned short ModuleNum() const noexcept {
+		return modules_.size();
+	}
+
+
+	/// @brief get the module config with template resolved
+	///
+	/// @param[in] index index of module
+	/// @returns config of module
+	///
+	inline const ModuleConfig& Module(size_t index) const {
+		return modules_[index];
 	}
 
 
@@ -80,7 +129,7 @@ public:
 	/// @returns physical slot number
 	///
 	inline unsigned short Slot(size_t index) const {
-		return json_["modules"][index]["slot"];
+		return modules_[index].slot;
 	}
 
 
@@ -88,8 +137,8 @@ public:
 	///
 	/// @returns crate id
 	///
-	inline unsigned short CrateId() const {
-		return json_["crateId"];
+	inline unsigned short CrateId() const noexcept {
+		return crate_id_;
 	}
 
 
@@ -97,8 +146,17 @@ public:
 	///
 	/// @returns path of parameter setting file
 	///
-	inline std::string ParameterFile() const {
-		return json_["parameterFile"];
+	inline const std::string& ParameterFile() const noexcept {
+		return parameter_file_;
+	}
+
+
+	/// @brief get endpoint of rpc server, unix:<path> or <host>:<port>
+	///
+	/// @returns endpoint, empty if not set
+	///
+	inline const std::string& RpcEndpoint() const noexcept {
+		return rpc_endpoint_;
 	}
 
 
@@ -113,7 +171,7 @@ public:
 	/// @returns revision of module
 	///
 	inline unsigned short Revision(size_t index) const {
-		return GetBootInfo<unsigned short>(index, "rev");
+		return modules_[index].revision;
 	}
 
 
@@ -123,7 +181,7 @@ public:
 	/// @returns sampling rate of module
 	///
 	inline unsigned short Rate(size_t index) const {
-		return GetBootInfo<unsigned short>(index, "rate");
+		return modules_[index].rate;
 	}
 
 
@@ -133,7 +191,7 @@ public:
 	/// @returns adc bits of module
 	///
 	inline unsigned short Bits(size_t index) const {
-		return GetBootInfo<unsigned short>(index, "bits");
+		return modules_[index].bits;
 	}
 	
 
@@ -141,37 +199,13 @@ public:
 	// 								boot files
 	//-------------------------------------------------------------------------
 
-	/// @brief get boot information of module by index
-	///
-	/// @tparam 
-	/// @param[in] index index of module
-	/// @returns path of boot file
-	///
-	template <typename ReturnType>
-	ReturnType GetBootInfo(size_t index, const std::string &name) const {
-		if (json_["modules"][index].contains(name)) {
-			return json_["modules"][index][name];
-		} else {
-			for (size_t i = 0; i < json_["templates"].size(); ++i) {
-				if (
-					json_["templates"][i]["name"] == 
-					json_["modules"][index]["template"]
-				) {
-					return json_["templates"][i][name];
-				}
-			}
-			throw RXError("Should not be here in GetBootFile.");
-		}
-	}
-
-
 	/// @brief get the boot file version
 	///
 	/// @param[in] index index of module
 	/// @returns version of boot file
 	///
-	inline std::string Version(size_t index) const {
-		return GetBootInfo<std::string>(index, "version");
+	inline const std::string& Version(size_t index) const {
+		return modules_[index].version;
 	}
 
 	
@@ -180,8 +214,8 @@ public:
 	/// @param[in] index 
 	/// @returns path of boot file
 	///
-	inline std::string Ldr(size_t index) const {
-		return GetBootInfo<std::string>(index, "ldr");
+	inline const std::string& Ldr(size_t index) const {
+		return modules_[index].ldr;
 	}
 
 
@@ -190,8 +224,8 @@ public:
 	/// @param[in] index 
 	/// @returns path of boot file
 	///
-	inline std::string Var(size_t index) const {
-		return GetBootInfo<std::string>(index, "var");
+	inline const std::string& Var(size_t index) const {
+		return modules_[index].var;
 	}
 
 
@@ -200,8 +234,8 @@ public:
 	/// @param[in] index 
 	/// @returns path of boot file
 	///
-	inline std::string Fippi(size_t index) const {
-		return GetBootInfo<std::string>(index, "fippi");
+	inline const std::string& Fippi(size_t index) const {
+		return modules_[index].fippi;
 	}
 
 
@@ -210,8 +244,8 @@ public:
 	/// @param[in] index 
 	/// @returns path of boot file
 	///
-	inline std::string Sys(size_t index) const {
-		return GetBootInfo<std::string>(index, "sys");
+	inline const std::string& Sys(size_t index) const {
+		return modules_[index].sys;
 	}
 
 
@@ -224,7 +258,7 @@ public:
 	/// @returns run number
 	///
 	inline unsigned int RunNumber() const noexcept {
-		return json_["run"]["number"];
+		return run_.number;
 	}
 
 
@@ -233,7 +267,7 @@ public:
 	/// @param[in] run_number run number for next run  
 	///
 	inline void SetRunNumber(unsigned int run_number) noexcept {
-		json_["run"]["number"] = run_number;
+		run_.number = run_number;
 	}
 
 
@@ -241,8 +275,8 @@ public:
 	///
 	/// @returns run data path
 	/// 
-	inline std::string RunDataPath() const noexcept {
-		return json_["run"]["dataPath"];
+	inline const std::string& RunDataPath() const noexcept {
+		return run_.data_path;
 	}
 
 
@@ -250,8 +284,8 @@ public:
 	///
 	/// @param[in] path run data path
 	///
-	inline void SetRunDataPath(const std::string &path) noexcept {
-		json_["run"]["dataPath"] = path;
+	inline void SetRunDataPath(const std::string &path) {
+		run_.data_path = path;
 	}
 
 
@@ -259,8 +293,8 @@ public:
 	///
 	/// @returns run data file name prefix
 	/// 
-	inline std::string RunDataFile() const noexcept {
-		return json_["run"]["dataFile"];
+	inline const std::string& RunDataFile() const noexcept {
+		return run_.data_file;
 	}
 
 
@@ -268,8 +302,35 @@ public:
 	///
 	/// @param[in] prefix run data file name prefix
 	///
-	inline void SetRunDataFile(const std::string &prefix) noexcept {
-		json_["run"]["dataFile"] = prefix;
+	inline void SetRunDataFile(const std::string &prefix) {
+		run_.data_file = prefix;
+	}
+
+
+	/// @brief get run data format
+	///
+	/// @returns "raw" for Pixie list mode data, "packed" for encoded traces
+	///
+	inline const std::string& RunFormat() const noexcept {
+		return run_.format;
+	}
+
+
+	/// @brief get interval of sampling module run statistics in runs
+	///
+	/// @returns seconds between samples, 0 not to sample
+	///
+	inline double RunStatsInterval() const noexcept {
+		return run_.stats_interval;
+	}
+
+
+	/// @brief get fill marks of module FIFO in runs
+	///
+	/// @returns ascending marks in fraction of FIFO
+	///
+	inline const std::vector<double>& RunFifoMarks() const noexcept {
+		return run_.fifo_marks;
 	}
 	
 
@@ -308,8 +369,26 @@ private:
 	///
 	void CheckRunParameters();
 
-	// json data
+
+	/// @brief extract checked json to typed members, resolve templates
+	///
+	void Extract();
+
+	// json data, only for reading and writing file
 	nlohmann::json json_;
+
+	// global configuration
+	std::string message_level_;
+	std::string xia_log_level_;
+	unsigned short crate_id_;
+	std::string parameter_file_;
+	std::string rpc_endpoint_;
+
+	// modules with templates resolved
+	std::vector<ModuleConfig> modules_;
+
+	// run configuration
+	RunConfig run_;
 };
 
 
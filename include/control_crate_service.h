@@ -34,13 +34,27 @@ public:
 	///
 	/// @param[in] context extra context from client
 	/// @param[in] request includes module id and boot pattern
-	/// @param[out] reply error message
+	/// @param[out] reply includes time spent in boot phases
 	/// @returns grpc status 
 	///
 	grpc::Status Boot(
 		grpc::ServerContext *context,
 		const BootRequest *request,
-		EmptyReply *reply
+		BootReply *reply
+	);
+
+
+	/// @brief plan the boot without booting
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes module id and boot pattern
+	/// @param[out] reply includes boot plan of modules
+	/// @returns grpc status
+	///
+	grpc::Status PlanBoot(
+		grpc::ServerContext *context,
+		const BootRequest *request,
+		BootPlanReply *reply
 	);
 
 
@@ -114,6 +128,35 @@ public:
 	);
 
 
+	/// @brief prepare output files of list mode run
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes module and run number
+	/// @param[out] reply includes status
+	/// @returns grpc status
+	///
+	grpc::Status PrepareRun(
+		grpc::ServerContext *context,
+		const RunRequest *request,
+		EmptyReply *reply
+	);
+
+
+	/// @brief run in list mode continuously
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes module, first run number and conditions
+	/// 	to roll
+	/// @param[out] reply includes status and the first run number
+	/// @returns grpc status
+	///
+	grpc::Status ContinuousRun(
+		grpc::ServerContext *context,
+		const ContinuousRunRequest *request,
+		RunReply *reply
+	);
+
+
 	/// @brief stop list mode run
 	///
 	/// @param[in] context extra context from client
@@ -127,6 +170,148 @@ public:
 		RunReply *reply
 	);
 
+
+	/// @brief get status of the current or last run
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty request
+	/// @param[out] reply includes run state, run number, seconds and bytes
+	/// @returns grpc status
+	///
+	grpc::Status RunStatus(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		RunStatusReply *reply
+	);
+
+
+	/// @brief wait for the list mode run to finish
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes maximum time to wait
+	/// @param[out] reply includes run state, run number, seconds and bytes
+	/// @returns grpc status
+	///
+	grpc::Status WaitRun(
+		grpc::ServerContext *context,
+		const WaitRunRequest *request,
+		RunStatusReply *reply
+	);
+
+
+	/// @brief set rules to filter events before writing
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes path of rules file, empty to turn off
+	/// @param[out] reply includes status
+	/// @returns grpc status
+	///
+	grpc::Status SetFilter(
+		grpc::ServerContext *context,
+		const FilterRequest *request,
+		EmptyReply *reply
+	);
+
+
+	/// @brief get accepted and rejected counts of filter rules
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty request
+	/// @param[out] reply includes counts of rules
+	/// @returns grpc status
+	///
+	grpc::Status FilterStats(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		FilterStatsReply *reply
+	);
+
+
+	/// @brief set or turn off trace reduction before writing
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes switch, samples to keep, trigger and
+	/// 	energy to drop traces
+	/// @param[out] reply includes status
+	/// @returns grpc status
+	///
+	grpc::Status SetTraceReduction(
+		grpc::ServerContext *context,
+		const TraceReductionRequest *request,
+		EmptyReply *reply
+	);
+
+
+	/// @brief get statistics of trace reduction
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty request
+	/// @param[out] reply includes events, dropped traces and samples
+	/// @returns grpc status
+	///
+	grpc::Status ReductionStats(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		ReductionStatsReply *reply
+	);
+
+
+	/// @brief get input count rates of channels
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty request
+	/// @param[out] reply includes rates of channels with counts
+	/// @returns grpc status
+	///
+	grpc::Status ChannelRates(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		ChannelRatesReply *reply
+	);
+
+
+	/// @brief get statistics of RPC handled by server
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty request
+	/// @param[out] reply includes latencies, calls in flight and outcomes of
+	/// 	methods
+	/// @returns grpc status
+	///
+	grpc::Status GetServerStats(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		ServerStatsReply *reply
+	);
+
+
+	/// @brief clear previous traces and start tracing
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request empty message as placeholder
+	/// @param[out] reply includes status
+	/// @returns grpc status
+	///
+	grpc::Status StartTrace(
+		grpc::ServerContext *context,
+		const EmptyMessage *request,
+		EmptyReply *reply
+	);
+
+
+	/// @brief stop tracing and export traces
+	///
+	/// @param[in] context extra context from client
+	/// @param[in] request includes path to export
+	/// @param[out] reply includes status
+	/// @returns grpc status
+	///
+	grpc::Status StopTrace(
+		grpc::ServerContext *context,
+		const TraceRequest *request,
+		EmptyReply *reply
+	);
+
 private:
 	std::shared_ptr<Crate> crate_;
 };
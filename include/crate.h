@@ -1,21 +1,34 @@
 #ifndef __CRATE_H__
 #define __CRATE_H__
 
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <fstream>
 #include <string>
 #include <mutex>
+#include <thread>
 
 #include "pixie/pixie16/crate.hpp"
 #include "nlohmann/json.hpp"
 
+#include "include/boot_plan.h"
 #include "include/config.h"
+#include "include/data_writer.h"
+#include "include/event_filter.h"
+#include "include/fifo_monitor.h"
+#include "include/trace_codec.h"
+#include "include/trace_reducer.h"
 #include "include/message.h"
+#include "include/metrics.h"
+#include "include/rate_monitor.h"
+#include "include/run_number.h"
+#include "include/stats_sampler.h"
+#include "include/timing.h"
+#include "include/trace.h"
 
 namespace rxdaq {
 
-const unsigned short kChannelNum = 16;
-
-
 /// parameters type
 enum class ParameterType {
 	kAll = 0,
@@ -310,6 +323,49 @@ namespace vparam {
 };
 
 
+/// conditions to roll to the next run in continuous mode
+struct RollPolicy {
+	// roll after the run lasts these seconds, 0 to disable
+	unsigned int seconds;
+	// roll after data files of the run reach this size, 0 to disable
+	uint64_t bytes;
+	// stop after this number of runs, 0 for infinite
+	unsigned int runs;
+};
+
+
+/// state of list mode run
+enum class RunState {
+	kIdle = 0,
+	kStarting,
+	kRunning,
+	kStopping,
+	kFinished
+};
+/// run state - run state name
+const std::map<RunState, std::string> kRunStateNames = {
+	{RunState::kIdle, "idle"},
+	{RunState::kStarting, "starting"},
+	{RunState::kRunning, "running"},
+	{RunState::kStopping, "stopping"},
+	{RunState::kFinished, "finished"}
+};
+
+
+/// status of the current or last list mode run
+struct RunInfo {
+	RunState state;
+	// run number, -1 if never run
+	int run;
+	unsigned short module;
+	// seconds since the run started
+	unsigned int seconds;
+	// bytes read from modules in this run
+	uint64_t bytes;
+	// error message if the run failed
+	std::string error;
+};
+
 
 
 /// This class represents a physical XIA crate, and provides some interface to
@@ -342,6 +398,26 @@ public:
 	}
 
 
+	/// @brief get endpoint of rpc server in config
+	///
+	/// @returns endpoint, empty if not set
+	///
+	inline const std::string& RpcEndpoint() const noexcept {
+		return config_.RpcEndpoint();
+	}
+
+
+	/// @brief write messages of crate in background thread, so the readout
+	/// 	never waits for the terminal. The rpc server turns it on, while
+	/// 	the local commands keep messages in order with their own output.
+	///
+	/// @param[in] async whether to write asynchronously
+	///
+	inline void SetAsyncMessage(bool async = true) {
+		message_.SetAsync(async);
+	}
+
+
 	//-------------------------------------------------------------------------
 	//	 				method to initialize and boot
 	//-------------------------------------------------------------------------
@@ -356,14 +432,36 @@ public:
 	virtual void Initialize(const std::string &config_path = "");
 
 
+	/// @brief plan the boot without booting
+	///
+	/// @param[in] module_id module to plan
+	/// @param[in] fast true for incremental boot, false to boot all the
+	/// 	requested modules
+	/// @returns boot plan of the requested modules
+	///
+	virtual BootPlan PlanBoot(unsigned short module_id, bool fast = true);
+
+
 	/// @brief boot modules
 	///
 	/// @param[in] module_id module to boot 
-	/// @param[in] fast true for fast boot (don't boot fpga or load parameters)
+	/// @param[in] fast true for incremental boot (only boot or import the
+	/// 	modules differ from config), false to boot all requested modules
+	///
+	/// @throws UserError if a run is in progress
 	///
 	virtual void Boot(unsigned short module_id, bool fast = true);
 
 
+	/// @brief get time spent in phases of last boot or import
+	///
+	/// @returns list of phase timings
+	///
+	virtual inline std::vector<PhaseTiming> BootTimings() const {
+		return boot_timing_.Timings();
+	}
+
+
 	//-------------------------------------------------------------------------
 	//	 					method for auto task
 	//-------------------------------------------------------------------------
@@ -374,6 +472,8 @@ public:
 	/// @param[in] task_name name of task to process
 	/// @param[in] module module to process
 	///
+	/// @throws UserError if a run is in progress
+	///
 	virtual void Task(const std::string &task_name, unsigned short module);
 
 
@@ -438,6 +538,8 @@ public:
 	/// @param[in] value value to write
 	/// @param[in] module module to write
 	///
+	/// @throws UserError if a run is in progress
+	///
 	virtual void WriteParameter(
 		const std::string &name,
 		unsigned int value,
@@ -452,6 +554,8 @@ public:
 	/// @param[in] module module to write
 	/// @param[in] channel channel to write
 	///
+	/// @throws UserError if a run is in progress
+	///
 	virtual void WriteParameter(
 		const std::string &name,
 		double value,
@@ -463,14 +567,18 @@ public:
 	/// @brief import parameters from json file
 	///
 	/// @param[in] path path to import
-	/// 
+	///
+	/// @throws UserError if a run is in progress
+	///
 	virtual void ImportParameters(const std::string &path);
 	
 	
 	/// @brief export parameters to json file
 	///
 	/// @param path path to export
-	/// 
+	///
+	/// @throws UserError if a run is in progress
+	///
 	virtual void ExportParameters(const std::string &path);
 
 
@@ -478,33 +586,166 @@ public:
 	//	 					method for list mode run
 	//-------------------------------------------------------------------------
 
-	/// @brief start list mode run
+	/// @brief start list mode run and return at once, the data is read and
+	/// 	written by threads owned by crate
 	///
 	/// @param[in] module_id module to run in list mode 
 	/// @param[in] seconds seconds to run, 0 for infinite time
 	/// @param[in] run run number, -1 to read from config file
+	/// @returns run number of the started run
 	///
-	virtual void StartRun(
+	/// @throws UserError if another run is in progress
+	///
+	virtual unsigned int StartRun(
 		unsigned short module_id,
 		unsigned int seconds,
 		int run
 	);
 
 
-	/// @brief stop list mode run
+	/// @brief create directory and output files of a run in advance, so
+	/// 	StartRun with the same module and run number can start at once
 	///
-	virtual inline void StopRun() {
-		keep_running_ = false;
-	}
+	/// @param[in] module_id module to run in list mode
+	/// @param[in] run run number, -1 to read from config file
+	///
+	virtual void PrepareRun(unsigned short module_id, int run);
+
+
+	/// @brief start list mode run continuously and return at once, roll to
+	/// 	the next run when the run lasts long enough or the data files are
+	/// 	large enough
+	///
+	/// Files of the next run are prepared in background during the current
+	/// run. After a run stops, the next run starts as soon as residual data is
+	/// read, and closing files, copying parameters and saving run number are
+	/// done in background. Parameters are exported only once since they can't
+	/// change during the continuous run.
+	///
+	/// @param[in] module_id module to run in list mode
+	/// @param[in] policy conditions to roll to the next run
+	/// @param[in] run run number of the first run, -1 to read from config file
+	/// @returns run number of the first run
+	///
+	/// @throws UserError if neither time nor size to roll is set, or another
+	/// 	run is in progress
+	///
+	virtual unsigned int ContinuousRun(
+		unsigned short module_id,
+		const RollPolicy &policy,
+		int run
+	);
+
+
+	/// @brief ask the list mode run to stop and return at once, a run still
+	/// 	starting stops as soon as it's started
+	///
+	virtual void StopRun();
+
+
+	/// @brief get status of the current or last run
+	///
+	/// @returns run status
+	///
+	virtual RunInfo RunStatus();
+
+
+	/// @brief wait for the list mode run to finish
+	///
+	/// @param[in] milliseconds maximum time to wait, 0 to wait until finished
+	/// @returns run status, which may be still running if timeout
+	///
+	/// @throws the error which stops the run
+	///
+	virtual RunInfo WaitRun(unsigned int milliseconds = 0);
 
 
 	/// @brief get the run number
 	///
 	virtual inline unsigned int RunNumber() const {
+		std::lock_guard<std::mutex> guard(run_lock_);
 		return config_.RunNumber();
 	}
 
 
+	//-------------------------------------------------------------------------
+	//	 					method for event filter
+	//-------------------------------------------------------------------------
+
+	/// @brief filter events by rules before writing in the following runs
+	///
+	/// @param[in] path path of rules file, empty to write all events
+	///
+	/// @throws UserError if the rules are invalid or a run is in progress
+	///
+	virtual void SetFilter(const std::string &path);
+
+
+	/// @brief get accepted and rejected counts of filter rules in the
+	/// 	current or last run
+	///
+	/// @returns counts of rules, empty if no filter is set
+	///
+	virtual std::vector<FilterCount> FilterStats();
+
+
+	/// @brief cut or drop traces before writing in the following runs,
+	/// 	applied after the event filter
+	///
+	/// @param[in] enable false to write traces as they are
+	/// @param[in] reduction settings of reduction, ignored if not enabled
+	///
+	/// @throws UserError if the trigger is invalid or a run is in progress
+	///
+	virtual void SetTraceReduction(
+		bool enable,
+		const TraceReduction &reduction
+	);
+
+
+	/// @brief get statistics of trace reduction in the current or last run
+	///
+	/// @returns statistics, all zero if reduction is not enabled
+	///
+	virtual TraceReductionStats ReductionStats();
+
+
+	/// @brief get input count rates of channels in the sliding window of
+	/// 	the current run, or the rates when the last run stopped
+	///
+	/// @returns rates of channels with counts, ordered by module and channel
+	///
+	virtual std::vector<ChannelRate> ChannelRates();
+
+
+	/// @brief get statistics of RPC handled by this process
+	///
+	/// @returns statistics of methods, empty if not serving RPC
+	///
+	virtual std::vector<RpcMethodStats> ServerStats();
+
+
+	//-------------------------------------------------------------------------
+	//	 					method for tracing
+	//-------------------------------------------------------------------------
+
+	/// @brief clear previous traces and start tracing
+	///
+	virtual inline void StartTrace() {
+		Tracer::Instance().Enable();
+	}
+
+
+	/// @brief stop tracing and export traces in Chrome trace json
+	///
+	/// @param[in] path path of file to export
+	///
+	virtual inline void StopTrace(const std::string &path) {
+		Tracer::Instance().Disable();
+		Tracer::Instance().Export(path);
+	}
+
+
 	
 	// virtual void PrintInfo() const;
 
@@ -517,6 +758,79 @@ private:
 	virtual void LoadFirmware(unsigned short module_id);
 
 
+	/// @brief get the boot states of modules from config
+	///
+	/// @returns target boot states of modules
+	///
+	std::vector<ModuleBootState> TargetBootStates() const;
+
+
+	/// @brief boot modules in plan and import parameters, timings are recorded
+	/// 	in boot timing report
+	///
+	/// @param[in] module_id module to boot, kModuleNum for all modules
+	/// @param[in] fast skip modules already booted with the same firmware
+	///
+	void BootModules(unsigned short module_id, bool fast);
+
+
+	/// @brief import parameters of all modules in file, and initialize
+	/// 	analog front end of the requested modules and the modules whose
+	/// 	parameters are changed
+	///
+	/// @param[in] path path to import
+	/// @param[in] modules modules to initialize analog front end
+	///
+	void ImportParameters(
+		const std::string &path,
+		const std::vector<unsigned short> &modules
+	);
+
+
+	/// @brief write module parameter without checking run state, used by
+	/// 	the run itself
+	///
+	/// @param[in] name name of the parameter
+	/// @param[in] value value to write
+	/// @param[in] module module to write
+	///
+	void WriteModuleParameter(
+		const std::string &name,
+		unsigned int value,
+		unsigned short module
+	);
+
+
+	/// @brief mark parameters of modules modified and differ from file
+	///
+	/// @param[in] module_id module to mark, kModuleNum for all modules
+	///
+	void ResetParameterHash(unsigned short module_id);
+
+
+	/// @brief start sampling run statistics of modules to the directory of
+	/// 	run, only warn if failed
+	///
+	/// @param[in] modules modules in run
+	/// @param[in] run run number
+	///
+	void StartStatsSampler(const std::vector<unsigned short> &modules, int run);
+
+
+	/// @brief read run statistics for the whole run and stop sampling, called
+	/// 	after the modules stop
+	///
+	void FinishStatsSampler();
+
+
+	/// @brief read run statistics of a module
+	///
+	/// @param[in] module_id module to read
+	/// @returns run statistics of channels
+	///
+	ModuleStats ReadModuleStats(unsigned short module_id);
+
+
 	/// @brief read list mode data from hardware to binary files
 	///
 	/// @param[in] module_id module to read from
@@ -534,6 +848,76 @@ private:
 	void WaitFinished(const std::vector<unsigned short> &modules);
 
 
+	/// @brief check no run is in progress before changing modules
+	///
+	/// @param[in] action action to report in error
+	///
+	/// @throws UserError if a run is starting, running or stopping
+	///
+	void CheckNoRun(const std::string &action);
+
+
+	/// @brief check and move to starting state
+	///
+	/// @throws UserError if another run is in progress
+	///
+	void BeginStarting();
+
+
+	/// @brief build pipeline of data writer from stages set and run format,
+	/// 	should hold run_lock_ before the data writer starts
+	///
+	void BuildPipeline();
+
+
+	/// @brief set state of run
+	///
+	/// @param[in] state new state
+	/// @param[in] error error stops the run, only for finished state
+	///
+	void SetRunState(RunState state, std::exception_ptr error = nullptr);
+
+
+	/// @brief take the prepared output streams of run, prepare them if
+	/// 	they were not prepared
+	///
+	/// @param[in] module_id module to run in list mode
+	/// @param[in] run run number
+	///
+	void TakePreparedRun(unsigned short module_id, int run);
+
+
+	/// @brief start list mode run in modules
+	///
+	/// @param[in] modules modules to start
+	///
+	void StartListMode(const std::vector<unsigned short> &modules);
+
+
+	/// @brief read data until stopped or reaching the conditions
+	///
+	/// @param[in] modules modules to read
+	/// @param[in] seconds stop after these seconds, 0 to disable
+	/// @param[in] bytes stop after writing these bytes, 0 to disable
+	///
+	void ReadUntil(
+		const std::vector<unsigned short> &modules,
+		unsigned int seconds,
+		uint64_t bytes
+	);
+
+
+	/// @brief end list mode run and read residual data
+	///
+	/// @param[in] module_id module to stop
+	/// @param[in] modules modules to wait and read
+	///
+	void StopListMode(
+		unsigned short module_id,
+		const std::vector<unsigned short> &modules
+	);
+
+
 	/// @brief do something after run finished
 	///
 	/// @param[in] module_id module to finish
@@ -541,13 +925,6 @@ private:
 	void FinishRun(unsigned short module_id);
 
 
-	static void SigIntHandler(int) {
-		std::cout << "\nYor press Ctrl+C to stop run, press again to quit."
-			 << std::endl;
-		keep_running_ = false;
-	}
-
-
 	// xia crate, the lower level compoment
 	xia::pixie::crate::crate xia_crate_;
 
@@ -556,6 +933,10 @@ private:
 
 	// boot flags
 	bool booted_;
+	// boot states of modules
+	std::vector<ModuleBootState> boot_states_;
+	// time spent in boot phases
+	TimingReport boot_timing_;
 
 	// firmwares and lock
 	std::map<std::string, xia::pixie::firmware::firmware_ref> firmwares_;
@@ -564,11 +945,42 @@ private:
 	// config
 	std::string config_path_;
 	Config config_;
+	RunNumberStore run_number_;
 
 	// run variables
 	std::vector<std::ofstream> run_output_streams_;
+	// output streams prepared in advance
+	std::mutex prepared_lock_;
+	std::vector<std::ofstream> prepared_streams_;
+	std::vector<std::shared_ptr<IndexWriter>> prepared_indexes_;
+	int prepared_run_;
+	unsigned short prepared_module_;
 	std::chrono::steady_clock::time_point run_start_time_;
-	static std::atomic<bool> keep_running_;
+	std::chrono::steady_clock::time_point run_stop_time_;
+	// bytes read from modules in this run
+	std::atomic<uint64_t> run_bytes_;
+	std::atomic<bool> keep_running_;
+	// writes data to files in background
+	DataWriter data_writer_;
+	// stages before writing, guarded by run_lock_
+	std::shared_ptr<EventFilter> event_filter_;
+	std::shared_ptr<TraceReducer> trace_reducer_;
+	// first stage of every run, never replaced so read without lock
+	std::shared_ptr<RateMonitor> rate_monitor_;
+	// samples run statistics between FIFO reads in the readout thread
+	StatsSampler stats_sampler_;
+	// fill levels of FIFO polled by the readout thread
+	FifoMonitor fifo_monitor_;
+
+	// run control, also guards the run number in config
+	mutable std::mutex run_lock_;
+	std::condition_variable run_cv_;
+	RunState run_state_;
+	int run_;
+	unsigned short run_module_;
+	std::exception_ptr run_error_;
+	// thread reads data from modules
+	std::thread run_thread_;
 };
 
 
@@ -576,9 +988,37 @@ private:
 ///
 /// @param[in] duration duration time in seconds
 /// @param[in] run run number to display, -1 not to display
+/// @param[in] fifo FIFO levels of modules in the run, empty not to display
+/// @param[in] marks fill marks of FIFO levels
 /// @returns run time information in string
 ///
-std::string RunTimeInfo(unsigned int duration, int run = -1);
+std::string RunTimeInfo(
+	unsigned int duration,
+	int run = -1,
+	const std::vector<FifoLevelStats> &fifo = {},
+	const std::vector<double> &marks = {}
+);
+
+
+/// @brief generate table of channel rates, a row for each module
+///
+/// @param[in] rates rates of channels
+/// @returns table of rates in string, empty if no rates
+///
+std::string ChannelRatesInfo(const std::vector<ChannelRate> &rates);
+
+
+/// @brief wait for the run of crate to finish, and stop the run if Ctrl+C is
+/// 	pressed
+///
+/// @param[in] crate crate running in list mode
+/// @param[in] rate_seconds print channel rates at this interval of seconds
+/// 	while waiting, 0 not to print
+/// @returns status of the finished run
+///
+/// @throws the error which stops the run
+///
+RunInfo WaitRunInterruptibly(Crate &crate, unsigned int rate_seconds = 0);
 
 
 /// @brief create vector of indexes for modules or channels
@@ -0,0 +1,178 @@
+#ifndef __DATA_WRITER_H__
+#define __DATA_WRITER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/pipeline.h"
+#include "include/run_index.h"
+
+namespace rxdaq {
+
+/// This class writes list mode data to files in its own thread, so the
+/// readout thread never waits for the disk. Data is queued in chunks, and
+/// writing blocks only when the queue is full. The streams must stay open
+/// until the chunks written to them are flushed. If a pipeline is set, data
+/// passes through it in the writing thread before written, and the index of
+/// the events is written if the stream has one. The words of an incomplete
+/// event left in the pipeline are written as they are when the data of the
+/// module in a stream ends, or when the writer stops.
+class DataWriter {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] capacity maximum number of chunks in queue
+	///
+	DataWriter(size_t capacity = 1024) noexcept;
+
+
+	/// @brief destructor, stop the thread
+	///
+	~DataWriter();
+
+
+	DataWriter(const DataWriter&) = delete;
+	DataWriter& operator=(const DataWriter&) = delete;
+
+
+	/// @brief set pipeline to process data before writing, only when the
+	/// 	writer is stopped
+	///
+	/// @param[in] pipeline pipeline, nullptr to write data as it is
+	///
+	void SetPipeline(std::shared_ptr<Pipeline> pipeline);
+
+
+	/// @brief attach index to stream, the events written to the stream are
+	/// 	added to the index, which needs the events decoded by pipeline
+	///
+	/// @param[in] stream stream to index
+	/// @param[in] index index writer of the stream
+	///
+	void AttachIndex(std::ofstream *stream, std::shared_ptr<IndexWriter> index);
+
+
+	/// @brief detach index from stream and close it, should be called after
+	/// 	data written to stream is flushed, do nothing if it has no index
+	///
+	/// @param[in] stream stream to detach index
+	///
+	/// @throws RXError if failed to write index
+	///
+	void DetachIndex(std::ofstream *stream);
+
+
+	/// @brief start the writing thread and reset the pipeline, do nothing if
+	/// 	it's running
+	///
+	void Start();
+
+
+	/// @brief queue data to write, block if the queue is full
+	///
+	/// @param[in] stream stream to write to
+	/// @param[in] module module of data
+	/// @param[in] words data to write
+	///
+	/// @throws RXError if previous writing failed or writer is not started
+	///
+	void Write(
+		std::ofstream *stream,
+		unsigned short module,
+		std::vector<uint32_t> &&words
+	);
+
+
+	/// @brief queue the end of data of a module in stream, the words of
+	/// 	incomplete event left in pipeline are written as they are
+	///
+	/// @param[in] stream stream of data
+	/// @param[in] module module of data
+	///
+	/// @throws RXError if previous writing failed or writer is not started
+	///
+	void EndStream(std::ofstream *stream, unsigned short module);
+
+
+	/// @brief wait until data queued before this call is written
+	///
+	/// @throws RXError if writing failed
+	///
+	void Flush();
+
+
+	/// @brief write all queued data and incomplete events, stop the thread
+	/// 	and close the indexes still attached
+	///
+	/// @throws RXError if writing failed
+	///
+	void Stop();
+
+
+	/// @brief get the number of chunks in queue
+	///
+	/// @returns number of chunks
+	///
+	size_t Pending() const;
+
+private:
+
+	/// chunk of data waiting to be written
+	struct Chunk {
+		std::ofstream *stream;
+		unsigned short module;
+		std::vector<uint32_t> words;
+		// end of data of module in stream
+		bool end;
+	};
+
+
+	/// @brief queue chunk, block if the queue is full
+	///
+	/// @param[in] chunk chunk to queue
+	///
+	/// @throws RXError if previous writing failed or writer is not started
+	///
+	void Push(Chunk &&chunk);
+
+
+	/// @brief process and write a chunk in the writing thread
+	///
+	/// @param[in] chunk chunk to write
+	/// @param[in] index index of stream, nullptr if not indexed
+	/// @returns false if failed to write
+	///
+	bool WriteChunk(Chunk &chunk, std::shared_ptr<IndexWriter> index);
+
+
+	/// @brief write chunks until stopped
+	///
+	void Loop();
+
+	size_t capacity_;
+	mutable std::mutex lock_;
+	std::condition_variable not_empty_;
+	std::condition_variable not_full_;
+	std::condition_variable written_cv_;
+	std::deque<Chunk> chunks_;
+	// number of chunks queued and written
+	uint64_t queued_;
+	uint64_t written_;
+	bool running_;
+	bool failed_;
+	std::thread thread_;
+	std::shared_ptr<Pipeline> pipeline_;
+	std::map<std::ofstream*, std::shared_ptr<IndexWriter>> indexes_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __DATA_WRITER_H__
@@ -0,0 +1,77 @@
+#ifndef __ENDPOINT_H__
+#define __ENDPOINT_H__
+
+#include <string>
+
+namespace rxdaq {
+
+// environment variable to choose the rpc endpoint, overrides config
+const char kEndpointVariable[] = "RXDAQ_ENDPOINT";
+// endpoint the rpc server listens on by default
+const std::string kServerEndpoint = "0.0.0.0:12300";
+// endpoint the client connects to by default
+const std::string kClientEndpoint = "localhost:12300";
+// prefix of unix domain socket endpoint, e.g. unix:/tmp/rxdaq.sock
+const std::string kUnixPrefix = "unix:";
+
+
+/// @brief check whether endpoint is a unix domain socket
+///
+/// @param[in] endpoint endpoint to check
+/// @returns true if it's a unix domain socket
+///
+bool IsUnixEndpoint(const std::string &endpoint) noexcept;
+
+
+/// @brief check endpoint format, unix:<path> or <host>:<port>
+///
+/// @param[in] endpoint endpoint to check
+/// @returns true if valid
+///
+bool CheckEndpoint(const std::string &endpoint) noexcept;
+
+
+/// @brief get the endpoint set by environment variable kEndpointVariable
+///
+/// @returns endpoint, empty if not set
+///
+/// @throws UserError if the endpoint is invalid
+///
+std::string EnvironmentEndpoint();
+
+
+/// @brief read rpcEndpoint from config file without checking the rest,
+/// 	so the client can find the server from the same config
+///
+/// @param[in] path path of config file
+/// @returns endpoint, empty if file or key doesn't exist or it's invalid
+///
+std::string ConfiguredEndpoint(const std::string &path) noexcept;
+
+
+/// @brief convert endpoint the server listens on to the one to connect,
+/// 	wildcard address becomes localhost
+///
+/// @param[in] endpoint endpoint of server
+/// @returns endpoint to connect
+///
+std::string ConnectEndpoint(const std::string &endpoint);
+
+
+/// @brief choose endpoint, environment variable first, then config, then
+/// 	the default
+///
+/// @param[in] configured endpoint in config, empty if not set
+/// @param[in] fallback default endpoint
+/// @returns endpoint chosen
+///
+/// @throws UserError if the environment variable is invalid
+///
+std::string ChooseEndpoint(
+	const std::string &configured,
+	const std::string &fallback
+);
+
+}		// namespace rxdaq
+
+#endif		// __ENDPOINT_H__
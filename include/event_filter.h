@@ -0,0 +1,222 @@
+#ifndef __EVENT_FILTER_H__
+#define __EVENT_FILTER_H__
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "include/config.h"
+#include "include/pipeline.h"
+
+namespace rxdaq {
+
+/// type of filter rule
+enum class FilterRuleType {
+	kChannel = 0,
+	kEnergy,
+	kMultiplicity,
+	kDownscale
+};
+
+
+/// a rule of event filter
+struct FilterRule {
+	FilterRuleType type;
+	// name to report counts
+	std::string name;
+	// module to apply, kModuleNum for all modules
+	unsigned short module;
+	// channel to apply, kChannelNum for all channels
+	unsigned short channel;
+	// channel rule, keep channels whose bits are set
+	uint16_t mask;
+	// energy rule, keep energy in [min_energy, max_energy]
+	uint16_t min_energy;
+	uint16_t max_energy;
+	// multiplicity and downscale rule, coincidence window in timestamp ticks
+	uint64_t window;
+	// multiplicity rule, keep events with at least this number of events in
+	// the window, including itself
+	unsigned int multiplicity;
+	// downscale rule, keep one of this number of singles
+	unsigned int factor;
+};
+
+
+/// events accepted and rejected by a rule
+struct FilterCount {
+	std::string name;
+	uint64_t accepted;
+	uint64_t rejected;
+};
+
+
+/// @brief parse filter rules from json
+///
+/// The rules look like
+/// {
+/// 	"rules": [
+/// 		{"type": "channel", "module": 0, "mask": 255},
+/// 		{"type": "energy", "module": 0, "channel": 3, "min": 100, "max": 30000},
+/// 		{"type": "multiplicity", "window": 100, "min": 2},
+/// 		{"type": "downscale", "window": 100, "factor": 10, "name": "singles"}
+/// 	]
+/// }
+/// Module is 13(all modules) and channel is 16(all channels) by default.
+///
+/// @param[in] json json of rules
+/// @returns rules
+///
+/// @throws UserError if the rules are invalid
+///
+std::vector<FilterRule> ParseFilterRules(const nlohmann::json &json);
+
+
+/// @brief read filter rules from json file
+///
+/// @param[in] path path of rules file
+/// @returns rules
+///
+/// @throws UserError if failed to read file or the rules are invalid
+///
+std::vector<FilterRule> ReadFilterRules(const std::string &path);
+
+
+/// This class is a pipeline stage dropping the events we don't want to
+/// write. Rules are applied in order, and an event is kept only if all
+/// rules accept it. Each rule sees the events kept by the previous rules.
+/// Multiplicity is counted among the events of the same module, so the
+/// coincidence is limited in one module. To count the neighbours across
+/// reads, an event is held back until events later than it by the sum of
+/// the windows of a module are read, and the decided events stay in the
+/// windows of the next blocks. So the result doesn't depend on how the
+/// data is split into blocks, as long as the events of a module are in
+/// time order within the windows.
+class EventFilter : public Stage {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] rules rules to apply in order
+	///
+	EventFilter(const std::vector<FilterRule> &rules);
+
+
+	/// @brief default destructor
+	///
+	virtual ~EventFilter() = default;
+
+
+	/// @brief get name of stage
+	///
+	/// @returns name of stage 'filter'
+	///
+	inline virtual std::string Name() const override {
+		return "filter";
+	}
+
+
+	/// @brief mark the events rejected by rules
+	///
+	/// @param[in,out] block block to filter
+	///
+	virtual void Process(DataBlock &block) override;
+
+
+	/// @brief decide the events held back at the end of data of a module
+	///
+	/// @param[in,out] block block to filter
+	///
+	virtual void Flush(DataBlock &block) override;
+
+
+	/// @brief clear counts, downscale counters and events held back
+	///
+	virtual void Reset() override;
+
+
+	/// @brief get accepted and rejected counts of rules
+	///
+	/// @returns counts in the same order of rules
+	///
+	std::vector<FilterCount> Counts() const;
+
+private:
+
+	/// events of a module waiting for or staying in the windows
+	struct ModuleWindows {
+		// raw words of events held back
+		std::vector<uint32_t> held;
+		// time of decided events seen by each rule, for windows of the next
+		// blocks
+		std::vector<std::deque<uint64_t>> decided;
+		// latest time of the events read
+		uint64_t latest = 0;
+		// how far the events read came later than the latest time before
+		uint64_t disorder = 0;
+	};
+
+
+	/// @brief apply rules to the events held back and the block
+	///
+	/// @param[in,out] block block to filter
+	/// @param[in] end true to decide all events at the end of data
+	///
+	void Apply(DataBlock &block, bool end);
+
+
+	/// @brief apply channel mask rule
+	///
+	/// @param[in] rule rule to apply
+	/// @param[in,out] block block to apply
+	///
+	void ApplyChannel(const FilterRule &rule, DataBlock &block) const;
+
+
+	/// @brief apply energy window rule
+	///
+	/// @param[in] rule rule to apply
+	/// @param[in,out] block block to apply
+	///
+	void ApplyEnergy(const FilterRule &rule, DataBlock &block) const;
+
+
+	/// @brief count the kept events in window of each kept event
+	///
+	/// @param[in] window coincidence window
+	/// @param[in] block block to count
+	/// @param[in] decided time of decided events of the previous blocks
+	///
+	void CountNeighbours(
+		uint64_t window,
+		const DataBlock &block,
+		const std::deque<uint64_t> &decided
+	);
+
+
+	std::vector<FilterRule> rules_;
+	std::map<unsigned short, ModuleWindows> windows_;
+	// singles seen by downscale rules
+	std::vector<uint64_t> singles_;
+
+	mutable std::mutex counts_lock_;
+	std::vector<FilterCount> counts_;
+
+	// reused buffers for multiplicity
+	std::vector<uint32_t> order_;
+	std::vector<uint32_t> neighbours_;
+	std::vector<uint64_t> past_;
+	// keep flags at the entry and before a rule, 1 for decided events
+	std::vector<uint8_t> entry_;
+	std::vector<uint8_t> before_;
+	std::vector<uint8_t> final_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __EVENT_FILTER_H__
@@ -0,0 +1,87 @@
+#ifndef __EVENT_SORT_H__
+#define __EVENT_SORT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rxdaq {
+
+// default memory budget of sorting, 1 GiB
+const size_t kDefaultSortMemory = size_t(1) << 30;
+// smallest buffer of a sorted run in merging, larger than the longest event
+const size_t kMinMergeBuffer = size_t(64) << 10;
+// most runs merged at once
+const size_t kMaxMergeFanIn = 256;
+
+
+/// key of event to sort
+struct SortKey {
+	// 48 bits timestamp
+	uint64_t time;
+	// offset and words of event in data
+	uint64_t offset;
+	uint32_t length;
+};
+
+
+/// @brief sort keys by timestamp with LSD radix sort on 16 bits digits, the
+/// 	order of events with the same timestamp is kept
+///
+/// @param[in,out] keys keys to sort
+///
+void RadixSortKeys(std::vector<SortKey> &keys);
+
+
+/// options of sorting
+struct SortOptions {
+	// memory for buffers in bytes
+	size_t memory;
+	// directory of temporary sorted runs, empty to use the directory of output
+	std::string temp_directory;
+	// number of threads generating sorted runs, 0 to use all cores
+	unsigned int threads;
+};
+
+
+/// summary of sorting
+struct SortResult {
+	uint64_t files;
+	uint64_t events;
+	uint64_t bytes;
+	// sorted runs generated and merge passes
+	uint64_t runs;
+	uint64_t passes;
+	// time of the two phases
+	double generate_seconds;
+	double merge_seconds;
+};
+
+
+/// @brief sort events of data files by timestamp into one file, with
+/// 	bounded memory
+///
+/// The data files are split into chunks fitting the memory. Chunks are
+/// sorted by radix sort in parallel and written to temporary files as
+/// sorted runs. Then the runs are merged with a heap, reading and writing
+/// in large blocks. If there are too many runs to merge at once, they are
+/// merged in several passes. Events with the same timestamp are kept in the
+/// order of files.
+///
+/// @param[in] files data files written in raw or packed format
+/// @param[in] output path of sorted file
+/// @param[in] options memory budget, temporary directory and threads
+/// @returns summary of sorting
+///
+/// @throws RXError if failed to read or write files, or data is invalid
+///
+SortResult SortRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	const SortOptions &options
+);
+
+}		// namespace rxdaq
+
+#endif		// __EVENT_SORT_H__
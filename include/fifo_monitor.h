@@ -0,0 +1,130 @@
+#ifndef __FIFO_MONITOR_H__
+#define __FIFO_MONITOR_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/config.h"
+
+namespace rxdaq {
+
+// words of the external FIFO of a module
+const size_t kFifoWords = 131072;
+// bins of the fill level histogram, each covers 10% of FIFO
+const size_t kFifoLevelBins = 10;
+// minimum seconds between two warnings of a module at the same mark
+const double kFifoWarningSeconds = 10.0;
+
+
+/// fill levels of the FIFO of a module polled in a run
+struct FifoLevelStats {
+	unsigned short module;
+	// polls by fill level, bin i for [i*10%, (i+1)*10%), full FIFO in the
+	// last bin
+	std::array<uint64_t, kFifoLevelBins> polls;
+	// the highest fill level in fraction of FIFO
+	double max_fill;
+	// seconds spent at or above each mark
+	std::vector<double> seconds_above;
+};
+
+
+/// This class tracks the fill levels of module FIFO polled by the readout.
+/// It keeps histograms of fill level, the highest level and the time spent
+/// at or above the fill marks, and tells when a module crosses a mark so the
+/// readout can warn that it's falling behind. The time above a mark is
+/// counted from a poll at or above the mark to the next poll of the module.
+/// The counters are atomic, so the statistics can be read while the readout
+/// is running. Only the readout thread should call Record.
+class FifoMonitor {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] capacity words of FIFO
+	///
+	FifoMonitor(size_t capacity = kFifoWords) noexcept;
+
+
+	/// @brief clear statistics and restart the clock before a run
+	///
+	/// @param[in] marks ascending fill marks in fraction of FIFO, at most
+	/// 	kMaxFifoMarks are used
+	///
+	void Reset(const std::vector<double> &marks);
+
+
+	/// @brief record a poll of FIFO level at the current time
+	///
+	/// @param[in] module module polled
+	/// @param[in] words words in FIFO
+	/// @returns index of the mark crossed upward to warn, -1 not to warn
+	///
+	int Record(unsigned short module, size_t words);
+
+
+	/// @brief record a poll of FIFO level
+	///
+	/// @param[in] module module polled
+	/// @param[in] words words in FIFO
+	/// @param[in] seconds time since reset
+	/// @returns index of the mark crossed upward to warn, -1 not to warn
+	///
+	int Record(unsigned short module, size_t words, double seconds);
+
+
+	/// @brief get statistics of the polled modules
+	///
+	/// @returns statistics ordered by module
+	///
+	std::vector<FifoLevelStats> Stats() const;
+
+
+	/// @brief get fill marks
+	///
+	/// @returns marks in fraction of FIFO
+	///
+	inline const std::vector<double>& Marks() const noexcept {
+		return marks_;
+	}
+
+private:
+
+	/// FIFO levels of a module
+	struct ModuleLevels {
+		std::array<std::atomic<uint64_t>, kFifoLevelBins> polls;
+		std::atomic<uint64_t> max_words;
+		std::array<std::atomic<uint64_t>, kMaxFifoMarks> nanoseconds_above;
+		// the last poll and warning, used by the readout thread only
+		double last_time;
+		size_t last_marks;
+		size_t warned_marks;
+		double warned_time;
+	};
+
+	size_t capacity_;
+	std::vector<double> marks_;
+	std::chrono::steady_clock::time_point start_;
+	std::array<ModuleLevels, kModuleNum> modules_;
+};
+
+
+/// @brief generate summary of FIFO levels, a row for each module
+///
+/// @param[in] stats statistics of modules
+/// @param[in] marks fill marks of statistics
+/// @returns summary in string, empty if no statistics
+///
+std::string FifoLevelInfo(
+	const std::vector<FifoLevelStats> &stats,
+	const std::vector<double> &marks
+);
+
+}		// namespace rxdaq
+
+#endif		// __FIFO_MONITOR_H__
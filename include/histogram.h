@@ -0,0 +1,337 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+
+namespace rxdaq {
+
+/// This class is a 1D or 2D histogram with fixed width bins. The counts
+/// include an underflow and an overflow bin on each axis.
+class Histogram {
+public:
+
+	/// @brief constructor of 1D histogram
+	///
+	/// @param[in] name name of histogram
+	/// @param[in] x_bins number of bins
+	/// @param[in] x_min lower edge of the first bin
+	/// @param[in] x_max upper edge of the last bin
+	///
+	Histogram(
+		const std::string &name,
+		uint32_t x_bins,
+		double x_min,
+		double x_max
+	);
+
+
+	/// @brief constructor of 2D histogram
+	///
+	/// @param[in] name name of histogram
+	/// @param[in] x_bins number of bins on x axis
+	/// @param[in] x_min lower edge of x axis
+	/// @param[in] x_max upper edge of x axis
+	/// @param[in] y_bins number of bins on y axis
+	/// @param[in] y_min lower edge of y axis
+	/// @param[in] y_max upper edge of y axis
+	///
+	Histogram(
+		const std::string &name,
+		uint32_t x_bins,
+		double x_min,
+		double x_max,
+		uint32_t y_bins,
+		double y_min,
+		double y_max
+	);
+
+
+	/// @brief fill value to 1D histogram
+	///
+	/// @param[in] x value
+	///
+	inline void Fill(double x) noexcept {
+		++counts_[XBin(x)];
+	}
+
+
+	/// @brief fill value to 2D histogram
+	///
+	/// @param[in] x value on x axis
+	/// @param[in] y value on y axis
+	///
+	inline void Fill(double x, double y) noexcept {
+		++counts_[YBin(y) * (x_bins_ + 2) + XBin(x)];
+	}
+
+
+	/// @brief add counts of another histogram with the same bins
+	///
+	/// @param[in] other histogram to add
+	///
+	/// @throws RXError if the bins are different
+	///
+	void Add(const Histogram &other);
+
+
+	inline const std::string& Name() const noexcept {
+		return name_;
+	}
+
+	inline uint32_t XBins() const noexcept {
+		return x_bins_;
+	}
+
+	inline double XMin() const noexcept {
+		return x_min_;
+	}
+
+	inline double XMax() const noexcept {
+		return x_max_;
+	}
+
+	/// 0 for 1D histogram
+	inline uint32_t YBins() const noexcept {
+		return y_bins_;
+	}
+
+	inline double YMin() const noexcept {
+		return y_min_;
+	}
+
+	inline double YMax() const noexcept {
+		return y_max_;
+	}
+
+
+	/// @brief get counts, bin 0 is underflow and bin bins+1 is overflow,
+	/// 	rows of y bins for 2D histogram
+	///
+	/// @returns counts
+	///
+	inline const std::vector<uint64_t>& Counts() const noexcept {
+		return counts_;
+	}
+
+
+	/// @brief replace counts, e.g. counts read from file
+	///
+	/// @param[in] counts counts in the layout of Counts()
+	///
+	/// @throws RXError if the size is different
+	///
+	void SetCounts(std::vector<uint64_t> &&counts);
+
+
+	/// @brief get count of bin
+	///
+	/// @param[in] x bin on x axis, 1 for the first bin
+	/// @param[in] y bin on y axis, 0 for 1D histogram
+	/// @returns count
+	///
+	inline uint64_t Count(uint32_t x, uint32_t y = 0) const noexcept {
+		return counts_[size_t(y) * (x_bins_ + 2) + x];
+	}
+
+private:
+
+	/// @brief get bin of value on x axis
+	///
+	/// @param[in] x value
+	/// @returns bin including underflow and overflow
+	///
+	inline size_t XBin(double x) const noexcept {
+		if (!(x >= x_min_)) return 0;
+		if (x >= x_max_) return x_bins_ + 1;
+		return size_t((x - x_min_) * x_scale_) + 1;
+	}
+
+
+	/// @brief get bin of value on y axis
+	///
+	/// @param[in] y value
+	/// @returns bin including underflow and overflow
+	///
+	inline size_t YBin(double y) const noexcept {
+		if (!(y >= y_min_)) return 0;
+		if (y >= y_max_) return y_bins_ + 1;
+		return size_t((y - y_min_) * y_scale_) + 1;
+	}
+
+
+	std::string name_;
+	uint32_t x_bins_;
+	double x_min_;
+	double x_max_;
+	double x_scale_;
+	uint32_t y_bins_;
+	double y_min_;
+	double y_max_;
+	double y_scale_;
+	std::vector<uint64_t> counts_;
+};
+
+
+/// settings of histograms
+struct HistogramOptions {
+	// bins of energy histograms over [0, 65536)
+	uint32_t energy_bins;
+	// QDC sum to histogram, 0 to 7
+	uint32_t qdc_gate;
+	// bins and upper edge of QDC histograms
+	uint32_t qdc_bins;
+	double qdc_max;
+	// coincidence window in ticks of timestamp, events are paired if
+	// their difference is less than window
+	uint64_t window;
+	// bins of timestamp difference over [-window, window)
+	uint32_t time_bins;
+	// bins of each axis of energy-energy coincidence
+	uint32_t coincidence_bins;
+	// number of threads, 0 to use all cores
+	unsigned int threads;
+	// words of data file in a chunk
+	size_t chunk_words;
+};
+
+
+/// @brief get the default settings of histograms
+///
+/// @returns default settings
+///
+HistogramOptions DefaultHistogramOptions() noexcept;
+
+
+/// This class holds the histograms filled from events: energy and QDC of
+/// each channel, timestamp difference and energy-energy of the events in
+/// coincidence window. Channel histograms are created when the channel
+/// first appears. Each thread fills its own set, and the sets are merged
+/// at the end.
+class HistogramSet {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] options settings of histograms
+	///
+	HistogramSet(const HistogramOptions &options);
+
+
+	/// @brief fill events
+	///
+	/// Events are paired with the following events within the window in
+	/// the order of data, so the data should be sorted or approximately
+	/// sorted by timestamp.
+	///
+	/// @param[in] events decoded events
+	/// @param[in] words list mode data of events
+	///
+	void Fill(const EventBatch &events, const uint32_t *words);
+
+
+	/// @brief add histograms of another set
+	///
+	/// @param[in] other set to add
+	///
+	void Add(const HistogramSet &other);
+
+
+	/// @brief get all histograms, channels in order of crate, slot and
+	/// 	channel
+	///
+	/// @returns pointers to histograms
+	///
+	std::vector<const Histogram*> Histograms() const;
+
+
+	/// @brief get number of events filled
+	///
+	/// @returns events
+	///
+	inline uint64_t Events() const noexcept {
+		return events_;
+	}
+
+private:
+
+	/// @brief get or create histograms of channel
+	///
+	/// @param[in] key key of crate, slot and channel
+	///
+	void CreateChannel(size_t key);
+
+
+	HistogramOptions options_;
+	uint64_t events_;
+	// indexed by crate, slot and channel
+	std::vector<std::unique_ptr<Histogram>> energy_;
+	std::vector<std::unique_ptr<Histogram>> qdc_;
+	Histogram time_difference_;
+	Histogram coincidence_;
+};
+
+
+/// @brief fill histograms from data files in parallel, files are split into
+/// 	chunks at event boundaries and threads steal chunks from each other
+///
+/// @param[in] files data files
+/// @param[in] options settings of histograms
+/// @returns filled histograms
+///
+/// @throws RXError if failed to read files or data is invalid
+///
+HistogramSet FillHistograms(
+	const std::vector<std::string> &files,
+	const HistogramOptions &options
+);
+
+
+/// @brief write histograms in binary format
+///
+/// The file starts with "RXHS", version and number of histograms. Each
+/// histogram has length of name, name, bins, minimum and maximum of x and
+/// y axis, followed by the counts including underflow and overflow.
+///
+/// @param[in] path path of file
+/// @param[in] histograms histograms to write
+///
+/// @throws RXError if failed to write
+///
+void WriteHistograms(
+	const std::string &path,
+	const std::vector<const Histogram*> &histograms
+);
+
+
+/// @brief read histograms in binary format
+///
+/// @param[in] path path of file
+/// @returns histograms
+///
+/// @throws RXError if failed to read or it's not a histogram file
+///
+std::vector<Histogram> ReadHistograms(const std::string &path);
+
+
+/// @brief write non-empty bins of histograms in CSV format, with columns
+/// 	name, x, y and count, where x and y are lower edges of bins
+///
+/// @param[in] path path of file
+/// @param[in] histograms histograms to write
+///
+/// @throws RXError if failed to write
+///
+void WriteHistogramsCsv(
+	const std::string &path,
+	const std::vector<const Histogram*> &histograms
+);
+
+}		// namespace rxdaq
+
+#endif		// __HISTOGRAM_H__
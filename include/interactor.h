@@ -1,9 +1,17 @@
 #ifndef __INTERACTOR_H__
 #define __INTERACTOR_H__
 
+#include <istream>
 #include <string>
+#include <vector>
 
+#include "include/columnar.h"
 #include "include/crate.h"
+#include "include/event_sort.h"
+#include "include/histogram.h"
+#include "include/replay.h"
+#include "include/run_index.h"
+#include "include/verify.h"
 #include "cxxopts.hpp"
 
 #include <grpcpp/grpcpp.h>
@@ -27,7 +35,21 @@ public:
 		kWriteCommandParser,
 		kImportCommandParser,
 		kExportCommandParser,
-		kRunCommandParser
+		kRunCommandParser,
+		kTraceCommandParser,
+		kShellCommandParser,
+		kBatchCommandParser,
+		kStatusCommandParser,
+		kStopCommandParser,
+		kFilterCommandParser,
+		kReduceCommandParser,
+		kQueryCommandParser,
+		kConvertCommandParser,
+		kSortCommandParser,
+		kHistCommandParser,
+		kVerifyCommandParser,
+		kReplayCommandParser,
+		kStatsCommandParser
 	};
 
 
@@ -90,6 +112,26 @@ public:
 	virtual void Run(std::shared_ptr<Crate> crate = nullptr) = 0;
 
 
+	/// @brief check whether the interactor controls crate, offline
+	/// 	interactors only work on data files
+	///
+	/// @returns true if crate is needed
+	///
+	inline virtual bool NeedCrate() const noexcept {
+		return true;
+	}
+
+
+	/// @brief get the config file of the crate, clients find the rpc server
+	/// 	from rpcEndpoint in it
+	///
+	/// @returns path of config file
+	///
+	inline virtual std::string ConfigPath() const noexcept {
+		return "config.json";
+	}
+
+
 	/// @brief get the help information of this interactor
 	///
 	/// @returns empty string
@@ -215,6 +257,9 @@ private:
 	std::string config_path_;
 	std::string host_;
 	std::string port_;
+	// endpoint set in command line, empty to choose from environment and config
+	std::string endpoint_;
+	int metrics_port_;
 
 	static std::unique_ptr<grpc::Server> server_;
 };
@@ -251,6 +296,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get boot information
 	///
 	/// @param[in] argc number of arguments
@@ -270,6 +324,8 @@ public:
 private:
 	std::string config_path_;
 	int module_;
+	bool force_;
+	bool dry_run_;
 };
 
 
@@ -303,6 +359,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -375,6 +440,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -429,6 +503,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -483,6 +566,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -534,6 +626,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -586,6 +687,15 @@ public:
 	virtual std::string Help() const noexcept override;
 
 
+	/// @brief get the config file of the crate
+	///
+	/// @returns path of config file from the arguments
+	///
+	inline virtual std::string ConfigPath() const noexcept override {
+		return config_path_;
+	}
+
+
 	/// @brief parse the arguments and get read information
 	///
 	/// @param[in] argc number of arguments
@@ -605,10 +715,868 @@ private:
 	int module_;
 	int seconds_;
 	int run_;
+	// roll to next run in continuous mode if time or size is set
+	RollPolicy roll_;
+	// return after the run starts
+	bool detach_;
+	// interval to print channel rates while waiting, 0 not to print
+	int rate_seconds_;
+};
+
+
+
+/// This class parse the options of subcommand status, and display the status
+/// of the current or last list mode run.
+class StatusCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	StatusCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~StatusCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'status'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "status";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and display run status
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// wait for the run to finish
+	bool wait_;
+};
+
+
+
+/// This class parse the options of subcommand stop, and stop the list mode
+/// run started by any client.
+class StopCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	StopCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~StopCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'stop'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "stop";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and stop the run
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// wait for the run to finish
+	bool wait_;
+};
+
+
+
+/// This class parse the options of subcommand stats, and display the
+/// latencies, calls in flight and errors of RPC handled by the server.
+class StatsCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	StatsCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~StatsCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'stats'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "stats";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and display RPC statistics
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// only display this method, empty for all
+	std::string method_;
+};
+
+
+
+/// This class parse the options of subcommand filter, and set or turn off
+/// the event filter, or display the counts of filter rules.
+class FilterCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	FilterCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~FilterCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'filter'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "filter";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and set filter or display counts
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// path of rules file
+	std::string path_;
+	// turn off the filter
+	bool off_;
+};
+
+
+
+/// This class parse the options of subcommand reduce, and set or turn off
+/// the trace reduction, or display the statistics of reduction.
+class ReduceCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	ReduceCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~ReduceCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'reduce'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "reduce";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and set reduction or display statistics
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// set reduction, or display statistics if false
+	bool set_;
+	bool enable_;
+	TraceReduction reduction_;
 };
 
 
 
+/// This class parse the options of subcommand query, and find events in a
+/// data file by timestamp and channel through its index. It works offline
+/// without crate.
+class QueryCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	QueryCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~QueryCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'query'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "query";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief query doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and query events
+	///
+	/// @param[in] crate not used
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	std::string path_;
+	IndexQuery query_;
+	// file to write matching events, empty to print them
+	std::string output_;
+	// events to print
+	unsigned int print_;
+};
+
+
+
+/// This class parse the options of subcommand convert, and convert data
+/// files of a run into columnar chunk files in parallel. It works offline
+/// without crate.
+class ConvertCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	ConvertCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~ConvertCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'convert'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "convert";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief convert doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and convert files
+	///
+	/// @param[in] crate not used
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// data files or run directories
+	std::vector<std::string> inputs_;
+	std::string output_;
+	unsigned int threads_;
+	size_t chunk_words_;
+};
+
+
+
+/// This class parse the options of subcommand sort, and sort events of data
+/// files by timestamp into one file with bounded memory. It works offline
+/// without crate.
+class SortCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	SortCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~SortCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'sort'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "sort";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief sort doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and sort events
+	///
+	/// @param[in] crate not used
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// data files or run directories
+	std::vector<std::string> inputs_;
+	std::string output_;
+	SortOptions sort_options_;
+};
+
+
+
+/// This class parse the options of subcommand hist, and fill histograms of
+/// data files in parallel. It works offline without crate.
+class HistCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	HistCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~HistCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'hist'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "hist";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief hist doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and fill histograms
+	///
+	/// @param[in] crate not used
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// data files or run directories
+	std::vector<std::string> inputs_;
+	// output files are prefix.rxh and prefix.csv
+	std::string output_;
+	HistogramOptions histogram_options_;
+};
+
+
+
+/// This class parse the options of subcommand verify, and check framing,
+/// crate, slot and timestamps of events in data files. It works offline
+/// without crate.
+class VerifyCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	VerifyCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~VerifyCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'verify'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "verify";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief verify doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and verify data files
+	///
+	/// @param[in] crate not used
+	///
+	/// @throws RXError if any file has problem
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// data files or run directories
+	std::vector<std::string> inputs_;
+	// config to check crate and slots, empty to skip
+	std::string config_path_;
+	VerifyOptions verify_options_;
+};
+
+
+
+/// This class parse the options of subcommand replay, and replay recorded
+/// data files through the pipeline of list mode run. It works offline
+/// without crate.
+class ReplayCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	ReplayCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~ReplayCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'replay'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "replay";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief replay doesn't need crate
+	///
+	/// @returns false
+	///
+	inline virtual bool NeedCrate() const noexcept override {
+		return false;
+	}
+
+
+	/// @brief parse the arguments
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and replay data files
+	///
+	/// @param[in] crate not used
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	// data files or run directories
+	std::vector<std::string> inputs_;
+	std::string output_;
+	// filter rules file, empty if not used
+	std::string filter_path_;
+	ReplayOptions replay_options_;
+};
+
+
+
+/// This class parse the options of subcommand trace, and start or stop
+/// tracing in the crate.
+class TraceCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	TraceCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~TraceCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'trace'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "trace";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments and get trace action
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and start or stop tracing
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	bool start_;
+	std::string path_;
+};
+
+
+
+/// This class runs an interactive shell. It reads commands from terminal or
+/// command files line by line and runs them with the same crate, so the
+/// connection to the rpc server is kept between commands.
+class ShellCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	ShellCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~ShellCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'shell'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "shell";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments and get command files
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run commands from terminal or command files
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	/// @throws UserError if failed to open file or any command in files
+	/// 	failed
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+
+	/// @brief parse and run a line of command
+	///
+	/// @param[in] line command line without program name
+	/// @param[in] crate pointer to crate object
+	///
+	/// @throws UserError if the command is invalid, or any error thrown by
+	/// 	the command
+	///
+	void RunCommand(const std::string &line, std::shared_ptr<Crate> crate);
+
+private:
+
+	/// @brief run commands from stream until the end or exit command
+	///
+	/// @param[in] is stream to read commands
+	/// @param[in] crate pointer to crate object
+	/// @param[in] interactive whether to show prompt
+	/// @returns number of failed commands
+	///
+	size_t RunStream(
+		std::istream &is,
+		std::shared_ptr<Crate> crate,
+		bool interactive
+	);
+
+	std::vector<std::string> files_;
+	bool exit_;
+};
+
+
+/// This class parse the options of subcommand batch and execute the batch
+/// plan in file.
+class BatchCommandParser : public Interactor {
+public:
+
+	/// @brief constructor
+	///
+	BatchCommandParser() noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~BatchCommandParser() = default;
+
+
+	/// @brief get command name
+	///
+	/// @returns command name 'batch'
+	///
+	inline virtual std::string CommandName() const noexcept override {
+		return "batch";
+	}
+
+
+	/// @brief get help information
+	///
+	/// @returns help information
+	///
+	virtual std::string Help() const noexcept override;
+
+
+	/// @brief parse the arguments and get plan file
+	///
+	/// @param[in] argc number of arguments
+	/// @param[in] argv arguments list
+	///
+	virtual void Parse(int argc, char **argv) override;
+
+
+	/// @brief run the interactor and execute the plan
+	///
+	/// @param[in] crate pointer to crate object
+	///
+	/// @throws UserError if the plan is invalid or any step failed
+	///
+	virtual void Run(std::shared_ptr<Crate> crate) override;
+
+private:
+	std::string path_;
+};
+
+
+/// @brief split command line into arguments by white spaces, quoted
+/// 	arguments can contain spaces
+///
+/// @param[in] line command line to split
+/// @returns arguments
+///
+/// @throws UserError if quotes don't match
+///
+std::vector<std::string> SplitCommandLine(const std::string &line);
+
+
+
 }		// namespace rxdaq
 
 #endif				// __INTERACTOR_H__
\ No newline at end of file
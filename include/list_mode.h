@@ -0,0 +1,112 @@
+#ifndef __LIST_MODE_H__
+#define __LIST_MODE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rxdaq {
+
+// fields of Pixie-16 list mode event header
+namespace list_mode {
+	// word 0
+	const uint32_t kChannelMask = 0xf;
+	const uint32_t kSlotShift = 4;
+	const uint32_t kSlotMask = 0xf;
+	const uint32_t kCrateShift = 8;
+	const uint32_t kCrateMask = 0xf;
+	const uint32_t kHeaderLengthShift = 12;
+	const uint32_t kHeaderLengthMask = 0x1f;
+	const uint32_t kEventLengthShift = 17;
+	const uint32_t kEventLengthMask = 0x3fff;
+	const uint32_t kFinishCodeShift = 31;
+	// word 2
+	const uint32_t kTimeHighMask = 0xffff;
+	const uint32_t kCfdShift = 16;
+	// word 3
+	const uint32_t kEnergyMask = 0xffff;
+	const uint32_t kTraceLengthShift = 16;
+	const uint32_t kTraceLengthMask = 0x7fff;
+	const uint32_t kTraceOutOfRangeShift = 31;
+
+	// minimum words of header
+	const uint32_t kMinHeaderLength = 4;
+}
+
+
+/// Decoded list mode events in structure of arrays, so rules can be applied
+/// to a whole column in tight loops. The raw words are kept outside and
+/// located by offset and length.
+struct EventBatch {
+	// offset of the first word in raw data
+	std::vector<uint32_t> offset;
+	// words of the whole event
+	std::vector<uint32_t> length;
+	// words of header
+	std::vector<uint8_t> header_length;
+	std::vector<uint8_t> crate;
+	std::vector<uint8_t> slot;
+	std::vector<uint8_t> channel;
+	// pileup or out of range
+	std::vector<uint8_t> finish_code;
+	// 48 bits timestamp
+	std::vector<uint64_t> time;
+	// raw CFD fraction word
+	std::vector<uint16_t> cfd;
+	std::vector<uint16_t> energy;
+	// samples of trace
+	std::vector<uint16_t> trace_length;
+
+
+	/// @brief get number of events
+	///
+	/// @returns number of events
+	///
+	inline size_t Size() const noexcept {
+		return offset.size();
+	}
+
+
+	/// @brief remove all events
+	///
+	void Clear() noexcept;
+};
+
+
+/// @brief decode complete events in list mode data and append to batch
+///
+/// @param[in] words list mode data
+/// @param[in] size number of words
+/// @param[out] batch batch to append events
+/// @returns number of words of complete events, the rest is the beginning
+/// 	of an incomplete event
+///
+/// @throws RXError if the header is invalid
+///
+size_t DecodeListMode(const uint32_t *words, size_t size, EventBatch &batch);
+
+
+/// @brief encode the header words of an event, for tests and tools
+///
+/// @param[in] crate crate id
+/// @param[in] slot slot id
+/// @param[in] channel channel id
+/// @param[in] time 48 bits timestamp
+/// @param[in] energy energy
+/// @param[in] trace_length samples of trace, should be even
+/// @param[in] header_length words of header, at least 4
+/// @returns header words
+///
+std::vector<uint32_t> EncodeListModeHeader(
+	uint8_t crate,
+	uint8_t slot,
+	uint8_t channel,
+	uint64_t time,
+	uint16_t energy,
+	uint16_t trace_length = 0,
+	uint8_t header_length = list_mode::kMinHeaderLength
+);
+
+}		// namespace rxdaq
+
+#endif		// __LIST_MODE_H__
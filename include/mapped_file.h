@@ -0,0 +1,83 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rxdaq {
+
+/// This class maps a data file into memory read only, so offline tools can
+/// read list mode data in place from several threads without copying.
+class MappedFile {
+public:
+
+	/// @brief constructor, map the whole file
+	///
+	/// @param[in] path path of file
+	///
+	/// @throws RXError if failed to open or map the file
+	///
+	MappedFile(const std::string &path);
+
+
+	/// @brief destructor, unmap the file
+	///
+	~MappedFile();
+
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+
+	/// @brief get path of file
+	///
+	/// @returns path
+	///
+	inline const std::string& Path() const noexcept {
+		return path_;
+	}
+
+
+	/// @brief get size of file
+	///
+	/// @returns size in bytes
+	///
+	inline size_t Size() const noexcept {
+		return size_;
+	}
+
+
+	/// @brief get words of file, the bytes after the last whole word are
+	/// 	ignored
+	///
+	/// @returns pointer to the first word, nullptr if file is empty
+	///
+	inline const uint32_t* Words() const noexcept {
+		return static_cast<const uint32_t*>(data_);
+	}
+
+
+	/// @brief get number of whole words
+	///
+	/// @returns words
+	///
+	inline size_t WordSize() const noexcept {
+		return size_ / sizeof(uint32_t);
+	}
+
+
+	/// @brief tell the kernel the file will be read sequentially, so pages
+	/// 	are read ahead aggressively
+	///
+	void AdviseSequential() const noexcept;
+
+private:
+	std::string path_;
+	void *data_;
+	size_t size_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __MAPPED_FILE_H__
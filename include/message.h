@@ -1,12 +1,18 @@
 #ifndef __MESSAGE_H__
 #define __MESSAGE_H__
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <sstream>
 
 namespace rxdaq {
 
+class Message;
+
 
 class MessageOstream {
 public:
@@ -14,24 +20,28 @@ public:
 	/// @brief constructor
 	///
 	/// @param[in] os ostream to write message
-	/// @param[in] print whether to print message(since level control)
-	/// @param[in] lock reference to lock of Message object
+	/// @param[in] message message object, nullptr if the message is filtered
+	/// 	out by level
 	/// @param[in] prefix prefix of message
 	///
 	MessageOstream(
 		std::ostream &os,
-		bool print,
-		std::mutex &lock,
+		const Message *message,
 		const std::string &prefix
 	);
 
-	
-	/// @brief default destructor
+
+	/// @brief destructor, write the whole message or send it to the
+	/// 	asynchronous sink
 	///
-	~MessageOstream() = default;
+	~MessageOstream();
+
+
+	MessageOstream(const MessageOstream&) = delete;
+	MessageOstream& operator=(const MessageOstream&) = delete;
 
 
-	/// @brief write message to ostream
+	/// @brief write message to buffer
 	///
 	/// @tparam OutputType type of output content
 	/// @param[in] content content to output
@@ -39,15 +49,18 @@ public:
 	///
 	template <typename OutputType>
 	MessageOstream& operator<<(const OutputType &content) {
-		if (print_) os_ << content;
+		if (buffer_) *buffer_ << content;
 		return *this;
 	}
 
 private:
 
 	std::ostream &os_;
-	bool print_;
-	std::lock_guard<std::mutex> guard_;
+	const Message *message_;
+	std::chrono::system_clock::time_point time_;
+	// thread local buffer, or owned_buffer_ if the former is in use
+	std::ostringstream *buffer_;
+	std::unique_ptr<std::ostringstream> owned_buffer_;
 };
 
 
@@ -61,6 +74,14 @@ public:
 		kDebug
 	};
 
+
+	/// message with printing level, generated by Message::operator()
+	struct Printer {
+		Message &message;
+		Level level;
+	};
+
+
 	/// @brief constructor
 	///
 	/// @param[in] level the message level
@@ -78,7 +99,18 @@ public:
 	/// @param[in] level the message level to set
 	///
 	inline void SetLevel(Level level) {
-		intrinsic_level_ =  level;
+		intrinsic_level_.store(level, std::memory_order_relaxed);
+	}
+
+
+	/// @brief check whether the level is printed, useful to skip preparing
+	/// 	the content of filtered message
+	///
+	/// @param[in] level level to check
+	/// @returns true if message in this level is printed
+	///
+	inline bool Enabled(Level level) const {
+		return level <= intrinsic_level_.load(std::memory_order_relaxed);
 	}
 
 
@@ -124,39 +156,75 @@ public:
 	}
 
 
+	/// @brief let message show the time it was generated
+	///
+	/// @param[in] timestamp whether to show timestamp
+	///
+	inline void SetTimestamp(bool timestamp = true) {
+		show_timestamp_ = timestamp;
+	}
+
+
+	/// @brief write messages in background thread instead of the calling
+	/// 	thread. Messages are queued in per-thread lock-free queues, and
+	/// 	dropped with a warning if the queue is full rather than blocking
+	/// 	the caller. Only use this with long-lived streams like std::cout.
+	///
+	/// @param[in] async whether to write asynchronously
+	///
+	inline void SetAsync(bool async = true) {
+		async_ = async;
+	}
+
+
+	/// @brief check whether messages are written asynchronously
+	///
+	/// @returns true if written in background thread
+	///
+	inline bool Async() const {
+		return async_;
+	}
+
+
+	/// @brief wait until all asynchronous messages are written
+	///
+	static void Flush();
+
+
 	/// @brief set the printing level
 	///
 	/// @param[in] level level of content to print
-	/// @returns reference to this Message
+	/// @returns printer of this message in level
 	///
-	inline Message& operator()(Level level) {
-		printing_level_ = level;
-		return *this;
+	inline Printer operator()(Level level) {
+		return Printer{*this, level};
 	}
 
 
 	/// @brief overload stream output function
 	///
-	/// @param[in] os ostream to output 
-	/// @param[in] message message object to set format
+	/// @param[in] os ostream to output
+	/// @param[in] printer message object and the level to print
 	/// @returns instance of MessageOstream object
 	///
 	/// @relates Message
 	///
-	friend MessageOstream operator<<(std::ostream &os, Message &message);
-
+	friend MessageOstream operator<<(std::ostream &os, const Printer &printer);
 
 private:
+	friend class MessageOstream;
 
 	static const std::map<Level, std::string> prefix_map_;
 	static const std::map<Level, std::string> color_map_;
 	static const std::map<std::string, Level> level_map_;
 
-	Level intrinsic_level_;
-	Level printing_level_;
+	std::atomic<Level> intrinsic_level_;
 	bool show_prefix_;
 	bool show_color_;
-	std::mutex lock_;
+	bool show_timestamp_;
+	bool async_;
+	// lock for writing synchronously
+	mutable std::mutex lock_;
 };
 
 
@@ -0,0 +1,409 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/config.h"
+#include "include/timing.h"
+
+namespace rxdaq {
+
+// upper bounds of latency buckets in seconds, the last bucket is +Inf
+const std::array<double, 14> kLatencyBounds = {
+	0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+	0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+
+/// This class counts latencies in the fixed buckets of kLatencyBounds.
+/// Observing is lock free, so it can be called from any thread.
+class LatencyHistogram {
+public:
+
+	/// @brief constructor
+	///
+	LatencyHistogram() noexcept;
+
+
+	/// @brief count a latency
+	///
+	/// @param[in] seconds latency in seconds
+	///
+	void Observe(double seconds) noexcept;
+
+
+	/// @brief get counts of buckets, not cumulative
+	///
+	/// @returns counts, the last one for latencies over all bounds
+	///
+	std::array<uint64_t, kLatencyBounds.size()+1> Counts() const noexcept;
+
+
+	/// @brief get number of observed latencies
+	///
+	/// @returns number of latencies
+	///
+	uint64_t Count() const noexcept;
+
+
+	/// @brief get sum of observed latencies
+	///
+	/// @returns sum in seconds
+	///
+	double Sum() const noexcept;
+
+private:
+	std::array<std::atomic<uint64_t>, kLatencyBounds.size()+1> counts_;
+	std::atomic<uint64_t> count_;
+	std::atomic<uint64_t> sum_nanoseconds_;
+};
+
+
+// 16 linear sub-buckets in each power of 2 of HDR histogram, so the
+// relative error is within 1/16
+const unsigned int kHdrSubBucketBits = 4;
+// HDR histogram counts latencies in microseconds below 2^kHdrMaxBits
+const unsigned int kHdrMaxBits = 36;
+const size_t kHdrBuckets = (kHdrMaxBits - kHdrSubBucketBits + 1) << kHdrSubBucketBits;
+
+
+/// This class counts latencies in HDR style buckets, the bucket width grows
+/// with the latency so that the percentiles keep the same relative precision
+/// from microseconds to hours. Recording is lock free.
+class HdrHistogram {
+public:
+
+	/// @brief constructor
+	///
+	HdrHistogram() noexcept;
+
+
+	/// @brief count a latency
+	///
+	/// @param[in] seconds latency in seconds
+	///
+	void Record(double seconds) noexcept;
+
+
+	/// @brief get number of recorded latencies
+	///
+	/// @returns number of latencies
+	///
+	uint64_t Count() const noexcept;
+
+
+	/// @brief get mean of recorded latencies
+	///
+	/// @returns mean in seconds, 0 if nothing recorded
+	///
+	double Mean() const noexcept;
+
+
+	/// @brief get the highest recorded latency
+	///
+	/// @returns highest latency in seconds
+	///
+	double Max() const noexcept;
+
+
+	/// @brief get percentile of recorded latencies
+	///
+	/// @param[in] fraction fraction of latencies at or below the result,
+	/// 	e.g. 0.99 for the 99th percentile
+	/// @returns the highest latency equivalent to the percentile bucket in
+	/// 	seconds, 0 if nothing recorded
+	///
+	double Percentile(double fraction) const noexcept;
+
+
+	/// @brief get bucket of latency
+	///
+	/// @param[in] microseconds latency in microseconds
+	/// @returns index of bucket
+	///
+	static size_t BucketIndex(uint64_t microseconds) noexcept;
+
+
+	/// @brief get the exclusive upper bound of bucket
+	///
+	/// @param[in] index index of bucket
+	/// @returns upper bound in microseconds
+	///
+	static uint64_t BucketUpper(size_t index) noexcept;
+
+private:
+	std::array<std::atomic<uint64_t>, kHdrBuckets> counts_;
+	std::atomic<uint64_t> count_;
+	std::atomic<uint64_t> sum_nanoseconds_;
+	std::atomic<uint64_t> max_microseconds_;
+};
+
+
+// outcomes of RPC, the first ones are StatusType of reply in proto
+const std::array<const char*, 5> kRpcOutcomeNames = {
+	"success", "undefined", "fatal_error", "warning", "rpc_failed"
+};
+// outcome of RPC that failed in gRPC, without a reply
+const size_t kRpcFailed = 4;
+
+
+/// statistics of an RPC method
+struct RpcMethodStats {
+	std::string method;
+	// finished calls
+	uint64_t calls;
+	// calls being handled
+	uint64_t in_flight;
+	// finished calls by outcome, see kRpcOutcomeNames
+	std::array<uint64_t, kRpcOutcomeNames.size()> outcomes;
+	// latencies in seconds
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+
+/// This class keeps the latencies, the calls in flight and the outcomes of
+/// an RPC method. All updates are lock free.
+class RpcMetrics {
+public:
+
+	/// @brief constructor
+	///
+	RpcMetrics() noexcept;
+
+
+	/// @brief count a call beginning
+	///
+	void Begin() noexcept;
+
+
+	/// @brief count a call finished
+	///
+	/// @param[in] seconds latency of call
+	/// @param[in] outcome outcome of call, index of kRpcOutcomeNames
+	///
+	void End(double seconds, size_t outcome) noexcept;
+
+
+	/// @brief get statistics
+	///
+	/// @param[in] method name of method to fill in
+	/// @returns statistics
+	///
+	RpcMethodStats Stats(const std::string &method) const;
+
+
+	/// @brief get latency histogram in Prometheus buckets
+	///
+	/// @returns reference to histogram
+	///
+	inline const LatencyHistogram& Latency() const noexcept {
+		return latency_;
+	}
+
+private:
+	LatencyHistogram latency_;
+	HdrHistogram hdr_;
+	std::atomic<int64_t> in_flight_;
+	std::array<std::atomic<uint64_t>, kRpcOutcomeNames.size()> outcomes_;
+};
+
+
+/// This class keeps the metrics of the process in Prometheus style. The
+/// readout, writer and RPC paths update lock free counters and gauges, and
+/// Export reads them at scraping. Only registering a new RPC method and
+/// publishing boot timings take a lock, neither of them is in hot paths.
+class Metrics {
+public:
+
+	/// @brief get the only metrics of the process
+	///
+	/// @returns reference to metrics
+	///
+	static Metrics& Instance();
+
+
+	Metrics(const Metrics&) = delete;
+	Metrics& operator=(const Metrics&) = delete;
+
+
+	/// @brief count data read from a module
+	///
+	/// @param[in] module module read
+	/// @param[in] words words read
+	///
+	void AddRead(unsigned short module, size_t words) noexcept;
+
+
+	/// @brief set the last polled FIFO level of a module
+	///
+	/// @param[in] module module polled
+	/// @param[in] words words in FIFO
+	///
+	void SetFifoLevel(unsigned short module, size_t words) noexcept;
+
+
+	/// @brief change the data waiting to be written
+	///
+	/// @param[in] chunks chunks queued, negative for written
+	/// @param[in] bytes bytes queued, negative for written
+	///
+	void AddWriteBacklog(int64_t chunks, int64_t bytes) noexcept;
+
+
+	/// @brief set run state
+	///
+	/// @param[in] state run state in number, 0 idle, 1 starting, 2 running,
+	/// 	3 stopping and 4 finished
+	///
+	void SetRunState(int state) noexcept;
+
+
+	/// @brief replace timings of the last boot
+	///
+	/// @param[in] timings timings of boot phases
+	///
+	void SetBootTimings(const std::vector<PhaseTiming> &timings);
+
+
+	/// @brief get metrics of an RPC method, registered at the first call
+	///
+	/// @param[in] method name of method
+	/// @returns reference to metrics, valid for the process lifetime
+	///
+	RpcMetrics& Rpc(const std::string &method);
+
+
+	/// @brief get statistics of the registered RPC methods
+	///
+	/// @returns statistics ordered by method name
+	///
+	std::vector<RpcMethodStats> RpcStats() const;
+
+
+	/// @brief generate metrics in Prometheus text format
+	///
+	/// @returns metrics in string
+	///
+	std::string Export() const;
+
+private:
+
+	/// counters of a module
+	struct ModuleCounters {
+		std::atomic<bool> seen;
+		std::atomic<uint64_t> read_words;
+		std::atomic<uint64_t> fifo_words;
+	};
+
+
+	/// @brief constructor
+	///
+	Metrics() noexcept;
+
+
+	std::array<ModuleCounters, kModuleNum> modules_;
+	std::atomic<int64_t> backlog_chunks_;
+	std::atomic<int64_t> backlog_bytes_;
+	std::atomic<int> run_state_;
+
+	mutable std::mutex lock_;
+	std::vector<PhaseTiming> boot_timings_;
+	std::map<std::string, std::unique_ptr<RpcMetrics>> rpc_methods_;
+};
+
+
+/// This class serves the metrics over HTTP in its own thread, so that
+/// Prometheus or curl can scrape GET /metrics. Requests are answered one by
+/// one, which is enough for scraping.
+class MetricsServer {
+public:
+
+	/// @brief constructor
+	///
+	MetricsServer() noexcept;
+
+
+	/// @brief destructor, stop serving
+	///
+	~MetricsServer();
+
+
+	MetricsServer(const MetricsServer&) = delete;
+	MetricsServer& operator=(const MetricsServer&) = delete;
+
+
+	/// @brief listen and start serving
+	///
+	/// @param[in] host host to listen on
+	/// @param[in] port port to listen on, 0 to choose a free one
+	///
+	/// @throws RXError if failed to listen
+	///
+	void Start(const std::string &host, unsigned short port);
+
+
+	/// @brief stop serving and close the socket
+	///
+	void Stop();
+
+
+	/// @brief get the port listened on
+	///
+	/// @returns port, 0 if not started
+	///
+	inline unsigned short Port() const noexcept {
+		return port_;
+	}
+
+private:
+
+	/// @brief accept and answer requests until stopped
+	///
+	void Loop();
+
+
+	/// @brief answer one request
+	///
+	/// @param[in] client socket of client
+	///
+	void Answer(int client);
+
+
+	int socket_;
+	unsigned short port_;
+	std::atomic<bool> running_;
+	std::thread thread_;
+};
+
+
+/// @brief generate table of RPC statistics, a row for each method
+///
+/// @param[in] stats statistics of methods
+/// @returns table in string
+///
+std::string RpcStatsInfo(const std::vector<RpcMethodStats> &stats);
+
+
+/// @brief generate HTTP response of a request to the metrics server
+///
+/// @param[in] request request line and headers
+/// @returns response with status line, headers and body
+///
+std::string MetricsResponse(const std::string &request);
+
+}		// namespace rxdaq
+
+#endif		// __METRICS_H__
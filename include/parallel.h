@@ -0,0 +1,89 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rxdaq {
+
+/// @brief get number of worker threads of offline tools
+///
+/// @param[in] threads requested threads, 0 for all hardware threads
+/// @returns number of threads, at least 1
+///
+unsigned int WorkerThreads(unsigned int threads);
+
+
+/// @brief run workers in threads, stop them at the first exception
+///
+/// @param[in] workers number of workers
+/// @param[in] work function run by each worker, takes index of worker
+/// @param[in] stop function called once a worker throws, to make the other
+/// 	workers run out of tasks
+///
+/// @throws the first exception thrown by work
+///
+template<typename Work, typename Stop>
+void RunWorkers(unsigned int workers, Work work, Stop stop) {
+	std::mutex error_lock;
+	std::exception_ptr error = nullptr;
+	auto run = [&](unsigned int index) {
+		try {
+			work(index);
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(error_lock);
+			if (!error) error = std::current_exception();
+			stop();
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < workers; ++i) {
+		threads.emplace_back(run, i);
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+
+/// @brief run function on indexes in parallel, stop at the first exception
+///
+/// @param[in] count number of indexes
+/// @param[in] threads number of threads, 0 for all hardware threads
+/// @param[in] function function to run on each index, takes the index and
+/// 	optionally the index of worker, to reuse buffers of the worker
+///
+/// @throws the first exception thrown by function
+///
+template<typename Function>
+void ParallelFor(size_t count, unsigned int threads, Function function) {
+	std::atomic<size_t> next(0);
+	RunWorkers(
+		unsigned(std::min(size_t(WorkerThreads(threads)), count)),
+		[&](unsigned int worker) {
+			for (size_t i = next++; i < count; i = next++) {
+				if constexpr (std::is_invocable_v<Function&, size_t, unsigned int>) {
+					function(i, worker);
+				} else {
+					function(i);
+				}
+			}
+		},
+		[&]() {
+			next = count;
+		}
+	);
+}
+
+}		// namespace rxdaq
+
+#endif		// __PARALLEL_H__
@@ -0,0 +1,158 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+
+namespace rxdaq {
+
+/// block of list mode data from one module passing through the pipeline
+struct DataBlock {
+	unsigned short module;
+	// raw words of complete events
+	std::vector<uint32_t> words;
+	// decoded events of words
+	EventBatch events;
+	// 1 to keep the event, 0 to drop it
+	std::vector<uint8_t> keep;
+};
+
+
+/// @brief drop the events not kept, and move the raw words and decoded
+/// 	events of the kept ones forward
+///
+/// @param[in,out] block block to compact
+///
+void CompactBlock(DataBlock &block);
+
+
+/// This class is a processing stage of pipeline. A stage can drop events by
+/// clearing keep flags, or rewrite the raw words and events consistently.
+class Stage {
+public:
+
+	/// @brief default destructor
+	///
+	virtual ~Stage() = default;
+
+
+	/// @brief get name of stage
+	///
+	/// @returns name of stage
+	///
+	virtual std::string Name() const = 0;
+
+
+	/// @brief process events of the block
+	///
+	/// @param[in,out] block block to process
+	///
+	virtual void Process(DataBlock &block) = 0;
+
+
+	/// @brief process events of the block at the end of data of a module,
+	/// 	the stage holding events back should release them
+	///
+	/// @param[in,out] block block to process
+	///
+	virtual void Flush(DataBlock &block) {
+		Process(block);
+	}
+
+
+	/// @brief clear the state before a new run
+	///
+	virtual void Reset() {
+	}
+};
+
+
+/// This class decodes list mode data read from modules and passes the
+/// complete events through stages before they are written. The beginning
+/// of an incomplete event is kept until the rest is read. Only one thread
+/// should call Process.
+class Pipeline {
+public:
+
+	/// @brief constructor
+	///
+	Pipeline() noexcept;
+
+
+	/// @brief add stage to the end of pipeline
+	///
+	/// @param[in] stage stage to add
+	///
+	void AddStage(std::shared_ptr<Stage> stage);
+
+
+	/// @brief get stages in order
+	///
+	/// @returns stages
+	///
+	inline const std::vector<std::shared_ptr<Stage>>& Stages() const noexcept {
+		return stages_;
+	}
+
+
+	/// @brief clear incomplete events and states of stages before a new run
+	///
+	void Reset();
+
+
+	/// @brief process list mode data of a module
+	///
+	/// Data which can't be decoded is passed through without processing.
+	///
+	/// @param[in] module module of data
+	/// @param[in,out] words data read from module, replaced by data to write
+	///
+	void Process(unsigned short module, std::vector<uint32_t> &words);
+
+
+	/// @brief take the events held back by stages at the end of data of a
+	/// 	module, followed by the words of incomplete event which are written
+	/// 	as they are
+	///
+	/// @param[in] module module of data
+	/// @param[out] words data to write, empty if none
+	///
+	void Flush(unsigned short module, std::vector<uint32_t> &words);
+
+
+	/// @brief get number of blocks passed through since they can't be decoded
+	///
+	/// @returns number of invalid blocks
+	///
+	inline uint64_t InvalidBlocks() const noexcept {
+		return invalid_blocks_.load(std::memory_order_relaxed);
+	}
+
+
+	/// @brief get decoded events of the words returned by the last Process
+	/// 	or Flush, empty if the words can't be decoded
+	///
+	/// @returns events, offsets are relative to the returned words
+	///
+	inline const EventBatch& Events() const noexcept {
+		return block_.events;
+	}
+
+private:
+	std::vector<std::shared_ptr<Stage>> stages_;
+	// beginning of incomplete event of each module
+	std::map<unsigned short, std::vector<uint32_t>> incomplete_;
+	// reused block
+	DataBlock block_;
+	std::atomic<uint64_t> invalid_blocks_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __PIPELINE_H__
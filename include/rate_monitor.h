@@ -0,0 +1,133 @@
+#ifndef __RATE_MONITOR_H__
+#define __RATE_MONITOR_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/config.h"
+#include "include/pipeline.h"
+
+namespace rxdaq {
+
+// channels of all modules in a crate
+const size_t kRateChannels = kModuleNum * kChannelNum;
+// buckets of the sliding window
+const size_t kRateBuckets = 10;
+// default seconds of the sliding window
+const double kRateWindow = 10.0;
+
+
+/// input count rate of a channel
+struct ChannelRate {
+	unsigned short module;
+	unsigned short channel;
+	// counts per second in the sliding window
+	double rate;
+	// counts since reset
+	uint64_t total;
+};
+
+
+/// This class is a pipeline stage counting the input events of every channel
+/// in a sliding window of wall clock time, without changing the block. The
+/// window is a ring of buckets, and the counts are atomic, so the rates can
+/// be read by other threads while the pipeline is running without locks.
+/// The rates are estimated from the buckets in the window and may miss the
+/// events being counted at the same time. Only one thread should call Count.
+class RateMonitor : public Stage {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] window seconds of the sliding window
+	///
+	RateMonitor(double window = kRateWindow) noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~RateMonitor() = default;
+
+
+	/// @brief get name of stage
+	///
+	/// @returns name of stage 'rate'
+	///
+	inline virtual std::string Name() const override {
+		return "rate";
+	}
+
+
+	/// @brief count events of the block at the current time
+	///
+	/// @param[in,out] block block to count, not changed
+	///
+	virtual void Process(DataBlock &block) override;
+
+
+	/// @brief clear counts and restart the clock
+	///
+	virtual void Reset() override;
+
+
+	/// @brief count events of the block
+	///
+	/// @param[in] block block to count
+	/// @param[in] seconds time since reset
+	///
+	void Count(const DataBlock &block, double seconds);
+
+
+	/// @brief get rates of the channels with counts at the current time
+	///
+	/// @returns rates ordered by module and channel
+	///
+	std::vector<ChannelRate> Rates() const;
+
+
+	/// @brief get rates of the channels with counts
+	///
+	/// @param[in] seconds time since reset
+	/// @returns rates ordered by module and channel
+	///
+	std::vector<ChannelRate> Rates(double seconds) const;
+
+
+	/// @brief get seconds of the sliding window
+	///
+	/// @returns seconds of window
+	///
+	inline double Window() const noexcept {
+		return bucket_seconds_ * kRateBuckets;
+	}
+
+private:
+
+	/// @brief get seconds since reset
+	///
+	/// @returns seconds since reset
+	///
+	double Now() const noexcept;
+
+
+	/// counts of channels in a period of the window
+	struct Bucket {
+		// index of period since reset, -1 if not used
+		std::atomic<int64_t> period;
+		std::array<std::atomic<uint64_t>, kRateChannels> counts;
+	};
+
+	double bucket_seconds_;
+	// steady clock nanoseconds of reset
+	std::atomic<int64_t> start_;
+	std::array<Bucket, kRateBuckets> buckets_;
+	std::array<std::atomic<uint64_t>, kRateChannels> totals_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __RATE_MONITOR_H__
@@ -46,12 +46,35 @@ public:
 	virtual void Initialize(const std::string &) override;
 
 
+	/// @brief plan the boot without booting
+	///
+	/// @param[in] module_id module to plan
+	/// @param[in] fast true for incremental boot, false to boot all the
+	/// 	requested modules
+	/// @returns boot plan of the requested modules
+	///
+	virtual BootPlan PlanBoot(
+		unsigned short module_id,
+		bool fast = true
+	) override;
+
+
 	/// @brief boot modules
 	///
 	/// @param[in] module_id module to boot 
-	/// @param[in] fast true for fast boot (don't boot fpga or load parameters)
+	/// @param[in] fast true for incremental boot (only boot or import the
+	/// 	modules differ from config), false to boot all requested modules
 	///
 	virtual void Boot(unsigned short module_id, bool fast = true) override;
+
+
+	/// @brief get time spent in phases of last boot
+	///
+	/// @returns list of phase timings
+	///
+	virtual inline std::vector<PhaseTiming> BootTimings() const override {
+		return boot_timings_;
+	}
 	
 
 	// //-------------------------------------------------------------------------
@@ -127,46 +150,127 @@ public:
 	virtual void ExportParameters(const std::string &path) override;
 
 
-	/// @brief start list mode run
+	/// @brief start list mode run in server
 	///
 	/// @param[in] module_id module to run in list mode 
 	/// @param[in] seconds seconds to run, 0 for infinite time
 	/// @param[in] run run number, -1 to read from config file
+	/// @returns run number of the started run
 	///
-	virtual void StartRun(
+	virtual unsigned int StartRun(
 		unsigned short module_id,
 		unsigned int seconds,
 		int run
 	) override;
 
 
-	/// @brief stop list mode run
+	/// @brief prepare output files of list mode run in server
+	///
+	/// @param[in] module_id module to run in list mode
+	/// @param[in] run run number, -1 to read from config file
+	///
+	virtual void PrepareRun(unsigned short module_id, int run) override;
+
+
+	/// @brief run in list mode continuously in server
+	///
+	/// @param[in] module_id module to run in list mode
+	/// @param[in] policy conditions to roll to the next run
+	/// @param[in] run run number of the first run, -1 to read from config file
+	/// @returns run number of the first run
 	///
-	/// @param[in] module_id module to stop
+	virtual unsigned int ContinuousRun(
+		unsigned short module_id,
+		const RollPolicy &policy,
+		int run
+	) override;
+
+
+	/// @brief stop list mode run
 	///
 	virtual void StopRun() override;
 
 
+	/// @brief get status of the current or last run in server
+	///
+	/// @returns run status
+	///
+	virtual RunInfo RunStatus() override;
 
-private:
 
-	struct AsyncClientCall {
-		int type;
-		std::unique_ptr<grpc::ClientAsyncResponseReader<RunReply>> reader;
-		grpc::ClientContext context;
-		RunReply reply;
-		grpc::Status status;
-	};
+	/// @brief wait for the list mode run in server to finish
+	///
+	/// @param[in] milliseconds maximum time to wait, 0 to wait until finished
+	/// @returns run status, which may be still running if timeout
+	///
+	virtual RunInfo WaitRun(unsigned int milliseconds = 0) override;
+
 
+	/// @brief set rules to filter events in server
+	///
+	/// @param[in] path path of rules file in server side, empty to turn off
+	///
+	virtual void SetFilter(const std::string &path) override;
 
-	/// @brief signal INT handler, stop the list mode run
-	///  
-	static void SigIntHandler(int);
 
+	/// @brief get counts of filter rules in server
+	///
+	/// @returns counts of rules
+	///
+	virtual std::vector<FilterCount> FilterStats() override;
+
+
+	/// @brief set or turn off trace reduction in server
+	///
+	/// @param[in] enable false to write traces as they are
+	/// @param[in] reduction settings of reduction
+	///
+	virtual void SetTraceReduction(
+		bool enable,
+		const TraceReduction &reduction
+	) override;
+
+
+	/// @brief get statistics of trace reduction in server
+	///
+	/// @returns statistics
+	///
+	virtual TraceReductionStats ReductionStats() override;
+
+
+	/// @brief get input count rates of channels in server
+	///
+	/// @returns rates of channels with counts
+	///
+	virtual std::vector<ChannelRate> ChannelRates() override;
+
+
+	/// @brief get statistics of RPC handled by server
+	///
+	/// @returns statistics of methods
+	///
+	virtual std::vector<RpcMethodStats> ServerStats() override;
+
+
+	/// @brief clear previous traces and start tracing in server
+	///
+	virtual void StartTrace() override;
+
+
+	/// @brief stop tracing in server and export traces
+	///
+	/// @param[in] path path of file to export, in server side
+	///
+	virtual void StopTrace(const std::string &path) override;
+
+
+
+private:
+
+	bool initialized_;
 	unsigned short module_num_;
+	std::vector<PhaseTiming> boot_timings_;
 	std::unique_ptr<ControlCrate::Stub> stub_;
-	static RemoteCrate *instance_;
-	grpc::CompletionQueue completion_queue_;
 };
 
 }		// namespace rxdaq
@@ -0,0 +1,95 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/event_filter.h"
+#include "include/pipeline.h"
+#include "include/rate_monitor.h"
+#include "include/trace_reducer.h"
+
+namespace rxdaq {
+
+// words of a replayed block, about a read of module FIFO in a run
+const size_t kReplayBlockWords = 32768;
+
+
+/// @brief build the pipeline of list mode run, the live run and replay use
+/// 	the same stages in the same order
+///
+/// @param[in] monitor rate monitor, nullptr if not used
+/// @param[in] filter event filter, nullptr if not used
+/// @param[in] reducer trace reducer, nullptr if not used
+/// @param[in] packed whether to encode traces
+/// @returns pipeline
+///
+std::shared_ptr<Pipeline> BuildRunPipeline(
+	std::shared_ptr<RateMonitor> monitor,
+	std::shared_ptr<EventFilter> filter,
+	std::shared_ptr<TraceReducer> reducer,
+	bool packed
+);
+
+
+/// options of replaying
+struct ReplayOptions {
+	// speed relative to the original timing, 1 for the original timing,
+	// 2 for twice as fast, 0 for as fast as possible
+	double speed;
+	// nanoseconds of a timestamp tick
+	double tick;
+	// words read from a file at a time
+	size_t block_words;
+	// stages of pipeline, nullptr if not used
+	std::shared_ptr<EventFilter> filter;
+	std::shared_ptr<TraceReducer> reducer;
+	// whether to encode traces and write .rxp files
+	bool packed;
+};
+
+
+/// summary of replaying
+struct ReplayResult {
+	uint64_t files;
+	uint64_t blocks;
+	// bytes read from files
+	uint64_t bytes;
+	double seconds;
+	// the longest time blocks were written behind the original timing
+	double max_lag;
+	// blocks passed through the pipeline without decoding
+	uint64_t invalid_blocks;
+};
+
+
+/// @brief replay recorded data files through the pipeline and data writer
+/// 	of list mode run, without modules
+///
+/// Files are read in blocks like reads of module FIFO, the blocks don't end
+/// at event boundaries. Blocks of all modules are written in order of the
+/// timestamp of the last event starting in the block. With timing, a block
+/// is written when the time since the start reaches the time of its last
+/// event since the first event, scaled by the speed. The module of a file
+/// is read from _Mxx in its name, or its position in files. The output
+/// files have the same names and their indexes in the output directory.
+///
+/// @param[in] files recorded raw data files
+/// @param[in] output output directory
+/// @param[in] options timing, block size and stages of pipeline
+/// @returns summary of replaying
+///
+/// @throws RXError if failed to read or write files
+///
+ReplayResult ReplayRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	const ReplayOptions &options
+);
+
+}		// namespace rxdaq
+
+#endif		// __REPLAY_H__
@@ -0,0 +1,83 @@
+#ifndef __RPC_METRICS_H__
+#define __RPC_METRICS_H__
+
+#include <chrono>
+#include <string>
+
+#include <grpcpp/support/server_interceptor.h>
+
+#include "include/metrics.h"
+
+namespace rxdaq {
+
+/// This class measures the time an RPC spends in the server, from the
+/// creation of the call to sending the status, and counts it in the metrics
+/// of the method with the outcome. HandleError always returns OK and puts
+/// the error in status_type of the reply, so the outcome is read from the
+/// reply, and a call without OK status is counted as failed in gRPC. gRPC
+/// creates one for each call and deletes it after the call.
+class RpcMetricsInterceptor : public grpc::experimental::Interceptor {
+public:
+
+	/// @brief constructor, count the call in flight and start timing
+	///
+	/// @param[in] info information of the call
+	///
+	RpcMetricsInterceptor(grpc::experimental::ServerRpcInfo *info);
+
+
+	/// @brief destructor, count the call failed if it didn't send status
+	///
+	~RpcMetricsInterceptor();
+
+
+	/// @brief intercept hook points of the call
+	///
+	/// @param[in] methods methods of the hook point
+	///
+	void Intercept(grpc::experimental::InterceptorBatchMethods *methods) override;
+
+private:
+
+	/// @brief count the call finished
+	///
+	/// @param[in] outcome outcome of call, index of kRpcOutcomeNames
+	///
+	void End(size_t outcome) noexcept;
+
+
+	RpcMetrics &metrics_;
+	std::chrono::steady_clock::time_point start_;
+	// status type of the reply, undefined until the reply is sent
+	size_t outcome_;
+	bool ended_;
+};
+
+
+/// This class creates the metrics interceptor for every call, register it by
+/// ServerBuilder::experimental().SetInterceptorCreators.
+class RpcMetricsInterceptorFactory
+	: public grpc::experimental::ServerInterceptorFactoryInterface {
+public:
+
+	/// @brief create an interceptor for a call
+	///
+	/// @param[in] info information of the call
+	/// @returns pointer to interceptor, owned by gRPC
+	///
+	grpc::experimental::Interceptor* CreateServerInterceptor(
+		grpc::experimental::ServerRpcInfo *info
+	) override;
+};
+
+
+/// @brief get the short name of RPC method
+///
+/// @param[in] method fully specified name, e.g. /rxdaq.ControlCrate/Boot
+/// @returns name after the last slash, e.g. Boot
+///
+std::string RpcMethodName(const std::string &method);
+
+}		// namespace rxdaq
+
+#endif		// __RPC_METRICS_H__
@@ -0,0 +1,214 @@
+#ifndef __RUN_INDEX_H__
+#define __RUN_INDEX_H__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+#include "include/mapped_file.h"
+
+namespace rxdaq {
+
+// default maximum events in an index entry
+const uint32_t kIndexInterval = 1024;
+// entries summarized by a group in the top level table of index
+const uint32_t kIndexGroupSize = 1024;
+
+
+/// an entry of index, describes a region of events in data file
+struct IndexEntry {
+	// offset of the first event in bytes
+	uint64_t offset;
+	// minimum and maximum timestamp of events
+	uint64_t min_time;
+	uint64_t max_time;
+	// words and number of events of the region
+	uint32_t words;
+	uint32_t events;
+	// bit i is set if channel i appears in the region
+	uint16_t channels;
+	uint16_t reserved[3];
+};
+
+
+/// @brief get path of index file of data file
+///
+/// @param[in] data_path path of data file
+/// @returns path of index file
+///
+inline std::string IndexPath(const std::string &data_path) {
+	return data_path + ".idx";
+}
+
+
+/// summary of a group of consecutive entries, the groups are written to the
+/// end of index file as a top level table when the file is closed
+struct IndexGroup {
+	// minimum and maximum timestamp of events in the group
+	uint64_t min_time;
+	uint64_t max_time;
+	// number of entries in the group
+	uint32_t entries;
+	// bit i is set if channel i appears in the group
+	uint16_t channels;
+	uint16_t reserved;
+};
+
+
+/// This class writes the index sidecar of a data file. Events are added in
+/// the order they are written to data file, and an entry is written for
+/// every interval events or at the end of each block. The entries are
+/// summarized in groups, which are written after the entries on closing.
+class IndexWriter {
+public:
+
+	/// @brief constructor, create index file
+	///
+	/// @param[in] path path of index file
+	/// @param[in] interval maximum events in an entry
+	///
+	/// @throws RXError if failed to create file
+	///
+	IndexWriter(const std::string &path, uint32_t interval = kIndexInterval);
+
+
+	/// @brief add events written to data file
+	///
+	/// @param[in] events decoded events, offsets are relative to the words
+	/// @param[in] words number of words written, including the words which
+	/// 	can't be decoded
+	/// @returns false if failed to write index
+	///
+	bool Add(const EventBatch &events, size_t words);
+
+
+	/// @brief close the index file, write the groups and the trailer
+	///
+	/// @returns false if failed to write index
+	///
+	bool Close();
+
+private:
+	std::ofstream stream_;
+	uint32_t interval_;
+	// words written to data file
+	uint64_t offset_;
+	// entries written
+	uint64_t entries_;
+	// summaries of entries, the last one may be incomplete
+	std::vector<IndexGroup> groups_;
+};
+
+
+/// conditions of events to query
+struct IndexQuery {
+	// timestamps in [begin, end]
+	uint64_t begin;
+	uint64_t end;
+	// channels whose bits are set
+	uint16_t channels;
+};
+
+
+/// This class maps an index file into memory read only. Queries check the
+/// top level table of groups first and only touch the entries of matching
+/// groups, so the index is never loaded as a whole. Files without the
+/// table, e.g. not closed after a crash, fall back to scan all entries.
+class IndexFile {
+public:
+
+	/// @brief constructor, map and check the index file
+	///
+	/// @param[in] path path of index file
+	///
+	/// @throws RXError if the file doesn't exist or is not an index file
+	///
+	IndexFile(const std::string &path);
+
+
+	/// @brief get number of entries
+	///
+	/// @returns entries
+	///
+	inline size_t Size() const noexcept {
+		return size_;
+	}
+
+
+	/// @brief get entry
+	///
+	/// @param[in] index index of entry, less than Size()
+	/// @returns entry
+	///
+	inline const IndexEntry& operator[](size_t index) const noexcept {
+		return entries_[index];
+	}
+
+
+	/// @brief find the entries may contain events matching query
+	///
+	/// @param[in] query conditions of events
+	/// @returns indexes of matching entries in order
+	///
+	std::vector<size_t> Find(const IndexQuery &query) const;
+
+private:
+	MappedFile file_;
+	const IndexEntry *entries_;
+	size_t size_;
+	// top level table, nullptr if the file has no table
+	const IndexGroup *groups_;
+	size_t group_count_;
+	uint32_t group_size_;
+};
+
+
+/// @brief read index file
+///
+/// @param[in] path path of index file
+/// @returns entries of index
+///
+/// @throws RXError if the file doesn't exist or is not an index file
+///
+std::vector<IndexEntry> ReadIndex(const std::string &path);
+
+
+/// @brief find the entries may contain events matching query
+///
+/// @param[in] entries entries of index
+/// @param[in] query conditions of events
+/// @returns indexes of matching entries
+///
+std::vector<size_t> FindEntries(
+	const std::vector<IndexEntry> &entries,
+	const IndexQuery &query
+);
+
+
+/// result of query in data file
+struct QueryResult {
+	// raw words of matching events
+	std::vector<uint32_t> words;
+	uint64_t events;
+	// regions read from data file, adjacent entries are read together
+	uint64_t regions;
+	uint64_t bytes_read;
+};
+
+
+/// @brief read the events matching query from data file, only the regions
+/// 	found in index are read
+///
+/// @param[in] data_path path of data file, with index file next to it
+/// @param[in] query conditions of events
+/// @returns matching events and statistics
+///
+/// @throws RXError if failed to read files or data can't be decoded
+///
+QueryResult QueryRunFile(const std::string &data_path, const IndexQuery &query);
+
+}		// namespace rxdaq
+
+#endif		// __RUN_INDEX_H__
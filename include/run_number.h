@@ -0,0 +1,93 @@
+#ifndef __RUN_NUMBER_H__
+#define __RUN_NUMBER_H__
+
+#include <string>
+
+namespace rxdaq {
+
+/// This class keeps the next run number in a small append-only log file, so
+/// the config file needn't be rewritten after every run. Each record is a
+/// fixed-width line synced to disk before the store returns, and a torn
+/// record left by a crash is dropped on opening. The log is compacted by
+/// writing to a temporary file and renaming it when it grows too long.
+class RunNumberStore {
+public:
+
+	/// @brief constructor
+	///
+	RunNumberStore() noexcept;
+
+
+	/// @brief destructor, close the log file
+	///
+	~RunNumberStore();
+
+
+	RunNumberStore(const RunNumberStore&) = delete;
+	RunNumberStore& operator=(const RunNumberStore&) = delete;
+
+
+	/// @brief open the store, create it if not exists
+	///
+	/// @param[in] path path of the log file
+	/// @param[in] initial run number from config, the larger one of this and
+	/// 	the stored one is used
+	///
+	/// @throws runtime_error if failed to open or write the log file
+	///
+	void Open(const std::string &path, unsigned int initial);
+
+
+	/// @brief close the log file
+	///
+	void Close() noexcept;
+
+
+	/// @brief get the stored run number
+	///
+	/// @returns stored run number
+	///
+	inline unsigned int Current() const noexcept {
+		return number_;
+	}
+
+
+	/// @brief store the run number and sync to disk
+	///
+	/// @param[in] number run number to store
+	///
+	/// @throws runtime_error if failed to write the log file
+	///
+	void Store(unsigned int number);
+
+
+	/// @brief get path of log file
+	///
+	/// @returns path of log file
+	///
+	inline const std::string& Path() const noexcept {
+		return path_;
+	}
+
+private:
+
+	/// @brief append a record to log file and sync
+	///
+	/// @param[in] number run number to append
+	///
+	void Append(unsigned int number);
+
+
+	/// @brief rewrite the log file with only the current record
+	///
+	void Compact();
+
+	std::string path_;
+	int fd_;
+	unsigned int number_;
+	size_t records_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __RUN_NUMBER_H__
@@ -0,0 +1,193 @@
+#ifndef __STATS_SAMPLER_H__
+#define __STATS_SAMPLER_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/config.h"
+
+namespace rxdaq {
+
+/// run statistics of a channel read from module, counted since the run starts
+struct ChannelStats {
+	// seconds
+	double real_time;
+	double live_time;
+	uint64_t input_counts;
+	uint64_t output_counts;
+};
+
+
+/// run statistics of a module
+struct ModuleStats {
+	unsigned short module;
+	std::vector<ChannelStats> channels;
+};
+
+
+/// statistics of a channel in the interval between two reads
+struct ChannelSample {
+	// seconds since the sampler starts when the statistics were read
+	double time;
+	unsigned short module;
+	unsigned short channel;
+	// seconds of real time and live time in the interval
+	double real_time;
+	double live_time;
+	// input counts over live time, output counts over real time
+	double input_rate;
+	double output_rate;
+	// live time over real time
+	double live_fraction;
+	// fraction of input counts not in output, 1 - output_rate/input_rate
+	double dead_fraction;
+};
+
+
+/// @brief compute statistics of channels in the interval between two reads,
+/// 	the rates and fractions are 0 if the interval is empty
+///
+/// @param[in] previous statistics of the previous read, empty channels for
+/// 	the beginning of run
+/// @param[in] current statistics of the current read
+/// @param[in] time seconds since the sampler starts of the current read
+/// @returns statistics of channels in the interval
+///
+std::vector<ChannelSample> ComputeSamples(
+	const ModuleStats &previous,
+	const ModuleStats &current,
+	double time
+);
+
+
+/// function to read run statistics of a module
+typedef std::function<ModuleStats(unsigned short)> StatsReader;
+
+
+/// This class samples run statistics of modules in a run and writes the time
+/// series to a csv file. A background thread marks modules due at the
+/// interval, and the readout thread calls Sample between FIFO reads, so the
+/// statistics are read only right after the FIFO of the module was drained
+/// and never compete with readout for the module. Computing and writing are
+/// done in the background thread.
+class StatsSampler {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] reader function to read run statistics of a module
+	///
+	StatsSampler(StatsReader reader) noexcept;
+
+
+	/// @brief destructor, stop sampling without the last read
+	///
+	~StatsSampler();
+
+
+	/// @brief start sampling, stop the last sampling if not stopped
+	///
+	/// @param[in] modules modules to sample
+	/// @param[in] interval seconds between two samples, 0 not to sample
+	/// @param[in] path path of csv file
+	///
+	/// @throws RXError if failed to open the file
+	///
+	void Start(
+		const std::vector<unsigned short> &modules,
+		double interval,
+		const std::string &path
+	);
+
+
+	/// @brief read statistics of module if it's due, called by the readout
+	/// 	thread only
+	///
+	/// @param[in] module module just read
+	///
+	inline void Sample(unsigned short module) {
+		if (module < kModuleNum && due_[module].load(std::memory_order_acquire)) {
+			Read(module);
+		}
+	}
+
+
+	/// @brief read statistics of all modules for the whole run and stop
+	/// 	sampling, called after the modules stop
+	///
+	void Finish();
+
+
+	/// @brief stop sampling, the read statistics are written
+	///
+	void Stop();
+
+
+	/// @brief get number of written samples of modules since start
+	///
+	/// @returns number of samples
+	///
+	uint64_t Samples() const;
+
+
+	/// @brief get number of failed reads since start
+	///
+	/// @returns number of failed reads
+	///
+	uint64_t Errors() const;
+
+private:
+
+	/// @brief read statistics of module and queue them for the background
+	/// 	thread
+	///
+	/// @param[in] module module to read
+	///
+	void Read(unsigned short module);
+
+
+	/// @brief mark modules due at the interval and write queued statistics
+	///
+	void Loop();
+
+
+	/// @brief compute and write statistics, called by the background thread
+	///
+	/// @param[in] stats statistics of module
+	/// @param[in] time seconds since start of the read
+	///
+	void Write(const ModuleStats &stats, double time);
+
+
+	StatsReader reader_;
+	std::array<std::atomic<bool>, kModuleNum> due_;
+
+	mutable std::mutex lock_;
+	std::condition_variable cv_;
+	bool running_;
+	std::vector<unsigned short> modules_;
+	double interval_;
+	std::chrono::steady_clock::time_point start_;
+	// read but not written statistics and their time
+	std::deque<std::pair<ModuleStats, double>> pending_;
+	// last read statistics of modules to compute intervals
+	std::array<ModuleStats, kModuleNum> previous_;
+	std::ofstream output_;
+	uint64_t samples_;
+	uint64_t errors_;
+	std::thread thread_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __STATS_SAMPLER_H__
@@ -0,0 +1,105 @@
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rxdaq {
+
+/// module index of crate level phase
+const int kCratePhase = -1;
+
+/// time spent in a phase of a module or the crate
+struct PhaseTiming {
+	// name of the phase
+	std::string phase;
+	// module index, kCratePhase for crate level phase
+	int module;
+	// time spent in milliseconds
+	double milliseconds;
+};
+
+
+/// This class collects the time spent in phases. Phases of different modules
+/// are usually recorded from different threads, so it's thread safe.
+class TimingReport {
+public:
+
+	/// @brief default constructor
+	///
+	TimingReport() = default;
+
+
+	/// @brief default destructor
+	///
+	~TimingReport() = default;
+
+
+	/// @brief record time of a phase
+	///
+	/// @param[in] phase name of the phase
+	/// @param[in] module module index, kCratePhase for crate level phase
+	/// @param[in] milliseconds time spent in milliseconds
+	///
+	void Record(const std::string &phase, int module, double milliseconds);
+
+
+	/// @brief clear all records
+	///
+	void Clear();
+
+
+	/// @brief get the records
+	///
+	/// @returns list of records in the recorded order
+	///
+	std::vector<PhaseTiming> Timings() const;
+
+private:
+	mutable std::mutex lock_;
+	std::vector<PhaseTiming> timings_;
+};
+
+
+/// This class records the time spent in its scope to a TimingReport.
+class ScopedTimer {
+public:
+
+	/// @brief constructor, start timing
+	///
+	/// @param[in] report report to record to
+	/// @param[in] phase name of the phase
+	/// @param[in] module module index, kCratePhase for crate level phase
+	///
+	ScopedTimer(
+		TimingReport &report,
+		const std::string &phase,
+		int module = kCratePhase
+	) noexcept;
+
+
+	/// @brief destructor, stop timing and record
+	///
+	~ScopedTimer();
+
+private:
+	TimingReport &report_;
+	std::string phase_;
+	int module_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+
+/// @brief generate timing information in table, phases in rows and modules
+/// 	in columns
+///
+/// @param[in] timings timings to display
+/// @returns timing information in string, empty if there is nothing
+///
+std::string TimingInfo(const std::vector<PhaseTiming> &timings);
+
+}		// namespace rxdaq
+
+#endif		// __TIMING_H__
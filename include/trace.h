@@ -0,0 +1,198 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rxdaq {
+
+/// type of trace event
+enum class TraceEventType : uint8_t {
+	kBegin = 0,
+	kEnd
+};
+
+
+/// binary trace event, the name must be a string literal
+struct TraceEvent {
+	const char *name;
+	uint64_t ticks;
+	uint32_t thread;
+	TraceEventType type;
+};
+
+
+/// @brief read the time stamp counter, or steady clock in nanoseconds if TSC
+/// 	is not available
+///
+/// @returns current ticks
+///
+uint64_t TraceTicks() noexcept;
+
+
+/// This class records the span begin and end events in per-thread ring
+/// buffers. Recording is lock free and does nothing if tracing is disabled,
+/// so the instrumentation points can stay in hot paths. The oldest events
+/// are overwritten when a ring is full. Export can run while other threads
+/// are still recording, the events being overwritten are left out.
+class Tracer {
+public:
+
+	/// @brief get the only tracer of the process
+	///
+	/// @returns reference to tracer
+	///
+	static Tracer& Instance();
+
+
+	Tracer(const Tracer&) = delete;
+	Tracer& operator=(const Tracer&) = delete;
+
+
+	/// @brief clear previous events and start tracing
+	///
+	void Enable();
+
+
+	/// @brief stop tracing
+	///
+	void Disable();
+
+
+	/// @brief check whether tracing is enabled
+	///
+	/// @returns true if enabled
+	///
+	inline bool Enabled() const noexcept {
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+
+	/// @brief record an event of this thread
+	///
+	/// @param[in] name name of span, must be a string literal
+	/// @param[in] type begin or end of span
+	///
+	void Record(const char *name, TraceEventType type) noexcept;
+
+
+	/// @brief get recorded events, ordered by thread and then time
+	///
+	/// @returns list of events
+	///
+	std::vector<TraceEvent> Events() const;
+
+
+	/// @brief generate Chrome trace json, which can be opened by
+	/// 	chrome://tracing or Perfetto
+	///
+	/// @returns json in string
+	///
+	std::string ChromeTrace() const;
+
+
+	/// @brief export Chrome trace json to file
+	///
+	/// @param[in] path path of file
+	///
+	/// @throws UserError if failed to open file
+	///
+	void Export(const std::string &path) const;
+
+private:
+	friend struct TraceBufferHolder;
+
+	// events in each ring, power of 2
+	static const size_t kRingCapacity = 1 << 14;
+
+	/// ring buffer owned by one thread at a time
+	struct Ring {
+		// epoch of the events, the owner clears the ring in a new epoch
+		std::atomic<uint64_t> epoch{0};
+		// total number of events written in the epoch
+		std::atomic<size_t> written{0};
+		TraceEvent events[kRingCapacity];
+	};
+
+
+	/// @brief constructor
+	///
+	Tracer() noexcept;
+
+
+	/// @brief get a free ring for this thread
+	///
+	/// @returns pointer to ring, nullptr if failed
+	///
+	Ring* AcquireRing() noexcept;
+
+
+	/// @brief give back the ring when thread exits, events are kept
+	///
+	/// @param[in] ring ring to release
+	///
+	void ReleaseRing(Ring *ring) noexcept;
+
+
+	/// @brief get ticks per microsecond measured since enabled
+	///
+	/// @returns ticks per microsecond
+	///
+	double TicksPerMicrosecond() const;
+
+	std::atomic<bool> enabled_;
+	std::atomic<uint32_t> next_thread_;
+	// increased by every enabling, only events of this epoch are exported
+	std::atomic<uint64_t> epoch_;
+
+	// calibration of ticks
+	uint64_t start_ticks_;
+	std::chrono::steady_clock::time_point start_time_;
+
+	mutable std::mutex rings_lock_;
+	std::vector<std::unique_ptr<Ring>> rings_;
+	std::vector<Ring*> free_rings_;
+};
+
+
+/// This class records a span from its construction to destruction.
+class TraceSpan {
+public:
+
+	/// @brief constructor, record the begin event if tracing is enabled
+	///
+	/// @param[in] name name of span, must be a string literal
+	///
+	explicit TraceSpan(const char *name) noexcept
+	: name_(name), active_(Tracer::Instance().Enabled()) {
+		if (active_) {
+			Tracer::Instance().Record(name_, TraceEventType::kBegin);
+		}
+	}
+
+
+	/// @brief destructor, record the end event
+	///
+	~TraceSpan() {
+		if (active_) {
+			Tracer::Instance().Record(name_, TraceEventType::kEnd);
+		}
+	}
+
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+	const char *name_;
+	bool active_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __TRACE_H__
@@ -0,0 +1,148 @@
+#ifndef __TRACE_CODEC_H__
+#define __TRACE_CODEC_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/pipeline.h"
+
+namespace rxdaq {
+
+// samples in a block of encoded trace
+const size_t kTraceBlockSamples = 128;
+// flag in the first word of each block of encoded trace
+const uint32_t kTraceEncodedFlag = 0x80000000;
+
+
+/// @brief encode trace losslessly, append the encoded words to output
+///
+/// The trace is split into blocks of 128 samples. Each block starts with a
+/// word of the first sample in bits 0-15, the bit width in bits 16-20 and
+/// the encoded flag in bit 31, bits 21-30 are reserved as 0. The word is
+/// followed by the zigzag encoded deltas packed in 4 interleaved lanes of
+/// 32 values, which is 4 * width words. Blocks are independent so they can
+/// be decoded alone.
+///
+/// @param[in] samples samples of trace
+/// @param[in] size number of samples
+/// @param[out] output vector to append encoded words
+/// @returns number of words appended
+///
+size_t EncodeTrace(
+	const uint16_t *samples,
+	size_t size,
+	std::vector<uint32_t> &output
+);
+
+
+/// @brief decode one block of trace
+///
+/// @param[in] words encoded words starting from the block
+/// @param[in] size number of words available
+/// @param[in] samples number of samples in block, at most 128
+/// @param[out] output place to store decoded samples
+/// @returns number of words of the block
+///
+/// @throws RXError if the block is truncated or invalid
+///
+size_t DecodeTraceBlock(
+	const uint32_t *words,
+	size_t size,
+	size_t samples,
+	uint16_t *output
+);
+
+
+/// @brief decode trace
+///
+/// @param[in] words encoded words
+/// @param[in] size number of words available
+/// @param[in] samples number of samples of trace
+/// @param[out] output place to store decoded samples
+/// @returns number of words of the encoded trace
+///
+/// @throws RXError if the trace is truncated or invalid
+///
+size_t DecodeTrace(
+	const uint32_t *words,
+	size_t size,
+	size_t samples,
+	uint16_t *output
+);
+
+
+/// @brief check whether the trace of an event in packed format is encoded
+///
+/// An encoded event is always shorter than its raw trace, and the first
+/// word of its trace has the encoded flag. Other events are kept raw.
+///
+/// @param[in] event words of event
+/// @param[in] length words of event
+/// @param[in] header_length words of header
+/// @param[in] trace_length samples of trace in header
+/// @returns true if the trace is encoded
+///
+bool IsEncodedTrace(
+	const uint32_t *event,
+	uint32_t length,
+	uint32_t header_length,
+	uint32_t trace_length
+);
+
+
+/// @brief convert list mode data with encoded traces back to raw list mode
+/// 	data
+///
+/// @param[in] packed list mode data written in packed format
+/// @returns raw list mode data
+///
+/// @throws RXError if the data can't be decoded, or an event is marked
+/// 	encoded but its trace doesn't decode to exactly the event length
+///
+std::vector<uint32_t> UnpackListMode(const std::vector<uint32_t> &packed);
+
+
+/// This class is a pipeline stage encoding traces of events. The headers are
+/// kept except the event length, so events can still be framed by the
+/// header, while the trace length is the number of samples before encoding.
+/// Traces are only encoded if they get shorter, so the encoded events are
+/// told apart by IsEncodedTrace.
+class TraceEncoder : public Stage {
+public:
+
+	/// @brief default constructor
+	///
+	TraceEncoder() = default;
+
+
+	/// @brief default destructor
+	///
+	virtual ~TraceEncoder() = default;
+
+
+	/// @brief get name of stage
+	///
+	/// @returns name of stage 'codec'
+	///
+	inline virtual std::string Name() const override {
+		return "codec";
+	}
+
+
+	/// @brief encode traces of kept events and rewrite the raw words
+	///
+	/// @param[in,out] block block to process
+	///
+	virtual void Process(DataBlock &block) override;
+
+private:
+	// reused buffers
+	std::vector<uint32_t> output_;
+	std::vector<uint16_t> samples_;
+};
+
+}		// namespace rxdaq
+
+#endif		// __TRACE_CODEC_H__
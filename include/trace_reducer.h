@@ -0,0 +1,159 @@
+#ifndef __TRACE_REDUCER_H__
+#define __TRACE_REDUCER_H__
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "include/pipeline.h"
+
+namespace rxdaq {
+
+/// settings of trace reduction
+struct TraceReduction {
+	// samples to keep before the trigger
+	unsigned int pre;
+	// samples to keep from the trigger
+	unsigned int post;
+	// trigger sample in trace, -1 to find the leading edge of each trace
+	int trigger;
+	// drop the whole trace if energy is not smaller than it, 0 to disable
+	uint16_t drop_energy;
+};
+
+
+/// statistics of trace reduction
+struct TraceReductionStats {
+	// events processed
+	uint64_t events;
+	// traces dropped by energy
+	uint64_t dropped;
+	// samples before and after reduction
+	uint64_t input_samples;
+	uint64_t output_samples;
+};
+
+
+/// This class is a pipeline stage cutting the traces to the samples around
+/// the trigger, or dropping the traces of events passing the energy cut. The
+/// event length and trace length in headers are rewritten, so the output is
+/// still valid list mode data. The kept samples are copied as they are.
+class TraceReducer : public Stage {
+public:
+
+	/// @brief constructor
+	///
+	/// @param[in] reduction settings of reduction
+	///
+	TraceReducer(const TraceReduction &reduction) noexcept;
+
+
+	/// @brief default destructor
+	///
+	virtual ~TraceReducer() = default;
+
+
+	/// @brief get name of stage
+	///
+	/// @returns name of stage 'trace'
+	///
+	inline virtual std::string Name() const override {
+		return "trace";
+	}
+
+
+	/// @brief cut traces of the kept events and rewrite the raw words
+	///
+	/// @param[in,out] block block to process
+	///
+	virtual void Process(DataBlock &block) override;
+
+
+	/// @brief clear statistics
+	///
+	virtual void Reset() override;
+
+
+	/// @brief get statistics since reset
+	///
+	/// @returns statistics
+	///
+	TraceReductionStats Stats() const;
+
+
+	/// @brief get the window of samples kept of a trace, aligned to words
+	///
+	/// @param[in] trace trace words, two samples in a word
+	/// @param[in] length number of samples
+	/// @param[in] energy energy of event
+	/// @param[out] begin first sample to keep
+	/// @param[out] end sample after the last one to keep
+	/// @returns false if the trace is dropped by energy, and the window is
+	/// 	empty
+	///
+	bool Window(
+		const uint32_t *trace,
+		uint32_t length,
+		uint16_t energy,
+		uint32_t &begin,
+		uint32_t &end
+	);
+
+private:
+
+	/// @brief find the leading edge, the sample after the largest rise
+	///
+	/// @param[in] trace trace words, two samples in a word
+	/// @param[in] length number of samples
+	/// @returns sample index of leading edge
+	///
+	unsigned int FindLeadingEdge(const uint32_t *trace, unsigned int length);
+
+
+	TraceReduction reduction_;
+
+	mutable std::mutex stats_lock_;
+	TraceReductionStats stats_;
+
+	// reused buffers
+	std::vector<uint32_t> output_;
+	std::vector<uint16_t> samples_;
+	std::vector<int32_t> rises_;
+};
+
+
+/// result of comparing reduced traces with raw traces
+struct TraceCheck {
+	// events in reduced data
+	uint64_t events;
+	// events with trace in reduced data
+	uint64_t traces;
+	// samples in reduced data
+	uint64_t samples;
+	// events whose header or trace doesn't match raw data
+	uint64_t mismatches;
+};
+
+
+/// @brief check the reduced data against the raw data, every reduced event
+/// 	should have the same header, and its trace should be the window of
+/// 	the raw trace derived from the reduction settings
+///
+/// @param[in] raw raw list mode data
+/// @param[in] reduced reduced list mode data, may lack some raw events
+/// @param[in] reduction settings the data was reduced with
+/// @returns result of checking
+///
+/// @throws RXError if the data can't be decoded or a reduced event is not
+/// 	found in raw data
+///
+TraceCheck CheckReducedTraces(
+	const std::vector<uint32_t> &raw,
+	const std::vector<uint32_t> &reduced,
+	const TraceReduction &reduction
+);
+
+}		// namespace rxdaq
+
+#endif		// __TRACE_REDUCER_H__
@@ -0,0 +1,108 @@
+#ifndef __VERIFY_H__
+#define __VERIFY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+
+namespace rxdaq {
+
+/// problems found in data file, in order of severity
+enum class VerifyProblem {
+	kNone = 0,
+	// header length or event length is invalid, the rest can't be framed
+	kFraming,
+	// partial event at the end of file
+	kTruncated,
+	// event length doesn't match header length and trace length
+	kTraceLength,
+	// crate id is different from config
+	kCrate,
+	// slot is different from the module of file
+	kSlot,
+	// timestamp is less than the previous event of the same channel
+	kTimestamp
+};
+
+
+/// @brief get name of problem
+///
+/// @param[in] problem problem
+/// @returns name of problem
+///
+std::string VerifyProblemName(VerifyProblem problem) noexcept;
+
+
+/// expectation and settings of verifying
+struct VerifyOptions {
+	// expected crate id, negative to skip checking
+	int crate;
+	// expected slot of module index, files named with _Mxx are checked
+	// against slots[xx], empty to skip checking
+	std::vector<unsigned short> slots;
+	// number of threads, 0 to use all cores
+	unsigned int threads;
+	// words of data file in a chunk
+	size_t chunk_words;
+};
+
+
+/// result of verifying a data file
+struct VerifyReport {
+	std::string file;
+	uint64_t bytes;
+	uint64_t events;
+	// events with each problem
+	uint64_t trace_length_errors;
+	uint64_t crate_errors;
+	uint64_t slot_errors;
+	uint64_t timestamp_errors;
+	// bytes after framing error or partial event, not verified
+	uint64_t unverified_bytes;
+	// the problem at the smallest offset
+	VerifyProblem first_problem;
+	uint64_t first_offset;
+	std::string message;
+
+	/// @brief check whether the file has no problem
+	///
+	/// @returns true if no problem is found
+	///
+	inline bool Good() const noexcept {
+		return first_problem == VerifyProblem::kNone;
+	}
+};
+
+
+/// @brief get module index from name of data file, e.g. data_R0001_M02.bin
+///
+/// @param[in] path path of data file
+/// @returns module index, or -1 if the name has no module
+///
+int ModuleOfDataFile(const std::string &path) noexcept;
+
+
+/// @brief verify events of data files in parallel
+///
+/// Files are memory-mapped and framed by the headers, the framing stops at
+/// the first invalid header. The framed events are split into chunks and
+/// checked in parallel. Timestamps are checked for each channel across
+/// chunks. Events of packed files (.rxp) are not checked for trace length.
+///
+/// @param[in] files data files
+/// @param[in] options expectation and settings
+/// @returns reports of files in the same order
+///
+/// @throws RXError if failed to read files
+///
+std::vector<VerifyReport> VerifyRun(
+	const std::vector<std::string> &files,
+	const VerifyOptions &options
+);
+
+}		// namespace rxdaq
+
+#endif		// __VERIFY_H__
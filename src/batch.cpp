@@ -0,0 +1,263 @@
+#include "include/batch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+const std::map<std::string, BatchStepType> kBatchStepTypes = {
+	{"boot", BatchStepType::kBoot},
+	{"write", BatchStepType::kWrite},
+	{"task", BatchStepType::kTask},
+	{"import", BatchStepType::kImport},
+	{"export", BatchStepType::kExport},
+	{"run", BatchStepType::kRun}
+};
+
+
+/// @brief parse a step of batch plan
+///
+/// @param[in] json json of step
+/// @param[in] index index of step, used in error message
+/// @returns step
+///
+BatchStep ParseBatchStep(const nlohmann::json &json, size_t index) {
+	const std::string step_name = "Step " + std::to_string(index);
+	if (!json.contains("type")) {
+		throw UserError(step_name + " lack of parameter \"type\".");
+	}
+	auto search = kBatchStepTypes.find(json["type"].get<std::string>());
+	if (search == kBatchStepTypes.end()) {
+		throw UserError(
+			step_name + " has invalid type " + json["type"].dump() + "."
+		);
+	}
+
+	BatchStep step;
+	step.type = search->second;
+	step.name = "";
+	step.module = json.value("module", kModuleNum);
+	step.channel = json.value("channel", kChannelNum);
+	step.value = 0.0;
+	step.fast = json.value("fast", true);
+	step.seconds = json.value("seconds", 0u);
+	step.run = json.value("run", -1);
+	step.repeat = json.value("repeat", 1u);
+
+	if (step.module > kModuleNum) {
+		throw UserError(step_name + " module should be smaller than 13.");
+	}
+	if (step.channel > kChannelNum) {
+		throw UserError(step_name + " channel should be smaller than 16.");
+	}
+	if (step.repeat == 0) {
+		throw UserError(step_name + " repeat should be positive.");
+	}
+
+	// parameters required by type
+	std::vector<std::string> required;
+	if (step.type == BatchStepType::kWrite) {
+		required = {"name", "value"};
+	} else if (step.type == BatchStepType::kTask) {
+		required = {"name"};
+	} else if (
+		step.type == BatchStepType::kImport ||
+		step.type == BatchStepType::kExport
+	) {
+		required = {"path"};
+	}
+	for (const auto &name : required) {
+		if (!json.contains(name)) {
+			throw UserError(
+				step_name + " lack of parameter \"" + name + "\"."
+			);
+		}
+	}
+	if (json.contains("name")) {
+		step.name = json["name"].get<std::string>();
+	}
+	if (json.contains("path")) {
+		step.name = json["path"].get<std::string>();
+	}
+	if (json.contains("value")) {
+		step.value = json["value"].get<double>();
+	}
+	return step;
+}
+
+
+BatchPlan ParseBatchPlan(const nlohmann::json &json) {
+	BatchPlan plan;
+	try {
+		if (!json.contains("steps") || !json["steps"].is_array()) {
+			throw UserError("Batch plan lack of parameter \"steps\".");
+		}
+		for (size_t i = 0; i < json["steps"].size(); ++i) {
+			plan.steps.push_back(ParseBatchStep(json["steps"][i], i));
+		}
+		nlohmann::json stop = json.value("stop", nlohmann::json::object());
+		plan.stop_file = stop.value("file", "");
+		plan.max_seconds = stop.value("seconds", 0u);
+		plan.max_runs = stop.value("runs", 0u);
+		plan.keep_going = json.value("keepGoing", false);
+	} catch (const nlohmann::json::exception &e) {
+		throw UserError("Invalid batch plan: " + std::string(e.what()));
+	}
+	return plan;
+}
+
+
+BatchPlan ReadBatchPlan(const std::string &path) {
+	std::ifstream fin(path);
+	if (!fin.good()) {
+		throw UserError("Open file " + path + " failed.");
+	}
+	nlohmann::json json = nlohmann::json::parse(fin, nullptr, false);
+	fin.close();
+	if (json.is_discarded()) {
+		throw UserError("Parse batch plan " + path + " failed.");
+	}
+	return ParseBatchPlan(json);
+}
+
+
+//-----------------------------------------------------------------------------
+// 								BatchRunner
+//-----------------------------------------------------------------------------
+
+BatchRunner::BatchRunner(std::shared_ptr<Crate> crate) noexcept
+: crate_(crate), finished_runs_(0), next_run_(-1) {
+}
+
+
+size_t BatchRunner::Run(const BatchPlan &plan) {
+	start_time_ = std::chrono::steady_clock::now();
+	finished_runs_ = 0;
+	next_run_ = -1;
+	size_t failed = 0;
+	for (size_t i = 0; i < plan.steps.size(); ++i) {
+		if (ShouldStop(plan)) break;
+		try {
+			if (plan.steps[i].type == BatchStepType::kRun) {
+				ExecuteRun(plan, i);
+			} else {
+				Execute(plan.steps[i]);
+			}
+		} catch (const std::exception &e) {
+			if (!plan.keep_going) {
+				if (preparing_.valid()) preparing_.wait();
+				throw;
+			}
+			std::cerr << "batch step " << i << " failed: " << e.what() << "\n";
+			++failed;
+		}
+	}
+	if (preparing_.valid()) preparing_.wait();
+	return failed;
+}
+
+
+void BatchRunner::Execute(const BatchStep &step) {
+	switch (step.type) {
+		case BatchStepType::kBoot:
+			crate_->Boot(step.module, step.fast);
+			break;
+		case BatchStepType::kWrite:
+			if (step.channel == kChannelNum) {
+				crate_->WriteParameter(
+					step.name, static_cast<unsigned int>(step.value), step.module
+				);
+			} else {
+				crate_->WriteParameter(
+					step.name, step.value, step.module, step.channel
+				);
+			}
+			break;
+		case BatchStepType::kTask:
+			crate_->Task(step.name, step.module);
+			break;
+		case BatchStepType::kImport:
+			crate_->ImportParameters(step.name);
+			break;
+		case BatchStepType::kExport:
+			crate_->ExportParameters(step.name);
+			break;
+		default:
+			throw RXError("Run step should be executed by ExecuteRun.");
+	}
+}
+
+
+void BatchRunner::ExecuteRun(const BatchPlan &plan, size_t index) {
+	const BatchStep &step = plan.steps[index];
+	for (unsigned int i = 0; i < step.repeat; ++i) {
+		if (i && ShouldStop(plan)) return;
+
+		if (preparing_.valid()) {
+			try {
+				preparing_.get();
+			} catch (const std::exception&) {
+				// StartRun prepares again and reports the error
+			}
+		}
+		// start the run prepared with its number, so the crate never reads
+		// the run number while the previous run is finishing
+		int request = i || step.run == -1 ? next_run_ : step.run;
+		next_run_ = -1;
+		unsigned int run = crate_->StartRun(step.module, step.seconds, request);
+
+		// find the next run
+		const BatchStep *next = nullptr;
+		int next_run = run + 1;
+		if (i + 1 < step.repeat) {
+			next = &step;
+		} else {
+			for (size_t j = index + 1; j < plan.steps.size(); ++j) {
+				if (plan.steps[j].type == BatchStepType::kRun) {
+					next = &plan.steps[j];
+					if (next->run != -1) next_run = next->run;
+					break;
+				}
+			}
+		}
+		if (next && !(plan.max_runs && finished_runs_ + 1 >= plan.max_runs)) {
+			// prepare output files of the next run while this run is taking
+			// data
+			auto crate = crate_;
+			unsigned short module = next->module;
+			next_run_ = next_run;
+			preparing_ = std::async(
+				std::launch::async,
+				[crate, module, next_run]() {
+					crate->PrepareRun(module, next_run);
+				}
+			);
+		}
+
+		WaitRunInterruptibly(*crate_);
+		++finished_runs_;
+	}
+}
+
+
+bool BatchRunner::ShouldStop(const BatchPlan &plan) const {
+	if (plan.max_runs && finished_runs_ >= plan.max_runs) {
+		return true;
+	}
+	if (plan.max_seconds) {
+		auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::steady_clock::now() - start_time_
+		).count();
+		if (seconds >= plan.max_seconds) return true;
+	}
+	if (!plan.stop_file.empty() && std::filesystem::exists(plan.stop_file)) {
+		return true;
+	}
+	return false;
+}
+
+}		// namespace rxdaq
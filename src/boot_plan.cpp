@@ -0,0 +1,140 @@
+#include "include/boot_plan.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "nlohmann/json.hpp"
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+BootPlan PlanBoot(
+	const std::vector<ModuleBootState> &current,
+	const std::vector<ModuleBootState> &target,
+	const std::vector<unsigned short> &modules,
+	bool force
+) {
+	if (current.size() != target.size()) {
+		throw RXError("Size of current and target boot states don't match.");
+	}
+
+	BootPlan result;
+	for (const auto &m : modules) {
+		if (m >= current.size()) {
+			throw UserError(
+				"Module " + std::to_string(m) + " is not in the crate."
+			);
+		}
+		if (force) {
+			result.push_back({m, BootAction::kBoot, "forced"});
+		} else if (!current[m].online) {
+			result.push_back({m, BootAction::kBoot, "offline"});
+		} else if (current[m].firmware != target[m].firmware) {
+			result.push_back({m, BootAction::kBoot, "firmware changed"});
+		} else if (
+			current[m].parameter_hash != target[m].parameter_hash
+			|| current[m].parameter_hash == kUnknownParameterHash
+			|| target[m].parameter_hash == kMissingParameterHash
+		) {
+			result.push_back({m, BootAction::kImport, "parameters changed"});
+		} else {
+			result.push_back({m, BootAction::kNone, "up to date"});
+		}
+	}
+	return result;
+}
+
+
+std::vector<unsigned short> PlannedModules(
+	const BootPlan &plan,
+	BootAction action
+) {
+	std::vector<unsigned short> result;
+	for (const auto &module_plan : plan) {
+		if (
+			module_plan.action == action ||
+			(
+				action == BootAction::kImport &&
+				module_plan.action == BootAction::kBoot
+			)
+		) {
+			result.push_back(module_plan.module);
+		}
+	}
+	return result;
+}
+
+
+std::string BootPlanInfo(const BootPlan &plan) {
+	std::stringstream ss;
+	ss << "module  action  reason\n";
+	for (const auto &module_plan : plan) {
+		ss << std::setw(6) << module_plan.module
+			<< std::setw(8) << kBootActionNames.at(module_plan.action)
+			<< "  " << module_plan.reason << "\n";
+	}
+	return ss.str();
+}
+
+
+std::string FirmwareIdentity(const Config &config, size_t index) {
+	std::stringstream ss;
+	ss << config.Version(index) << ":" << config.Revision(index)
+		<< ":" << config.Rate(index) << ":" << config.Bits(index)
+		<< ":" << config.Sys(index) << ":" << config.Fippi(index)
+		<< ":" << config.Ldr(index) << ":" << config.Var(index);
+	return ss.str();
+}
+
+
+/// @brief FNV-1a hash of bytes
+///
+/// @param[in] bytes bytes to hash
+/// @returns 64-bit hash value, never kUnknownParameterHash or
+/// 	kMissingParameterHash
+///
+static uint64_t HashBytes(const std::string &bytes) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char &c : bytes) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ull;
+	}
+	// keep the special values for states
+	if (hash == kUnknownParameterHash || hash == kMissingParameterHash) {
+		hash += 2;
+	}
+	return hash;
+}
+
+
+std::vector<uint64_t> ParameterHashes(
+	const std::string &path,
+	unsigned short module_num
+) {
+	std::ifstream fin(path, std::ios::in);
+	if (!fin.good()) {
+		return std::vector<uint64_t>(module_num, kMissingParameterHash);
+	}
+	std::stringstream ss;
+	ss << fin.rdbuf();
+	fin.close();
+	const std::string content = ss.str();
+
+	// parameter file exported by crate is an array of modules, so hash them
+	// separately, and changing one module won't affect the others
+	nlohmann::json json = nlohmann::json::parse(content, nullptr, false);
+	if (!json.is_discarded() && json.is_array()) {
+		std::vector<uint64_t> result;
+		for (unsigned short i = 0; i < module_num; ++i) {
+			result.push_back(
+				i < json.size() ? HashBytes(json[i].dump()) : kMissingParameterHash
+			);
+		}
+		return result;
+	}
+	return std::vector<uint64_t>(module_num, HashBytes(content));
+}
+
+}		// namespace rxdaq
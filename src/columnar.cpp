@@ -0,0 +1,491 @@
+#include "include/columnar.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#include "nlohmann/json.hpp"
+
+#include "include/error.h"
+#include "include/mapped_file.h"
+#include "include/parallel.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+const std::vector<std::string> kColumnNames = {
+	"time",
+	"crate",
+	"slot",
+	"channel",
+	"energy",
+	"cfd",
+	"finish_code",
+	"trace_offset",
+	"trace_length"
+};
+
+// "RXCC" in little endian
+const uint32_t kChunkMagic = 0x43435852;
+const uint32_t kChunkVersion = 1;
+
+/// header at the beginning of chunk file
+struct ChunkHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t columns;
+	uint32_t reserved;
+	uint64_t events;
+};
+
+/// header of each column after the chunk header
+struct ColumnHeader {
+	uint32_t column;
+	uint32_t reserved;
+	uint64_t min;
+	uint64_t max;
+	// offset of encoded words in file in bytes
+	uint64_t offset;
+	uint64_t words;
+};
+
+
+/// @brief get mask of lower bits
+///
+/// @param[in] bits number of bits, at most 32
+/// @returns mask
+///
+inline uint64_t LowMask(uint32_t bits) {
+	return (uint64_t(1) << bits) - 1;
+}
+
+
+size_t EncodeColumn(
+	const uint64_t *values,
+	size_t size,
+	std::vector<uint32_t> &output
+) {
+	const size_t start = output.size();
+	for (size_t begin = 0; begin < size; begin += kColumnBlockValues) {
+		const size_t count = std::min(kColumnBlockValues, size - begin);
+		const uint64_t *block = values + begin;
+		uint64_t min = block[0];
+		uint64_t max = block[0];
+		for (size_t i = 1; i < count; ++i) {
+			min = std::min(min, block[i]);
+			max = std::max(max, block[i]);
+		}
+		uint32_t width = 0;
+		while (width < 64 && ((max - min) >> width)) ++width;
+
+		output.push_back(width);
+		output.push_back(min & 0xffffffff);
+		output.push_back(min >> 32);
+		// accumulate less than 32 bits, and add at most 32 bits each time
+		uint64_t acc = 0;
+		uint32_t pending = 0;
+		for (size_t i = 0; i < count; ++i) {
+			uint64_t value = block[i] - min;
+			for (uint32_t left = width; left;) {
+				uint32_t take = std::min(left, 32u);
+				acc |= (value & LowMask(take)) << pending;
+				pending += take;
+				value >>= take;
+				left -= take;
+				if (pending >= 32) {
+					output.push_back(acc & 0xffffffff);
+					acc >>= 32;
+					pending -= 32;
+				}
+			}
+		}
+		if (pending) {
+			output.push_back(acc & 0xffffffff);
+		}
+	}
+	return output.size() - start;
+}
+
+
+size_t DecodeColumn(
+	const uint32_t *words,
+	size_t size,
+	size_t values,
+	uint64_t *output
+) {
+	size_t position = 0;
+	for (size_t begin = 0; begin < values; begin += kColumnBlockValues) {
+		const size_t count = std::min(kColumnBlockValues, values - begin);
+		if (position + 3 > size) {
+			throw RXError("Column block is truncated.");
+		}
+		const uint32_t width = words[position];
+		if (width > 64) {
+			throw RXError("Invalid bit width " + std::to_string(width) + " of column block.");
+		}
+		const uint64_t min = words[position+1] | (uint64_t(words[position+2]) << 32);
+		position += 3;
+		const size_t length = (count * width + 31) / 32;
+		if (position + length > size) {
+			throw RXError("Column block is truncated.");
+		}
+
+		const uint32_t *packed = words + position;
+		uint64_t acc = 0;
+		uint32_t available = 0;
+		for (size_t i = 0; i < count; ++i) {
+			uint64_t value = 0;
+			uint32_t shift = 0;
+			for (uint32_t left = width; left;) {
+				uint32_t take = std::min(left, 32u);
+				if (available < take) {
+					acc |= uint64_t(*packed++) << available;
+					available += 32;
+				}
+				value |= (acc & LowMask(take)) << shift;
+				acc >>= take;
+				available -= take;
+				shift += take;
+				left -= take;
+			}
+			output[begin + i] = min + value;
+		}
+		position += length;
+	}
+	return position;
+}
+
+
+std::vector<FileChunk> SplitChunks(
+	const uint32_t *words,
+	size_t size,
+	size_t chunk_words
+) {
+	std::vector<FileChunk> result;
+	// offsets of decoded events are 32 bits
+	chunk_words = std::clamp(chunk_words, size_t(1), size_t(1) << 30);
+	uint64_t begin = 0;
+	uint64_t position = 0;
+	while (position + kMinHeaderLength <= size) {
+		const uint32_t header = words[position];
+		uint32_t header_length = (header >> kHeaderLengthShift) & kHeaderLengthMask;
+		uint32_t event_length = (header >> kEventLengthShift) & kEventLengthMask;
+		if (header_length < kMinHeaderLength || event_length < header_length) {
+			throw RXError(
+				"Invalid list mode header at word " + std::to_string(position)
+				+ ", header length " + std::to_string(header_length)
+				+ ", event length " + std::to_string(event_length) + "."
+			);
+		}
+		if (position + event_length > size) break;
+		position += event_length;
+		if (position - begin >= chunk_words) {
+			result.push_back(FileChunk{begin, position});
+			begin = position;
+		}
+	}
+	if (position > begin) {
+		result.push_back(FileChunk{begin, position});
+	}
+	return result;
+}
+
+
+EventColumns DecodeChunk(const uint32_t *words, const FileChunk &chunk) {
+	EventBatch events;
+	const size_t size = chunk.end - chunk.begin;
+	if (DecodeListMode(words + chunk.begin, size, events) != size) {
+		throw RXError(
+			"Chunk at word " + std::to_string(chunk.begin)
+			+ " ends with incomplete event."
+		);
+	}
+
+	EventColumns columns;
+	columns.time = std::move(events.time);
+	columns.crate = std::move(events.crate);
+	columns.slot = std::move(events.slot);
+	columns.channel = std::move(events.channel);
+	columns.energy = std::move(events.energy);
+	columns.cfd = std::move(events.cfd);
+	columns.finish_code = std::move(events.finish_code);
+	columns.trace_length = std::move(events.trace_length);
+	columns.trace_offset.resize(events.Size());
+	for (size_t i = 0; i < events.Size(); ++i) {
+		columns.trace_offset[i] = (
+			chunk.begin + events.offset[i] + events.header_length[i]
+		) * sizeof(uint32_t);
+	}
+	return columns;
+}
+
+
+/// @brief call function with each column converted to 64 bits values, in
+/// 	the order of Column
+///
+/// @param[in] columns events
+/// @param[in] function function called with index and values of column
+///
+template<typename Function>
+void ForEachColumn(const EventColumns &columns, Function function) {
+	std::vector<uint64_t> values;
+	auto call = [&](size_t index, const auto &column) {
+		values.assign(column.begin(), column.end());
+		function(index, values);
+	};
+	call(size_t(Column::kTime), columns.time);
+	call(size_t(Column::kCrate), columns.crate);
+	call(size_t(Column::kSlot), columns.slot);
+	call(size_t(Column::kChannel), columns.channel);
+	call(size_t(Column::kEnergy), columns.energy);
+	call(size_t(Column::kCfd), columns.cfd);
+	call(size_t(Column::kFinishCode), columns.finish_code);
+	call(size_t(Column::kTraceOffset), columns.trace_offset);
+	call(size_t(Column::kTraceLength), columns.trace_length);
+}
+
+
+/// @brief get minimum and maximum of values
+///
+/// @param[in] values values
+/// @returns statistics, zeros if empty
+///
+ColumnStats ValueStats(const std::vector<uint64_t> &values) {
+	if (values.empty()) return ColumnStats{0, 0};
+	auto [min, max] = std::minmax_element(values.begin(), values.end());
+	return ColumnStats{*min, *max};
+}
+
+
+std::vector<ColumnStats> ComputeStats(const EventColumns &columns) {
+	std::vector<ColumnStats> result(kColumnNames.size());
+	ForEachColumn(columns, [&](size_t index, const std::vector<uint64_t> &values) {
+		result[index] = ValueStats(values);
+	});
+	return result;
+}
+
+
+uint64_t WriteColumnChunk(const std::string &path, const EventColumns &columns) {
+	std::vector<ColumnHeader> headers(kColumnNames.size());
+	std::vector<uint32_t> data;
+	uint64_t offset = sizeof(ChunkHeader) + headers.size() * sizeof(ColumnHeader);
+	ForEachColumn(columns, [&](size_t index, const std::vector<uint64_t> &values) {
+		ColumnStats stats = ValueStats(values);
+		uint64_t words = EncodeColumn(values.data(), values.size(), data);
+		headers[index] = ColumnHeader{
+			uint32_t(index), 0, stats.min, stats.max, offset, words
+		};
+		offset += words * sizeof(uint32_t);
+	});
+
+	ChunkHeader header{
+		kChunkMagic, kChunkVersion, uint32_t(headers.size()), 0, columns.Size()
+	};
+	std::ofstream fout(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(
+		reinterpret_cast<const char*>(headers.data()),
+		headers.size() * sizeof(ColumnHeader)
+	);
+	fout.write(
+		reinterpret_cast<const char*>(data.data()),
+		data.size() * sizeof(uint32_t)
+	);
+	fout.close();
+	if (!fout.good()) {
+		throw RXError("Write chunk file " + path + " failed.");
+	}
+	return offset;
+}
+
+
+/// @brief read header and column headers of chunk file
+///
+/// @param[in] fin stream of chunk file
+/// @param[in] path path of chunk file, for error message
+/// @param[out] header chunk header
+/// @returns headers of columns
+///
+/// @throws RXError if it's not a chunk file
+///
+std::vector<ColumnHeader> ReadChunkHeaders(
+	std::ifstream &fin,
+	const std::string &path,
+	ChunkHeader &header
+) {
+	if (!fin.good()) {
+		throw RXError("Open chunk file " + path + " failed.");
+	}
+	fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (
+		fin.gcount() != sizeof(header)
+		|| header.magic != kChunkMagic
+		|| header.columns != kColumnNames.size()
+	) {
+		throw RXError("File " + path + " is not a valid chunk file.");
+	}
+	if (header.version != kChunkVersion) {
+		throw RXError(
+			"Chunk version " + std::to_string(header.version)
+			+ " of " + path + " is not supported."
+		);
+	}
+	std::vector<ColumnHeader> headers(header.columns);
+	fin.read(
+		reinterpret_cast<char*>(headers.data()),
+		headers.size() * sizeof(ColumnHeader)
+	);
+	if (size_t(fin.gcount()) != headers.size() * sizeof(ColumnHeader)) {
+		throw RXError("File " + path + " is not a valid chunk file.");
+	}
+	return headers;
+}
+
+
+std::vector<ColumnStats> ReadChunkStats(const std::string &path) {
+	std::ifstream fin(path, std::ios::in | std::ios::binary);
+	ChunkHeader header;
+	std::vector<ColumnHeader> headers = ReadChunkHeaders(fin, path, header);
+	std::vector<ColumnStats> result;
+	for (const auto &column : headers) {
+		result.push_back(ColumnStats{column.min, column.max});
+	}
+	return result;
+}
+
+
+EventColumns ReadColumnChunk(const std::string &path) {
+	std::ifstream fin(path, std::ios::in | std::ios::binary);
+	ChunkHeader header;
+	std::vector<ColumnHeader> headers = ReadChunkHeaders(fin, path, header);
+
+	std::vector<std::vector<uint64_t>> values(headers.size());
+	std::vector<uint32_t> words;
+	for (size_t i = 0; i < headers.size(); ++i) {
+		words.resize(headers[i].words);
+		fin.seekg(headers[i].offset, std::ios::beg);
+		fin.read(
+			reinterpret_cast<char*>(words.data()),
+			words.size() * sizeof(uint32_t)
+		);
+		if (size_t(fin.gcount()) != words.size() * sizeof(uint32_t)) {
+			throw RXError("Chunk file " + path + " is truncated.");
+		}
+		values[i].resize(header.events);
+		DecodeColumn(words.data(), words.size(), header.events, values[i].data());
+	}
+
+	EventColumns columns;
+	auto assign = [&](Column column, auto &output) {
+		const auto &input = values[size_t(column)];
+		output.resize(input.size());
+		std::copy(input.begin(), input.end(), output.begin());
+	};
+	assign(Column::kTime, columns.time);
+	assign(Column::kCrate, columns.crate);
+	assign(Column::kSlot, columns.slot);
+	assign(Column::kChannel, columns.channel);
+	assign(Column::kEnergy, columns.energy);
+	assign(Column::kCfd, columns.cfd);
+	assign(Column::kFinishCode, columns.finish_code);
+	assign(Column::kTraceOffset, columns.trace_offset);
+	assign(Column::kTraceLength, columns.trace_length);
+	return columns;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								convert
+//-----------------------------------------------------------------------------
+
+/// a chunk of a data file to convert
+struct ConvertTask {
+	size_t file;
+	size_t index;
+	FileChunk chunk;
+	// results
+	std::string name;
+	uint64_t events;
+	uint64_t bytes;
+	std::vector<ColumnStats> stats;
+};
+
+
+ConvertResult ConvertRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	unsigned int threads,
+	size_t chunk_words
+) {
+	TraceSpan trace_span("ConvertRun");
+	std::filesystem::create_directories(output);
+
+	// map files and split them at event boundaries
+	ConvertResult result{files.size(), 0, 0, 0, 0};
+	std::vector<std::unique_ptr<MappedFile>> mapped;
+	std::vector<ConvertTask> tasks;
+	for (size_t f = 0; f < files.size(); ++f) {
+		mapped.push_back(std::make_unique<MappedFile>(files[f]));
+		const MappedFile &file = *mapped.back();
+		file.AdviseSequential();
+		result.input_bytes += file.Size();
+		std::vector<FileChunk> chunks =
+			SplitChunks(file.Words(), file.WordSize(), chunk_words);
+		std::string stem = std::filesystem::path(files[f]).stem().string();
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			std::stringstream name;
+			name << stem << "_C" << std::setfill('0') << std::setw(4) << i << ".rxc";
+			tasks.push_back(ConvertTask{f, i, chunks[i], name.str(), 0, 0, {}});
+		}
+	}
+
+	// decode and encode chunks in parallel
+	ParallelFor(tasks.size(), threads, [&](size_t t) {
+		TraceSpan chunk_span("convert chunk");
+		ConvertTask &task = tasks[t];
+		EventColumns columns = DecodeChunk(mapped[task.file]->Words(), task.chunk);
+		task.events = columns.Size();
+		task.stats = ComputeStats(columns);
+		task.bytes = WriteColumnChunk(
+			(std::filesystem::path(output) / task.name).string(), columns
+		);
+	});
+
+	// list chunks and statistics in manifest
+	nlohmann::json manifest;
+	manifest["version"] = kChunkVersion;
+	manifest["columns"] = kColumnNames;
+	manifest["chunks"] = nlohmann::json::array();
+	for (const auto &task : tasks) {
+		nlohmann::json chunk;
+		chunk["file"] = task.name;
+		chunk["source"] = std::filesystem::path(files[task.file]).filename().string();
+		chunk["begin"] = task.chunk.begin * sizeof(uint32_t);
+		chunk["end"] = task.chunk.end * sizeof(uint32_t);
+		chunk["events"] = task.events;
+		for (size_t i = 0; i < kColumnNames.size(); ++i) {
+			chunk["min"][kColumnNames[i]] = task.stats[i].min;
+			chunk["max"][kColumnNames[i]] = task.stats[i].max;
+		}
+		manifest["chunks"].push_back(chunk);
+		++result.chunks;
+		result.events += task.events;
+		result.output_bytes += task.bytes;
+	}
+	std::ofstream fout(
+		(std::filesystem::path(output) / "manifest.json").string()
+	);
+	fout << manifest.dump(4) << std::endl;
+	if (!fout.good()) {
+		throw RXError("Write manifest of " + output + " failed.");
+	}
+	return result;
+}
+
+}		// namespace rxdaq
@@ -6,6 +6,8 @@
 #include <iomanip>
 #include <iostream>
 
+#include "include/endpoint.h"
+
 namespace rxdaq {
 
 const std::string top_level_parameters[] = {
@@ -37,6 +39,14 @@ const std::string run_parameters[] = {
 	"number"
 };
 
+// fill marks of module FIFO if not set
+const std::vector<double> kDefaultFifoMarks = {0.5, 0.8, 0.95};
+
+
+
+Config::Config() noexcept
+: crate_id_(0), run_({"", "", 0, "raw", kStatsInterval, kDefaultFifoMarks}) {
+}
 
 
 bool CheckLogLevel(const std::string &level) {
@@ -74,6 +84,15 @@ void Config::CheckTopLevelParameters() {
 	if (json_["crateId"] < 0) {
 		throw std::runtime_error("crateId should be positive.\n");
 	}
+	if (json_.contains("rpcEndpoint")) {
+		const auto &endpoint = json_["rpcEndpoint"];
+		if (!endpoint.is_string() || !CheckEndpoint(endpoint)) {
+			throw std::runtime_error(
+				"rpcEndpoint " + endpoint.dump()
+				+ " is invalid(unix:<path> or <host>:<port>).\n"
+			);
+		}
+	}
 }
 
 
@@ -165,7 +184,7 @@ void Config::CheckModulesParameters() {
 			);
 		}
 		for (size_t i = 0; i < index; ++i) {
-			if (module["slot"] == Slot(i)) {
+			if (module["slot"] == json_["modules"][i]["slot"]) {
 				throw std::runtime_error(
 					"Module " + std::to_string(i) + " and module "
 					+ std::to_string(index) + " share the same slot "
@@ -231,9 +250,88 @@ void Config::CheckRunParameters() {
 			throw std::runtime_error("Run lack of parameter \"" + name + "\".\n");
 		}
 	}
-	if (RunDataPath().back() != '/') {
-		SetRunDataPath(RunDataPath()+"/");
+	std::string path = json_["run"]["dataPath"];
+	if (path.back() != '/') {
+		json_["run"]["dataPath"] = path + "/";
+	}
+	if (json_["run"].contains("format")) {
+		std::string format = json_["run"]["format"];
+		if (format != "raw" && format != "packed") {
+			throw std::runtime_error(
+				"Run format \"" + format + "\" is invalid(raw or packed).\n"
+			);
+		}
+	}
+	if (json_["run"].contains("statsInterval")) {
+		const auto &interval = json_["run"]["statsInterval"];
+		if (!interval.is_number() || interval.get<double>() < 0) {
+			throw std::runtime_error(
+				"Run stats interval " + interval.dump()
+				+ " is invalid(0 or positive seconds).\n"
+			);
+		}
 	}
+	if (json_["run"].contains("fifoMarks")) {
+		const auto &marks = json_["run"]["fifoMarks"];
+		bool valid = marks.is_array()
+			&& !marks.empty() && marks.size() <= kMaxFifoMarks;
+		double last = 0.0;
+		for (size_t i = 0; valid && i < marks.size(); ++i) {
+			valid = marks[i].is_number()
+				&& marks[i].get<double>() > last && marks[i].get<double>() <= 1.0;
+			if (valid) last = marks[i].get<double>();
+		}
+		if (!valid) {
+			throw std::runtime_error(
+				"Run FIFO marks " + marks.dump() + " are invalid(1 - "
+				+ std::to_string(kMaxFifoMarks)
+				+ " ascending fractions in (0, 1]).\n"
+			);
+		}
+	}
+}
+
+
+void Config::Extract() {
+	message_level_ = json_["messageLevel"];
+	xia_log_level_ = json_["xiaLogLevel"];
+	crate_id_ = json_["crateId"];
+	parameter_file_ = json_["parameterFile"];
+	rpc_endpoint_ = json_.value("rpcEndpoint", "");
+
+	// resolve templates once, modules refer to templates by name
+	std::map<std::string, const nlohmann::json*> templates;
+	if (json_.contains("templates")) {
+		for (const auto &temp : json_["templates"]) {
+			templates[temp["name"]] = &temp;
+		}
+	}
+	modules_.clear();
+	for (const auto &module : json_["modules"]) {
+		// field in module overrides the one in template
+		auto field = [&](const std::string &name) -> const nlohmann::json& {
+			if (module.contains(name)) return module[name];
+			return (*templates.at(module["template"]))[name];
+		};
+		ModuleConfig config;
+		config.slot = module["slot"];
+		config.revision = field("rev");
+		config.rate = field("rate");
+		config.bits = field("bits");
+		config.version = field("version");
+		config.ldr = field("ldr");
+		config.var = field("var");
+		config.fippi = field("fippi");
+		config.sys = field("sys");
+		modules_.push_back(config);
+	}
+
+	run_.data_path = json_["run"]["dataPath"];
+	run_.data_file = json_["run"]["dataFile"];
+	run_.number = json_["run"]["number"];
+	run_.format = json_["run"].value("format", "raw");
+	run_.stats_interval = json_["run"].value("statsInterval", kStatsInterval);
+	run_.fifo_marks = json_["run"].value("fifoMarks", kDefaultFifoMarks);
 }
 
 
@@ -255,6 +353,8 @@ void Config::ReadFromFile(const std::string &file_name) {
 
 	CheckRunParameters();
 
+	Extract();
+
 	return;
 }
 
@@ -267,6 +367,11 @@ void Config::WriteToFile(const std::string &file_name) {
 		throw std::runtime_error("Open file \"" + file_name + "\" failed.\n");
 	}
 
+	// run settings may be changed through setters
+	json_["run"]["dataPath"] = run_.data_path;
+	json_["run"]["dataFile"] = run_.data_file;
+	json_["run"]["number"] = run_.number;
+
 	fout << json_.dump(4) << std::endl;
 	fout.close();
 }
@@ -41,6 +41,7 @@ grpc::Status ControlCrateService::Initialize(
 	const EmptyMessage*,
 	InitializeReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::Initialize");
 	
 	return HandleError(
 		[](
@@ -59,17 +60,53 @@ grpc::Status ControlCrateService::Initialize(
 grpc::Status ControlCrateService::Boot(
 	grpc::ServerContext*,
 	const BootRequest *request,
-	EmptyReply *reply
+	BootReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::Boot");
 
 	return HandleError(
 		[](
-			EmptyReply*,
+			BootReply *reply,
 			std::shared_ptr<Crate> crate,
 			unsigned short module,
 			bool fast
 		) {
 			crate->Boot(module, fast);
+			for (const auto &phase_timing : crate->BootTimings()) {
+				auto timing = reply->add_timings();
+				timing->set_phase(phase_timing.phase);
+				timing->set_module(phase_timing.module);
+				timing->set_milliseconds(phase_timing.milliseconds);
+			}
+		},
+		reply,
+		crate_,
+		request->module(),
+		request->fast()
+	);
+}
+
+
+grpc::Status ControlCrateService::PlanBoot(
+	grpc::ServerContext*,
+	const BootRequest *request,
+	BootPlanReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::PlanBoot");
+
+	return HandleError(
+		[](
+			BootPlanReply *reply,
+			std::shared_ptr<Crate> crate,
+			unsigned short module,
+			bool fast
+		) {
+			for (const auto &module_plan : crate->PlanBoot(module, fast)) {
+				auto plan = reply->add_plans();
+				plan->set_module(module_plan.module);
+				plan->set_action(uint32_t(module_plan.action));
+				plan->set_reason(module_plan.reason);
+			}
 		},
 		reply,
 		crate_,
@@ -84,6 +121,7 @@ grpc::Status ControlCrateService::ReadParameter(
 	const ReadRequest *request,
 	ReadReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::ReadParameter");
 
 	if (request->type() == uint32_t(ParameterType::kModule)) {
 		return HandleError(
@@ -134,6 +172,7 @@ grpc::Status ControlCrateService::WriteParameter(
 	const WriteRequest *request,
 	EmptyReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::WriteParameter");
 	if (request->type() == uint32_t(ParameterType::kModule)) {
 		return HandleError(
 			[](
@@ -183,6 +222,7 @@ grpc::Status ControlCrateService::ImportParameters(
 	const ImportExportRequest *request,
 	EmptyReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::ImportParameters");
 
 	return HandleError(
 		[](
@@ -204,6 +244,7 @@ grpc::Status ControlCrateService::ExportParameters(
 	const ImportExportRequest *request,
 	EmptyReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::ExportParameters");
 
 	return HandleError(
 		[](
@@ -225,6 +266,7 @@ grpc::Status ControlCrateService::StartRun(
 	const RunRequest *request,
 	RunReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::StartRun");
 
 	return HandleError(
 		[](
@@ -234,15 +276,7 @@ grpc::Status ControlCrateService::StartRun(
 			unsigned int seconds,
 			int run
 		) {
-			auto start_time = std::chrono::steady_clock::now();
-			crate->StartRun(module, seconds, run);
-			auto stop_time = std::chrono::steady_clock::now();
-			reply->set_seconds(
-				std::chrono::duration_cast<std::chrono::seconds>(
-					stop_time - start_time
-				).count()
-			);
-			reply->set_run_number(crate->RunNumber()-1);
+			reply->set_run_number(crate->StartRun(module, seconds, run));
 		},
 		reply,
 		crate_,
@@ -253,11 +287,64 @@ grpc::Status ControlCrateService::StartRun(
 }
 
 
+grpc::Status ControlCrateService::PrepareRun(
+	grpc::ServerContext*,
+	const RunRequest *request,
+	EmptyReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::PrepareRun");
+
+	return HandleError(
+		[](
+			EmptyReply *,
+			std::shared_ptr<Crate> crate,
+			unsigned short module,
+			int run
+		) {
+			crate->PrepareRun(module, run);
+		},
+		reply,
+		crate_,
+		request->module(),
+		request->run_number()
+	);
+}
+
+
+grpc::Status ControlCrateService::ContinuousRun(
+	grpc::ServerContext*,
+	const ContinuousRunRequest *request,
+	RunReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::ContinuousRun");
+
+	return HandleError(
+		[](
+			RunReply *reply,
+			std::shared_ptr<Crate> crate,
+			unsigned short module,
+			RollPolicy policy,
+			int run
+		) {
+			reply->set_run_number(crate->ContinuousRun(module, policy, run));
+		},
+		reply,
+		crate_,
+		request->module(),
+		RollPolicy{
+			request->roll_seconds(), request->roll_bytes(), request->runs()
+		},
+		request->run_number()
+	);
+}
+
+
 grpc::Status ControlCrateService::StopRun(
 	grpc::ServerContext *,
 	const EmptyMessage *,
 	RunReply *reply
 ) {
+	TraceSpan trace_span("ControlCrateService::StopRun");
 
 	return HandleError(
 		[](
@@ -272,4 +359,262 @@ grpc::Status ControlCrateService::StopRun(
 }
 
 
+/// @brief fill reply with run status
+///
+/// @param[out] reply reply to fill
+/// @param[in] info run status
+///
+void SetRunStatusReply(RunStatusReply *reply, const RunInfo &info) {
+	reply->set_state(static_cast<uint32_t>(info.state));
+	reply->set_run_number(info.run);
+	reply->set_module(info.module);
+	reply->set_seconds(info.seconds);
+	reply->set_bytes(info.bytes);
+	reply->set_error(info.error);
+}
+
+
+grpc::Status ControlCrateService::RunStatus(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	RunStatusReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::RunStatus");
+
+	return HandleError(
+		[](
+			RunStatusReply *reply,
+			std::shared_ptr<Crate> crate
+		) {
+			SetRunStatusReply(reply, crate->RunStatus());
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::WaitRun(
+	grpc::ServerContext *,
+	const WaitRunRequest *request,
+	RunStatusReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::WaitRun");
+
+	return HandleError(
+		[](
+			RunStatusReply *reply,
+			std::shared_ptr<Crate> crate,
+			unsigned int milliseconds
+		) {
+			SetRunStatusReply(reply, crate->WaitRun(milliseconds));
+		},
+		reply,
+		crate_,
+		request->milliseconds()
+	);
+}
+
+
+grpc::Status ControlCrateService::SetFilter(
+	grpc::ServerContext *,
+	const FilterRequest *request,
+	EmptyReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::SetFilter");
+
+	return HandleError(
+		[](
+			EmptyReply *,
+			std::shared_ptr<Crate> crate,
+			const std::string &path
+		) {
+			crate->SetFilter(path);
+		},
+		reply,
+		crate_,
+		request->path()
+	);
+}
+
+
+grpc::Status ControlCrateService::FilterStats(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	FilterStatsReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::FilterStats");
+
+	return HandleError(
+		[](
+			FilterStatsReply *reply,
+			std::shared_ptr<Crate> crate
+		) {
+			for (const auto &count : crate->FilterStats()) {
+				FilterRuleCount *rule_count = reply->add_counts();
+				rule_count->set_name(count.name);
+				rule_count->set_accepted(count.accepted);
+				rule_count->set_rejected(count.rejected);
+			}
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::SetTraceReduction(
+	grpc::ServerContext *,
+	const TraceReductionRequest *request,
+	EmptyReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::SetTraceReduction");
+
+	return HandleError(
+		[](
+			EmptyReply *,
+			std::shared_ptr<Crate> crate,
+			bool enable,
+			const TraceReduction &reduction
+		) {
+			crate->SetTraceReduction(enable, reduction);
+		},
+		reply,
+		crate_,
+		request->enable(),
+		TraceReduction{
+			request->pre(),
+			request->post(),
+			request->trigger(),
+			static_cast<uint16_t>(request->drop_energy())
+		}
+	);
+}
+
+
+grpc::Status ControlCrateService::ReductionStats(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	ReductionStatsReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::ReductionStats");
+
+	return HandleError(
+		[](
+			ReductionStatsReply *reply,
+			std::shared_ptr<Crate> crate
+		) {
+			TraceReductionStats stats = crate->ReductionStats();
+			reply->set_events(stats.events);
+			reply->set_dropped(stats.dropped);
+			reply->set_input_samples(stats.input_samples);
+			reply->set_output_samples(stats.output_samples);
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::ChannelRates(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	ChannelRatesReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::ChannelRates");
+
+	return HandleError(
+		[](
+			ChannelRatesReply *reply,
+			std::shared_ptr<Crate> crate
+		) {
+			for (const auto &rate : crate->ChannelRates()) {
+				auto channel_rate = reply->add_rates();
+				channel_rate->set_module(rate.module);
+				channel_rate->set_channel(rate.channel);
+				channel_rate->set_rate(rate.rate);
+				channel_rate->set_total(rate.total);
+			}
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::GetServerStats(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	ServerStatsReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::GetServerStats");
+
+	return HandleError(
+		[](
+			ServerStatsReply *reply,
+			std::shared_ptr<Crate> crate
+		) {
+			for (const auto &stats : crate->ServerStats()) {
+				auto method = reply->add_methods();
+				method->set_method(stats.method);
+				method->set_calls(stats.calls);
+				method->set_in_flight(stats.in_flight);
+				for (const auto &count : stats.outcomes) {
+					method->add_outcomes(count);
+				}
+				method->set_mean(stats.mean);
+				method->set_p50(stats.p50);
+				method->set_p90(stats.p90);
+				method->set_p99(stats.p99);
+				method->set_max(stats.max);
+			}
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::StartTrace(
+	grpc::ServerContext *,
+	const EmptyMessage *,
+	EmptyReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::StartTrace");
+
+	return HandleError(
+		[](
+			EmptyReply *,
+			std::shared_ptr<Crate> crate
+		) {
+			crate->StartTrace();
+		},
+		reply,
+		crate_
+	);
+}
+
+
+grpc::Status ControlCrateService::StopTrace(
+	grpc::ServerContext *,
+	const TraceRequest *request,
+	EmptyReply *reply
+) {
+	TraceSpan trace_span("ControlCrateService::StopTrace");
+
+	return HandleError(
+		[](
+			EmptyReply *,
+			std::shared_ptr<Crate> crate,
+			const std::string &path
+		) {
+			crate->StopTrace(path);
+		},
+		reply,
+		crate_,
+		request->path()
+	);
+}
+
+
 }	 	// namespace rxdaq
\ No newline at end of file
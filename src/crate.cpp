@@ -1,14 +1,20 @@
 #include <csignal>
+#include <cstdio>
 
+#include <algorithm>
 #include <vector>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <filesystem>
 
 #include "pixie/error.hpp"
 
 #include "include/crate.h"
 #include "include/error.h"
+#include "include/replay.h"
 
 namespace rxdaq {
 
@@ -227,16 +233,25 @@ const size_t kFifoRunWaitUsecs = 2000;
 const size_t kFifoIdleWaitUsecs = 150000;
 const size_t kFifoHoldUsecs = 50000;
 
-std::atomic<bool> Crate::keep_running_ = false;
-
 Crate::Crate() noexcept
-: message_(Message::Level::kWarning), booted_(false), config_path_("config.json") {
+: message_(Message::Level::kWarning), booted_(false), config_path_("config.json")
+, prepared_run_(-1), prepared_module_(kModuleNum), run_bytes_(0)
+, keep_running_(false), rate_monitor_(std::make_shared<RateMonitor>())
+, stats_sampler_([this](unsigned short module_id) {
+	return ReadModuleStats(module_id);
+})
+, run_state_(RunState::kIdle), run_(-1), run_module_(kModuleNum) {
 	message_.SetColorfulPrefix();
+	message_.SetTimestamp();
 }
 
 
 Crate::~Crate() {
 	std::cout << message_(MsgLevel::kDebug) << "Crate::~Crate()\n";
+	if (run_thread_.joinable()) {
+		StopRun();
+		run_thread_.join();
+	}
 	if (booted_) {
 		std::cout << message_(MsgLevel::kInfo) << "Closing modules...\n";
 		
@@ -247,6 +262,10 @@ Crate::~Crate() {
 			module->close();
 		}
 	}
+	// don't lose the last messages at exit
+	if (message_.Async()) {
+		Message::Flush();
+	}
 }
 
 
@@ -271,6 +290,9 @@ void Crate::Initialize(const std::string &config_path) {
 	}
 	// read config from json file
 	config_.ReadFromFile(config_path_);
+	// run number is kept in the store instead of rewriting the config file
+	run_number_.Open(config_path_ + ".run", config_.RunNumber());
+	config_.SetRunNumber(run_number_.Current());
 	message_.SetLevel(Message::ToLevel(config_.MessageLevel()));
 
 	std::cout << message_(MsgLevel::kDebug) << "Crate::Init().\n";
@@ -305,6 +327,9 @@ void Crate::Initialize(const std::string &config_path) {
 	}
 	xia_crate_.assign(numbers);
 
+	// nothing is known about the modules until they are booted
+	boot_states_.assign(config_.ModuleNum(), ModuleBootState{false, "", 0});
+
 	// // set the FIFO realtime settings
 	// for (auto &module : xia_crate_.modules) {
 	// 	module->fifo_buffers = kFifoBuffers;
@@ -320,6 +345,8 @@ void Crate::LoadFirmware(unsigned short module_id) {
 	std::cout << message_(MsgLevel::kDebug)
 		<< "Crate::LoadFirmware(" << module_id << ")\n";
 
+	ScopedTimer timer(boot_timing_, "load firmware", module_id);
+
 	// check module firmware information before boot
 	xia::pixie::module::module &module = *(xia_crate_.modules[module_id]);
 	if (module.eeprom.revision != config_.Revision(module_id)) {
@@ -346,6 +373,9 @@ void Crate::LoadFirmware(unsigned short module_id) {
 
 	std::cout << message_(MsgLevel::kDebug) << "Crate::LoadFirmwares: loading firmwares...\n";
 
+	// drop firmwares from last boot
+	module.firmware.clear();
+
 	// check firmwares
 	xia::pixie::firmware::firmware_ref firmwares[4];			// firmwares
 	std::string firmware_files[4] = {
@@ -382,7 +412,13 @@ void Crate::LoadFirmware(unsigned short module_id) {
 			firmwares[i] = search->second;
 		}
 		// record module in firmware
-		firmwares[i]->slot.push_back(config_.Slot(module_id));
+		auto &slots = firmwares[i]->slot;
+		if (
+			std::find(slots.begin(), slots.end(), config_.Slot(module_id))
+				== slots.end()
+		) {
+			slots.push_back(config_.Slot(module_id));
+		}
 	}
 	firmwares_lock_.unlock();
 	
@@ -392,33 +428,115 @@ void Crate::LoadFirmware(unsigned short module_id) {
 }
 
 
+std::vector<ModuleBootState> Crate::TargetBootStates() const {
+	std::vector<uint64_t> hashes =
+		ParameterHashes(config_.ParameterFile(), ModuleNum());
+	std::vector<ModuleBootState> result;
+	for (unsigned short i = 0; i < ModuleNum(); ++i) {
+		result.push_back({true, FirmwareIdentity(config_, i), hashes[i]});
+	}
+	return result;
+}
+
+
+BootPlan Crate::PlanBoot(unsigned short module_id, bool fast) {
+	std::cout << message_(MsgLevel::kDebug)
+		<< "Crate::PlanBoot(" << module_id << ", " << fast << ").\n";
+
+	xia_crate_.ready();
+	// module may go offline without notice, e.g. power cycle
+	for (unsigned short i = 0; i < ModuleNum(); ++i) {
+		boot_states_[i].online = xia_crate_.modules[i]->online();
+	}
+
+	return rxdaq::PlanBoot(
+		boot_states_,
+		TargetBootStates(),
+		CreateRequestIndexes(kModuleNum, ModuleNum(), module_id),
+		!fast
+	);
+}
+
+
 void Crate::Boot(unsigned short module_id, bool fast) {
+	TraceSpan trace_span("Crate::Boot");
 	std::cout << message_(MsgLevel::kDebug)
 		<< "Crate::Boot(" << module_id << ", " << fast << ").\n";
 
-	// load firmware
-	if (module_id == kModuleNum) {
-		std::vector<std::thread> threads;
-		for (unsigned short i = 0; i < ModuleNum(); ++i) {
-			threads.emplace_back(&Crate::LoadFirmware, this, i);
+	CheckNoRun("Boot");
+	boot_timing_.Clear();
+	{
+		ScopedTimer total_timer(boot_timing_, "total");
+		BootModules(module_id, fast);
+	}
+	Metrics::Instance().SetBootTimings(boot_timing_.Timings());
+}
+
+
+void Crate::BootModules(unsigned short module_id, bool fast) {
+	BootPlan plan;
+	{
+		ScopedTimer timer(boot_timing_, "plan");
+		plan = PlanBoot(module_id, fast);
+	}
+	std::cout << message_(MsgLevel::kInfo) << "Boot plan:\n"
+		<< BootPlanInfo(plan);
+
+	std::vector<unsigned short> boot_modules =
+		PlannedModules(plan, BootAction::kBoot);
+	std::vector<unsigned short> import_modules =
+		PlannedModules(plan, BootAction::kImport);
+
+	if (!boot_modules.empty()) {
+		// load firmware
+		std::vector<std::future<void>> results;
+		for (const auto &m : boot_modules) {
+			results.push_back(
+				std::async(std::launch::async, &Crate::LoadFirmware, this, m)
+			);
 		}
-		for (auto &t : threads) {
-			t.join();
+		for (auto &result : results) {
+			result.get();
 		}
-	} else {
-		LoadFirmware(module_id);
-	}
 
-	// std::vector<unsigned short> modules = CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
-	// for (const auto &m : modules) {
-	// 	LoadFirmware(m);
-	// }
+		{
+			ScopedTimer timer(boot_timing_, "set firmware");
+			xia_crate_.ready();
+			xia_crate_.set_firmware();
+		}
 
-	xia_crate_.ready();
-	xia_crate_.set_firmware();
-	xia_crate_.boot(!fast);
+		// only boot the modules in plan, others keep running
+		results.clear();
+		for (const auto &m : boot_modules) {
+			results.push_back(std::async(std::launch::async, [this, m]() {
+				xia::pixie::crate::module_handle module(
+					xia_crate_, m, xia::pixie::crate::module_handle::present
+				);
+				// boot fpga and dsp separately to see which is slow
+				{
+					ScopedTimer timer(boot_timing_, "boot fpga", m);
+					module->boot(true, true, false);
+				}
+				{
+					ScopedTimer timer(boot_timing_, "boot dsp", m);
+					module->boot(false, false, true);
+				}
+			}));
+		}
+		for (auto &result : results) {
+			result.get();
+		}
 
-	ImportParameters(config_.ParameterFile());
+		for (const auto &m : boot_modules) {
+			boot_states_[m].online = true;
+			boot_states_[m].firmware = FirmwareIdentity(config_, m);
+			boot_states_[m].parameter_hash = kUnknownParameterHash;
+		}
+	}
+
+	if (!import_modules.empty()) {
+		ImportParameters(config_.ParameterFile(), import_modules);
+	}
 	booted_ = true;
 }
 
@@ -446,9 +564,11 @@ void Crate::Task(const std::string &task_name, unsigned short module_id) {
 		CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
 
 	CheckTaskName(task_name);
+	CheckNoRun("Run task " + task_name);
 
 	xia_crate_.ready();
 	for (unsigned short m : modules) {
+		ResetParameterHash(m);
 		xia::pixie::crate::module_handle module(xia_crate_, m);
 		if (task_name == "offset") {
 			module->adjust_offsets();
@@ -581,6 +701,17 @@ void Crate::WriteParameter(
 		<< "Crate::WriteModuleParameter("  << name << ", " << value
 		<< ", " << module <<  ")\n";
 
+	CheckNoRun("Write parameter " + name);
+	WriteModuleParameter(name, value, module);
+}
+
+
+void Crate::WriteModuleParameter(
+	const std::string &name,
+	unsigned int value,
+	unsigned short module
+) {
+	ResetParameterHash(module);
 	xia_crate_.ready();
 	bool bcast;
 	if (module == kModuleNum) {
@@ -591,6 +722,7 @@ void Crate::WriteParameter(
 	}
 	// some parameters should be written to all modules
 	if (bcast) {
+		ResetParameterHash(kModuleNum);
 		xia::pixie::crate::crate::user user(xia_crate_);
 		for (auto &m : xia_crate_.modules) {
 			if (module != m->number && m->online()) {
@@ -612,20 +744,86 @@ void Crate::WriteParameter(
 		<< "Crate::WriteChannelParameter(" << name << ", " << value << ", "
 		<< module << ", " << channel << ")\n";
 
+	CheckNoRun("Write parameter " + name);
+	ResetParameterHash(module);
 	xia_crate_.ready();
 	xia::pixie::crate::module_handle module_handler(xia_crate_, module);
 	module_handler->write(name, channel, value);
 }
 
 
+void Crate::ResetParameterHash(unsigned short module_id) {
+	for (
+		const auto &m :
+		CreateRequestIndexes(kModuleNum, boot_states_.size(), module_id)
+	) {
+		if (m < boot_states_.size()) {
+			boot_states_[m].parameter_hash = kUnknownParameterHash;
+		}
+	}
+}
+
+
 
 void Crate::ImportParameters(const std::string &path) {
+	CheckNoRun("Import parameters");
+	boot_timing_.Clear();
+	ImportParameters(
+		path,
+		CreateRequestIndexes(kModuleNum, ModuleNum(), kModuleNum)
+	);
+	Metrics::Instance().SetBootTimings(boot_timing_.Timings());
+}
+
+
+void Crate::ImportParameters(
+	const std::string &path,
+	const std::vector<unsigned short> &modules
+) {
 	std::cout << message_(MsgLevel::kDebug)
-		<< "Crate::ImportParameters(" << path << ").\n";
+		<< "Crate::ImportParameters(" << path << ", "
+		<< modules.size() << " modules).\n";
+
+	ScopedTimer total_timer(boot_timing_, "import total");
 
+	// pixie imports the whole file to all modules in it, writing the
+	// parameters is fast anyway
 	xia::pixie::module::number_slots loaded;
-	xia_crate_.import_config(path, loaded);
-	xia_crate_.initialize_afe();
+	{
+		ScopedTimer timer(boot_timing_, "import config");
+		xia_crate_.import_config(path, loaded);
+	}
+
+	// initializing analog front end is slow, only initialize the requested
+	// modules and the others whose parameters are changed by this import
+	std::vector<uint64_t> hashes = ParameterHashes(path, ModuleNum());
+	std::vector<unsigned short> afe_modules = modules;
+	for (const auto &number_slot : loaded) {
+		size_t number = static_cast<size_t>(number_slot.first);
+		if (
+			number < boot_states_.size()
+			&& boot_states_[number].parameter_hash != hashes[number]
+			&& std::find(modules.begin(), modules.end(), number) == modules.end()
+		) {
+			afe_modules.push_back(static_cast<unsigned short>(number));
+		}
+	}
+	for (const auto &m : afe_modules) {
+		ScopedTimer timer(boot_timing_, "initialize afe", m);
+		xia::pixie::crate::module_handle module(xia_crate_, m);
+		module->initialize_afe();
+	}
+
+	// record what the modules have imported, parameters that can't be
+	// hashed are unknown and imported again next time
+	for (const auto &number_slot : loaded) {
+		size_t number = static_cast<size_t>(number_slot.first);
+		if (number < boot_states_.size()) {
+			boot_states_[number].parameter_hash =
+				hashes[number] == kMissingParameterHash
+				? kUnknownParameterHash : hashes[number];
+		}
+	}
 
 	// try {
 	// 	std::cout << message_(MsgLevel::kDebug)
@@ -654,7 +852,8 @@ void Crate::ImportParameters(const std::string &path) {
 void Crate::ExportParameters(const std::string &path) {
 	std::cout << message_(MsgLevel::kDebug)
 		<< "Crate::ExportParameters(" <<  path << ").\n";
-	
+
+	CheckNoRun("Export parameters");
 	xia_crate_.export_config(path);
 }
 
@@ -671,19 +870,18 @@ inline unsigned int ClockDuration(
 }
 
 
-std::ofstream CreateRunDataStream(
+std::string RunDataFileName(
 	std::string path,
 	std::string name,
 	unsigned short run,
-	unsigned short module
+	unsigned short module,
+	const std::string &extension
 ) {
 	std::stringstream file_name;
 	file_name << path << name << "_R" << std::setfill('0') << std::setw(4)
 		<< run << "_M" << std::setfill('0') << std::setw(2) << module
-		<< ".bin";
-
-	return 
-		std::ofstream(file_name.str(), std::ios::binary | std::ios::trunc);
+		<< extension;
+	return file_name.str();
 }
 
 
@@ -698,64 +896,496 @@ std::string RunDataDirectory(
 }
 
 
-void Crate::StartRun(unsigned short module_id, unsigned int seconds, int run) {
-	if (run != -1) {
-		config_.SetRunNumber(run);
-	} else {
-		run = config_.RunNumber();
+unsigned int Crate::StartRun(
+	unsigned short module_id,
+	unsigned int seconds,
+	int run
+) {
+	TraceSpan trace_span("Crate::StartRun");
+	BeginStarting();
+	std::vector<unsigned short> modules;
+	try {
+		{
+			// the run number may be read by PrepareRun in another thread
+			std::lock_guard<std::mutex> guard(run_lock_);
+			if (run != -1) {
+				config_.SetRunNumber(run);
+			} else {
+				run = config_.RunNumber();
+			}
+		}
+
+		std::cout << message_(MsgLevel::kDebug)
+			<<  "Crate::Run(" << module_id << ", " << seconds << " s, " << run << ")\n";
+		std::cout << message_(MsgLevel::kInfo)
+			<< "Starting list mode run" << (
+				seconds ?
+				" for " + std::to_string(seconds) + " seconds" :
+				""
+			)
+			<< ".\n"; 
+
+		
+		xia_crate_.ready();
+		
+		modules = CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
+
+
+		WriteModuleParameter("SYNCH_WAIT", module_id == kModuleNum ? 1 : 0, 0);
+		WriteModuleParameter("IN_SYNCH", 0, 0);
+
+		TakePreparedRun(module_id, run);
+		{
+			std::lock_guard<std::mutex> guard(run_lock_);
+			run_ = run;
+			run_module_ = module_id;
+			BuildPipeline();
+		}
+		data_writer_.Start();
+		StartListMode(modules);
+		StartStatsSampler(modules, run);
+	} catch (...) {
+		SetRunState(RunState::kFinished, std::current_exception());
+		throw;
+	}
+	SetRunState(RunState::kRunning);
+
+	// get data in thread
+	run_thread_ = std::thread([this, module_id, seconds, modules]() {
+		try {
+			ReadUntil(modules, seconds, 0);
+			SetRunState(RunState::kStopping);
+			FinishRun(module_id);
+		} catch (...) {
+			std::exception_ptr error = std::current_exception();
+			stats_sampler_.Stop();
+			try {
+				data_writer_.Stop();
+			} catch (...) {
+			}
+			SetRunState(RunState::kFinished, error);
+			return;
+		}
+		SetRunState(RunState::kFinished);
+	});
+	return run;
+}
+
+
+unsigned int Crate::ContinuousRun(
+	unsigned short module_id,
+	const RollPolicy &policy,
+	int run
+) {
+	TraceSpan trace_span("Crate::ContinuousRun");
+	if (!policy.seconds && !policy.bytes) {
+		throw UserError("Continuous run requires time or size to roll.");
 	}
+	BeginStarting();
+	std::vector<unsigned short> modules;
+	std::string parameters_path;
+	try {
+		{
+			// the run number may be read by PrepareRun in another thread
+			std::lock_guard<std::mutex> guard(run_lock_);
+			if (run != -1) {
+				config_.SetRunNumber(run);
+			} else {
+				run = config_.RunNumber();
+			}
+		}
 
-	std::cout << message_(MsgLevel::kDebug)
-		<<  "Crate::Run(" << module_id << ", " << seconds << " s, " << run << ")\n";
+		std::cout << message_(MsgLevel::kDebug)
+			<< "Crate::ContinuousRun(" << module_id << ", " << policy.seconds
+			<< " s, " << policy.bytes << " bytes, " << policy.runs << " runs, "
+			<< run << ")\n";
+		std::cout << message_(MsgLevel::kInfo)
+			<< "Starting continuous list mode run from run " << run << ".\n";
+
+		xia_crate_.ready();
+
+		modules = CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
+
+		WriteModuleParameter("SYNCH_WAIT", module_id == kModuleNum ? 1 : 0, 0);
+		WriteModuleParameter("IN_SYNCH", 0, 0);
+
+		TakePreparedRun(module_id, run);
+		// settings can't change until the continuous run stops, so export
+		// them once and copy to the other runs
+		parameters_path = RunDataDirectory(
+			config_.RunDataPath(), config_.RunDataFile(), run
+		) + "parameters.json";
+		xia_crate_.export_config(parameters_path);
+		{
+			std::lock_guard<std::mutex> guard(run_lock_);
+			run_ = run;
+			run_module_ = module_id;
+			BuildPipeline();
+		}
+		data_writer_.Start();
+	} catch (...) {
+		SetRunState(RunState::kFinished, std::current_exception());
+		throw;
+	}
+	SetRunState(RunState::kRunning);
+
+	run_thread_ = std::thread(
+		[this, module_id, policy, run, modules, parameters_path]() mutable {
+			std::future<void> preparing;
+			std::future<void> bookkeeping;
+			unsigned int finished = 0;
+			try {
+				while (true) {
+					bool last = policy.runs && finished + 1 >= policy.runs;
+					int next_run = run + 1;
+					// prepare files of the next run while this run is taking
+					// data
+					if (!last) {
+						preparing = std::async(
+							std::launch::async,
+							[this, module_id, next_run]() {
+								PrepareRun(module_id, next_run);
+							}
+						);
+					}
+
+					StartListMode(modules);
+					StartStatsSampler(modules, run);
+					ReadUntil(modules, policy.seconds, policy.bytes);
+					StopListMode(module_id, modules);
+					FinishStatsSampler();
+					std::vector<FifoLevelStats> fifo = fifo_monitor_.Stats();
+					auto stop_time = std::chrono::steady_clock::now();
+					unsigned int duration =
+						ClockDuration(run_start_time_, stop_time);
+					++finished;
+					last = last || !keep_running_;
+
+					std::vector<std::ofstream> streams =
+						std::move(run_output_streams_);
+					run_output_streams_.clear();
+					if (!last) {
+						// errors of preparing are reported by preparing again
+						try {
+							preparing.get();
+						} catch (const std::exception&) {
+						}
+						TakePreparedRun(module_id, next_run);
+					} else {
+						SetRunState(RunState::kStopping);
+						if (preparing.valid()) preparing.wait();
+					}
+					{
+						std::lock_guard<std::mutex> guard(run_lock_);
+						if (!last) run_ = next_run;
+						config_.SetRunNumber(run + 1);
+					}
+
+					// finish the last run in background, wait for the previous
+					// one to keep the run number in order
+					if (bookkeeping.valid()) {
+						bookkeeping.get();
+					}
+					std::string path = RunDataDirectory(
+						config_.RunDataPath(), config_.RunDataFile(), run
+					) + "parameters.json";
+					bookkeeping = std::async(
+						std::launch::async,
+						[this, run, duration, path, parameters_path, fifo](
+							std::vector<std::ofstream> &&streams
+						) {
+							TraceSpan bookkeeping_span(
+								"Crate::ContinuousRun bookkeeping"
+							);
+							// data of this run is queued before the call
+							data_writer_.Flush();
+							for (auto &stream : streams) {
+								data_writer_.DetachIndex(&stream);
+								stream.close();
+							}
+							if (path != parameters_path) {
+								std::filesystem::copy_file(
+									parameters_path, path,
+									std::filesystem::copy_options::overwrite_existing
+								);
+							}
+							run_number_.Store(run + 1);
+							std::cout << message_(MsgLevel::kInfo)
+								<< RunTimeInfo(
+									duration, run, fifo, config_.RunFifoMarks()
+								);
+						},
+						std::move(streams)
+					);
+
+					if (last) break;
+					run = next_run;
+				}
+				bookkeeping.get();
+				data_writer_.Stop();
+			} catch (...) {
+				std::exception_ptr error = std::current_exception();
+				stats_sampler_.Stop();
+				if (preparing.valid()) preparing.wait();
+				if (bookkeeping.valid()) bookkeeping.wait();
+				try {
+					data_writer_.Stop();
+				} catch (...) {
+				}
+				SetRunState(RunState::kFinished, error);
+				return;
+			}
+
+			std::cout << message_(MsgLevel::kInfo)
+				<< "Continuous list mode run finished " << finished
+				<< " runs.\n";
+			SetRunState(RunState::kFinished);
+		}
+	);
+	return run;
+}
+
+
+void Crate::StopRun() {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	keep_running_ = false;
+	if (run_state_ == RunState::kRunning) {
+		run_state_ = RunState::kStopping;
+		Metrics::Instance().SetRunState(static_cast<int>(run_state_));
+		run_cv_.notify_all();
+	}
+}
+
+
+RunInfo Crate::RunStatus() {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	RunInfo info{
+		run_state_, run_, run_module_, 0, run_bytes_.load(), ""
+	};
+	if (run_state_ == RunState::kRunning || run_state_ == RunState::kStopping) {
+		info.seconds = ClockDuration(
+			run_start_time_, std::chrono::steady_clock::now()
+		);
+	} else if (run_state_ == RunState::kFinished) {
+		info.seconds = ClockDuration(run_start_time_, run_stop_time_);
+	}
+	if (run_error_) {
+		try {
+			std::rethrow_exception(run_error_);
+		} catch (const std::exception &e) {
+			info.error = e.what();
+		} catch (...) {
+			info.error = "unknown error";
+		}
+	}
+	return info;
+}
+
+
+RunInfo Crate::WaitRun(unsigned int milliseconds) {
+	{
+		std::unique_lock<std::mutex> lock(run_lock_);
+		auto finished = [this]() {
+			return run_state_ == RunState::kIdle
+				|| run_state_ == RunState::kFinished;
+		};
+		if (milliseconds) {
+			run_cv_.wait_for(
+				lock, std::chrono::milliseconds(milliseconds), finished
+			);
+		} else {
+			run_cv_.wait(lock, finished);
+		}
+		if (run_state_ == RunState::kFinished && run_error_) {
+			std::rethrow_exception(run_error_);
+		}
+	}
+	return RunStatus();
+}
+
+
+void Crate::SetFilter(const std::string &path) {
+	TraceSpan trace_span("Crate::SetFilter");
+	std::shared_ptr<EventFilter> filter;
+	if (!path.empty()) {
+		filter = std::make_shared<EventFilter>(ReadFilterRules(path));
+	}
+
+	std::lock_guard<std::mutex> guard(run_lock_);
+	if (run_state_ != RunState::kIdle && run_state_ != RunState::kFinished) {
+		throw UserError(
+			"Set filter while run " + std::to_string(run_) + " is "
+			+ kRunStateNames.at(run_state_) + "."
+		);
+	}
+	event_filter_ = filter;
 	std::cout << message_(MsgLevel::kInfo)
-		<< "Starting list mode run" << (
-			seconds ?
-			" for " + std::to_string(seconds) + " seconds" :
-			""
-		)
-		<< ".\n"; 
+		<< (path.empty() ? "Event filter is off.\n" : "Event filter is set.\n");
+}
 
-	
-	xia_crate_.ready();
-	
-	std::vector<unsigned short> modules =
-		CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
 
+std::vector<FilterCount> Crate::FilterStats() {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	if (!event_filter_) return std::vector<FilterCount>();
+	return event_filter_->Counts();
+}
 
-	WriteParameter("SYNCH_WAIT", module_id == kModuleNum ? 1 : 0, 0);
-	WriteParameter("IN_SYNCH", 0, 0);
 
-	// create directory for data files
-	std::string dir_name =
-		RunDataDirectory(config_.RunDataPath(), config_.RunDataFile(), run);
-	std::filesystem::create_directories(dir_name);
-	// create output stream
-	run_output_streams_.clear();
-	for (const auto &m : modules) {
-		run_output_streams_.push_back(CreateRunDataStream(
-			dir_name, config_.RunDataFile(), run, m
-		));
+void Crate::SetTraceReduction(bool enable, const TraceReduction &reduction) {
+	TraceSpan trace_span("Crate::SetTraceReduction");
+	if (enable && reduction.trigger < -1) {
+		throw UserError("Trigger of trace reduction should be -1 or sample index.");
+	}
+
+	std::lock_guard<std::mutex> guard(run_lock_);
+	if (run_state_ != RunState::kIdle && run_state_ != RunState::kFinished) {
+		throw UserError(
+			"Set trace reduction while run " + std::to_string(run_) + " is "
+			+ kRunStateNames.at(run_state_) + "."
+		);
+	}
+	trace_reducer_ = enable ? std::make_shared<TraceReducer>(reduction) : nullptr;
+	std::cout << message_(MsgLevel::kInfo)
+		<< (enable ? "Trace reduction is set.\n" : "Trace reduction is off.\n");
+}
+
+
+TraceReductionStats Crate::ReductionStats() {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	if (!trace_reducer_) return TraceReductionStats{0, 0, 0, 0};
+	return trace_reducer_->Stats();
+}
+
+
+std::vector<ChannelRate> Crate::ChannelRates() {
+	return rate_monitor_->Rates();
+}
+
+
+std::vector<RpcMethodStats> Crate::ServerStats() {
+	return Metrics::Instance().RpcStats();
+}
+
+
+void Crate::BuildPipeline() {
+	// replay builds the same pipeline
+	data_writer_.SetPipeline(BuildRunPipeline(
+		rate_monitor_, event_filter_, trace_reducer_,
+		config_.RunFormat() == "packed"
+	));
+}
+
+
+void Crate::CheckNoRun(const std::string &action) {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	if (run_state_ != RunState::kIdle && run_state_ != RunState::kFinished) {
+		throw UserError(
+			action + " while run " + std::to_string(run_) + " is "
+			+ kRunStateNames.at(run_state_) + "."
+		);
 	}
+}
+
 
-	// start list mode
+void Crate::BeginStarting() {
+	{
+		std::lock_guard<std::mutex> guard(run_lock_);
+		if (
+			run_state_ != RunState::kIdle
+			&& run_state_ != RunState::kFinished
+		) {
+			throw UserError(
+				"Run " + std::to_string(run_) + " is "
+				+ kRunStateNames.at(run_state_) + "."
+			);
+		}
+		// set before starting is published, so a stop arriving while
+		// starting is kept and the run stops as soon as it's running
+		keep_running_ = true;
+		run_state_ = RunState::kStarting;
+		Metrics::Instance().SetRunState(static_cast<int>(run_state_));
+		run_error_ = nullptr;
+		run_bytes_ = 0;
+		run_cv_.notify_all();
+	}
+	// only the starting thread reaches here, the last run thread has finished
+	if (run_thread_.joinable()) {
+		run_thread_.join();
+	}
+}
+
+
+void Crate::SetRunState(RunState state, std::exception_ptr error) {
+	std::lock_guard<std::mutex> guard(run_lock_);
+	run_state_ = state;
+	Metrics::Instance().SetRunState(static_cast<int>(state));
+	if (state == RunState::kFinished) {
+		run_error_ = error;
+		run_stop_time_ = std::chrono::steady_clock::now();
+		if (error) {
+			try {
+				std::rethrow_exception(error);
+			} catch (const std::exception &e) {
+				std::cout << message_(MsgLevel::kError)
+					<< "List mode run stopped by error: " << e.what() << "\n";
+			} catch (...) {
+			}
+		}
+	}
+	run_cv_.notify_all();
+}
+
+
+void Crate::TakePreparedRun(unsigned short module_id, int run) {
+	// create directory and output streams if they were not prepared
+	bool prepared = false;
+	{
+		std::lock_guard<std::mutex> guard(prepared_lock_);
+		prepared = prepared_run_ == run && prepared_module_ == module_id;
+	}
+	if (!prepared) {
+		PrepareRun(module_id, run);
+	}
+	std::lock_guard<std::mutex> guard(prepared_lock_);
+	run_output_streams_ = std::move(prepared_streams_);
+	prepared_streams_.clear();
+	for (size_t i = 0; i < prepared_indexes_.size(); ++i) {
+		data_writer_.AttachIndex(&run_output_streams_[i], prepared_indexes_[i]);
+	}
+	prepared_indexes_.clear();
+	prepared_run_ = -1;
+}
+
+
+void Crate::StartListMode(const std::vector<unsigned short> &modules) {
 	for (const auto &m : modules) {
 		xia_crate_.modules[m]->start_listmode(
 			xia::pixie::hw::run::run_mode::new_run
 		);
 	}
-
-	// get data
-	keep_running_ = true;
+	fifo_monitor_.Reset(config_.RunFifoMarks());
+	std::lock_guard<std::mutex> guard(run_lock_);
 	run_start_time_ = std::chrono::steady_clock::now();
+	run_bytes_ = 0;
+}
+
+
+void Crate::ReadUntil(
+	const std::vector<unsigned short> &modules,
+	unsigned int seconds,
+	uint64_t bytes
+) {
 	auto stop_time = run_start_time_;
-	signal(SIGINT, SigIntHandler);
 	while (
-		keep_running_ && 
-		(!seconds || ClockDuration(run_start_time_, stop_time) < seconds)
+		keep_running_ &&
+		(!seconds || ClockDuration(run_start_time_, stop_time) < seconds) &&
+		(!bytes || run_bytes_ < bytes)
 	) {
 		for (const auto &m : modules) {
 			if (xia_crate_.modules[m]->run_active()) {
-				ReadListModeData(m, 131072.0*0.2);
+				ReadListModeData(m, kFifoWords*0.2);
+				// the FIFO was just drained, read statistics if it's time
+				stats_sampler_.Sample(m);
 			} else {
 				std::cout << message_(MsgLevel::kInfo)
 					<< "Module " << m << " has not active run.\n";
@@ -763,9 +1393,42 @@ void Crate::StartRun(unsigned short module_id, unsigned int seconds, int run) {
 		}
 		stop_time = std::chrono::steady_clock::now();
 	}
-	signal(SIGINT, SIG_DFL);
+}
 
-	FinishRun(module_id);
+
+void Crate::PrepareRun(unsigned short module_id, int run) {
+	if (run == -1) {
+		// the run thread updates the run number when it finishes
+		std::lock_guard<std::mutex> guard(run_lock_);
+		run = config_.RunNumber();
+	}
+	std::cout << message_(MsgLevel::kDebug)
+		<< "Crate::PrepareRun(" << module_id << ", " << run << ")\n";
+
+	std::vector<unsigned short> modules =
+		CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
+
+	// create directory for data files
+	std::string dir_name =
+		RunDataDirectory(config_.RunDataPath(), config_.RunDataFile(), run);
+	std::filesystem::create_directories(dir_name);
+	// create output stream and its index
+	std::vector<std::ofstream> streams;
+	std::vector<std::shared_ptr<IndexWriter>> indexes;
+	for (const auto &m : modules) {
+		std::string file_name = RunDataFileName(
+			dir_name, config_.RunDataFile(), run, m,
+			config_.RunFormat() == "packed" ? ".rxp" : ".bin"
+		);
+		streams.emplace_back(file_name, std::ios::binary | std::ios::trunc);
+		indexes.push_back(std::make_shared<IndexWriter>(IndexPath(file_name)));
+	}
+
+	std::lock_guard<std::mutex> guard(prepared_lock_);
+	prepared_streams_ = std::move(streams);
+	prepared_indexes_ = std::move(indexes);
+	prepared_run_ = run;
+	prepared_module_ = module_id;
 }
 
 
@@ -796,7 +1459,28 @@ void Crate::WaitFinished(const std::vector<unsigned short> &modules) {
 
 
 
+void Crate::StopListMode(
+	unsigned short module_id,
+	const std::vector<unsigned short> &modules
+) {
+	// stop run
+	unsigned short director_module = module_id == kModuleNum ? 0 : module_id;
+	xia_crate_.modules[director_module]->run_end();
+
+	WaitFinished(modules);
+
+	// read residual data, and write the incomplete events left
+	for (const auto &m : modules) {
+		ReadListModeData(m, 0);
+		size_t index = run_output_streams_.size() == 1 ? 0 : m;
+		data_writer_.EndStream(&run_output_streams_[index], m);
+	}
+}
+
+
+
 void Crate::FinishRun(unsigned short module_id) {
+	TraceSpan trace_span("Crate::FinishRun");
 	std::cout << message_(MsgLevel::kDebug)
 		<< "FinishRun(" << module_id << ")\n";
 	std::cout << message_(MsgLevel::kInfo)
@@ -804,23 +1488,14 @@ void Crate::FinishRun(unsigned short module_id) {
 
 	xia_crate_.ready();
 
-	// stop run
-	unsigned short director_module = module_id == kModuleNum ? 0 : module_id;
-	xia_crate_.modules[director_module]->run_end();
-
-
 	std::vector<unsigned short> modules =
 		CreateRequestIndexes(kModuleNum, ModuleNum(), module_id);
 
+	StopListMode(module_id, modules);
+	FinishStatsSampler();
 
-	WaitFinished(modules);
-
-	// read residual data
-	for (const auto &m : modules) {
-		ReadListModeData(m, 0);
-	}
-
-	// close streams
+	// write the queued data, close indexes and streams
+	data_writer_.Stop();
 	for (auto &stream : run_output_streams_) {
 		stream.close();
 	}
@@ -828,39 +1503,112 @@ void Crate::FinishRun(unsigned short module_id) {
 	// display run time information
 	auto stop_time = std::chrono::steady_clock::now();
 	std::cout << message_(MsgLevel::kInfo)
-		<< RunTimeInfo(ClockDuration(run_start_time_, stop_time));
+		<< RunTimeInfo(
+			ClockDuration(run_start_time_, stop_time), -1,
+			fifo_monitor_.Stats(), fifo_monitor_.Marks()
+		);
+
 
+	unsigned int run = 0;
+	{
+		std::lock_guard<std::mutex> guard(run_lock_);
+		run = config_.RunNumber();
+	}
 
 	// export settings of this run
-	ExportParameters(RunDataDirectory(
-		config_.RunDataPath(), config_.RunDataFile(), config_.RunNumber()
+	xia_crate_.export_config(RunDataDirectory(
+		config_.RunDataPath(), config_.RunDataFile(), run
 	) + "parameters.json");
 
 	// update run number and save
-	config_.SetRunNumber(config_.RunNumber() + 1);
-	config_.WriteToFile(config_path_);
+	{
+		std::lock_guard<std::mutex> guard(run_lock_);
+		config_.SetRunNumber(run + 1);
+	}
+	run_number_.Store(run + 1);
+}
+
+
+
+void Crate::StartStatsSampler(
+	const std::vector<unsigned short> &modules,
+	int run
+) {
+	// the run goes on without statistics
+	try {
+		stats_sampler_.Start(
+			modules,
+			config_.RunStatsInterval(),
+			RunDataDirectory(config_.RunDataPath(), config_.RunDataFile(), run)
+				+ "stats.csv"
+		);
+	} catch (const std::exception &e) {
+		std::cout << message_(MsgLevel::kWarning) << e.what() << "\n";
+	}
 }
 
 
+void Crate::FinishStatsSampler() {
+	stats_sampler_.Finish();
+	if (stats_sampler_.Errors()) {
+		std::cout << message_(MsgLevel::kWarning) << "Failed to read run statistics "
+			<< stats_sampler_.Errors() << " times.\n";
+	}
+}
+
+
+ModuleStats Crate::ReadModuleStats(unsigned short module_id) {
+	xia::pixie::crate::module_handle module(xia_crate_, module_id);
+	xia::pixie::stats::stats stats(*module);
+	module->read_stats(stats);
+	ModuleStats result{module_id, {}};
+	for (const auto &channel : stats.chans) {
+		result.channels.push_back(ChannelStats{
+			channel.real_time(),
+			channel.live_time(),
+			static_cast<uint64_t>(channel.input_counts()),
+			static_cast<uint64_t>(channel.output_counts())
+		});
+	}
+	return result;
+}
+
 
 void Crate::ReadListModeData(
 	unsigned short module_id,
 	unsigned int threshold
 ) {
+	TraceSpan trace_span("Crate::ReadListModeData");
 	xia::pixie::crate::module_handle module(xia_crate_, module_id);
-	unsigned int fifo_words =
-		static_cast<unsigned int>(module->read_list_mode_level());
+	unsigned int fifo_words = 0;
+	{
+		TraceSpan poll_span("poll fifo");
+		fifo_words = static_cast<unsigned int>(module->read_list_mode_level());
+	}
+	Metrics::Instance().SetFifoLevel(module_id, fifo_words);
+	int mark = fifo_monitor_.Record(module_id, fifo_words);
+	if (mark >= 0) {
+		std::cout << message_(MsgLevel::kWarning)
+			<< "FIFO of module " << module_id << " is "
+			<< fifo_words * 100 / kFifoWords << "% full, over the mark "
+			<< int(fifo_monitor_.Marks()[mark] * 100 + 0.5)
+			<< "%, readout is falling behind.\n";
+	}
 
 	if (fifo_words > threshold) {
 		std::cout << message_(MsgLevel::kDebug)
 			<< "ReadListModeData(" << module_id << ", " << threshold << ")\n";
 
 		xia::pixie::hw::words data(fifo_words);
-		module->read_list_mode(data);
-		run_output_streams_[module_id].write(
-			reinterpret_cast<char*>(data.data()),
-			fifo_words*sizeof(uint32_t)
-		);
+		{
+			TraceSpan read_span("read fifo");
+			module->read_list_mode(data);
+		}
+		// only one stream if running a single module
+		size_t index = run_output_streams_.size() == 1 ? 0 : module_id;
+		run_bytes_ += fifo_words*sizeof(uint32_t);
+		Metrics::Instance().AddRead(module_id, fifo_words);
+		data_writer_.Write(&run_output_streams_[index], module_id, std::move(data));
 	}
 }
 
@@ -870,7 +1618,12 @@ void Crate::ReadListModeData(
 //-----------------------------------------------------------------------------
 
 
-std::string RunTimeInfo(unsigned int duration, int run) {
+std::string RunTimeInfo(
+	unsigned int duration,
+	int run,
+	const std::vector<FifoLevelStats> &fifo,
+	const std::vector<double> &marks
+) {
 	std::string result;
 	unsigned int seconds = duration;
 	unsigned int minutes = seconds / 60;
@@ -883,10 +1636,100 @@ std::string RunTimeInfo(unsigned int duration, int run) {
 		+ (hours ? std::to_string(hours) + ":" : "")
 		+ (minutes ? std::to_string(minutes) + ":" : "")
 		+ std::to_string(seconds) + "s.\n";
+	result += FifoLevelInfo(fifo, marks);
 	return result;
 }
 
 
+/// @brief format rate in a short string with k or M suffix
+///
+/// @param[in] rate counts per second
+/// @returns short string of rate
+///
+static std::string ShortRate(double rate) {
+	char result[16];
+	if (rate < 1e4) {
+		snprintf(result, sizeof(result), "%.0f", rate);
+	} else if (rate < 1e6) {
+		snprintf(result, sizeof(result), "%.1fk", rate * 1e-3);
+	} else {
+		snprintf(result, sizeof(result), "%.2fM", rate * 1e-6);
+	}
+	return result;
+}
+
+
+std::string ChannelRatesInfo(const std::vector<ChannelRate> &rates) {
+	if (rates.empty()) return "";
+	std::stringstream result;
+	result << "Input rates(/s)";
+	for (unsigned short i = 0; i < kChannelNum; ++i) {
+		result << std::setw(7) << ("ch" + std::to_string(i));
+	}
+	size_t index = 0;
+	while (index < rates.size()) {
+		// channels without counts are blank
+		unsigned short module = rates[index].module;
+		result << "\n  module " << std::setw(2) << module << "    ";
+		unsigned short channel = 0;
+		for (; index < rates.size() && rates[index].module == module; ++index) {
+			for (; channel < rates[index].channel; ++channel) {
+				result << std::setw(7) << "";
+			}
+			result << std::setw(7) << ShortRate(rates[index].rate);
+			++channel;
+		}
+	}
+	result << "\n";
+	return result.str();
+}
+
+
+// Ctrl+C pressed while waiting for run
+std::atomic<bool> run_interrupted(false);
+
+
+void RunSigIntHandler(int) {
+	run_interrupted = true;
+	// press again to quit
+	signal(SIGINT, SIG_DFL);
+}
+
+
+RunInfo WaitRunInterruptibly(Crate &crate, unsigned int rate_seconds) {
+	run_interrupted = false;
+	signal(SIGINT, RunSigIntHandler);
+	RunInfo info;
+	auto next_rates = std::chrono::steady_clock::now()
+		+ std::chrono::seconds(rate_seconds);
+	try {
+		while (true) {
+			if (rate_seconds && std::chrono::steady_clock::now() >= next_rates) {
+				std::cout << ChannelRatesInfo(crate.ChannelRates()) << std::flush;
+				next_rates += std::chrono::seconds(rate_seconds);
+			}
+			if (run_interrupted.exchange(false)) {
+				std::cout << "\nYou press Ctrl+C to stop run, press again to quit."
+					<< std::endl;
+				crate.StopRun();
+			}
+			info = crate.WaitRun(200);
+			if (
+				info.state == RunState::kFinished
+				|| info.state == RunState::kIdle
+			) {
+				break;
+			}
+		}
+	} catch (...) {
+		signal(SIGINT, SIG_DFL);
+		throw;
+	}
+	signal(SIGINT, SIG_DFL);
+	return info;
+}
+
+
 
 
 std::vector<unsigned short> CreateRequestIndexes(
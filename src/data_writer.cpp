@@ -0,0 +1,234 @@
+#include "include/data_writer.h"
+
+#include "include/error.h"
+#include "include/metrics.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+DataWriter::DataWriter(size_t capacity) noexcept
+: capacity_(capacity), queued_(0), written_(0), running_(false)
+, failed_(false) {
+}
+
+
+DataWriter::~DataWriter() {
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		running_ = false;
+	}
+	not_empty_.notify_all();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+
+void DataWriter::SetPipeline(std::shared_ptr<Pipeline> pipeline) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (running_) {
+		throw RXError("Set pipeline of data writer while it's running.");
+	}
+	pipeline_ = pipeline;
+}
+
+
+void DataWriter::AttachIndex(
+	std::ofstream *stream,
+	std::shared_ptr<IndexWriter> index
+) {
+	std::lock_guard<std::mutex> guard(lock_);
+	indexes_[stream] = index;
+}
+
+
+void DataWriter::DetachIndex(std::ofstream *stream) {
+	std::shared_ptr<IndexWriter> index;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		auto search = indexes_.find(stream);
+		if (search == indexes_.end()) return;
+		index = search->second;
+		indexes_.erase(search);
+	}
+	if (!index->Close()) {
+		throw RXError("Failed to write index of list mode data.");
+	}
+}
+
+
+void DataWriter::Start() {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (running_) return;
+	running_ = true;
+	failed_ = false;
+	if (pipeline_) {
+		pipeline_->Reset();
+	}
+	thread_ = std::thread(&DataWriter::Loop, this);
+}
+
+
+void DataWriter::Write(
+	std::ofstream *stream,
+	unsigned short module,
+	std::vector<uint32_t> &&words
+) {
+	Push(Chunk{stream, module, std::move(words), false});
+}
+
+
+void DataWriter::EndStream(std::ofstream *stream, unsigned short module) {
+	Push(Chunk{stream, module, std::vector<uint32_t>(), true});
+}
+
+
+void DataWriter::Push(Chunk &&chunk) {
+	std::unique_lock<std::mutex> lock(lock_);
+	not_full_.wait(lock, [this]() {
+		return chunks_.size() < capacity_ || failed_ || !running_;
+	});
+	if (failed_) {
+		throw RXError("Failed to write list mode data to file.");
+	}
+	if (!running_) {
+		throw RXError("Write list mode data before writer starts.");
+	}
+	Metrics::Instance().AddWriteBacklog(1, chunk.words.size()*sizeof(uint32_t));
+	chunks_.push_back(std::move(chunk));
+	++queued_;
+	lock.unlock();
+	not_empty_.notify_one();
+}
+
+
+void DataWriter::Flush() {
+	std::unique_lock<std::mutex> lock(lock_);
+	uint64_t target = queued_;
+	written_cv_.wait(lock, [this, target]() {
+		return written_ >= target || failed_;
+	});
+	if (failed_) {
+		throw RXError("Failed to write list mode data to file.");
+	}
+}
+
+
+void DataWriter::Stop() {
+	bool running = false;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		running = running_;
+		running_ = false;
+	}
+	if (running) {
+		not_empty_.notify_all();
+		not_full_.notify_all();
+		thread_.join();
+	}
+
+	// close indexes left
+	bool closed = true;
+	for (auto &item : indexes_) {
+		closed = item.second->Close() && closed;
+	}
+	indexes_.clear();
+	if (failed_) {
+		throw RXError("Failed to write list mode data to file.");
+	}
+	if (!closed) {
+		throw RXError("Failed to write index of list mode data.");
+	}
+}
+
+
+size_t DataWriter::Pending() const {
+	std::lock_guard<std::mutex> guard(lock_);
+	return chunks_.size();
+}
+
+
+bool DataWriter::WriteChunk(
+	Chunk &chunk,
+	std::shared_ptr<IndexWriter> index
+) {
+	if (pipeline_) {
+		if (chunk.end) {
+			pipeline_->Flush(chunk.module, chunk.words);
+		} else {
+			pipeline_->Process(chunk.module, chunk.words);
+		}
+	}
+	if (chunk.end && chunk.words.empty()) return true;
+
+	bool good = true;
+	{
+		TraceSpan write_span("write file");
+		chunk.stream->write(
+			reinterpret_cast<const char*>(chunk.words.data()),
+			chunk.words.size() * sizeof(uint32_t)
+		);
+		good = chunk.stream->good();
+	}
+	if (index && pipeline_) {
+		good = index->Add(pipeline_->Events(), chunk.words.size()) && good;
+	}
+	return good;
+}
+
+
+void DataWriter::Loop() {
+	// the last stream of each module without end, to write the incomplete
+	// events before stopping
+	std::map<unsigned short, std::ofstream*> open_streams;
+	std::unique_lock<std::mutex> lock(lock_);
+	while (true) {
+		not_empty_.wait(lock, [this]() {
+			return !chunks_.empty() || !running_;
+		});
+		// write the remaining chunks before stopping
+		if (chunks_.empty()) break;
+
+		Chunk chunk = std::move(chunks_.front());
+		chunks_.pop_front();
+		auto search = indexes_.find(chunk.stream);
+		std::shared_ptr<IndexWriter> index =
+			search == indexes_.end() ? nullptr : search->second;
+		lock.unlock();
+		not_full_.notify_one();
+		// the pipeline may change the size, the backlog counts the read size
+		int64_t bytes = chunk.words.size() * sizeof(uint32_t);
+
+		if (chunk.end) {
+			open_streams.erase(chunk.module);
+		} else {
+			open_streams[chunk.module] = chunk.stream;
+		}
+		bool good = WriteChunk(chunk, index);
+		Metrics::Instance().AddWriteBacklog(-1, -bytes);
+
+		lock.lock();
+		if (!good) {
+			failed_ = true;
+			not_full_.notify_all();
+		}
+		++written_;
+		written_cv_.notify_all();
+	}
+
+	// the streams are still open until the writer stops
+	for (const auto &item : open_streams) {
+		Chunk chunk{item.second, item.first, std::vector<uint32_t>(), true};
+		auto search = indexes_.find(chunk.stream);
+		std::shared_ptr<IndexWriter> index =
+			search == indexes_.end() ? nullptr : search->second;
+		lock.unlock();
+		bool good = WriteChunk(chunk, index);
+		lock.lock();
+		if (!good) {
+			failed_ = true;
+		}
+	}
+}
+
+}		// namespace rxdaq
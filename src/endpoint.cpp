@@ -0,0 +1,88 @@
+#include "include/endpoint.h"
+
+#include <cstdlib>
+#include <fstream>
+
+#include "nlohmann/json.hpp"
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+bool IsUnixEndpoint(const std::string &endpoint) noexcept {
+	return endpoint.rfind(kUnixPrefix, 0) == 0;
+}
+
+
+bool CheckEndpoint(const std::string &endpoint) noexcept {
+	if (IsUnixEndpoint(endpoint)) {
+		// unix:path or unix:///absolute/path
+		return endpoint.size() > kUnixPrefix.size()
+			&& endpoint != kUnixPrefix + "//";
+	}
+	size_t colon = endpoint.rfind(':');
+	if (colon == std::string::npos || colon == 0) return false;
+	std::string port = endpoint.substr(colon + 1);
+	if (port.empty() || port.size() > 5) return false;
+	for (const auto &c : port) {
+		if (c < '0' || c > '9') return false;
+	}
+	int number = std::stoi(port);
+	return number > 0 && number <= 65535;
+}
+
+
+std::string EnvironmentEndpoint() {
+	const char *value = std::getenv(kEndpointVariable);
+	if (!value || !*value) return "";
+	std::string endpoint(value);
+	if (!CheckEndpoint(endpoint)) {
+		throw UserError(
+			std::string(kEndpointVariable) + " " + endpoint
+			+ " is invalid(unix:<path> or <host>:<port>)."
+		);
+	}
+	return endpoint;
+}
+
+
+std::string ConfiguredEndpoint(const std::string &path) noexcept {
+	try {
+		std::ifstream fin(path);
+		if (!fin.good()) return "";
+		nlohmann::json json;
+		fin >> json;
+		if (!json.contains("rpcEndpoint") || !json["rpcEndpoint"].is_string()) {
+			return "";
+		}
+		std::string endpoint = json["rpcEndpoint"];
+		return CheckEndpoint(endpoint) ? endpoint : "";
+	} catch (const std::exception&) {
+		return "";
+	}
+}
+
+
+std::string ConnectEndpoint(const std::string &endpoint) {
+	if (IsUnixEndpoint(endpoint)) return endpoint;
+	size_t colon = endpoint.rfind(':');
+	if (colon == std::string::npos) return endpoint;
+	std::string host = endpoint.substr(0, colon);
+	if (host == "0.0.0.0" || host == "[::]" || host == "*") {
+		return "localhost" + endpoint.substr(colon);
+	}
+	return endpoint;
+}
+
+
+std::string ChooseEndpoint(
+	const std::string &configured,
+	const std::string &fallback
+) {
+	std::string endpoint = EnvironmentEndpoint();
+	if (!endpoint.empty()) return endpoint;
+	if (!configured.empty()) return configured;
+	return fallback;
+}
+
+}		// namespace rxdaq
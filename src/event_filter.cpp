@@ -0,0 +1,450 @@
+#include "include/event_filter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+const std::map<std::string, FilterRuleType> kFilterRuleTypes = {
+	{"channel", FilterRuleType::kChannel},
+	{"energy", FilterRuleType::kEnergy},
+	{"multiplicity", FilterRuleType::kMultiplicity},
+	{"downscale", FilterRuleType::kDownscale}
+};
+
+
+/// @brief parse a filter rule
+///
+/// @param[in] json json of rule
+/// @param[in] index index of rule, used in error message and default name
+/// @returns rule
+///
+FilterRule ParseFilterRule(const nlohmann::json &json, size_t index) {
+	const std::string rule_name = "Rule " + std::to_string(index);
+	if (!json.contains("type")) {
+		throw UserError(rule_name + " lack of parameter \"type\".");
+	}
+	std::string type = json["type"].get<std::string>();
+	auto search = kFilterRuleTypes.find(type);
+	if (search == kFilterRuleTypes.end()) {
+		throw UserError(rule_name + " has invalid type \"" + type + "\".");
+	}
+
+	FilterRule rule;
+	rule.type = search->second;
+	rule.name = json.value("name", type + "_" + std::to_string(index));
+	rule.module = json.value("module", kModuleNum);
+	rule.channel = json.value("channel", kChannelNum);
+	rule.window = json.value("window", 0ull);
+	rule.factor = json.value("factor", 1u);
+	// check range before narrowing
+	long long mask = json.value("mask", 0xffffll);
+	long long min = json.value("min", 0ll);
+	long long max = json.value("max", 0xffffll);
+	if (mask < 0 || mask > 0xffff) {
+		throw UserError(rule_name + " mask should be in 0-65535.");
+	}
+	if (
+		(min < 0 || min > 0xffff || max < 0 || max > 0xffff)
+		&& rule.type == FilterRuleType::kEnergy
+	) {
+		throw UserError(rule_name + " min and max should be in 0-65535.");
+	}
+	if (
+		(min < 0 || min > 0xffffffffll)
+		&& rule.type == FilterRuleType::kMultiplicity
+	) {
+		throw UserError(rule_name + " min should be in 1-4294967295.");
+	}
+	rule.mask = static_cast<uint16_t>(mask);
+	rule.min_energy = static_cast<uint16_t>(min);
+	rule.max_energy = static_cast<uint16_t>(max);
+	rule.multiplicity = static_cast<unsigned int>(min);
+
+	if (rule.module > kModuleNum) {
+		throw UserError(rule_name + " module should be smaller than 13.");
+	}
+	if (rule.channel > kChannelNum) {
+		throw UserError(rule_name + " channel should be smaller than 16.");
+	}
+
+	// parameters required by type
+	std::vector<std::string> required;
+	if (rule.type == FilterRuleType::kChannel) {
+		required = {"mask"};
+	} else if (rule.type == FilterRuleType::kMultiplicity) {
+		required = {"window", "min"};
+	} else if (rule.type == FilterRuleType::kDownscale) {
+		required = {"window", "factor"};
+	}
+	for (const auto &name : required) {
+		if (!json.contains(name)) {
+			throw UserError(
+				rule_name + " lack of parameter \"" + name + "\"."
+			);
+		}
+	}
+
+	if (rule.type == FilterRuleType::kEnergy) {
+		if (rule.min_energy > rule.max_energy) {
+			throw UserError(rule_name + " min is larger than max.");
+		}
+		// multiplicity shares the name "min"
+		rule.multiplicity = 1;
+	} else if (rule.type == FilterRuleType::kMultiplicity) {
+		if (rule.multiplicity == 0) {
+			throw UserError(rule_name + " min should be positive.");
+		}
+		rule.min_energy = 0;
+	} else {
+		rule.min_energy = 0;
+		rule.multiplicity = 1;
+	}
+	if (rule.type == FilterRuleType::kDownscale && rule.factor == 0) {
+		throw UserError(rule_name + " factor should be positive.");
+	}
+	return rule;
+}
+
+
+std::vector<FilterRule> ParseFilterRules(const nlohmann::json &json) {
+	std::vector<FilterRule> rules;
+	try {
+		if (!json.contains("rules") || !json["rules"].is_array()) {
+			throw UserError("Filter lack of parameter \"rules\".");
+		}
+		for (size_t i = 0; i < json["rules"].size(); ++i) {
+			rules.push_back(ParseFilterRule(json["rules"][i], i));
+		}
+	} catch (const nlohmann::json::exception &e) {
+		throw UserError("Invalid filter rules: " + std::string(e.what()));
+	}
+	return rules;
+}
+
+
+std::vector<FilterRule> ReadFilterRules(const std::string &path) {
+	std::ifstream fin(path);
+	if (!fin.good()) {
+		throw UserError("Open file " + path + " failed.");
+	}
+	nlohmann::json json = nlohmann::json::parse(fin, nullptr, false);
+	fin.close();
+	if (json.is_discarded()) {
+		throw UserError("Parse filter rules " + path + " failed.");
+	}
+	return ParseFilterRules(json);
+}
+
+
+//-----------------------------------------------------------------------------
+// 								EventFilter
+//-----------------------------------------------------------------------------
+
+EventFilter::EventFilter(const std::vector<FilterRule> &rules)
+: rules_(rules), singles_(rules.size(), 0) {
+
+	for (const auto &rule : rules_) {
+		counts_.push_back(FilterCount{rule.name, 0, 0});
+	}
+}
+
+
+/// @brief check whether a rule counts events in window
+///
+/// @param[in] rule rule to check
+/// @returns true for multiplicity and downscale rules
+///
+bool IsWindowRule(const FilterRule &rule) {
+	return rule.type == FilterRuleType::kMultiplicity
+		|| rule.type == FilterRuleType::kDownscale;
+}
+
+
+/// @brief append a column to the end of another
+///
+/// @param[in,out] front column to append to
+/// @param[in] back column to append
+///
+template<typename T>
+void AppendColumn(std::vector<T> &front, const std::vector<T> &back) {
+	front.insert(front.end(), back.begin(), back.end());
+}
+
+
+/// @brief put the events held back before the events of block
+///
+/// @param[in,out] block block to put in
+/// @param[in] held raw words of complete events
+///
+void PrependEvents(DataBlock &block, const std::vector<uint32_t> &held) {
+	EventBatch events;
+	DecodeListMode(held.data(), held.size(), events);
+	const size_t size = events.Size();
+	for (auto &offset : block.events.offset) {
+		offset += held.size();
+	}
+	AppendColumn(events.offset, block.events.offset);
+	AppendColumn(events.length, block.events.length);
+	AppendColumn(events.header_length, block.events.header_length);
+	AppendColumn(events.crate, block.events.crate);
+	AppendColumn(events.slot, block.events.slot);
+	AppendColumn(events.channel, block.events.channel);
+	AppendColumn(events.finish_code, block.events.finish_code);
+	AppendColumn(events.time, block.events.time);
+	AppendColumn(events.cfd, block.events.cfd);
+	AppendColumn(events.energy, block.events.energy);
+	AppendColumn(events.trace_length, block.events.trace_length);
+	block.events = std::move(events);
+	block.words.insert(block.words.begin(), held.begin(), held.end());
+	block.keep.insert(block.keep.begin(), size, 1);
+}
+
+
+/// @brief count events kept and decided
+///
+/// @param[in] keep keep flags
+/// @param[in] decided 1 for decided events
+/// @returns number of events
+///
+size_t CountKept(
+	const std::vector<uint8_t> &keep,
+	const std::vector<uint8_t> &decided
+) {
+	size_t result = 0;
+	for (size_t i = 0; i < keep.size(); ++i) {
+		result += keep[i] & decided[i];
+	}
+	return result;
+}
+
+
+void EventFilter::Process(DataBlock &block) {
+	TraceSpan trace_span("EventFilter::Process");
+	Apply(block, false);
+}
+
+
+void EventFilter::Flush(DataBlock &block) {
+	TraceSpan trace_span("EventFilter::Flush");
+	Apply(block, true);
+}
+
+
+void EventFilter::Apply(DataBlock &block, bool end) {
+	ModuleWindows &windows = windows_[block.module];
+	if (windows.decided.empty()) {
+		windows.decided.resize(rules_.size());
+	}
+	// events out of order wait longer for the events in their windows
+	for (size_t i = 0; i < block.events.Size(); ++i) {
+		uint64_t t = block.events.time[i];
+		if (t < windows.latest) {
+			windows.disorder = std::max(windows.disorder, windows.latest - t);
+		} else {
+			windows.latest = t;
+		}
+	}
+	if (!windows.held.empty()) {
+		PrependEvents(block, windows.held);
+		windows.held.clear();
+	}
+
+	// events are decided when the events in windows of all rules are read
+	uint64_t delay = 0;
+	for (const auto &rule : rules_) {
+		bool apply = rule.module == kModuleNum || rule.module == block.module;
+		if (apply && IsWindowRule(rule)) {
+			delay += rule.window;
+		}
+	}
+	if (delay) delay += windows.disorder;
+	const size_t size = block.events.Size();
+	const uint64_t *time = block.events.time.data();
+	uint64_t latest = 0;
+	for (size_t i = 0; i < size; ++i) {
+		latest = std::max(latest, time[i]);
+	}
+	final_.assign(size, 1);
+	if (!end && delay) {
+		for (size_t i = 0; i < size; ++i) {
+			final_[i] = latest - time[i] >= delay;
+		}
+	}
+	entry_ = block.keep;
+
+	std::vector<uint64_t> accepted(rules_.size(), 0);
+	std::vector<uint64_t> rejected(rules_.size(), 0);
+	for (size_t r = 0; r < rules_.size(); ++r) {
+		const FilterRule &rule = rules_[r];
+		if (rule.module != kModuleNum && rule.module != block.module) {
+			continue;
+		}
+
+		before_ = block.keep;
+		if (rule.type == FilterRuleType::kChannel) {
+			ApplyChannel(rule, block);
+		} else if (rule.type == FilterRuleType::kEnergy) {
+			ApplyEnergy(rule, block);
+		} else {
+			std::deque<uint64_t> &decided = windows.decided[r];
+			CountNeighbours(rule.window, block, decided);
+			const uint8_t *channel = block.events.channel.data();
+			const uint32_t *neighbours = neighbours_.data();
+			uint8_t *keep = block.keep.data();
+			if (rule.type == FilterRuleType::kMultiplicity) {
+				for (size_t i = 0; i < size; ++i) {
+					uint8_t match =
+						rule.channel == kChannelNum || channel[i] == rule.channel;
+					keep[i] &= (neighbours[i] >= rule.multiplicity) | !match;
+				}
+			} else {
+				// keep one of factor singles, the counter moves on only for
+				// decided events, the others are decided again later
+				uint64_t singles = singles_[r];
+				for (size_t i = 0; i < size; ++i) {
+					bool match =
+						rule.channel == kChannelNum || channel[i] == rule.channel;
+					if (keep[i] && match && neighbours[i] == 1) {
+						keep[i] = singles % rule.factor == 0;
+						if (final_[i]) ++singles;
+					}
+				}
+				singles_[r] = singles;
+			}
+
+			// the decided events seen by this rule stay in the windows of
+			// the next blocks
+			for (size_t i = 0; i < size; ++i) {
+				if (final_[i] && before_[i]) decided.push_back(time[i]);
+			}
+			uint64_t oldest = latest - std::min(latest, delay);
+			oldest -= std::min(oldest, rule.window);
+			while (!decided.empty() && decided.front() < oldest) {
+				decided.pop_front();
+			}
+		}
+		accepted[r] = CountKept(block.keep, final_);
+		rejected[r] = CountKept(before_, final_) - accepted[r];
+	}
+
+	// hold back the events not decided
+	for (size_t i = 0; i < size; ++i) {
+		if (final_[i] || !entry_[i]) continue;
+		windows.held.insert(
+			windows.held.end(),
+			block.words.begin() + block.events.offset[i],
+			block.words.begin() + block.events.offset[i] + block.events.length[i]
+		);
+		block.keep[i] = 0;
+	}
+	if (end) {
+		windows_.erase(block.module);
+	}
+
+	std::lock_guard<std::mutex> guard(counts_lock_);
+	for (size_t r = 0; r < rules_.size(); ++r) {
+		counts_[r].accepted += accepted[r];
+		counts_[r].rejected += rejected[r];
+	}
+}
+
+
+void EventFilter::Reset() {
+	std::fill(singles_.begin(), singles_.end(), 0);
+	windows_.clear();
+	std::lock_guard<std::mutex> guard(counts_lock_);
+	for (auto &count : counts_) {
+		count.accepted = 0;
+		count.rejected = 0;
+	}
+}
+
+
+std::vector<FilterCount> EventFilter::Counts() const {
+	std::lock_guard<std::mutex> guard(counts_lock_);
+	return counts_;
+}
+
+
+void EventFilter::ApplyChannel(const FilterRule &rule, DataBlock &block) const {
+	const size_t size = block.events.Size();
+	const uint8_t *channel = block.events.channel.data();
+	uint8_t *keep = block.keep.data();
+	const uint32_t mask = rule.mask;
+	for (size_t i = 0; i < size; ++i) {
+		keep[i] &= (mask >> channel[i]) & 1;
+	}
+}
+
+
+void EventFilter::ApplyEnergy(const FilterRule &rule, DataBlock &block) const {
+	const size_t size = block.events.Size();
+	const uint8_t *channel = block.events.channel.data();
+	const uint16_t *energy = block.events.energy.data();
+	uint8_t *keep = block.keep.data();
+	const uint16_t min_energy = rule.min_energy;
+	const uint16_t max_energy = rule.max_energy;
+	if (rule.channel == kChannelNum) {
+		for (size_t i = 0; i < size; ++i) {
+			keep[i] &= (energy[i] >= min_energy) & (energy[i] <= max_energy);
+		}
+	} else {
+		const uint8_t target = rule.channel;
+		for (size_t i = 0; i < size; ++i) {
+			uint8_t inside =
+				(energy[i] >= min_energy) & (energy[i] <= max_energy);
+			keep[i] &= inside | (channel[i] != target);
+		}
+	}
+}
+
+
+void EventFilter::CountNeighbours(
+	uint64_t window,
+	const DataBlock &block,
+	const std::deque<uint64_t> &decided
+) {
+	const size_t size = block.events.Size();
+	const std::vector<uint64_t> &time = block.events.time;
+	// sort kept events by time, they are almost in order
+	order_.clear();
+	for (size_t i = 0; i < size; ++i) {
+		if (block.keep[i]) order_.push_back(i);
+	}
+	std::stable_sort(
+		order_.begin(), order_.end(),
+		[&time](uint32_t a, uint32_t b) {
+			return time[a] < time[b];
+		}
+	);
+	past_.assign(decided.begin(), decided.end());
+	std::sort(past_.begin(), past_.end());
+
+	// count events in [t-window, t+window] with two pointers, and the
+	// decided events of the previous blocks by binary search
+	neighbours_.assign(size, 0);
+	size_t low = 0;
+	size_t high = 0;
+	for (size_t k = 0; k < order_.size(); ++k) {
+		uint64_t t = time[order_[k]];
+		while (time[order_[low]] + window < t) ++low;
+		while (high < order_.size() && time[order_[high]] <= t + window) {
+			++high;
+		}
+		neighbours_[order_[k]] = high - low;
+		if (!past_.empty()) {
+			neighbours_[order_[k]] += std::upper_bound(
+				past_.begin(), past_.end(), t + window
+			) - std::lower_bound(
+				past_.begin(), past_.end(), t - std::min(t, window)
+			);
+		}
+	}
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,449 @@
+#include "include/event_sort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+
+#include "include/columnar.h"
+#include "include/error.h"
+#include "include/list_mode.h"
+#include "include/mapped_file.h"
+#include "include/parallel.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+void RadixSortKeys(std::vector<SortKey> &keys) {
+	auto less = [](const SortKey &a, const SortKey &b) {
+		return a.time < b.time;
+	};
+	// data of a module is approximately ordered, and often sorted already
+	if (std::is_sorted(keys.begin(), keys.end(), less)) return;
+
+	std::vector<SortKey> buffer(keys.size());
+	std::vector<size_t> counts(size_t(1) << 16);
+	for (unsigned int shift = 0; shift < 48; shift += 16) {
+		std::fill(counts.begin(), counts.end(), 0);
+		for (const auto &key : keys) {
+			++counts[(key.time >> shift) & 0xffff];
+		}
+		// all keys have the same digit, nothing to move
+		if (counts[(keys[0].time >> shift) & 0xffff] == keys.size()) continue;
+
+		size_t position = 0;
+		for (auto &count : counts) {
+			size_t value = count;
+			count = position;
+			position += value;
+		}
+		for (const auto &key : keys) {
+			buffer[counts[(key.time >> shift) & 0xffff]++] = key;
+		}
+		keys.swap(buffer);
+	}
+}
+
+
+/// This class writes words to file in large blocks.
+class BlockWriter {
+public:
+
+	/// @brief constructor, create file
+	///
+	/// @param[in] path path of file
+	/// @param[in] capacity words of buffer
+	///
+	/// @throws RXError if failed to create file
+	///
+	BlockWriter(const std::string &path, size_t capacity)
+	: path_(path), fout_(path, std::ios::out | std::ios::binary | std::ios::trunc) {
+		if (!fout_.good()) {
+			throw RXError("Create file " + path + " failed.");
+		}
+		buffer_.reserve(capacity);
+	}
+
+
+	/// @brief append words, write the buffer if it's full
+	///
+	/// @param[in] words words to append
+	/// @param[in] size number of words
+	///
+	/// @throws RXError if failed to write
+	///
+	void Append(const uint32_t *words, size_t size) {
+		if (buffer_.size() + size > buffer_.capacity()) {
+			Flush();
+			if (size > buffer_.capacity()) {
+				// larger than buffer, write directly
+				Write(words, size);
+				return;
+			}
+		}
+		buffer_.insert(buffer_.end(), words, words + size);
+	}
+
+
+	/// @brief write buffer and close file
+	///
+	/// @throws RXError if failed to write
+	///
+	void Close() {
+		Flush();
+		fout_.close();
+		if (!fout_.good()) {
+			throw RXError("Write file " + path_ + " failed.");
+		}
+	}
+
+private:
+
+	/// @brief write buffer to file
+	///
+	/// @throws RXError if failed to write
+	///
+	void Flush() {
+		Write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+
+
+	/// @brief write words to file
+	///
+	/// @param[in] words words to write
+	/// @param[in] size number of words
+	///
+	/// @throws RXError if failed to write
+	///
+	void Write(const uint32_t *words, size_t size) {
+		fout_.write(
+			reinterpret_cast<const char*>(words), size * sizeof(uint32_t)
+		);
+		if (!fout_.good()) {
+			throw RXError("Write file " + path_ + " failed.");
+		}
+	}
+
+	std::string path_;
+	std::ofstream fout_;
+	std::vector<uint32_t> buffer_;
+};
+
+
+/// This class reads events of a sorted run in large blocks.
+class RunReader {
+public:
+
+	/// @brief constructor, open file and read the first event
+	///
+	/// @param[in] path path of file
+	/// @param[in] capacity words of buffer, larger than the longest event
+	///
+	/// @throws RXError if failed to open file
+	///
+	RunReader(const std::string &path, size_t capacity)
+	: path_(path), fin_(path, std::ios::in | std::ios::binary)
+	, buffer_(capacity), begin_(0), end_(0), length_(0) {
+		if (!fin_.good()) {
+			throw RXError("Open file " + path + " failed.");
+		}
+		Load();
+	}
+
+
+	/// @brief check whether there is an event
+	///
+	/// @returns true if there is an event
+	///
+	inline bool Valid() const noexcept {
+		return length_ != 0;
+	}
+
+
+	/// @brief get timestamp of current event
+	///
+	/// @returns timestamp
+	///
+	inline uint64_t Time() const noexcept {
+		const uint32_t *event = Event();
+		return (uint64_t(event[2] & kTimeHighMask) << 32) | event[1];
+	}
+
+
+	/// @brief get current event
+	///
+	/// @returns pointer to the first word of event
+	///
+	inline const uint32_t* Event() const noexcept {
+		return buffer_.data() + begin_;
+	}
+
+
+	/// @brief get words of current event
+	///
+	/// @returns words
+	///
+	inline uint32_t Length() const noexcept {
+		return length_;
+	}
+
+
+	/// @brief move to the next event
+	///
+	/// @throws RXError if the file ends with incomplete event
+	///
+	void Next() {
+		begin_ += length_;
+		Load();
+	}
+
+private:
+
+	/// @brief make sure the whole current event is in buffer
+	///
+	/// @throws RXError if the file ends with incomplete event
+	///
+	void Load() {
+		length_ = 0;
+		if (end_ - begin_ < kMinHeaderLength || end_ - begin_ < EventLength()) {
+			Fill();
+		}
+		if (begin_ == end_) return;
+		if (end_ - begin_ < kMinHeaderLength || end_ - begin_ < EventLength()) {
+			throw RXError("File " + path_ + " ends with incomplete event.");
+		}
+		length_ = EventLength();
+	}
+
+
+	/// @brief get length of event at the beginning of buffer
+	///
+	/// @returns words of event
+	///
+	inline uint32_t EventLength() const noexcept {
+		return (buffer_[begin_] >> kEventLengthShift) & kEventLengthMask;
+	}
+
+
+	/// @brief move the rest words to the front and read more
+	///
+	void Fill() {
+		std::copy(buffer_.begin() + begin_, buffer_.begin() + end_, buffer_.begin());
+		end_ -= begin_;
+		begin_ = 0;
+		fin_.read(
+			reinterpret_cast<char*>(buffer_.data() + end_),
+			(buffer_.size() - end_) * sizeof(uint32_t)
+		);
+		end_ += fin_.gcount() / sizeof(uint32_t);
+	}
+
+	std::string path_;
+	std::ifstream fin_;
+	std::vector<uint32_t> buffer_;
+	size_t begin_;
+	size_t end_;
+	uint32_t length_;
+};
+
+
+/// @brief merge sorted runs into one file
+///
+/// @param[in] inputs paths of sorted runs, in order of priority for the
+/// 	same timestamp
+/// @param[in] output path of merged file
+/// @param[in] buffer_words words of buffer of each run and output
+///
+/// @throws RXError if failed to read or write files
+///
+void MergeRuns(
+	const std::vector<std::string> &inputs,
+	const std::string &output,
+	size_t buffer_words
+) {
+	TraceSpan trace_span("MergeRuns");
+	std::vector<std::unique_ptr<RunReader>> readers;
+	for (const auto &input : inputs) {
+		readers.push_back(std::make_unique<RunReader>(input, buffer_words));
+	}
+	BlockWriter writer(output, buffer_words);
+
+	// earliest event on top, then the run with smaller index
+	using Item = std::pair<uint64_t, size_t>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+	for (size_t i = 0; i < readers.size(); ++i) {
+		if (readers[i]->Valid()) {
+			heap.emplace(readers[i]->Time(), i);
+		}
+	}
+	while (!heap.empty()) {
+		size_t index = heap.top().second;
+		heap.pop();
+		RunReader &reader = *readers[index];
+		writer.Append(reader.Event(), reader.Length());
+		reader.Next();
+		if (reader.Valid()) {
+			heap.emplace(reader.Time(), index);
+		}
+	}
+	writer.Close();
+}
+
+
+SortResult SortRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	const SortOptions &options
+) {
+	TraceSpan trace_span("SortRun");
+	const unsigned int threads = WorkerThreads(options.threads);
+	const size_t memory = std::max(options.memory, kMinMergeBuffer * 3);
+	std::filesystem::path temp_directory = options.temp_directory.empty() ?
+		std::filesystem::absolute(output).parent_path() :
+		std::filesystem::path(options.temp_directory);
+	std::filesystem::create_directories(temp_directory);
+	const std::string temp_prefix = (
+		temp_directory / std::filesystem::path(output).filename()
+	).string();
+
+	for (const auto &file : files) {
+		std::error_code error;
+		if (std::filesystem::equivalent(file, output, error)) {
+			throw RXError("Output " + output + " is the same as input file.");
+		}
+	}
+
+	SortResult result{files.size(), 0, 0, 0, 0, 0.0, 0.0};
+	std::vector<std::string> temp_files;
+	auto remove_temp_files = [&temp_files]() {
+		std::error_code error;
+		for (const auto &file : temp_files) {
+			std::filesystem::remove(file, error);
+		}
+		temp_files.clear();
+	};
+
+	try {
+		// split files into chunks, each thread holds the sorted copy of its
+		// chunk and the keys
+		auto start = std::chrono::steady_clock::now();
+		const size_t chunk_words = memory / threads / 3 / sizeof(uint32_t);
+		std::vector<std::unique_ptr<MappedFile>> mapped;
+		std::vector<std::pair<size_t, FileChunk>> tasks;
+		for (size_t f = 0; f < files.size(); ++f) {
+			mapped.push_back(std::make_unique<MappedFile>(files[f]));
+			mapped.back()->AdviseSequential();
+			std::vector<FileChunk> chunks = SplitChunks(
+				mapped.back()->Words(), mapped.back()->WordSize(), chunk_words
+			);
+			for (const auto &chunk : chunks) {
+				tasks.emplace_back(f, chunk);
+				temp_files.push_back(
+					temp_prefix + ".run" + std::to_string(temp_files.size()) + ".tmp"
+				);
+			}
+		}
+
+		// generate sorted runs in parallel
+		std::atomic<uint64_t> events(0);
+		// buffers of each thread, reused by its runs
+		std::vector<std::vector<SortKey>> thread_keys(threads);
+		std::vector<std::vector<uint32_t>> thread_sorted(threads);
+		ParallelFor(tasks.size(), threads, [&](size_t t, unsigned int worker) {
+			TraceSpan run_span("generate sorted run");
+			std::vector<SortKey> &keys = thread_keys[worker];
+			std::vector<uint32_t> &sorted = thread_sorted[worker];
+			const uint32_t *words = mapped[tasks[t].first]->Words();
+			const FileChunk &chunk = tasks[t].second;
+			keys.clear();
+			for (uint64_t position = chunk.begin; position < chunk.end;) {
+				const uint32_t *event = words + position;
+				uint32_t length = (event[0] >> kEventLengthShift) & kEventLengthMask;
+				keys.push_back(SortKey{
+					(uint64_t(event[2] & kTimeHighMask) << 32) | event[1],
+					position,
+					length
+				});
+				position += length;
+			}
+			RadixSortKeys(keys);
+
+			sorted.resize(chunk.end - chunk.begin);
+			uint32_t *out = sorted.data();
+			for (const auto &key : keys) {
+				out = std::copy(
+					words + key.offset, words + key.offset + key.length, out
+				);
+			}
+			BlockWriter writer(temp_files[t], 0);
+			writer.Append(sorted.data(), sorted.size());
+			writer.Close();
+			events += keys.size();
+		});
+		mapped.clear();
+		result.events = events;
+		result.runs = tasks.size();
+		for (const auto &task : tasks) {
+			result.bytes += (task.second.end - task.second.begin) * sizeof(uint32_t);
+		}
+		auto generated = std::chrono::steady_clock::now();
+		result.generate_seconds =
+			std::chrono::duration<double>(generated - start).count();
+
+		// merge runs, in several passes if there are too many
+		const size_t fan_in = std::clamp(
+			memory / kMinMergeBuffer - 1, size_t(2), kMaxMergeFanIn
+		);
+		std::vector<std::string> runs = temp_files;
+		while (runs.size() > fan_in) {
+			std::vector<std::string> merged;
+			const size_t groups = (runs.size() + fan_in - 1) / fan_in;
+			// spread the runs evenly, so the buffers are as large as possible
+			const size_t group_size = (runs.size() + groups - 1) / groups;
+			const size_t buffer_words = memory / (group_size + 1) / sizeof(uint32_t);
+			for (size_t begin = 0; begin < runs.size(); begin += group_size) {
+				std::vector<std::string> group(
+					runs.begin() + begin,
+					runs.begin() + std::min(runs.size(), begin + group_size)
+				);
+				merged.push_back(
+					temp_prefix + ".run" + std::to_string(temp_files.size()) + ".tmp"
+				);
+				temp_files.push_back(merged.back());
+				MergeRuns(group, merged.back(), buffer_words);
+				for (const auto &run : group) {
+					std::filesystem::remove(run);
+				}
+			}
+			runs.swap(merged);
+			++result.passes;
+		}
+		std::error_code rename_error;
+		if (runs.size() == 1) {
+			std::filesystem::rename(runs[0], output, rename_error);
+		}
+		if (runs.size() != 1 || rename_error) {
+			// the last pass, or copy the only run to another file system
+			const size_t buffer_words =
+				memory / (runs.size() + 1) / sizeof(uint32_t);
+			MergeRuns(runs, output, buffer_words);
+			++result.passes;
+		}
+		remove_temp_files();
+		result.merge_seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - generated
+		).count();
+	} catch (...) {
+		remove_temp_files();
+		throw;
+	}
+	return result;
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,152 @@
+#include "include/fifo_monitor.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace rxdaq {
+
+FifoMonitor::FifoMonitor(size_t capacity) noexcept
+: capacity_(std::max(capacity, size_t(1))) {
+
+	Reset({});
+}
+
+
+void FifoMonitor::Reset(const std::vector<double> &marks) {
+	marks_.assign(
+		marks.begin(), marks.begin() + std::min(marks.size(), kMaxFifoMarks)
+	);
+	for (auto &levels : modules_) {
+		for (auto &polls : levels.polls) {
+			polls.store(0, std::memory_order_relaxed);
+		}
+		levels.max_words.store(0, std::memory_order_relaxed);
+		for (auto &nanoseconds : levels.nanoseconds_above) {
+			nanoseconds.store(0, std::memory_order_relaxed);
+		}
+		levels.last_time = -1.0;
+		levels.last_marks = 0;
+		levels.warned_marks = 0;
+		levels.warned_time = 0.0;
+	}
+	start_ = std::chrono::steady_clock::now();
+}
+
+
+int FifoMonitor::Record(unsigned short module, size_t words) {
+	return Record(
+		module,
+		words,
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count()
+	);
+}
+
+
+int FifoMonitor::Record(unsigned short module, size_t words, double seconds) {
+	if (module >= kModuleNum) return -1;
+	ModuleLevels &levels = modules_[module];
+
+	size_t bin = std::min(words * kFifoLevelBins / capacity_, kFifoLevelBins - 1);
+	levels.polls[bin].fetch_add(1, std::memory_order_relaxed);
+	if (words > levels.max_words.load(std::memory_order_relaxed)) {
+		levels.max_words.store(words, std::memory_order_relaxed);
+	}
+
+	// the level of the last poll lasts until this poll
+	if (levels.last_time >= 0 && seconds > levels.last_time) {
+		uint64_t nanoseconds = static_cast<uint64_t>((seconds - levels.last_time) * 1e9);
+		for (size_t i = 0; i < levels.last_marks; ++i) {
+			levels.nanoseconds_above[i].fetch_add(nanoseconds, std::memory_order_relaxed);
+		}
+	}
+
+	double fill = static_cast<double>(words) / capacity_;
+	size_t reached = 0;
+	while (reached < marks_.size() && fill >= marks_[reached]) {
+		++reached;
+	}
+	// warn when crossing a mark upward, unless it was warned recently
+	int result = -1;
+	if (
+		reached > levels.last_marks
+		&& (
+			reached > levels.warned_marks
+			|| seconds - levels.warned_time >= kFifoWarningSeconds
+		)
+	) {
+		result = static_cast<int>(reached) - 1;
+		levels.warned_marks = reached;
+		levels.warned_time = seconds;
+	}
+	if (seconds - levels.warned_time >= kFifoWarningSeconds) {
+		levels.warned_marks = 0;
+	}
+	levels.last_time = seconds;
+	levels.last_marks = reached;
+	return result;
+}
+
+
+std::vector<FifoLevelStats> FifoMonitor::Stats() const {
+	std::vector<FifoLevelStats> result;
+	for (unsigned short m = 0; m < kModuleNum; ++m) {
+		const ModuleLevels &levels = modules_[m];
+		FifoLevelStats stats;
+		stats.module = m;
+		uint64_t polls = 0;
+		for (size_t i = 0; i < kFifoLevelBins; ++i) {
+			stats.polls[i] = levels.polls[i].load(std::memory_order_relaxed);
+			polls += stats.polls[i];
+		}
+		if (!polls) continue;
+		stats.max_fill = static_cast<double>(
+			levels.max_words.load(std::memory_order_relaxed)
+		) / capacity_;
+		for (size_t i = 0; i < marks_.size(); ++i) {
+			stats.seconds_above.push_back(
+				levels.nanoseconds_above[i].load(std::memory_order_relaxed) * 1e-9
+			);
+		}
+		result.push_back(stats);
+	}
+	return result;
+}
+
+
+std::string FifoLevelInfo(
+	const std::vector<FifoLevelStats> &stats,
+	const std::vector<double> &marks
+) {
+	if (stats.empty()) return "";
+	std::stringstream result;
+	// polls in percent for each 10% of FIFO, then the time above marks
+	result << "FIFO fill(%)";
+	for (size_t i = 0; i < kFifoLevelBins; ++i) {
+		result << std::setw(6) << (std::to_string(i * 100 / kFifoLevelBins) + "+");
+	}
+	result << std::setw(7) << "max";
+	for (const auto &mark : marks) {
+		result << std::setw(8) << (">" + std::to_string(int(mark * 100 + 0.5)) + "%");
+	}
+	result << "\n" << std::fixed;
+	for (const auto &module : stats) {
+		uint64_t polls = 0;
+		for (const auto &count : module.polls) {
+			polls += count;
+		}
+		result << "  module " << std::setw(2) << module.module << " " << std::setprecision(1);
+		for (const auto &count : module.polls) {
+			result << std::setw(6) << (polls ? count * 100.0 / polls : 0.0);
+		}
+		result << std::setw(6) << module.max_fill * 100.0 << "%";
+		result << std::setprecision(2);
+		for (const auto &seconds : module.seconds_above) {
+			result << std::setw(7) << seconds << "s";
+		}
+		result << "\n";
+	}
+	return result.str();
+}
+
+}		// namespace rxdaq
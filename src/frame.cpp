@@ -5,6 +5,7 @@
 
 #include "grpcpp/grpcpp.h"
 
+#include "include/endpoint.h"
 #include "include/error.h"
 #include "include/remote_crate.h"
 
@@ -48,19 +49,28 @@ void Frame::Run() {
 		std::cerr << "Error: Frame's interactor not found." << std::endl;
 		exit(-1);
 	}
-	// create crate if needed
-	if (
-		interactor_->Type() == Interactor::InteractorType::kRpcCommandParser ||
-		interactor_->Type() == Interactor::InteractorType::kUndefined
-	) {	
-		crate_ = std::make_shared<Crate>();
-	} else if (interactor_->Type() != Interactor::InteractorType::kHelpCommandParser) {
-		crate_ = std::make_shared<RemoteCrate>(
-			grpc::CreateChannel("localhost:12300", grpc::InsecureChannelCredentials())
-		);
-	}
 
 	try {
+		// create crate if needed
+		if (
+			interactor_->Type() == Interactor::InteractorType::kRpcCommandParser ||
+			interactor_->Type() == Interactor::InteractorType::kUndefined
+		) {	
+			crate_ = std::make_shared<Crate>();
+		} else if (
+			interactor_->Type() != Interactor::InteractorType::kHelpCommandParser
+			&& interactor_->NeedCrate()
+		) {
+			// find the server from environment or config of the same host
+			std::string endpoint = ChooseEndpoint(
+				ConnectEndpoint(ConfiguredEndpoint(interactor_->ConfigPath())),
+				kClientEndpoint
+			);
+			crate_ = std::make_shared<RemoteCrate>(
+				grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials())
+			);
+		}
+
 		// Run the Interactor. From now on, the daq do nothing and
 		// the Interactor call the public method of the Crate actively.
 		interactor_->Run(crate_);
@@ -0,0 +1,480 @@
+#include "include/histogram.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <mutex>
+
+#include "include/columnar.h"
+#include "include/error.h"
+#include "include/mapped_file.h"
+#include "include/parallel.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+// magic "RXHS" and version of binary histogram file
+const uint32_t kHistogramMagic = 0x53485852;
+const uint32_t kHistogramVersion = 1;
+// channel histograms indexed by 4 bits crate, slot and channel
+const size_t kChannelKeys = size_t(1) << 12;
+// QDC sums in header, Pixie-16 puts them after the 4 energy sums if any
+const uint32_t kQdcSums = 8;
+// most following events compared for coincidence, bounds the time of
+// unsorted data
+const size_t kMaxPairLookahead = 256;
+
+
+//-----------------------------------------------------------------------------
+//								Histogram
+//-----------------------------------------------------------------------------
+
+Histogram::Histogram(
+	const std::string &name,
+	uint32_t x_bins,
+	double x_min,
+	double x_max
+)
+: Histogram(name, x_bins, x_min, x_max, 0, 0.0, 0.0) {
+}
+
+
+Histogram::Histogram(
+	const std::string &name,
+	uint32_t x_bins,
+	double x_min,
+	double x_max,
+	uint32_t y_bins,
+	double y_min,
+	double y_max
+)
+: name_(name)
+, x_bins_(x_bins)
+, x_min_(x_min)
+, x_max_(x_max)
+, x_scale_(0.0)
+, y_bins_(y_bins)
+, y_min_(y_min)
+, y_max_(y_max)
+, y_scale_(0.0) {
+
+	if (x_bins_ == 0 || !(x_max_ > x_min_)) {
+		throw RXError("Invalid x axis of histogram " + name_);
+	}
+	if (y_bins_ != 0 && !(y_max_ > y_min_)) {
+		throw RXError("Invalid y axis of histogram " + name_);
+	}
+	x_scale_ = x_bins_ / (x_max_ - x_min_);
+	if (y_bins_) {
+		y_scale_ = y_bins_ / (y_max_ - y_min_);
+	}
+	counts_.resize(size_t(x_bins_ + 2) * (y_bins_ ? y_bins_ + 2 : 1), 0);
+}
+
+
+void Histogram::Add(const Histogram &other) {
+	if (
+		other.x_bins_ != x_bins_ || other.x_min_ != x_min_
+		|| other.x_max_ != x_max_ || other.y_bins_ != y_bins_
+		|| other.y_min_ != y_min_ || other.y_max_ != y_max_
+	) {
+		throw RXError("Add histograms with different bins: " + name_);
+	}
+	for (size_t i = 0; i < counts_.size(); ++i) {
+		counts_[i] += other.counts_[i];
+	}
+}
+
+
+void Histogram::SetCounts(std::vector<uint64_t> &&counts) {
+	if (counts.size() != counts_.size()) {
+		throw RXError("Set counts of different size to histogram " + name_);
+	}
+	counts_ = std::move(counts);
+}
+
+
+//-----------------------------------------------------------------------------
+//								HistogramSet
+//-----------------------------------------------------------------------------
+
+HistogramOptions DefaultHistogramOptions() noexcept {
+	return HistogramOptions{
+		4096,			// energy_bins
+		0,				// qdc_gate
+		4096,			// qdc_bins
+		1048576.0,		// qdc_max
+		100,			// window
+		200,			// time_bins
+		512,			// coincidence_bins
+		0,				// threads
+		kDefaultChunkWords
+	};
+}
+
+
+/// @brief get name of channel histogram
+///
+/// @param[in] prefix prefix of name
+/// @param[in] key key of crate, slot and channel
+/// @returns name, e.g. energy_C0_S2_CH05
+///
+static std::string ChannelName(const std::string &prefix, size_t key) {
+	std::string channel = std::to_string(key & 0xf);
+	if (channel.size() < 2) channel = "0" + channel;
+	return prefix
+		+ "_C" + std::to_string(key >> 8)
+		+ "_S" + std::to_string((key >> 4) & 0xf)
+		+ "_CH" + channel;
+}
+
+
+HistogramSet::HistogramSet(const HistogramOptions &options)
+: options_(options)
+, events_(0)
+, energy_(kChannelKeys)
+, qdc_(kChannelKeys)
+, time_difference_(
+	"time_difference", options.time_bins,
+	-double(options.window), double(options.window)
+)
+, coincidence_(
+	"energy_energy", options.coincidence_bins, 0.0, 65536.0,
+	options.coincidence_bins, 0.0, 65536.0
+) {
+
+	if (options_.window == 0) {
+		throw RXError("Coincidence window should be positive");
+	}
+	if (options_.qdc_gate >= kQdcSums) {
+		throw RXError("QDC gate should be less than 8");
+	}
+}
+
+
+void HistogramSet::CreateChannel(size_t key) {
+	energy_[key] = std::make_unique<Histogram>(
+		ChannelName("energy", key), options_.energy_bins, 0.0, 65536.0
+	);
+	qdc_[key] = std::make_unique<Histogram>(
+		ChannelName("qdc", key), options_.qdc_bins, 0.0, options_.qdc_max
+	);
+}
+
+
+void HistogramSet::Fill(const EventBatch &events, const uint32_t *words) {
+	const size_t size = events.Size();
+	events_ += size;
+	for (size_t i = 0; i < size; ++i) {
+		size_t key = (size_t(events.crate[i]) << 8)
+			| (size_t(events.slot[i]) << 4) | events.channel[i];
+		if (!energy_[key]) CreateChannel(key);
+		energy_[key]->Fill(events.energy[i]);
+
+		// header of 12 or 14 words has QDC sums after the 4 words, and
+		// header of 16 or 18 words has them after the energy sums
+		uint32_t header_length = events.header_length[i];
+		if (header_length >= 12) {
+			uint32_t first = header_length >= 16 ? 8 : 4;
+			qdc_[key]->Fill(
+				words[events.offset[i] + first + options_.qdc_gate]
+			);
+		}
+
+		// pair with the following events in the window, events slightly out
+		// of order are still paired by the absolute difference
+		const int64_t window = int64_t(options_.window);
+		const size_t last = std::min(size, i + 1 + kMaxPairLookahead);
+		for (size_t j = i + 1; j < last; ++j) {
+			int64_t difference = int64_t(events.time[j] - events.time[i]);
+			if (difference >= window) break;
+			if (difference <= -window) continue;
+			time_difference_.Fill(double(difference));
+			coincidence_.Fill(events.energy[i], events.energy[j]);
+		}
+	}
+}
+
+
+void HistogramSet::Add(const HistogramSet &other) {
+	events_ += other.events_;
+	for (size_t key = 0; key < kChannelKeys; ++key) {
+		if (!other.energy_[key]) continue;
+		if (!energy_[key]) CreateChannel(key);
+		energy_[key]->Add(*other.energy_[key]);
+		qdc_[key]->Add(*other.qdc_[key]);
+	}
+	time_difference_.Add(other.time_difference_);
+	coincidence_.Add(other.coincidence_);
+}
+
+
+std::vector<const Histogram*> HistogramSet::Histograms() const {
+	std::vector<const Histogram*> result;
+	for (const auto &histogram : energy_) {
+		if (histogram) result.push_back(histogram.get());
+	}
+	for (const auto &histogram : qdc_) {
+		if (histogram) result.push_back(histogram.get());
+	}
+	result.push_back(&time_difference_);
+	result.push_back(&coincidence_);
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------
+//								FillHistograms
+//-----------------------------------------------------------------------------
+
+/// chunk of a data file to fill
+struct HistogramTask {
+	size_t file;
+	FileChunk chunk;
+};
+
+
+/// This class distributes tasks to threads. Each thread takes tasks from
+/// the front of its own queue, and steals from the back of the other queues
+/// when its own queue is empty, so threads stay busy even if chunks take
+/// different time.
+class TaskQueues {
+public:
+
+	/// @brief constructor, tasks are dealt to queues in turn
+	///
+	/// @param[in] tasks all tasks
+	/// @param[in] queues number of queues
+	///
+	TaskQueues(const std::vector<HistogramTask> &tasks, size_t queues)
+	: queues_(queues), locks_(queues) {
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			queues_[i % queues].push_back(tasks[i]);
+		}
+	}
+
+
+	/// @brief get next task of thread
+	///
+	/// @param[in] index index of thread
+	/// @param[out] task next task
+	/// @returns true if got a task, false if all queues are empty
+	///
+	bool Next(size_t index, HistogramTask &task) {
+		{
+			std::lock_guard<std::mutex> guard(locks_[index]);
+			if (!queues_[index].empty()) {
+				task = queues_[index].front();
+				queues_[index].pop_front();
+				return true;
+			}
+		}
+		for (size_t i = 1; i < queues_.size(); ++i) {
+			size_t victim = (index + i) % queues_.size();
+			std::lock_guard<std::mutex> guard(locks_[victim]);
+			if (!queues_[victim].empty()) {
+				task = queues_[victim].back();
+				queues_[victim].pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	/// @brief drop all tasks
+	///
+	void Clear() {
+		for (size_t i = 0; i < queues_.size(); ++i) {
+			std::lock_guard<std::mutex> guard(locks_[i]);
+			queues_[i].clear();
+		}
+	}
+
+private:
+	std::vector<std::deque<HistogramTask>> queues_;
+	std::vector<std::mutex> locks_;
+};
+
+
+HistogramSet FillHistograms(
+	const std::vector<std::string> &files,
+	const HistogramOptions &options
+) {
+	TraceSpan trace_span("FillHistograms");
+	unsigned int threads = WorkerThreads(options.threads);
+
+	// map files and split them at event boundaries
+	std::vector<std::unique_ptr<MappedFile>> mapped;
+	std::vector<HistogramTask> tasks;
+	for (size_t f = 0; f < files.size(); ++f) {
+		mapped.push_back(std::make_unique<MappedFile>(files[f]));
+		const MappedFile &file = *mapped.back();
+		file.AdviseSequential();
+		for (const auto &chunk : SplitChunks(file.Words(), file.WordSize(), options.chunk_words)) {
+			tasks.push_back(HistogramTask{f, chunk});
+		}
+	}
+	threads = std::max(std::min(size_t(threads), tasks.size()), size_t(1));
+
+	// each thread fills its own histograms
+	TaskQueues queues(tasks, threads);
+	std::vector<HistogramSet> local;
+	for (size_t i = 0; i < threads; ++i) {
+		local.emplace_back(options);
+	}
+	auto work = [&](unsigned int index) {
+		EventBatch events;
+		HistogramTask task;
+		while (queues.Next(index, task)) {
+			TraceSpan chunk_span("histogram chunk");
+			const uint32_t *words = mapped[task.file]->Words() + task.chunk.begin;
+			const size_t size = task.chunk.end - task.chunk.begin;
+			events.Clear();
+			if (DecodeListMode(words, size, events) != size) {
+				throw RXError(
+					"Chunk at word " + std::to_string(task.chunk.begin)
+					+ " of " + mapped[task.file]->Path()
+					+ " ends with incomplete event."
+				);
+			}
+			local[index].Fill(events, words);
+		}
+	};
+	// stop other threads by dropping their tasks
+	RunWorkers(threads, work, [&]() { queues.Clear(); });
+
+	for (size_t i = 1; i < local.size(); ++i) {
+		local[0].Add(local[i]);
+	}
+	return std::move(local[0]);
+}
+
+
+//-----------------------------------------------------------------------------
+//								output
+//-----------------------------------------------------------------------------
+
+/// header of histogram in binary file
+struct HistogramHeader {
+	uint32_t name_length;
+	uint32_t x_bins;
+	double x_min;
+	double x_max;
+	uint32_t y_bins;
+	uint32_t reserved;
+	double y_min;
+	double y_max;
+};
+
+
+void WriteHistograms(
+	const std::string &path,
+	const std::vector<const Histogram*> &histograms
+) {
+	std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+	if (!fout.good()) {
+		throw RXError("Failed to open histogram file " + path);
+	}
+	uint32_t file_header[3] = {
+		kHistogramMagic, kHistogramVersion, uint32_t(histograms.size())
+	};
+	fout.write(reinterpret_cast<const char*>(file_header), sizeof(file_header));
+	for (const auto &histogram : histograms) {
+		HistogramHeader header{
+			uint32_t(histogram->Name().size()),
+			histogram->XBins(), histogram->XMin(), histogram->XMax(),
+			histogram->YBins(), 0, histogram->YMin(), histogram->YMax()
+		};
+		fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		fout.write(histogram->Name().data(), histogram->Name().size());
+		fout.write(
+			reinterpret_cast<const char*>(histogram->Counts().data()),
+			histogram->Counts().size() * sizeof(uint64_t)
+		);
+	}
+	fout.close();
+	if (fout.fail()) {
+		throw RXError("Failed to write histogram file " + path);
+	}
+}
+
+
+std::vector<Histogram> ReadHistograms(const std::string &path) {
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin.good()) {
+		throw RXError("Failed to open histogram file " + path);
+	}
+	uint32_t file_header[3];
+	fin.read(reinterpret_cast<char*>(file_header), sizeof(file_header));
+	if (
+		!fin.good() || file_header[0] != kHistogramMagic
+		|| file_header[1] != kHistogramVersion
+	) {
+		throw RXError("Not a histogram file " + path);
+	}
+	std::vector<Histogram> result;
+	for (uint32_t i = 0; i < file_header[2]; ++i) {
+		HistogramHeader header;
+		fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!fin.good() || header.name_length > 4096) {
+			throw RXError("Broken histogram file " + path);
+		}
+		std::string name(header.name_length, '\0');
+		fin.read(name.data(), name.size());
+		if (header.y_bins) {
+			result.emplace_back(
+				name, header.x_bins, header.x_min, header.x_max,
+				header.y_bins, header.y_min, header.y_max
+			);
+		} else {
+			result.emplace_back(name, header.x_bins, header.x_min, header.x_max);
+		}
+		std::vector<uint64_t> counts(result.back().Counts().size());
+		fin.read(
+			reinterpret_cast<char*>(counts.data()),
+			counts.size() * sizeof(uint64_t)
+		);
+		if (!fin.good()) {
+			throw RXError("Broken histogram file " + path);
+		}
+		result.back().SetCounts(std::move(counts));
+	}
+	return result;
+}
+
+
+void WriteHistogramsCsv(
+	const std::string &path,
+	const std::vector<const Histogram*> &histograms
+) {
+	std::ofstream fout(path, std::ios::trunc);
+	if (!fout.good()) {
+		throw RXError("Failed to open CSV file " + path);
+	}
+	fout << "name,x,y,count\n";
+	for (const auto &histogram : histograms) {
+		const uint32_t x_bins = histogram->XBins();
+		const uint32_t y_bins = histogram->YBins();
+		const double x_width = (histogram->XMax() - histogram->XMin()) / x_bins;
+		const double y_width = y_bins
+			? (histogram->YMax() - histogram->YMin()) / y_bins : 0.0;
+		// underflow and overflow are not written
+		for (uint32_t y = y_bins ? 1 : 0; y <= y_bins; ++y) {
+			for (uint32_t x = 1; x <= x_bins; ++x) {
+				uint64_t count = histogram->Count(x, y);
+				if (!count) continue;
+				fout << histogram->Name() << ","
+					<< histogram->XMin() + (x - 1) * x_width << ","
+					<< (y_bins ? histogram->YMin() + (y - 1) * y_width : 0.0) << ","
+					<< count << "\n";
+			}
+		}
+	}
+	fout.close();
+	if (fout.fail()) {
+		throw RXError("Failed to write CSV file " + path);
+	}
+}
+
+}		// namespace rxdaq
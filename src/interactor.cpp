@@ -1,15 +1,29 @@
 #include "include/interactor.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
 #include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <thread>
 
 #include "grpcpp/grpcpp.h"
 #include "pixie/error.hpp"
 
+#include "include/batch.h"
+#include "include/config.h"
 #include "include/error.h"
 #include "include/view.h"
 #include "include/control_crate_service.h"
+#include "include/endpoint.h"
+#include "include/metrics.h"
+#include "include/rpc_metrics.h"
 
 typedef xia::pixie::error::error XiaError;
 
@@ -49,6 +63,34 @@ std::unique_ptr<Interactor> Interactor::CreateInteractor(const char* name) noexc
 		result = std::make_unique<ExportCommandParser>();
 	} else if (!strcmp(name, "run")) {
 		result = std::make_unique<RunCommandParser>();
+	} else if (!strcmp(name, "trace")) {
+		result = std::make_unique<TraceCommandParser>();
+	} else if (!strcmp(name, "shell")) {
+		result = std::make_unique<ShellCommandParser>();
+	} else if (!strcmp(name, "batch")) {
+		result = std::make_unique<BatchCommandParser>();
+	} else if (!strcmp(name, "status")) {
+		result = std::make_unique<StatusCommandParser>();
+	} else if (!strcmp(name, "stop")) {
+		result = std::make_unique<StopCommandParser>();
+	} else if (!strcmp(name, "stats")) {
+		result = std::make_unique<StatsCommandParser>();
+	} else if (!strcmp(name, "filter")) {
+		result = std::make_unique<FilterCommandParser>();
+	} else if (!strcmp(name, "reduce")) {
+		result = std::make_unique<ReduceCommandParser>();
+	} else if (!strcmp(name, "query")) {
+		result = std::make_unique<QueryCommandParser>();
+	} else if (!strcmp(name, "convert")) {
+		result = std::make_unique<ConvertCommandParser>();
+	} else if (!strcmp(name, "sort")) {
+		result = std::make_unique<SortCommandParser>();
+	} else if (!strcmp(name, "hist")) {
+		result = std::make_unique<HistCommandParser>();
+	} else if (!strcmp(name, "verify")) {
+		result = std::make_unique<VerifyCommandParser>();
+	} else if (!strcmp(name, "replay")) {
+		result = std::make_unique<ReplayCommandParser>();
 	}
 	return result;
 }
@@ -81,7 +123,21 @@ std::string HelpCommandParser::Help() const noexcept {
 		"  write                 Write parameters.\n"
 		"  import                Import parameters.\n"
 		"  export                Export parameters.\n"
-		"  run                   Run in list mode.\n";
+		"  run                   Run in list mode.\n"
+		"  status                Display status of list mode run.\n"
+		"  stop                  Stop list mode run.\n"
+		"  stats                 Display latencies and errors of rpc server.\n"
+		"  filter                Filter events before writing.\n"
+		"  reduce                Cut traces before writing.\n"
+		"  query                 Find events in data file by time and channel.\n"
+		"  convert               Convert data files to columnar format.\n"
+		"  sort                  Sort events of data files by timestamp.\n"
+		"  hist                  Fill histograms of data files.\n"
+		"  verify                Check events of data files.\n"
+		"  replay                Replay data files through run pipeline.\n"
+		"  trace                 Start or stop tracing.\n"
+		"  shell                 Run commands in interactive shell.\n"
+		"  batch                 Execute batch plan.\n";
 	return result;
 }
 
@@ -133,7 +189,8 @@ void HelpCommandParser::Run(std::shared_ptr<Crate> crate) {
 std::unique_ptr<grpc::Server> RpcCommandParser::server_ = nullptr;
 
 RpcCommandParser::RpcCommandParser() noexcept
-: Interactor(CommandName(), "launch rpc server") {
+: Interactor(CommandName(), "launch rpc server")
+, metrics_port_(0) {
 
 	type_ = InteractorType::kRpcCommandParser;
 	options_.add_options()
@@ -147,11 +204,22 @@ RpcCommandParser::RpcCommandParser() noexcept
 			cxxopts::value<std::string>()->default_value("12300"),
 			"<port>"
 		)
+		(
+			"e,endpoint", "Set the endpoint of server, unix:<path> or <host>:<port>.",
+			cxxopts::value<std::string>(),
+			"<endpoint>"
+		)
 		(
 			"config", "Set config file path.",
 			cxxopts::value<std::string>()->default_value("config.json"),
 			"<file>"
 		)
+		(
+			"metrics",
+			"Serve Prometheus metrics over HTTP on this port, 0 not to serve.",
+			cxxopts::value<int>()->default_value("0"),
+			"<port>"
+		)
 		(
 			"host_pos", "Set the host of server",
 			cxxopts::value<std::string>()->default_value("0.0.0.0")
@@ -179,6 +247,18 @@ std::string RpcCommandParser::Help() const noexcept {
 		"  './rxdaq rpc 0.0.0.0 12300' to launch the rpc server and listen\n"
 		"    on 0.0.0.0:12300\n"
 		"  './rxdaq rpc -h 0.0.0.0 -p 12300' to do the same thing as above.\n"
+		"  './rxdaq rpc -e unix:/tmp/rxdaq.sock' to listen on unix domain socket,\n"
+		"    which is faster for clients on the same host.\n"
+		"  './rxdaq rpc --metrics 9100' to launch the rpc server and serve\n"
+		"    metrics at http://0.0.0.0:9100/metrics, check it by\n"
+		"    'curl localhost:9100/metrics'.\n"
+		"Without endpoint, host or port, the endpoint is taken from environment\n"
+		"variable " + std::string(kEndpointVariable) + ", then rpcEndpoint in config, then "
+		+ kServerEndpoint + ".\n"
+		"Clients connect to the same " + std::string(kEndpointVariable)
+		+ " or rpcEndpoint in the config given by\n"
+		"--config of the command, ./config.json by default, or " + kClientEndpoint
+		+ "\nif neither is set.\n"
 		"Remember that --config can be used to choose path of json config file.\n";
 	
 	return result;
@@ -202,24 +282,65 @@ void RpcCommandParser::Parse(int argc, char **argv) {
 		parse_result["port"].as<std::string>() :
 		parse_result["port_pos"].as<std::string>();
 
+	// endpoint set in command line overrides environment and config
+	endpoint_ = "";
+	if (parse_result["endpoint"].count()) {
+		if (
+			parse_result["host"].count() || parse_result["host_pos"].count()
+			|| parse_result["port"].count() || parse_result["port_pos"].count()
+		) {
+			throw UserError("endpoint conflicts with host and port");
+		}
+		endpoint_ = parse_result["endpoint"].as<std::string>();
+		if (!CheckEndpoint(endpoint_)) {
+			throw UserError("invalid endpoint " + endpoint_);
+		}
+	} else if (
+		parse_result["host"].count() || parse_result["host_pos"].count()
+		|| parse_result["port"].count() || parse_result["port_pos"].count()
+	) {
+		endpoint_ = host_ + ":" + port_;
+	}
+
+	metrics_port_ = parse_result["metrics"].as<int>();
+	if (metrics_port_ < 0 || metrics_port_ > 65535) {
+		throw UserError("port of metrics should be in 0-65535");
+	}
+
 	return;
 }
 
 
 void RpcCommandParser::Run(std::shared_ptr<Crate> crate) {
 	crate->Initialize(config_path_);
+	// handlers and run threads don't wait for the terminal
+	crate->SetAsyncMessage();
+	std::string endpoint = endpoint_.empty() ?
+		ChooseEndpoint(crate->RpcEndpoint(), kServerEndpoint) : endpoint_;
 	
 	// service
 	ControlCrateService service(crate);
 	grpc::ServerBuilder builder;
-	builder.AddListeningPort(
-		host_ + ":" + port_,
-		grpc::InsecureServerCredentials()
-	);
+	builder.AddListeningPort(endpoint, grpc::InsecureServerCredentials());
 	builder.RegisterService(&service);
+	// measure latency of every call for metrics
+	std::vector<std::unique_ptr<grpc::experimental::ServerInterceptorFactoryInterface>>
+		interceptors;
+	interceptors.push_back(std::make_unique<RpcMetricsInterceptorFactory>());
+	builder.experimental().SetInterceptorCreators(std::move(interceptors));
 
 	server_ = builder.BuildAndStart();
-	std::cout << "Rpc server listening on " << host_ << ":" << port_ << "\n";
+	if (!server_) {
+		throw RXError("Failed to listen on " + endpoint);
+	}
+	std::cout << "Rpc server listening on " << endpoint << "\n";
+
+	MetricsServer metrics_server;
+	if (metrics_port_) {
+		metrics_server.Start(host_, metrics_port_);
+		std::cout << "Metrics served on http://" << host_ << ":"
+			<< metrics_server.Port() << "/metrics\n";
+	}
 
 	// signal(SIGINT, SigIntHandler);
 	server_->Wait();
@@ -234,7 +355,9 @@ void RpcCommandParser::Run(std::shared_ptr<Crate> crate) {
 BootCommandParser::BootCommandParser() noexcept
 : Interactor(CommandName(), "boot firmwares")
 , config_path_("")
-, module_(kModuleNum) {
+, module_(kModuleNum)
+, force_(false)
+, dry_run_(false) {
 
 	type_ = InteractorType::kBootCommandParser;
 	options_.add_options()
@@ -243,6 +366,14 @@ BootCommandParser::BootCommandParser() noexcept
 			cxxopts::value<int>()->default_value(std::to_string(kModuleNum)),
 			"<id>"
 		)
+		(
+			"f,force", "Boot modules even they are up to date.",
+			cxxopts::value<bool>()
+		)
+		(
+			"dry-run", "Show what would be booted or imported only.",
+			cxxopts::value<bool>()
+		)
 		(
 			"config", "Set config file path.",
 			cxxopts::value<std::string>()->default_value("config.json"),
@@ -265,6 +396,10 @@ std::string BootCommandParser::Help() const noexcept {
 		"  './rxdaq boot' to boot all modules.\n"
 		"  './rxdaq boot 0' to boot only module 0.(same with below command)\n"
 		"  './rxdaq boot -m 0' to use options to choose module to boot.\n"
+		"  './rxdaq boot --dry-run' to show modules to boot or import.\n"
+		"  './rxdaq boot -f' to boot all modules even they are up to date.\n"
+		"Only modules differ from the config file (offline, firmware or\n"
+		"parameters changed) are booted or imported unless --force is set.\n"
 		"Remember that --config can be used to choose path of json config file.\n";
 	
 	return result;
@@ -286,13 +421,21 @@ void BootCommandParser::Parse(int argc, char **argv) {
 		parse_result["module_pos"].as<int>();
 	CheckModuleNumber(module_);
 
+	force_ = parse_result["force"].count() ? true : false;
+	dry_run_ = parse_result["dry-run"].count() ? true : false;
+
 	return;
 }
 
 
 void BootCommandParser::Run(std::shared_ptr<Crate> crate) {
 	crate->Initialize(config_path_);
-	crate->Boot(module_, false);
+	if (dry_run_) {
+		std::cout << BootPlanInfo(crate->PlanBoot(module_, !force_));
+		return;
+	}
+	crate->Boot(module_, !force_);
+	std::cout << TimingInfo(crate->BootTimings());
 
 	// if (module_ == kModuleNum) {
 	// 	std::vector<std::thread> boot_threads;
@@ -967,7 +1110,10 @@ RunCommandParser::RunCommandParser() noexcept
 , config_path_("config.json")
 , module_(kModuleNum)
 , seconds_(0)
-, run_(0) {
+, run_(0)
+, roll_{0, 0, 0}
+, detach_(false)
+, rate_seconds_(10) {
 
 	type_ = InteractorType::kRunCommandParser;
 	options_.add_options()
@@ -989,6 +1135,35 @@ RunCommandParser::RunCommandParser() noexcept
 			cxxopts::value<int>()->default_value("-1"),
 			"<number>"
 		)
+		(
+			"roll-time",
+			"Run continuously and roll to the next run after these seconds.",
+			cxxopts::value<int>()->default_value("0"),
+			"<seconds>"
+		)
+		(
+			"roll-size",
+			"Run continuously and roll to the next run after writing this size.",
+			cxxopts::value<int>()->default_value("0"),
+			"<MiB>"
+		)
+		(
+			"runs",
+			"Stop continuous run after this number of runs, default is 0(infinite).",
+			cxxopts::value<int>()->default_value("0"),
+			"<number>"
+		)
+		(
+			"d,detach",
+			"Return after the run starts, use 'status' and 'stop' to control it.",
+			cxxopts::value<bool>()
+		)
+		(
+			"rates",
+			"Print input rates of channels at this interval, 0 not to print.",
+			cxxopts::value<int>()->default_value("10"),
+			"<seconds>"
+		)
 		(
 			"config",
 			"Set the config file path.",
@@ -1025,6 +1200,10 @@ std::string RunCommandParser::Help() const noexcept {
 		"  'run 0 60 3' to run module 0 in list mode for 60 seconds as run 3.\n"
 		"  'run -m 0 -t 60 -r 3' to do the same thing with name arguments as above.\n"
 		"  'run -r 4' to run all modules in list mode as run 4.\n"
+		"  'run --roll-time 600' to run all modules continuously, and roll to the next run every 10 minutes.\n"
+		"  'run --roll-size 2048 --runs 5' to run 5 runs continuously, each run is about 2 GiB.\n"
+		"  'run -d -t 3600' to start an one hour run and return at once.\n"
+		"  'run --rates 1' to print input rates of channels every second.\n"
 		"Press Ctrl+C to stop before reaching the finish time.\n"
 		"Remember that --config can be used to choose path of json config file.\n";
 	return result;
@@ -1052,11 +1231,1462 @@ void RunCommandParser::Parse(int argc, char **argv) {
 	run_ = parse_result["run"].count() ?
 		parse_result["run"].as<int>() :
 		parse_result["run_pos"].as<int>();
+
+	int roll_seconds = parse_result["roll-time"].as<int>();
+	int roll_size = parse_result["roll-size"].as<int>();
+	int runs = parse_result["runs"].as<int>();
+	if (roll_seconds < 0 || roll_size < 0 || runs < 0) {
+		throw UserError("roll time, roll size and runs should be positive");
+	}
+	if (!roll_seconds && !roll_size) {
+		if (runs) {
+			throw UserError("--runs requires --roll-time or --roll-size");
+		}
+	} else if (seconds_) {
+		throw UserError(
+			"--time can't be used with --roll-time or --roll-size, "
+			"use --runs to limit the continuous run"
+		);
+	}
+	roll_.seconds = roll_seconds;
+	roll_.bytes = static_cast<uint64_t>(roll_size) << 20;
+	roll_.runs = runs;
+
+	detach_ = parse_result["detach"].count() ? true : false;
+
+	rate_seconds_ = parse_result["rates"].as<int>();
+	if (rate_seconds_ < 0) {
+		throw UserError("interval of rates should not be negative");
+	}
 }
 
 void RunCommandParser::Run(std::shared_ptr<Crate> crate) {
 	crate->Initialize();
-	crate->StartRun(module_, seconds_, run_);
+	unsigned int run = 0;
+	if (roll_.seconds || roll_.bytes) {
+		run = crate->ContinuousRun(module_, roll_, run_);
+	} else {
+		run = crate->StartRun(module_, seconds_, run_);
+	}
+	if (detach_) {
+		std::cout << "List mode run " << run << " started.\n";
+		return;
+	}
+	RunInfo info = WaitRunInterruptibly(*crate, rate_seconds_);
+	std::cout << ChannelRatesInfo(crate->ChannelRates())
+		<< RunTimeInfo(info.seconds, info.run) << std::flush;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								StatusCommandParser
+//-----------------------------------------------------------------------------
+
+StatusCommandParser::StatusCommandParser() noexcept
+: Interactor(CommandName(), "display status of list mode run")
+, wait_(false) {
+
+	type_ = InteractorType::kStatusCommandParser;
+	options_.add_options()
+		(
+			"w,wait", "Wait for the run to finish.",
+			cxxopts::value<bool>()
+		);
+}
+
+
+std::string StatusCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'status' to display state, run number, time and size of the run.\n"
+		"  'status -w' to wait for the run to finish and display the status.\n";
+	return result;
+}
+
+
+void StatusCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	wait_ = parse_result["wait"].count() ? true : false;
+}
+
+
+/// @brief print run status
+///
+/// @param[in] info run status
+///
+void PrintRunInfo(const RunInfo &info) {
+	if (info.run == -1) {
+		std::cout << "No list mode run.\n";
+		return;
+	}
+	std::cout << "Run " << info.run << " " << kRunStateNames.at(info.state)
+		<< ", module " << (
+			info.module == kModuleNum ? "all" : std::to_string(info.module)
+		)
+		<< ", " << info.seconds << " s, " << info.bytes << " bytes.\n";
+	if (!info.error.empty()) {
+		std::cout << "Error: " << info.error << "\n";
+	}
+}
+
+
+void StatusCommandParser::Run(std::shared_ptr<Crate> crate) {
+	crate->Initialize();
+	if (wait_) {
+		// the error is displayed in status
+		try {
+			crate->WaitRun();
+		} catch (const std::exception&) {
+		}
+	}
+	PrintRunInfo(crate->RunStatus());
+}
+
+
+//-----------------------------------------------------------------------------
+// 								StopCommandParser
+//-----------------------------------------------------------------------------
+
+StopCommandParser::StopCommandParser() noexcept
+: Interactor(CommandName(), "stop list mode run")
+, wait_(false) {
+
+	type_ = InteractorType::kStopCommandParser;
+	options_.add_options()
+		(
+			"w,wait", "Wait for the run to finish.",
+			cxxopts::value<bool>()
+		);
+}
+
+
+std::string StopCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'stop' to ask the list mode run to stop and return at once.\n"
+		"  'stop -w' to stop the run and wait until data is written.\n";
+	return result;
+}
+
+
+void StopCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	wait_ = parse_result["wait"].count() ? true : false;
+}
+
+
+void StopCommandParser::Run(std::shared_ptr<Crate> crate) {
+	crate->Initialize();
+	crate->StopRun();
+	if (wait_) {
+		PrintRunInfo(crate->WaitRun());
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								StatsCommandParser
+//-----------------------------------------------------------------------------
+
+StatsCommandParser::StatsCommandParser() noexcept
+: Interactor(CommandName(), "display statistics of rpc server")
+, method_("") {
+
+	type_ = InteractorType::kStatsCommandParser;
+	options_.add_options()
+		(
+			"m,method", "Only display this method, e.g. ReadParameter.",
+			cxxopts::value<std::string>(),
+			"<name>"
+		);
+}
+
+
+std::string StatsCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'stats' to display calls, calls in flight, latencies in\n"
+		"    milliseconds and errors of each method since server started.\n"
+		"  'stats -m ReadParameter' to display the method ReadParameter only.\n";
+	return result;
+}
+
+
+void StatsCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	method_ = parse_result["method"].count() ?
+		parse_result["method"].as<std::string>() : "";
+}
+
+
+void StatsCommandParser::Run(std::shared_ptr<Crate> crate) {
+	crate->Initialize();
+	std::vector<RpcMethodStats> stats = crate->ServerStats();
+	if (!method_.empty()) {
+		stats.erase(
+			std::remove_if(
+				stats.begin(), stats.end(),
+				[this](const RpcMethodStats &method) {
+					return method.method != method_;
+				}
+			),
+			stats.end()
+		);
+	}
+	std::cout << RpcStatsInfo(stats);
+}
+
+
+//-----------------------------------------------------------------------------
+// 								FilterCommandParser
+//-----------------------------------------------------------------------------
+
+FilterCommandParser::FilterCommandParser() noexcept
+: Interactor(CommandName(), "filter events before writing")
+, path_("")
+, off_(false) {
+
+	type_ = InteractorType::kFilterCommandParser;
+	options_.add_options()
+		(
+			"off", "Turn off the filter and write all events.",
+			cxxopts::value<bool>()
+		)
+		(
+			"rules", "Set the json file of filter rules.",
+			cxxopts::value<std::string>()
+		);
+	options_.parse_positional({"rules"});
+	options_.positional_help("[rules]");
+}
+
+
+std::string FilterCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'filter rules.json' to filter events by rules in the following runs.\n"
+		"  'filter --off' to write all events.\n"
+		"  'filter' to display accepted and rejected events of each rule.\n"
+		"Rules file looks like\n"
+		"  {\"rules\": [\n"
+		"    {\"type\": \"channel\", \"module\": 0, \"mask\": 255},\n"
+		"    {\"type\": \"energy\", \"channel\": 3, \"min\": 100, \"max\": 30000},\n"
+		"    {\"type\": \"multiplicity\", \"window\": 100, \"min\": 2},\n"
+		"    {\"type\": \"downscale\", \"window\": 100, \"factor\": 10}\n"
+		"  ]}\n"
+		"Window is in timestamp ticks. Rules are applied in order, and\n"
+		"module or channel is all by default. The file is read by the rpc\n"
+		"server.\n";
+	return result;
+}
+
+
+void FilterCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	off_ = parse_result["off"].count() ? true : false;
+	path_ = parse_result.count("rules") ?
+		parse_result["rules"].as<std::string>() : "";
+	if (off_ && !path_.empty()) {
+		throw UserError("filter rules and --off can't be used together");
+	}
+}
+
+
+void FilterCommandParser::Run(std::shared_ptr<Crate> crate) {
+	crate->Initialize();
+	if (off_ || !path_.empty()) {
+		crate->SetFilter(path_);
+		return;
+	}
+
+	auto counts = crate->FilterStats();
+	if (counts.empty()) {
+		std::cout << "No event filter.\n";
+		return;
+	}
+	std::cout << std::left << std::setw(20) << "rule"
+		<< std::right << std::setw(16) << "accepted"
+		<< std::setw(16) << "rejected" << "\n";
+	for (const auto &count : counts) {
+		std::cout << std::left << std::setw(20) << count.name
+			<< std::right << std::setw(16) << count.accepted
+			<< std::setw(16) << count.rejected << "\n";
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								ReduceCommandParser
+//-----------------------------------------------------------------------------
+
+// samples more than the longest trace, to keep the whole trace
+const int kWholeTrace = 0x8000;
+
+ReduceCommandParser::ReduceCommandParser() noexcept
+: Interactor(CommandName(), "cut traces before writing")
+, set_(false)
+, enable_(false)
+, reduction_{kWholeTrace, kWholeTrace, -1, 0} {
+
+	type_ = InteractorType::kReduceCommandParser;
+	options_.add_options()
+		(
+			"pre", "Keep this number of samples before the trigger.",
+			cxxopts::value<int>(), "<samples>"
+		)
+		(
+			"post", "Keep this number of samples from the trigger.",
+			cxxopts::value<int>(), "<samples>"
+		)
+		(
+			"trigger",
+			"Set the trigger sample, default is the leading edge of each trace.",
+			cxxopts::value<int>(), "<sample>"
+		)
+		(
+			"drop-energy", "Drop the traces of events with energy over this value.",
+			cxxopts::value<int>(), "<energy>"
+		)
+		(
+			"off", "Turn off the reduction and write the whole traces.",
+			cxxopts::value<bool>()
+		);
+}
+
+
+std::string ReduceCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'reduce --pre 40 --post 160' to keep 200 samples around the leading edge.\n"
+		"  'reduce --trigger 100 --pre 40 --post 160' to keep samples 60 to 259.\n"
+		"  'reduce --drop-energy 20000' to drop traces with energy over 20000.\n"
+		"  'reduce --off' to write the whole traces.\n"
+		"  'reduce' to display samples before and after reduction.\n"
+		"The kept samples are aligned to words, so the window may be one sample\n"
+		"larger. Traces are cut after the event filter in the following runs.\n";
+	return result;
+}
+
+
+void ReduceCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+
+	bool off = parse_result["off"].count() ? true : false;
+	enable_ = false;
+	reduction_ = TraceReduction{kWholeTrace, kWholeTrace, -1, 0};
+	const std::vector<std::string> names = {"pre", "post", "trigger", "drop-energy"};
+	for (const auto &name : names) {
+		if (!parse_result.count(name)) continue;
+		int value = parse_result[name].as<int>();
+		if (value < 0) {
+			throw UserError("--" + name + " should not be negative");
+		}
+		if (name == "pre") {
+			reduction_.pre = value;
+		} else if (name == "post") {
+			reduction_.post = value;
+		} else if (name == "trigger") {
+			reduction_.trigger = value;
+		} else {
+			if (value > 0xffff) {
+				throw UserError("--drop-energy should be smaller than 65536");
+			}
+			reduction_.drop_energy = value;
+		}
+		enable_ = true;
+	}
+	if (off && enable_) {
+		throw UserError("--off can't be used with other options");
+	}
+	set_ = off || enable_;
+}
+
+
+void ReduceCommandParser::Run(std::shared_ptr<Crate> crate) {
+	crate->Initialize();
+	if (set_) {
+		crate->SetTraceReduction(enable_, reduction_);
+		return;
+	}
+
+	TraceReductionStats stats = crate->ReductionStats();
+	std::cout << "Events " << stats.events << ", traces dropped "
+		<< stats.dropped << ", samples " << stats.input_samples << " -> "
+		<< stats.output_samples;
+	if (stats.input_samples) {
+		std::cout << " (" << std::fixed << std::setprecision(1)
+			<< 100.0 * stats.output_samples / stats.input_samples << "%)";
+	}
+	std::cout << ".\n";
+}
+
+
+//-----------------------------------------------------------------------------
+// 								QueryCommandParser
+//-----------------------------------------------------------------------------
+
+QueryCommandParser::QueryCommandParser() noexcept
+: Interactor(CommandName(), "find events in data file by time and channel")
+, path_("")
+, query_{0, std::numeric_limits<uint64_t>::max(), 0xffff}
+, output_("")
+, print_(10) {
+
+	type_ = InteractorType::kQueryCommandParser;
+	options_.add_options()
+		(
+			"c,channel", "Channels to find, separated by comma, default is all.",
+			cxxopts::value<std::string>(), "<channels>"
+		)
+		(
+			"b,begin", "Find events from this timestamp.",
+			cxxopts::value<uint64_t>(), "<time>"
+		)
+		(
+			"e,end", "Find events until this timestamp.",
+			cxxopts::value<uint64_t>(), "<time>"
+		)
+		(
+			"o,output", "Write the found events to file.",
+			cxxopts::value<std::string>(), "<file>"
+		)
+		(
+			"n,number", "Print this number of events, default is 10.",
+			cxxopts::value<unsigned int>()->default_value("10"), "<events>"
+		)
+		(
+			"file", "Data file with index.",
+			cxxopts::value<std::string>()
+		);
+	options_.parse_positional({"file"});
+	options_.positional_help("<file>");
+}
+
+
+std::string QueryCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'query run0001/run_R0001_M00.bin -c 0,5' to find events of channel 0 and 5.\n"
+		"  'query run0001/run_R0001_M00.bin -b 1000000 -e 2000000 -o part.bin' to\n"
+		"    write events with timestamp in [1000000, 2000000] to part.bin.\n"
+		"Timestamps are in clock ticks of module. Only the parts of data file\n"
+		"found in the index file (data file with suffix .idx) are read.\n";
+	return result;
+}
+
+
+void QueryCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("file")) {
+		throw UserError("data file is required");
+	}
+	path_ = parse_result["file"].as<std::string>();
+
+	query_ = IndexQuery{0, std::numeric_limits<uint64_t>::max(), 0xffff};
+	if (parse_result.count("begin")) {
+		query_.begin = parse_result["begin"].as<uint64_t>();
+	}
+	if (parse_result.count("end")) {
+		query_.end = parse_result["end"].as<uint64_t>();
+	}
+	if (query_.begin > query_.end) {
+		throw UserError("--begin should not be larger than --end");
+	}
+	if (parse_result.count("channel")) {
+		query_.channels = 0;
+		std::stringstream channels(parse_result["channel"].as<std::string>());
+		std::string channel;
+		while (std::getline(channels, channel, ',')) {
+			size_t end = 0;
+			int value = -1;
+			try {
+				value = std::stoi(channel, &end);
+			} catch (const std::exception&) {
+			}
+			if (end != channel.size() || value < 0 || value >= int(kChannelNum)) {
+				throw UserError("invalid channel " + channel);
+			}
+			query_.channels |= 1u << value;
+		}
+		if (!query_.channels) {
+			throw UserError("--channel needs at least one channel");
+		}
+	}
+	output_ = parse_result.count("output") ?
+		parse_result["output"].as<std::string>() : "";
+	print_ = parse_result["number"].as<unsigned int>();
+}
+
+
+void QueryCommandParser::Run(std::shared_ptr<Crate>) {
+	auto start = std::chrono::steady_clock::now();
+	QueryResult result = QueryRunFile(path_, query_);
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << "Found " << result.events << " events in " << result.regions
+		<< " regions, read " << result.bytes_read << " bytes in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(
+			stop - start
+		).count() << " ms.\n";
+
+	if (!output_.empty()) {
+		std::ofstream fout(output_, std::ios::binary | std::ios::trunc);
+		fout.write(
+			reinterpret_cast<const char*>(result.words.data()),
+			result.words.size() * sizeof(uint32_t)
+		);
+		if (!fout.good()) {
+			throw RXError("Write events to " + output_ + " failed.");
+		}
+		return;
+	}
+
+	EventBatch events;
+	DecodeListMode(result.words.data(), result.words.size(), events);
+	size_t number = std::min(events.Size(), size_t(print_));
+	if (!number) return;
+	std::cout << std::setw(16) << "time" << std::setw(8) << "crate"
+		<< std::setw(8) << "slot" << std::setw(8) << "channel"
+		<< std::setw(8) << "energy" << std::setw(8) << "trace" << "\n";
+	for (size_t i = 0; i < number; ++i) {
+		std::cout << std::setw(16) << events.time[i]
+			<< std::setw(8) << int(events.crate[i])
+			<< std::setw(8) << int(events.slot[i])
+			<< std::setw(8) << int(events.channel[i])
+			<< std::setw(8) << events.energy[i]
+			<< std::setw(8) << events.trace_length[i] << "\n";
+	}
+	if (number < events.Size()) {
+		std::cout << "... " << events.Size() - number << " more events.\n";
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								ConvertCommandParser
+//-----------------------------------------------------------------------------
+
+/// @brief list data files of inputs, the data files in run directories are
+/// 	listed in order of name
+///
+/// @param[in] inputs data files or run directories
+/// @returns paths of data files
+///
+/// @throws UserError if no data file is found
+///
+std::vector<std::string> ListDataFiles(const std::vector<std::string> &inputs) {
+	std::vector<std::string> files;
+	for (const auto &input : inputs) {
+		if (!std::filesystem::is_directory(input)) {
+			files.push_back(input);
+			continue;
+		}
+		std::vector<std::string> found;
+		for (const auto &entry : std::filesystem::directory_iterator(input)) {
+			std::string extension = entry.path().extension().string();
+			if (extension == ".bin" || extension == ".rxp") {
+				found.push_back(entry.path().string());
+			}
+		}
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+	if (files.empty()) {
+		throw UserError("no data file found");
+	}
+	return files;
+}
+
+
+ConvertCommandParser::ConvertCommandParser() noexcept
+: Interactor(CommandName(), "convert data files to columnar format")
+, output_("")
+, threads_(0)
+, chunk_words_(kDefaultChunkWords) {
+
+	type_ = InteractorType::kConvertCommandParser;
+	options_.add_options()
+		(
+			"o,output", "Directory to write chunk files.",
+			cxxopts::value<std::string>(), "<directory>"
+		)
+		(
+			"j,threads", "Number of threads, default is all cores.",
+			cxxopts::value<unsigned int>()->default_value("0"), "<threads>"
+		)
+		(
+			"chunk-size", "Size of data file in a chunk in MiB, default is 64.",
+			cxxopts::value<unsigned int>()->default_value("64"), "<MiB>"
+		)
+		(
+			"inputs", "Data files or run directories.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"inputs"});
+	options_.positional_help("<file or directory>...");
+}
+
+
+std::string ConvertCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'convert run0001 -o run0001_columns' to convert all data files of run 1.\n"
+		"  'convert run0001/run_R0001_M00.bin -o m0 -j 4' to convert one file with\n"
+		"    4 threads.\n"
+		"Columns time, crate, slot, channel, energy, cfd, finish_code, trace_offset\n"
+		"and trace_length are written to chunk files, traces are left in data\n"
+		"files and located by trace_offset. The chunks and their minimum and\n"
+		"maximum values of columns are listed in manifest.json.\n";
+	return result;
+}
+
+
+void ConvertCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("inputs")) {
+		throw UserError("data files or run directories are required");
+	}
+	if (!parse_result.count("output")) {
+		throw UserError("--output is required");
+	}
+	inputs_ = parse_result["inputs"].as<std::vector<std::string>>();
+	output_ = parse_result["output"].as<std::string>();
+	threads_ = parse_result["threads"].as<unsigned int>();
+	unsigned int chunk_size = parse_result["chunk-size"].as<unsigned int>();
+	if (chunk_size == 0 || chunk_size > 4096) {
+		throw UserError("--chunk-size should be in [1, 4096]");
+	}
+	chunk_words_ = (size_t(chunk_size) << 20) / sizeof(uint32_t);
+}
+
+
+void ConvertCommandParser::Run(std::shared_ptr<Crate>) {
+	std::vector<std::string> files = ListDataFiles(inputs_);
+	auto start = std::chrono::steady_clock::now();
+	ConvertResult result = ConvertRun(files, output_, threads_, chunk_words_);
+	auto stop = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(stop - start).count();
+
+	std::cout << "Converted " << result.events << " events of " << result.files
+		<< " files into " << result.chunks << " chunks, "
+		<< std::fixed << std::setprecision(1)
+		<< result.input_bytes / 1048576.0 << " MiB -> "
+		<< result.output_bytes / 1048576.0 << " MiB in "
+		<< std::setprecision(2) << seconds << " s";
+	if (seconds > 0) {
+		std::cout << " (" << std::setprecision(1)
+			<< result.input_bytes / 1048576.0 / seconds << " MiB/s)";
+	}
+	std::cout << ".\n";
+}
+
+
+//-----------------------------------------------------------------------------
+// 								SortCommandParser
+//-----------------------------------------------------------------------------
+
+SortCommandParser::SortCommandParser() noexcept
+: Interactor(CommandName(), "sort events of data files by timestamp")
+, output_("")
+, sort_options_{kDefaultSortMemory, "", 0} {
+
+	type_ = InteractorType::kSortCommandParser;
+	options_.add_options()
+		(
+			"o,output", "File to write sorted events.",
+			cxxopts::value<std::string>(), "<file>"
+		)
+		(
+			"m,memory", "Memory for buffers in MiB, default is 1024.",
+			cxxopts::value<unsigned int>()->default_value("1024"), "<MiB>"
+		)
+		(
+			"t,temp", "Directory of temporary files, default is the output directory.",
+			cxxopts::value<std::string>(), "<directory>"
+		)
+		(
+			"j,threads", "Number of threads sorting chunks, default is all cores.",
+			cxxopts::value<unsigned int>()->default_value("0"), "<threads>"
+		)
+		(
+			"inputs", "Data files or run directories.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"inputs"});
+	options_.positional_help("<file or directory>...");
+}
+
+
+std::string SortCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'sort run0001 -o run0001.bin' to sort events of all modules in run 1.\n"
+		"  'sort run0001 -o run0001.bin -m 256 -t /scratch' to sort with 256 MiB\n"
+		"    memory and temporary files in /scratch.\n"
+		"Chunks of data files are sorted in parallel and written to temporary\n"
+		"files, then they are merged into the output. The temporary files take\n"
+		"as much disk space as the data files.\n";
+	return result;
+}
+
+
+void SortCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("inputs")) {
+		throw UserError("data files or run directories are required");
+	}
+	if (!parse_result.count("output")) {
+		throw UserError("--output is required");
+	}
+	inputs_ = parse_result["inputs"].as<std::vector<std::string>>();
+	output_ = parse_result["output"].as<std::string>();
+	unsigned int memory = parse_result["memory"].as<unsigned int>();
+	if (memory == 0) {
+		throw UserError("--memory should be positive");
+	}
+	sort_options_.memory = size_t(memory) << 20;
+	sort_options_.temp_directory = parse_result.count("temp") ?
+		parse_result["temp"].as<std::string>() : "";
+	sort_options_.threads = parse_result["threads"].as<unsigned int>();
+}
+
+
+void SortCommandParser::Run(std::shared_ptr<Crate>) {
+	std::vector<std::string> files = ListDataFiles(inputs_);
+	SortResult result = SortRun(files, output_, sort_options_);
+
+	const double mib = result.bytes / 1048576.0;
+	std::cout << "Sorted " << result.events << " events (" << std::fixed
+		<< std::setprecision(1) << mib << " MiB) of " << result.files
+		<< " files.\n"
+		<< "  generate " << result.runs << " sorted runs in "
+		<< std::setprecision(2) << result.generate_seconds << " s";
+	if (result.generate_seconds > 0) {
+		std::cout << " (" << std::setprecision(1)
+			<< mib / result.generate_seconds << " MiB/s)";
+	}
+	std::cout << "\n  merge in " << result.passes << " passes in "
+		<< std::setprecision(2) << result.merge_seconds << " s";
+	if (result.merge_seconds > 0) {
+		std::cout << " (" << std::setprecision(1)
+			<< mib * result.passes / result.merge_seconds << " MiB/s)";
+	}
+	std::cout << "\n";
+}
+
+
+//-----------------------------------------------------------------------------
+// 								HistCommandParser
+//-----------------------------------------------------------------------------
+
+HistCommandParser::HistCommandParser() noexcept
+: Interactor(CommandName(), "fill histograms of data files")
+, output_("")
+, histogram_options_(DefaultHistogramOptions()) {
+
+	type_ = InteractorType::kHistCommandParser;
+	options_.add_options()
+		(
+			"o,output", "Prefix of output files, writes <prefix>.rxh and <prefix>.csv.",
+			cxxopts::value<std::string>(), "<prefix>"
+		)
+		(
+			"w,window", "Coincidence window in ticks of timestamp, default is 100.",
+			cxxopts::value<uint64_t>()->default_value("100"), "<ticks>"
+		)
+		(
+			"energy-bins", "Bins of energy histograms, default is 4096.",
+			cxxopts::value<unsigned int>()->default_value("4096"), "<bins>"
+		)
+		(
+			"qdc-gate", "QDC sum to histogram, 0 to 7, default is 0.",
+			cxxopts::value<unsigned int>()->default_value("0"), "<gate>"
+		)
+		(
+			"j,threads", "Number of threads, default is all cores.",
+			cxxopts::value<unsigned int>()->default_value("0"), "<threads>"
+		)
+		(
+			"inputs", "Data files or run directories.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"inputs"});
+	options_.positional_help("<file or directory>...");
+}
+
+
+std::string HistCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'hist run0001 -o run0001' to fill histograms of all modules in run 1.\n"
+		"  'hist run0001.bin -o run0001 -w 50' to fill histograms of sorted data\n"
+		"    with coincidence window of 50 ticks.\n"
+		"Energy and QDC histograms are filled for each channel. Timestamp\n"
+		"difference and energy-energy histograms are filled with events within\n"
+		"the window in the order of data, so sort the run first to find\n"
+		"coincidence between modules.\n";
+	return result;
+}
+
+
+void HistCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("inputs")) {
+		throw UserError("data files or run directories are required");
+	}
+	if (!parse_result.count("output")) {
+		throw UserError("--output is required");
+	}
+	inputs_ = parse_result["inputs"].as<std::vector<std::string>>();
+	output_ = parse_result["output"].as<std::string>();
+	histogram_options_.window = parse_result["window"].as<uint64_t>();
+	if (histogram_options_.window == 0) {
+		throw UserError("--window should be positive");
+	}
+	histogram_options_.energy_bins = parse_result["energy-bins"].as<unsigned int>();
+	if (
+		histogram_options_.energy_bins == 0
+		|| histogram_options_.energy_bins > 65536
+	) {
+		throw UserError("--energy-bins should be in [1, 65536]");
+	}
+	histogram_options_.qdc_gate = parse_result["qdc-gate"].as<unsigned int>();
+	if (histogram_options_.qdc_gate > 7) {
+		throw UserError("--qdc-gate should be in [0, 7]");
+	}
+	histogram_options_.threads = parse_result["threads"].as<unsigned int>();
+}
+
+
+void HistCommandParser::Run(std::shared_ptr<Crate>) {
+	std::vector<std::string> files = ListDataFiles(inputs_);
+	auto start = std::chrono::steady_clock::now();
+	HistogramSet histograms = FillHistograms(files, histogram_options_);
+	auto stop = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(stop - start).count();
+
+	std::vector<const Histogram*> list = histograms.Histograms();
+	WriteHistograms(output_ + ".rxh", list);
+	WriteHistogramsCsv(output_ + ".csv", list);
+	std::cout << "Filled " << list.size() << " histograms with "
+		<< histograms.Events() << " events of " << files.size()
+		<< " files in " << std::fixed << std::setprecision(2)
+		<< seconds << " s.\n";
+}
+
+
+//-----------------------------------------------------------------------------
+// 								VerifyCommandParser
+//-----------------------------------------------------------------------------
+
+VerifyCommandParser::VerifyCommandParser() noexcept
+: Interactor(CommandName(), "check events of data files")
+, config_path_("")
+, verify_options_{-1, {}, 0, kDefaultChunkWords} {
+
+	type_ = InteractorType::kVerifyCommandParser;
+	options_.add_options()
+		(
+			"config", "Config file to check crate id and slots of modules.",
+			cxxopts::value<std::string>(), "<file>"
+		)
+		(
+			"j,threads", "Number of threads, default is all cores.",
+			cxxopts::value<unsigned int>()->default_value("0"), "<threads>"
+		)
+		(
+			"inputs", "Data files or run directories.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"inputs"});
+	options_.positional_help("<file or directory>...");
+}
+
+
+std::string VerifyCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'verify run0001' to check all data files of run 1.\n"
+		"  'verify run0001 --config config.json' to check crate id and slots\n"
+		"    of modules as well, module of file is read from the name _Mxx.\n"
+		"Framing, trace length and per channel timestamp order are always\n"
+		"checked. The first problem of each file is reported with its offset.\n";
+	return result;
+}
+
+
+void VerifyCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("inputs")) {
+		throw UserError("data files or run directories are required");
+	}
+	inputs_ = parse_result["inputs"].as<std::vector<std::string>>();
+	config_path_ = parse_result.count("config") ?
+		parse_result["config"].as<std::string>() : "";
+	verify_options_.threads = parse_result["threads"].as<unsigned int>();
+}
+
+
+void VerifyCommandParser::Run(std::shared_ptr<Crate>) {
+	if (!config_path_.empty()) {
+		Config config;
+		config.ReadFromFile(config_path_);
+		verify_options_.crate = config.CrateId();
+		verify_options_.slots.clear();
+		for (unsigned short i = 0; i < config.ModuleNum(); ++i) {
+			verify_options_.slots.push_back(config.Slot(i));
+		}
+	}
+	std::vector<std::string> files = ListDataFiles(inputs_);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<VerifyReport> reports = VerifyRun(files, verify_options_);
+	auto stop = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(stop - start).count();
+
+	uint64_t bytes = 0;
+	uint64_t events = 0;
+	size_t bad = 0;
+	for (const auto &report : reports) {
+		bytes += report.bytes;
+		events += report.events;
+		std::cout << (report.Good() ? "OK   " : "BAD  ") << report.file
+			<< ": " << report.events << " events\n";
+		if (report.Good()) continue;
+		++bad;
+		std::cout << "  first " << VerifyProblemName(report.first_problem)
+			<< " problem at byte " << report.first_offset << ", "
+			<< report.message << "\n"
+			<< "  trace length " << report.trace_length_errors
+			<< ", crate " << report.crate_errors
+			<< ", slot " << report.slot_errors
+			<< ", timestamp " << report.timestamp_errors
+			<< ", unverified bytes " << report.unverified_bytes << "\n";
+	}
+	const double mib = bytes / 1048576.0;
+	std::cout << "Verified " << events << " events (" << std::fixed
+		<< std::setprecision(1) << mib << " MiB) of " << files.size()
+		<< " files in " << std::setprecision(2) << seconds << " s";
+	if (seconds > 0) {
+		std::cout << " (" << std::setprecision(1) << mib / seconds << " MiB/s)";
+	}
+	std::cout << ".\n";
+	if (bad) {
+		throw RXError(std::to_string(bad) + " of " + std::to_string(files.size())
+			+ " files have problems");
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								ReplayCommandParser
+//-----------------------------------------------------------------------------
+
+ReplayCommandParser::ReplayCommandParser() noexcept
+: Interactor(CommandName(), "replay data files through run pipeline")
+, output_("")
+, filter_path_("")
+, replay_options_{0.0, 10.0, kReplayBlockWords, nullptr, nullptr, false} {
+
+	type_ = InteractorType::kReplayCommandParser;
+	options_.add_options()
+		(
+			"o,output", "Directory to write replayed run.",
+			cxxopts::value<std::string>(), "<directory>"
+		)
+		(
+			"s,speed",
+			"Speed relative to the original timing, default is 0 as fast as possible.",
+			cxxopts::value<double>()->default_value("0"), "<factor>"
+		)
+		(
+			"tick", "Nanoseconds of a timestamp tick, default is 10.",
+			cxxopts::value<double>()->default_value("10"), "<ns>"
+		)
+		(
+			"block", "Words read from a file at a time, default is 32768.",
+			cxxopts::value<unsigned int>()->default_value("32768"), "<words>"
+		)
+		(
+			"filter", "Filter events by rules in the json file.",
+			cxxopts::value<std::string>(), "<file>"
+		)
+		(
+			"packed", "Encode traces and write packed files.",
+			cxxopts::value<bool>()
+		)
+		(
+			"inputs", "Data files or run directories.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"inputs"});
+	options_.positional_help("<file or directory>...");
+}
+
+
+std::string ReplayCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'replay run0001 -o replay' to replay run 1 as fast as possible.\n"
+		"  'replay run0001 -o replay -s 1' to replay with the original timing.\n"
+		"  'replay run0001 -o replay -s 0.5 --filter rules.json --packed' to\n"
+		"    replay at half speed with filter and trace encoding.\n"
+		"Files are read in blocks like reads of modules and passed through the\n"
+		"same pipeline and writer as list mode run, without modules. Only raw\n"
+		"data files can be replayed.\n";
+	return result;
+}
+
+
+void ReplayCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("inputs")) {
+		throw UserError("data files or run directories are required");
+	}
+	if (!parse_result.count("output")) {
+		throw UserError("--output is required");
+	}
+	inputs_ = parse_result["inputs"].as<std::vector<std::string>>();
+	output_ = parse_result["output"].as<std::string>();
+	replay_options_.speed = parse_result["speed"].as<double>();
+	if (replay_options_.speed < 0) {
+		throw UserError("--speed should not be negative");
+	}
+	replay_options_.tick = parse_result["tick"].as<double>();
+	if (!(replay_options_.tick > 0)) {
+		throw UserError("--tick should be positive");
+	}
+	replay_options_.block_words = parse_result["block"].as<unsigned int>();
+	if (replay_options_.block_words == 0) {
+		throw UserError("--block should be positive");
+	}
+	filter_path_ = parse_result.count("filter") ?
+		parse_result["filter"].as<std::string>() : "";
+	replay_options_.packed = parse_result["packed"].as<bool>();
+}
+
+
+void ReplayCommandParser::Run(std::shared_ptr<Crate>) {
+	std::vector<std::string> files = ListDataFiles(inputs_);
+	for (const auto &file : files) {
+		if (std::filesystem::path(file).extension() == ".rxp") {
+			throw UserError("packed file can't be replayed: " + file);
+		}
+	}
+	if (!filter_path_.empty()) {
+		replay_options_.filter =
+			std::make_shared<EventFilter>(ReadFilterRules(filter_path_));
+	}
+	ReplayResult result = ReplayRun(files, output_, replay_options_);
+
+	const double mib = result.bytes / 1048576.0;
+	std::cout << "Replayed " << std::fixed << std::setprecision(1) << mib
+		<< " MiB of " << result.files << " files in " << result.blocks
+		<< " blocks in " << std::setprecision(2) << result.seconds << " s";
+	if (result.seconds > 0) {
+		std::cout << " (" << std::setprecision(1) << mib / result.seconds
+			<< " MiB/s)";
+	}
+	std::cout << ".\n";
+	if (replay_options_.speed > 0) {
+		std::cout << "  max lag behind timing " << std::setprecision(3)
+			<< result.max_lag << " s\n";
+	}
+	if (result.invalid_blocks) {
+		std::cout << "  " << result.invalid_blocks
+			<< " blocks can't be decoded and are written as they are\n";
+	}
+	if (replay_options_.filter) {
+		for (const auto &count : replay_options_.filter->Counts()) {
+			std::cout << "  " << count.name << ": accepted " << count.accepted
+				<< ", rejected " << count.rejected << "\n";
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								TraceCommandParser
+//-----------------------------------------------------------------------------
+
+TraceCommandParser::TraceCommandParser() noexcept
+: Interactor(CommandName(), "start or stop tracing")
+, start_(true)
+, path_("trace.json") {
+
+	type_ = InteractorType::kTraceCommandParser;
+	options_.add_options()
+		(
+			"o,output",
+			"Set the file to export traces, default is trace.json.",
+			cxxopts::value<std::string>()->default_value("trace.json"),
+			"<file>"
+		)
+		(
+			"action",
+			"Start or stop tracing.",
+			cxxopts::value<std::string>()
+		)
+		(
+			"output_pos",
+			"Set the file to export traces.",
+			cxxopts::value<std::string>()->default_value("trace.json")
+		);
+	options_.parse_positional({"action", "output_pos"});
+	options_.positional_help("start|stop [file]");
+}
+
+
+std::string TraceCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Examples:\n"
+		"  'trace start' to clear previous traces and start tracing.\n"
+		"  'trace stop' to stop tracing and export traces to trace.json.\n"
+		"  'trace stop run.json' to export traces to run.json.\n"
+		"Traces are in Chrome trace format, open them in chrome://tracing or\n"
+		"Perfetto. The file is written by the rpc server.\n";
+	return result;
+}
+
+
+void TraceCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+
+	if (!parse_result.count("action")) {
+		throw UserError("trace action start or stop is required");
+	}
+	std::string action = parse_result["action"].as<std::string>();
+	if (action == "start") {
+		start_ = true;
+	} else if (action == "stop") {
+		start_ = false;
+	} else {
+		throw UserError("invalid trace action " + action);
+	}
+
+	path_ = parse_result["output"].count() ?
+		parse_result["output"].as<std::string>() :
+		parse_result["output_pos"].as<std::string>();
+}
+
+
+void TraceCommandParser::Run(std::shared_ptr<Crate> crate) {
+	if (start_) {
+		crate->StartTrace();
+	} else {
+		crate->StopTrace(path_);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// 								ShellCommandParser
+//-----------------------------------------------------------------------------
+
+ShellCommandParser::ShellCommandParser() noexcept
+: Interactor(CommandName(), "run commands in interactive shell")
+, exit_(false) {
+
+	type_ = InteractorType::kShellCommandParser;
+	options_.add_options()
+		(
+			"f,file",
+			"Run commands in file, can be used several times.",
+			cxxopts::value<std::vector<std::string>>(),
+			"<file>"
+		)
+		(
+			"file_pos",
+			"Run commands in files.",
+			cxxopts::value<std::vector<std::string>>()
+		);
+	options_.parse_positional({"file_pos"});
+	options_.positional_help("[file...]");
+}
+
+
+std::string ShellCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Commands are the same as the subcommands of rxdaq, one in a line.\n"
+		"Empty lines and lines start with '#' are ignored, 'exit' or 'quit'\n"
+		"stops the shell.\n"
+		"Examples:\n"
+		"  'shell' to read commands from terminal.\n"
+		"  'shell tune.txt' to run commands in tune.txt.\n"
+		"  'shell -f boot.txt -f run.txt' to run commands in two files in order.\n"
+		"  'shell < tune.txt' to run commands from pipe.\n";
+	return result;
+}
+
+
+void ShellCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+
+	files_.clear();
+	if (parse_result.count("file")) {
+		files_ = parse_result["file"].as<std::vector<std::string>>();
+	}
+	if (parse_result.count("file_pos")) {
+		auto files = parse_result["file_pos"].as<std::vector<std::string>>();
+		files_.insert(files_.end(), files.begin(), files.end());
+	}
+}
+
+
+void ShellCommandParser::Run(std::shared_ptr<Crate> crate) {
+	exit_ = false;
+	size_t failed = 0;
+	bool interactive = files_.empty() && isatty(STDIN_FILENO);
+	if (files_.empty()) {
+		failed = RunStream(std::cin, crate, interactive);
+	}
+	for (const auto &file : files_) {
+		if (exit_) break;
+		std::ifstream fin(file);
+		if (!fin.good()) {
+			throw UserError("Open file " + file + " failed.");
+		}
+		failed += RunStream(fin, crate, false);
+		fin.close();
+	}
+	if (failed && !interactive) {
+		throw UserError(std::to_string(failed) + " commands failed");
+	}
+}
+
+
+void ShellCommandParser::RunCommand(
+	const std::string &line,
+	std::shared_ptr<Crate> crate
+) {
+	std::vector<std::string> args = SplitCommandLine(line);
+	if (args.empty()) return;
+
+	auto interactor = CreateInteractor(args[0].c_str());
+	if (!interactor) {
+		throw UserError("invalid command " + args[0]);
+	}
+	if (
+		interactor->Type() == InteractorType::kRpcCommandParser ||
+		interactor->Type() == InteractorType::kShellCommandParser
+	) {
+		throw UserError("command " + args[0] + " is not available in shell");
+	}
+
+	std::vector<char*> argv;
+	for (auto &arg : args) {
+		argv.push_back(arg.data());
+	}
+	argv.push_back(nullptr);
+	interactor->Parse(int(args.size()), argv.data());
+
+	if (interactor->Type() == InteractorType::kHelpCommandParser) {
+		interactor->Run(nullptr);
+	} else {
+		interactor->Run(crate);
+	}
+}
+
+
+size_t ShellCommandParser::RunStream(
+	std::istream &is,
+	std::shared_ptr<Crate> crate,
+	bool interactive
+) {
+	size_t failed = 0;
+	std::string line;
+	while (true) {
+		if (interactive) {
+			std::cout << "rxdaq> " << std::flush;
+		}
+		if (!std::getline(is, line)) break;
+
+		// skip empty lines and comments
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line[start] == '#') continue;
+		std::string command = line.substr(start);
+		command = command.substr(0, command.find_last_not_of(" \t\r") + 1);
+		if (command == "exit" || command == "quit") {
+			exit_ = true;
+			break;
+		}
+
+		try {
+			RunCommand(command, crate);
+		} catch (const UserError &e) {
+			std::cerr << "operation error: " << e.what() << std::endl;
+			++failed;
+		} catch (const RXError &e) {
+			std::cerr << "rxdaq error: " << e.what() << std::endl;
+			++failed;
+		} catch (const XiaError &e) {
+			std::cerr << "xia error: " << e.result_text() << "\n"
+				<< e.what() << std::endl;
+			++failed;
+		} catch (const std::exception &e) {
+			std::cerr << "fatal error: " << e.what() << std::endl;
+			++failed;
+		}
+	}
+	if (interactive && !exit_) {
+		std::cout << std::endl;
+	}
+	return failed;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								BatchCommandParser
+//-----------------------------------------------------------------------------
+
+BatchCommandParser::BatchCommandParser() noexcept
+: Interactor(CommandName(), "execute batch plan")
+, path_("") {
+
+	type_ = InteractorType::kBatchCommandParser;
+	options_.add_options()
+		(
+			"path",
+			"Set the batch plan file.",
+			cxxopts::value<std::string>()
+		);
+	options_.parse_positional({"path"});
+	options_.positional_help("<plan>");
+}
+
+
+std::string BatchCommandParser::Help() const noexcept {
+	std::string result = options_.help();
+	result += "\n"
+		"Batch plan is a json file with a sequence of steps and stop conditions:\n"
+		"  {\n"
+		"    \"stop\": {\"file\": \"stop\", \"seconds\": 36000, \"runs\": 100},\n"
+		"    \"keepGoing\": false,\n"
+		"    \"steps\": [\n"
+		"      {\"type\": \"boot\", \"module\": 13, \"fast\": true},\n"
+		"      {\"type\": \"import\", \"path\": \"parameters.json\"},\n"
+		"      {\"type\": \"write\", \"name\": \"TAU\", \"value\": 1.5, \"module\": 0, \"channel\": 3},\n"
+		"      {\"type\": \"task\", \"name\": \"adjust_offsets\"},\n"
+		"      {\"type\": \"run\", \"seconds\": 600, \"repeat\": 3},\n"
+		"      {\"type\": \"export\", \"path\": \"final.json\"}\n"
+		"    ]\n"
+		"  }\n"
+		"The plan stops before the next step if the stop file exists, or the\n"
+		"seconds or runs are reached.\n"
+		"Examples:\n"
+		"  'batch scan.json' to execute plan in scan.json.\n";
+	return result;
+}
+
+
+void BatchCommandParser::Parse(int argc, char **argv) {
+	auto parse_result = options_.parse(argc, argv);
+	if (!parse_result.unmatched().empty()) {
+		throw UserError("too many arguments");
+	}
+	if (!parse_result.count("path")) {
+		throw UserError("batch plan file is required");
+	}
+	path_ = parse_result["path"].as<std::string>();
+}
+
+
+void BatchCommandParser::Run(std::shared_ptr<Crate> crate) {
+	BatchPlan plan = ReadBatchPlan(path_);
+	crate->Initialize();
+	BatchRunner runner(crate);
+	size_t failed = runner.Run(plan);
+	std::cout << "Batch finished " << runner.FinishedRuns() << " runs.\n";
+	if (failed) {
+		throw UserError(std::to_string(failed) + " batch steps failed");
+	}
+}
+
+
+std::vector<std::string> SplitCommandLine(const std::string &line) {
+	std::vector<std::string> result;
+	std::string arg;
+	bool in_arg = false;
+	char quote = 0;
+	for (const char &c : line) {
+		if (quote) {
+			if (c == quote) {
+				quote = 0;
+			} else {
+				arg += c;
+			}
+		} else if (c == '"' || c == '\'') {
+			quote = c;
+			in_arg = true;
+		} else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			if (in_arg) {
+				result.push_back(arg);
+				arg.clear();
+				in_arg = false;
+			}
+		} else {
+			arg += c;
+			in_arg = true;
+		}
+	}
+	if (quote) {
+		throw UserError("unmatched quote in command");
+	}
+	if (in_arg) {
+		result.push_back(arg);
+	}
+	return result;
 }
 
 
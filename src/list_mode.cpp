@@ -0,0 +1,86 @@
+#include "include/list_mode.h"
+
+#include <string>
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+void EventBatch::Clear() noexcept {
+	offset.clear();
+	length.clear();
+	header_length.clear();
+	crate.clear();
+	slot.clear();
+	channel.clear();
+	finish_code.clear();
+	time.clear();
+	cfd.clear();
+	energy.clear();
+	trace_length.clear();
+}
+
+
+size_t DecodeListMode(const uint32_t *words, size_t size, EventBatch &batch) {
+	size_t position = 0;
+	while (position + kMinHeaderLength <= size) {
+		const uint32_t *event = words + position;
+		uint32_t header_length =
+			(event[0] >> kHeaderLengthShift) & kHeaderLengthMask;
+		uint32_t event_length =
+			(event[0] >> kEventLengthShift) & kEventLengthMask;
+		if (header_length < kMinHeaderLength || event_length < header_length) {
+			throw RXError(
+				"Invalid list mode header at word " + std::to_string(position)
+				+ ", header length " + std::to_string(header_length)
+				+ ", event length " + std::to_string(event_length) + "."
+			);
+		}
+		if (position + event_length > size) break;
+
+		batch.offset.push_back(position);
+		batch.length.push_back(event_length);
+		batch.header_length.push_back(header_length);
+		batch.crate.push_back((event[0] >> kCrateShift) & kCrateMask);
+		batch.slot.push_back((event[0] >> kSlotShift) & kSlotMask);
+		batch.channel.push_back(event[0] & kChannelMask);
+		batch.finish_code.push_back(event[0] >> kFinishCodeShift);
+		batch.time.push_back(
+			(uint64_t(event[2] & kTimeHighMask) << 32) | event[1]
+		);
+		batch.cfd.push_back(event[2] >> kCfdShift);
+		batch.energy.push_back(event[3] & kEnergyMask);
+		batch.trace_length.push_back(
+			(event[3] >> kTraceLengthShift) & kTraceLengthMask
+		);
+		position += event_length;
+	}
+	return position;
+}
+
+
+std::vector<uint32_t> EncodeListModeHeader(
+	uint8_t crate,
+	uint8_t slot,
+	uint8_t channel,
+	uint64_t time,
+	uint16_t energy,
+	uint16_t trace_length,
+	uint8_t header_length
+) {
+	std::vector<uint32_t> header(header_length, 0);
+	uint32_t event_length = header_length + trace_length / 2;
+	header[0] = (channel & kChannelMask)
+		| ((slot & kSlotMask) << kSlotShift)
+		| ((crate & kCrateMask) << kCrateShift)
+		| ((header_length & kHeaderLengthMask) << kHeaderLengthShift)
+		| ((event_length & kEventLengthMask) << kEventLengthShift);
+	header[1] = time & 0xffffffff;
+	header[2] = (time >> 32) & kTimeHighMask;
+	header[3] = energy | ((trace_length & kTraceLengthMask) << kTraceLengthShift);
+	return header;
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,54 @@
+#include "include/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+MappedFile::MappedFile(const std::string &path)
+: path_(path), data_(nullptr), size_(0) {
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw RXError("Open file " + path + " failed: " + strerror(errno));
+	}
+	struct stat status;
+	if (fstat(fd, &status) < 0) {
+		close(fd);
+		throw RXError("Get size of file " + path + " failed: " + strerror(errno));
+	}
+	size_ = status.st_size;
+	if (size_) {
+		data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data_ == MAP_FAILED) {
+			data_ = nullptr;
+			close(fd);
+			throw RXError("Map file " + path + " failed: " + strerror(errno));
+		}
+	}
+	// the mapping is kept after closing
+	close(fd);
+}
+
+
+MappedFile::~MappedFile() {
+	if (data_) {
+		munmap(data_, size_);
+	}
+}
+
+
+void MappedFile::AdviseSequential() const noexcept {
+	if (data_) {
+		madvise(data_, size_, MADV_SEQUENTIAL);
+	}
+}
+
+}		// namespace rxdaq
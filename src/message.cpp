@@ -1,20 +1,307 @@
 #include "include/message.h"
 
+#include <ctime>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
 namespace rxdaq {
 
+//-----------------------------------------------------------------------------
+// 								AsyncSink
+//-----------------------------------------------------------------------------
+
+/// message waiting to be written by the sink
+struct LogRecord {
+	std::ostream *os;
+	std::chrono::system_clock::time_point time;
+	bool timestamp;
+	std::string text;
+};
+
+
+/// @brief write record to its stream
+///
+/// @param[in] record record to write
+///
+void WriteRecord(const LogRecord &record) {
+	if (record.timestamp) {
+		auto time = std::chrono::system_clock::to_time_t(record.time);
+		auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+			record.time.time_since_epoch()
+		).count() % 1000;
+		std::tm local;
+		localtime_r(&time, &local);
+		*record.os << std::put_time(&local, "%H:%M:%S") << "."
+			<< std::setfill('0') << std::setw(3) << milliseconds
+			<< std::setfill(' ') << " ";
+	}
+	*record.os << record.text;
+}
+
+
+/// Single producer single consumer queue of records. Each producer thread
+/// owns one, so pushing never takes a lock.
+class RecordQueue {
+public:
+
+	/// @brief push record, drop it if the queue is full
+	///
+	/// @param[in] record record to push
+	/// @returns true if pushed, false if dropped
+	///
+	bool Push(LogRecord &&record) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		records_[tail % kCapacity] = std::move(record);
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+
+	/// @brief pop record
+	///
+	/// @param[out] record popped record
+	/// @returns true if popped, false if the queue is empty
+	///
+	bool Pop(LogRecord &record) {
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		record = std::move(records_[head % kCapacity]);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+
+	/// @brief take the number of dropped records and reset it
+	///
+	/// @returns number of dropped records since last call
+	///
+	size_t TakeDropped() {
+		return dropped_.exchange(0, std::memory_order_relaxed);
+	}
+
+private:
+	static const size_t kCapacity = 1024;
+	LogRecord records_[kCapacity];
+	std::atomic<size_t> head_{0};
+	std::atomic<size_t> tail_{0};
+	std::atomic<size_t> dropped_{0};
+};
+
+
+/// Queue of the current thread, gives the queue back to sink when thread
+/// exits.
+struct RecordQueueHolder {
+	std::shared_ptr<RecordQueue> queue;
+
+	~RecordQueueHolder();
+};
+
+
+/// Background thread writes the records in all queues. The queue of an
+/// exited thread is reused by the next thread, so the number of queues
+/// is limited by the threads logging at the same time.
+class AsyncSink {
+public:
+
+	/// @brief get the only sink, start it in the first call
+	///
+	/// @returns reference to sink
+	///
+	static AsyncSink& Instance() {
+		static AsyncSink sink;
+		return sink;
+	}
+
+
+	/// @brief destructor, write the remaining records and stop thread
+	///
+	~AsyncSink() {
+		running_ = false;
+		thread_.join();
+		Drain();
+	}
+
+
+	/// @brief push record to queue of this thread
+	///
+	/// @param[in] record record to push
+	///
+	void Push(LogRecord &&record) {
+		thread_local RecordQueueHolder holder;
+		if (!holder.queue) {
+			holder.queue = AcquireQueue();
+		}
+		if (holder.queue->Push(std::move(record))) {
+			pushed_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+
+	/// @brief wait until the pushed records are written
+	///
+	void Flush() {
+		size_t target = pushed_.load(std::memory_order_relaxed);
+		while (written_.load(std::memory_order_acquire) < target) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+
+	/// @brief give back the queue of an exited thread, the records left are
+	/// 	still written
+	///
+	/// @param[in] queue queue to give back
+	///
+	void ReleaseQueue(std::shared_ptr<RecordQueue> queue) noexcept {
+		try {
+			std::lock_guard<std::mutex> guard(queues_lock_);
+			free_queues_.push_back(queue);
+		} catch (...) {
+			// queue is leaked but still drained
+		}
+	}
+
+private:
+
+	/// @brief constructor, start the thread
+	///
+	AsyncSink()
+	: running_(true), pushed_(0), written_(0) {
+		thread_ = std::thread(&AsyncSink::Loop, this);
+	}
+
+
+	/// @brief get a free queue or create one for the current thread
+	///
+	/// @returns queue owned by the current thread until it exits
+	///
+	std::shared_ptr<RecordQueue> AcquireQueue() {
+		std::lock_guard<std::mutex> guard(queues_lock_);
+		if (!free_queues_.empty()) {
+			std::shared_ptr<RecordQueue> queue = free_queues_.back();
+			free_queues_.pop_back();
+			return queue;
+		}
+		queues_.push_back(std::make_shared<RecordQueue>());
+		return queues_.back();
+	}
+
+
+	/// @brief write records until stopped
+	///
+	void Loop() {
+		while (running_) {
+			if (!Drain()) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+
+	/// @brief write all records in queues
+	///
+	/// @returns true if anything was written
+	///
+	bool Drain() {
+		std::vector<std::shared_ptr<RecordQueue>> queues;
+		{
+			std::lock_guard<std::mutex> guard(queues_lock_);
+			queues = queues_;
+		}
+		size_t count = 0;
+		std::vector<std::ostream*> streams;
+		LogRecord record;
+		for (auto &queue : queues) {
+			while (queue->Pop(record)) {
+				WriteRecord(record);
+				if (streams.empty() || streams.back() != record.os) {
+					streams.push_back(record.os);
+				}
+				++count;
+			}
+			size_t dropped = queue->TakeDropped();
+			if (dropped) {
+				std::cerr << "WARNING: " << dropped
+					<< " messages dropped since log queue is full.\n";
+			}
+		}
+		for (auto &os : streams) {
+			os->flush();
+		}
+		written_.fetch_add(count, std::memory_order_release);
+		return count != 0;
+	}
+
+	std::atomic<bool> running_;
+	std::atomic<size_t> pushed_;
+	std::atomic<size_t> written_;
+	std::mutex queues_lock_;
+	std::vector<std::shared_ptr<RecordQueue>> queues_;
+	std::vector<std::shared_ptr<RecordQueue>> free_queues_;
+	std::thread thread_;
+};
+
+
+RecordQueueHolder::~RecordQueueHolder() {
+	if (queue) AsyncSink::Instance().ReleaseQueue(queue);
+}
+
 
 //-----------------------------------------------------------------------------
 // 								MessageOstream
 //-----------------------------------------------------------------------------
 
+// reused buffer of this thread, avoid constructing stream for every message
+thread_local std::ostringstream message_buffer;
+thread_local bool message_buffer_in_use = false;
+
+
 MessageOstream::MessageOstream(
 	std::ostream &os,
-	bool print,
-	std::mutex &lock,
+	const Message *message,
 	const std::string &prefix
 )
-: os_(os), print_(print), guard_(lock) {
-	os << prefix;
+: os_(os), message_(message), buffer_(nullptr) {
+	// filtered message do nothing
+	if (!message_) return;
+
+	if (message_->show_timestamp_) {
+		time_ = std::chrono::system_clock::now();
+	}
+	if (message_buffer_in_use) {
+		owned_buffer_ = std::make_unique<std::ostringstream>();
+		buffer_ = owned_buffer_.get();
+	} else {
+		message_buffer_in_use = true;
+		message_buffer.str("");
+		message_buffer.clear();
+		buffer_ = &message_buffer;
+	}
+	*buffer_ << prefix;
+}
+
+
+MessageOstream::~MessageOstream() {
+	if (!buffer_) return;
+
+	LogRecord record{&os_, time_, message_->show_timestamp_, buffer_->str()};
+	if (!owned_buffer_) {
+		message_buffer_in_use = false;
+	}
+
+	if (message_->async_) {
+		AsyncSink::Instance().Push(std::move(record));
+	} else {
+		std::lock_guard<std::mutex> guard(message_->lock_);
+		WriteRecord(record);
+	}
 }
 
 
@@ -49,30 +336,35 @@ const std::map<std::string, Message::Level> Message::level_map_ = {
 
 
 Message::Message(Level level)
-:intrinsic_level_(level), printing_level_(Level::kWarning),
-	show_prefix_(false), show_color_(false) {
+:intrinsic_level_(level), show_prefix_(false), show_color_(false),
+	show_timestamp_(false), async_(false) {
 }
 
 
-MessageOstream operator<<(std::ostream &os, Message &message) {
-	std::string content = "";
-	if (message.printing_level_ <= message.intrinsic_level_) {
-		if (message.show_prefix_) {
-			// add prefix
-			content = message.prefix_map_.at(message.printing_level_);
+void Message::Flush() {
+	AsyncSink::Instance().Flush();
+}
 
-			if (message.show_color_) {
-				// add color
-				content = message.color_map_.at(message.printing_level_)
-					+ content + "\033[0m";
-			}
-		}
+
+MessageOstream operator<<(std::ostream &os, const Message::Printer &printer) {
+	const Message &message = printer.message;
+	// reject filtered message before any formatting
+	if (!message.Enabled(printer.level)) {
+		return MessageOstream(os, nullptr, "");
+	}
+	if (!message.show_prefix_) {
+		return MessageOstream(os, &message, "");
+	}
+	if (!message.show_color_) {
+		return MessageOstream(
+			os, &message, message.prefix_map_.at(printer.level)
+		);
 	}
 	return MessageOstream(
 		os,
-		message.printing_level_ <= message.intrinsic_level_,
-		message.lock_,
-		content
+		&message,
+		message.color_map_.at(printer.level)
+			+ message.prefix_map_.at(printer.level) + "\033[0m"
 	);
 }
 
@@ -0,0 +1,633 @@
+#include "include/metrics.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "include/error.h"
+#include "include/fifo_monitor.h"
+
+namespace rxdaq {
+
+// milliseconds between checks of stopping while waiting for clients
+const int kAcceptPollMilliseconds = 200;
+// maximum bytes of request header
+const size_t kMaxRequestBytes = 8192;
+
+
+//-----------------------------------------------------------------------------
+// 								LatencyHistogram
+//-----------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram() noexcept
+: count_(0), sum_nanoseconds_(0) {
+
+	for (auto &count : counts_) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+void LatencyHistogram::Observe(double seconds) noexcept {
+	size_t bucket = std::lower_bound(
+		kLatencyBounds.begin(), kLatencyBounds.end(), seconds
+	) - kLatencyBounds.begin();
+	counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	if (seconds > 0) {
+		sum_nanoseconds_.fetch_add(
+			static_cast<uint64_t>(seconds * 1e9), std::memory_order_relaxed
+		);
+	}
+}
+
+
+std::array<uint64_t, kLatencyBounds.size()+1>
+LatencyHistogram::Counts() const noexcept {
+	std::array<uint64_t, kLatencyBounds.size()+1> result;
+	for (size_t i = 0; i < counts_.size(); ++i) {
+		result[i] = counts_[i].load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+
+uint64_t LatencyHistogram::Count() const noexcept {
+	return count_.load(std::memory_order_relaxed);
+}
+
+
+double LatencyHistogram::Sum() const noexcept {
+	return sum_nanoseconds_.load(std::memory_order_relaxed) * 1e-9;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								HdrHistogram
+//-----------------------------------------------------------------------------
+
+HdrHistogram::HdrHistogram() noexcept
+: count_(0), sum_nanoseconds_(0), max_microseconds_(0) {
+
+	for (auto &count : counts_) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+size_t HdrHistogram::BucketIndex(uint64_t microseconds) noexcept {
+	const uint64_t sub_buckets = uint64_t(1) << kHdrSubBucketBits;
+	microseconds = std::min(microseconds, (uint64_t(1) << kHdrMaxBits) - 1);
+	if (microseconds < sub_buckets) return microseconds;
+	// the highest bit selects the power of 2, the next bits the sub-bucket
+	unsigned int magnitude = 63 - __builtin_clzll(microseconds);
+	unsigned int shift = magnitude - kHdrSubBucketBits;
+	return ((shift + 1) << kHdrSubBucketBits)
+		+ ((microseconds >> shift) - sub_buckets);
+}
+
+
+uint64_t HdrHistogram::BucketUpper(size_t index) noexcept {
+	const uint64_t sub_buckets = uint64_t(1) << kHdrSubBucketBits;
+	if (index < sub_buckets) return index + 1;
+	unsigned int shift = (index >> kHdrSubBucketBits) - 1;
+	return (sub_buckets + (index & (sub_buckets - 1)) + 1) << shift;
+}
+
+
+void HdrHistogram::Record(double seconds) noexcept {
+	uint64_t nanoseconds = seconds > 0 ? static_cast<uint64_t>(seconds * 1e9) : 0;
+	uint64_t microseconds = nanoseconds / 1000;
+	counts_[BucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	sum_nanoseconds_.fetch_add(nanoseconds, std::memory_order_relaxed);
+	uint64_t max = max_microseconds_.load(std::memory_order_relaxed);
+	while (
+		microseconds > max
+		&& !max_microseconds_.compare_exchange_weak(
+			max, microseconds, std::memory_order_relaxed
+		)
+	);
+}
+
+
+uint64_t HdrHistogram::Count() const noexcept {
+	return count_.load(std::memory_order_relaxed);
+}
+
+
+double HdrHistogram::Mean() const noexcept {
+	uint64_t count = Count();
+	if (!count) return 0.0;
+	return sum_nanoseconds_.load(std::memory_order_relaxed) * 1e-9 / count;
+}
+
+
+double HdrHistogram::Max() const noexcept {
+	return max_microseconds_.load(std::memory_order_relaxed) * 1e-6;
+}
+
+
+double HdrHistogram::Percentile(double fraction) const noexcept {
+	uint64_t count = 0;
+	std::array<uint64_t, kHdrBuckets> counts;
+	for (size_t i = 0; i < kHdrBuckets; ++i) {
+		counts[i] = counts_[i].load(std::memory_order_relaxed);
+		count += counts[i];
+	}
+	if (!count) return 0.0;
+	uint64_t target = static_cast<uint64_t>(
+		std::ceil(std::min(std::max(fraction, 0.0), 1.0) * count)
+	);
+	target = std::max(target, uint64_t(1));
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < kHdrBuckets; ++i) {
+		cumulative += counts[i];
+		if (cumulative >= target) {
+			// never beyond the recorded maximum
+			return std::min(
+				(BucketUpper(i) - 1) * 1e-6, Max()
+			);
+		}
+	}
+	return Max();
+}
+
+
+//-----------------------------------------------------------------------------
+// 								RpcMetrics
+//-----------------------------------------------------------------------------
+
+RpcMetrics::RpcMetrics() noexcept
+: in_flight_(0) {
+
+	for (auto &outcome : outcomes_) {
+		outcome.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+void RpcMetrics::Begin() noexcept {
+	in_flight_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void RpcMetrics::End(double seconds, size_t outcome) noexcept {
+	in_flight_.fetch_sub(1, std::memory_order_relaxed);
+	latency_.Observe(seconds);
+	hdr_.Record(seconds);
+	outcomes_[std::min(outcome, kRpcFailed)].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+RpcMethodStats RpcMetrics::Stats(const std::string &method) const {
+	RpcMethodStats result;
+	result.method = method;
+	result.calls = hdr_.Count();
+	int64_t in_flight = in_flight_.load(std::memory_order_relaxed);
+	result.in_flight = in_flight > 0 ? in_flight : 0;
+	for (size_t i = 0; i < outcomes_.size(); ++i) {
+		result.outcomes[i] = outcomes_[i].load(std::memory_order_relaxed);
+	}
+	result.mean = hdr_.Mean();
+	result.p50 = hdr_.Percentile(0.5);
+	result.p90 = hdr_.Percentile(0.9);
+	result.p99 = hdr_.Percentile(0.99);
+	result.max = hdr_.Max();
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								Metrics
+//-----------------------------------------------------------------------------
+
+Metrics& Metrics::Instance() {
+	static Metrics metrics;
+	return metrics;
+}
+
+
+Metrics::Metrics() noexcept
+: backlog_chunks_(0), backlog_bytes_(0), run_state_(0) {
+
+	for (auto &module : modules_) {
+		module.seen.store(false, std::memory_order_relaxed);
+		module.read_words.store(0, std::memory_order_relaxed);
+		module.fifo_words.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+void Metrics::AddRead(unsigned short module, size_t words) noexcept {
+	if (module >= kModuleNum) return;
+	modules_[module].read_words.fetch_add(words, std::memory_order_relaxed);
+	modules_[module].seen.store(true, std::memory_order_relaxed);
+}
+
+
+void Metrics::SetFifoLevel(unsigned short module, size_t words) noexcept {
+	if (module >= kModuleNum) return;
+	modules_[module].fifo_words.store(words, std::memory_order_relaxed);
+	modules_[module].seen.store(true, std::memory_order_relaxed);
+}
+
+
+void Metrics::AddWriteBacklog(int64_t chunks, int64_t bytes) noexcept {
+	backlog_chunks_.fetch_add(chunks, std::memory_order_relaxed);
+	backlog_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+
+void Metrics::SetRunState(int state) noexcept {
+	run_state_.store(state, std::memory_order_relaxed);
+}
+
+
+void Metrics::SetBootTimings(const std::vector<PhaseTiming> &timings) {
+	std::lock_guard<std::mutex> guard(lock_);
+	boot_timings_ = timings;
+}
+
+
+RpcMetrics& Metrics::Rpc(const std::string &method) {
+	std::lock_guard<std::mutex> guard(lock_);
+	std::unique_ptr<RpcMetrics> &metrics = rpc_methods_[method];
+	if (!metrics) {
+		metrics = std::make_unique<RpcMetrics>();
+	}
+	return *metrics;
+}
+
+
+std::vector<RpcMethodStats> Metrics::RpcStats() const {
+	std::lock_guard<std::mutex> guard(lock_);
+	std::vector<RpcMethodStats> result;
+	for (const auto &[method, metrics] : rpc_methods_) {
+		result.push_back(metrics->Stats(method));
+	}
+	return result;
+}
+
+
+/// @brief escape label value in Prometheus text format
+///
+/// @param[in] value value of label
+/// @returns escaped value
+///
+static std::string EscapeLabel(const std::string &value) {
+	std::string result;
+	for (const auto &c : value) {
+		if (c == '\\') {
+			result += "\\\\";
+		} else if (c == '"') {
+			result += "\\\"";
+		} else if (c == '\n') {
+			result += "\\n";
+		} else {
+			result += c;
+		}
+	}
+	return result;
+}
+
+
+/// @brief write HELP and TYPE lines of a metric
+///
+/// @param[in] output stream to write
+/// @param[in] name name of metric
+/// @param[in] type type of metric
+/// @param[in] help description of metric
+///
+static void WriteHeader(
+	std::ostream &output,
+	const std::string &name,
+	const std::string &type,
+	const std::string &help
+) {
+	output << "# HELP " << name << " " << help << "\n"
+		<< "# TYPE " << name << " " << type << "\n";
+}
+
+
+std::string Metrics::Export() const {
+	std::stringstream result;
+	result.precision(9);
+
+	std::vector<unsigned short> modules;
+	for (unsigned short m = 0; m < kModuleNum; ++m) {
+		if (modules_[m].seen.load(std::memory_order_relaxed)) {
+			modules.push_back(m);
+		}
+	}
+
+	WriteHeader(
+		result, "rxdaq_read_words_total", "counter",
+		"Words of list mode data read from module."
+	);
+	for (const auto &m : modules) {
+		result << "rxdaq_read_words_total{module=\"" << m << "\"} "
+			<< modules_[m].read_words.load(std::memory_order_relaxed) << "\n";
+	}
+	WriteHeader(
+		result, "rxdaq_read_bytes_total", "counter",
+		"Bytes of list mode data read from module."
+	);
+	for (const auto &m : modules) {
+		result << "rxdaq_read_bytes_total{module=\"" << m << "\"} "
+			<< modules_[m].read_words.load(std::memory_order_relaxed) * sizeof(uint32_t)
+			<< "\n";
+	}
+	WriteHeader(
+		result, "rxdaq_fifo_words", "gauge",
+		"Words in the external FIFO of module at the last poll."
+	);
+	for (const auto &m : modules) {
+		result << "rxdaq_fifo_words{module=\"" << m << "\"} "
+			<< modules_[m].fifo_words.load(std::memory_order_relaxed) << "\n";
+	}
+	WriteHeader(
+		result, "rxdaq_fifo_fill_ratio", "gauge",
+		"Fill level of the external FIFO of module at the last poll."
+	);
+	for (const auto &m : modules) {
+		result << "rxdaq_fifo_fill_ratio{module=\"" << m << "\"} "
+			<< static_cast<double>(
+				modules_[m].fifo_words.load(std::memory_order_relaxed)
+			) / kFifoWords << "\n";
+	}
+
+	WriteHeader(
+		result, "rxdaq_write_backlog_chunks", "gauge",
+		"Chunks of data read but not written to file yet."
+	);
+	result << "rxdaq_write_backlog_chunks "
+		<< backlog_chunks_.load(std::memory_order_relaxed) << "\n";
+	WriteHeader(
+		result, "rxdaq_write_backlog_bytes", "gauge",
+		"Bytes of data read but not written to file yet."
+	);
+	result << "rxdaq_write_backlog_bytes "
+		<< backlog_bytes_.load(std::memory_order_relaxed) << "\n";
+
+	WriteHeader(
+		result, "rxdaq_run_state", "gauge",
+		"Run state, 0 idle, 1 starting, 2 running, 3 stopping, 4 finished."
+	);
+	result << "rxdaq_run_state "
+		<< run_state_.load(std::memory_order_relaxed) << "\n";
+
+	std::lock_guard<std::mutex> guard(lock_);
+	WriteHeader(
+		result, "rxdaq_boot_phase_seconds", "gauge",
+		"Time spent in phases of the last boot."
+	);
+	for (const auto &timing : boot_timings_) {
+		result << "rxdaq_boot_phase_seconds{phase=\"" << EscapeLabel(timing.phase)
+			<< "\",module=\""
+			<< (timing.module == kCratePhase ? "crate" : std::to_string(timing.module))
+			<< "\"} " << timing.milliseconds * 1e-3 << "\n";
+	}
+
+	WriteHeader(
+		result, "rxdaq_rpc_duration_seconds", "histogram",
+		"Time spent in handling RPC."
+	);
+	for (const auto &[method, metrics] : rpc_methods_) {
+		const LatencyHistogram &histogram = metrics->Latency();
+		std::string label = "method=\"" + EscapeLabel(method) + "\"";
+		auto counts = histogram.Counts();
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < kLatencyBounds.size(); ++i) {
+			cumulative += counts[i];
+			result << "rxdaq_rpc_duration_seconds_bucket{" << label
+				<< ",le=\"" << kLatencyBounds[i] << "\"} " << cumulative << "\n";
+		}
+		cumulative += counts.back();
+		result << "rxdaq_rpc_duration_seconds_bucket{" << label
+			<< ",le=\"+Inf\"} " << cumulative << "\n";
+		result << "rxdaq_rpc_duration_seconds_sum{" << label << "} "
+			<< histogram.Sum() << "\n";
+		// count from buckets, so that it's consistent with the +Inf bucket
+		result << "rxdaq_rpc_duration_seconds_count{" << label << "} "
+			<< cumulative << "\n";
+	}
+
+	std::vector<RpcMethodStats> stats;
+	for (const auto &[method, metrics] : rpc_methods_) {
+		stats.push_back(metrics->Stats(method));
+	}
+	WriteHeader(
+		result, "rxdaq_rpc_in_flight", "gauge",
+		"RPC being handled."
+	);
+	for (const auto &method : stats) {
+		result << "rxdaq_rpc_in_flight{method=\"" << EscapeLabel(method.method)
+			<< "\"} " << method.in_flight << "\n";
+	}
+	WriteHeader(
+		result, "rxdaq_rpc_outcomes_total", "counter",
+		"Finished RPC by status of reply, rpc_failed if there is no reply."
+	);
+	for (const auto &method : stats) {
+		for (size_t i = 0; i < kRpcOutcomeNames.size(); ++i) {
+			result << "rxdaq_rpc_outcomes_total{method=\""
+				<< EscapeLabel(method.method) << "\",status=\""
+				<< kRpcOutcomeNames[i] << "\"} " << method.outcomes[i] << "\n";
+		}
+	}
+	return result.str();
+}
+
+
+std::string RpcStatsInfo(const std::vector<RpcMethodStats> &stats) {
+	if (stats.empty()) return "No RPC handled.\n";
+	std::stringstream result;
+	// latencies in milliseconds, then the calls not succeeded
+	result << std::left << std::setw(20) << "method" << std::right
+		<< std::setw(8) << "calls" << std::setw(7) << "busy"
+		<< std::setw(10) << "mean(ms)" << std::setw(10) << "p50"
+		<< std::setw(10) << "p90" << std::setw(10) << "p99"
+		<< std::setw(10) << "max" << std::setw(9) << "warning"
+		<< std::setw(8) << "fatal" << std::setw(8) << "failed" << "\n"
+		<< std::fixed << std::setprecision(3);
+	for (const auto &method : stats) {
+		result << std::left << std::setw(20) << method.method << std::right
+			<< std::setw(8) << method.calls << std::setw(7) << method.in_flight
+			<< std::setw(10) << method.mean * 1e3
+			<< std::setw(10) << method.p50 * 1e3
+			<< std::setw(10) << method.p90 * 1e3
+			<< std::setw(10) << method.p99 * 1e3
+			<< std::setw(10) << method.max * 1e3
+			<< std::setw(9) << method.outcomes[3]
+			<< std::setw(8) << method.outcomes[1] + method.outcomes[2]
+			<< std::setw(8) << method.outcomes[kRpcFailed] << "\n";
+	}
+	return result.str();
+}
+
+
+//-----------------------------------------------------------------------------
+// 								MetricsServer
+//-----------------------------------------------------------------------------
+
+std::string MetricsResponse(const std::string &request) {
+	std::string line = request.substr(0, request.find("\r\n"));
+	std::stringstream fields(line);
+	std::string method, target;
+	fields >> method >> target;
+	target = target.substr(0, target.find('?'));
+
+	std::string status = "200 OK";
+	std::string type = "text/plain; version=0.0.4; charset=utf-8";
+	std::string body;
+	if (method != "GET" && method != "HEAD") {
+		status = "405 Method Not Allowed";
+		type = "text/plain; charset=utf-8";
+		body = "Only GET is allowed.\n";
+	} else if (target != "/metrics") {
+		status = "404 Not Found";
+		type = "text/plain; charset=utf-8";
+		body = "Metrics are at /metrics.\n";
+	} else {
+		body = Metrics::Instance().Export();
+	}
+
+	std::string result = "HTTP/1.1 " + status + "\r\n"
+		+ "Content-Type: " + type + "\r\n"
+		+ "Content-Length: " + std::to_string(body.size()) + "\r\n"
+		+ "Connection: close\r\n\r\n";
+	if (method != "HEAD") {
+		result += body;
+	}
+	return result;
+}
+
+
+MetricsServer::MetricsServer() noexcept
+: socket_(-1), port_(0), running_(false) {
+}
+
+
+MetricsServer::~MetricsServer() {
+	Stop();
+}
+
+
+void MetricsServer::Start(const std::string &host, unsigned short port) {
+	Stop();
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	addrinfo *addresses = nullptr;
+	std::string address = host + ":" + std::to_string(port);
+	if (getaddrinfo(
+		host.empty() ? nullptr : host.c_str(),
+		std::to_string(port).c_str(),
+		&hints,
+		&addresses
+	)) {
+		throw RXError("Failed to resolve metrics address " + address);
+	}
+	for (addrinfo *info = addresses; info; info = info->ai_next) {
+		socket_ = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (socket_ < 0) continue;
+		int reuse = 1;
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (
+			bind(socket_, info->ai_addr, info->ai_addrlen) == 0
+			&& listen(socket_, 16) == 0
+		) {
+			break;
+		}
+		close(socket_);
+		socket_ = -1;
+	}
+	freeaddrinfo(addresses);
+	if (socket_ < 0) {
+		throw RXError("Failed to listen on metrics address " + address);
+	}
+
+	// get the chosen port
+	sockaddr_storage bound;
+	socklen_t length = sizeof(bound);
+	getsockname(socket_, reinterpret_cast<sockaddr*>(&bound), &length);
+	if (bound.ss_family == AF_INET6) {
+		port_ = ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+	} else {
+		port_ = ntohs(reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+	}
+
+	running_ = true;
+	thread_ = std::thread(&MetricsServer::Loop, this);
+}
+
+
+void MetricsServer::Stop() {
+	running_ = false;
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+	if (socket_ >= 0) {
+		close(socket_);
+		socket_ = -1;
+	}
+	port_ = 0;
+}
+
+
+void MetricsServer::Loop() {
+	while (running_) {
+		pollfd listening{socket_, POLLIN, 0};
+		if (poll(&listening, 1, kAcceptPollMilliseconds) <= 0) continue;
+		int client = accept(socket_, nullptr, nullptr);
+		if (client < 0) continue;
+		Answer(client);
+		close(client);
+	}
+}
+
+
+void MetricsServer::Answer(int client) {
+	// don't let a slow client hold the server
+	timeval timeout{1, 0};
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	std::string request;
+	char buffer[1024];
+	while (
+		request.find("\r\n\r\n") == std::string::npos
+		&& request.size() < kMaxRequestBytes
+	) {
+		ssize_t size = recv(client, buffer, sizeof(buffer), 0);
+		if (size <= 0) break;
+		request.append(buffer, size);
+	}
+	if (request.empty()) return;
+
+	std::string response = MetricsResponse(request);
+	size_t sent = 0;
+	while (sent < response.size()) {
+		ssize_t size = send(
+			client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL
+		);
+		if (size <= 0) break;
+		sent += size;
+	}
+}
+
+}		// namespace rxdaq
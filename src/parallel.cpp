@@ -0,0 +1,12 @@
+#include "include/parallel.h"
+
+#include <algorithm>
+
+namespace rxdaq {
+
+unsigned int WorkerThreads(unsigned int threads) {
+	if (threads) return threads;
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+}		// namespace rxdaq
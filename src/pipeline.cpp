@@ -0,0 +1,143 @@
+#include "include/pipeline.h"
+
+#include <algorithm>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+/// @brief move the kept elements of column forward
+///
+/// @param[in,out] column column to compact
+/// @param[in] keep keep flags
+/// @param[in] kept number of kept elements
+///
+template<typename T>
+void CompactColumn(
+	std::vector<T> &column,
+	const std::vector<uint8_t> &keep,
+	size_t kept
+) {
+	size_t out = 0;
+	for (size_t i = 0; i < column.size(); ++i) {
+		column[out] = column[i];
+		out += keep[i];
+	}
+	column.resize(kept);
+}
+
+
+void CompactBlock(DataBlock &block) {
+	EventBatch &events = block.events;
+	size_t kept = 0;
+	for (const auto &k : block.keep) {
+		kept += k;
+	}
+	if (kept == events.Size()) return;
+
+	// move raw words of kept events forward
+	uint32_t position = 0;
+	for (size_t i = 0; i < events.Size(); ++i) {
+		if (!block.keep[i]) continue;
+		if (events.offset[i] != position) {
+			std::copy(
+				block.words.begin() + events.offset[i],
+				block.words.begin() + events.offset[i] + events.length[i],
+				block.words.begin() + position
+			);
+		}
+		events.offset[i] = position;
+		position += events.length[i];
+	}
+	block.words.resize(position);
+
+	CompactColumn(events.offset, block.keep, kept);
+	CompactColumn(events.length, block.keep, kept);
+	CompactColumn(events.header_length, block.keep, kept);
+	CompactColumn(events.crate, block.keep, kept);
+	CompactColumn(events.slot, block.keep, kept);
+	CompactColumn(events.channel, block.keep, kept);
+	CompactColumn(events.finish_code, block.keep, kept);
+	CompactColumn(events.time, block.keep, kept);
+	CompactColumn(events.cfd, block.keep, kept);
+	CompactColumn(events.energy, block.keep, kept);
+	CompactColumn(events.trace_length, block.keep, kept);
+	block.keep.assign(kept, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// 								Pipeline
+//-----------------------------------------------------------------------------
+
+Pipeline::Pipeline() noexcept
+: invalid_blocks_(0) {
+}
+
+
+void Pipeline::AddStage(std::shared_ptr<Stage> stage) {
+	stages_.push_back(stage);
+}
+
+
+void Pipeline::Reset() {
+	incomplete_.clear();
+	for (auto &stage : stages_) {
+		stage->Reset();
+	}
+}
+
+
+void Pipeline::Process(unsigned short module, std::vector<uint32_t> &words) {
+	TraceSpan trace_span("Pipeline::Process");
+	std::vector<uint32_t> &incomplete = incomplete_[module];
+	if (!incomplete.empty()) {
+		incomplete.insert(incomplete.end(), words.begin(), words.end());
+		words.swap(incomplete);
+		incomplete.clear();
+	}
+
+	block_.module = module;
+	block_.events.Clear();
+	size_t complete = 0;
+	try {
+		complete = DecodeListMode(words.data(), words.size(), block_.events);
+	} catch (const RXError&) {
+		// lost the event boundary, write the data as it is
+		invalid_blocks_.fetch_add(1, std::memory_order_relaxed);
+		block_.events.Clear();
+		return;
+	}
+	incomplete.assign(words.begin() + complete, words.end());
+	words.resize(complete);
+
+	block_.words.swap(words);
+	block_.keep.assign(block_.events.Size(), 1);
+	for (auto &stage : stages_) {
+		stage->Process(block_);
+	}
+	CompactBlock(block_);
+	words.swap(block_.words);
+}
+
+
+void Pipeline::Flush(unsigned short module, std::vector<uint32_t> &words) {
+	TraceSpan trace_span("Pipeline::Flush");
+	block_.module = module;
+	block_.words.clear();
+	block_.events.Clear();
+	block_.keep.clear();
+	for (auto &stage : stages_) {
+		stage->Flush(block_);
+	}
+	CompactBlock(block_);
+	words.swap(block_.words);
+
+	auto search = incomplete_.find(module);
+	if (search == incomplete_.end()) return;
+	words.insert(words.end(), search->second.begin(), search->second.end());
+	incomplete_.erase(search);
+}
+
+}		// namespace rxdaq
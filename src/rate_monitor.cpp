@@ -0,0 +1,117 @@
+#include "include/rate_monitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace rxdaq {
+
+RateMonitor::RateMonitor(double window) noexcept
+: bucket_seconds_(
+	(window > 0 ? window : kRateWindow) / static_cast<double>(kRateBuckets)
+) {
+	Reset();
+}
+
+
+void RateMonitor::Process(DataBlock &block) {
+	Count(block, Now());
+}
+
+
+void RateMonitor::Reset() {
+	for (auto &bucket : buckets_) {
+		bucket.period.store(-1, std::memory_order_relaxed);
+		for (auto &count : bucket.counts) {
+			count.store(0, std::memory_order_relaxed);
+		}
+	}
+	for (auto &total : totals_) {
+		total.store(0, std::memory_order_relaxed);
+	}
+	start_.store(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count(),
+		std::memory_order_release
+	);
+}
+
+
+void RateMonitor::Count(const DataBlock &block, double seconds) {
+	if (block.module >= kModuleNum || block.events.Size() == 0) return;
+
+	// count in local variables and touch the atomics once a block
+	uint64_t counts[kChannelNum] = {};
+	const uint8_t *channels = block.events.channel.data();
+	const size_t size = block.events.Size();
+	for (size_t i = 0; i < size; ++i) {
+		++counts[channels[i] % kChannelNum];
+	}
+
+	int64_t period = static_cast<int64_t>(
+		std::floor(std::max(seconds, 0.0) / bucket_seconds_)
+	);
+	Bucket &bucket = buckets_[period % kRateBuckets];
+	if (bucket.period.load(std::memory_order_relaxed) != period) {
+		// the bucket left the window, reuse it for the new period
+		for (auto &count : bucket.counts) {
+			count.store(0, std::memory_order_relaxed);
+		}
+		bucket.period.store(period, std::memory_order_release);
+	}
+
+	const size_t first = block.module * kChannelNum;
+	for (size_t i = 0; i < kChannelNum; ++i) {
+		if (!counts[i]) continue;
+		bucket.counts[first+i].fetch_add(counts[i], std::memory_order_relaxed);
+		totals_[first+i].fetch_add(counts[i], std::memory_order_relaxed);
+	}
+}
+
+
+std::vector<ChannelRate> RateMonitor::Rates() const {
+	return Rates(Now());
+}
+
+
+std::vector<ChannelRate> RateMonitor::Rates(double seconds) const {
+	seconds = std::max(seconds, 0.0);
+	int64_t period = static_cast<int64_t>(std::floor(seconds / bucket_seconds_));
+	int64_t first_period = period - static_cast<int64_t>(kRateBuckets) + 1;
+	// the window covers the full buckets before and the current part
+	double begin = std::max(first_period, int64_t(0)) * bucket_seconds_;
+	double span = seconds - begin;
+
+	std::array<uint64_t, kRateChannels> counts{};
+	for (const auto &bucket : buckets_) {
+		int64_t bucket_period = bucket.period.load(std::memory_order_acquire);
+		if (bucket_period < first_period || bucket_period > period) continue;
+		for (size_t i = 0; i < kRateChannels; ++i) {
+			counts[i] += bucket.counts[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	std::vector<ChannelRate> result;
+	for (size_t i = 0; i < kRateChannels; ++i) {
+		uint64_t total = totals_[i].load(std::memory_order_relaxed);
+		if (!total) continue;
+		result.push_back(ChannelRate{
+			static_cast<unsigned short>(i / kChannelNum),
+			static_cast<unsigned short>(i % kChannelNum),
+			span > 0 ? counts[i] / span : 0.0,
+			total
+		});
+	}
+	return result;
+}
+
+
+double RateMonitor::Now() const noexcept {
+	int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+	return (now - start_.load(std::memory_order_acquire)) * 1e-9;
+}
+
+}		// namespace rxdaq
@@ -1,4 +1,3 @@
-#include <signal.h>
 #include <stdint.h>
 
 #include "grpcpp/grpcpp.h"
@@ -8,8 +7,6 @@
 
 namespace rxdaq {
 
-RemoteCrate *RemoteCrate::instance_ = nullptr;
-
 template <typename Reply>
 void CheckStatus(grpc::Status &status, Reply &reply) {
 	if (status.ok()) {
@@ -29,12 +26,15 @@ void CheckStatus(grpc::Status &status, Reply &reply) {
 
 
 RemoteCrate::RemoteCrate(std::shared_ptr<grpc::Channel> channel) noexcept
-: stub_(ControlCrate::NewStub(channel)) {
-	instance_ = this;
+: initialized_(false), module_num_(0)
+, stub_(ControlCrate::NewStub(channel)) {
 }
 
 
 void RemoteCrate::Initialize(const std::string &) {
+	// the server crate is initialized once, so is the module number
+	if (initialized_) return;
+
 	EmptyMessage request;
 	InitializeReply reply;
 	grpc::ClientContext context;
@@ -43,6 +43,7 @@ void RemoteCrate::Initialize(const std::string &) {
 	
 	CheckStatus(status, reply);
 	module_num_ = reply.num();
+	initialized_ = true;
 }
 
 
@@ -51,12 +52,45 @@ void RemoteCrate::Boot(unsigned short module_id, bool fast) {
 	request.set_module(module_id);
 	request.set_fast(fast);
 	
-	EmptyReply reply;
+	BootReply reply;
 	grpc::ClientContext context;
 
 	grpc::Status status = stub_->Boot(&context, request, &reply);
 
 	CheckStatus(status, reply);
+
+	boot_timings_.clear();
+	for (const auto &timing : reply.timings()) {
+		boot_timings_.push_back({
+			timing.phase(),
+			timing.module(),
+			timing.milliseconds()
+		});
+	}
+}
+
+
+BootPlan RemoteCrate::PlanBoot(unsigned short module_id, bool fast) {
+	BootRequest request;
+	request.set_module(module_id);
+	request.set_fast(fast);
+
+	BootPlanReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->PlanBoot(&context, request, &reply);
+
+	CheckStatus(status, reply);
+
+	BootPlan result;
+	for (const auto &plan : reply.plans()) {
+		result.push_back({
+			static_cast<unsigned short>(plan.module()),
+			static_cast<BootAction>(plan.action()),
+			plan.reason()
+		});
+	}
+	return result;
 }
 
 
@@ -168,7 +202,7 @@ void RemoteCrate::ExportParameters(const std::string &path) {
 }
 
 
-void RemoteCrate::StartRun(
+unsigned int RemoteCrate::StartRun(
 	unsigned short module_id,
 	unsigned int seconds,
 	int run
@@ -178,60 +212,243 @@ void RemoteCrate::StartRun(
 	request.set_seconds(seconds);
 	request.set_run_number(run);
 
-	AsyncClientCall *call = new AsyncClientCall;
-	call->type = 1;
-	
-	call->reader = stub_->PrepareAsyncStartRun(
-		&call->context, request, &completion_queue_
-	);
-	call->reader->StartCall();
-	call->reader->Finish(&call->reply, &call->status, (void*)call);
-
-	void *got_tag;
-	bool ok = false;
-	signal(SIGINT, SigIntHandler);
-	while (completion_queue_.Next(&got_tag, &ok)) {
-		GPR_ASSERT(ok);
-		AsyncClientCall *call = static_cast<AsyncClientCall*>(got_tag);
-		if (!call->status.ok()) {
-			grpc::Status status = call->status;
-			RunReply reply = call->reply;
-			delete call;
-			CheckStatus(status, reply);
-		}
-		if (call->type == 1) {
-			// exit the loop
-			signal(SIGINT, SIG_DFL);
-			std::cout << RunTimeInfo(call->reply.seconds(), call->reply.run_number())
-				<< std::endl;
-			delete call;
-			return;
-		} else {
-			std::cout << "Stop run success." << std::endl;
-			delete call;
-		}
-	}
+	RunReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->StartRun(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	return reply.run_number();
+}
+
+
+unsigned int RemoteCrate::ContinuousRun(
+	unsigned short module_id,
+	const RollPolicy &policy,
+	int run
+) {
+	ContinuousRunRequest request;
+	request.set_module(module_id);
+	request.set_run_number(run);
+	request.set_roll_seconds(policy.seconds);
+	request.set_roll_bytes(policy.bytes);
+	request.set_runs(policy.runs);
+
+	RunReply reply;
+	grpc::ClientContext context;
 
-} 
+	grpc::Status status = stub_->ContinuousRun(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	return reply.run_number();
+}
+
+
+void RemoteCrate::PrepareRun(unsigned short module_id, int run) {
+	RunRequest request;
+	request.set_module(module_id);
+	request.set_run_number(run);
+
+	EmptyReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->PrepareRun(&context, request, &reply);
+
+	CheckStatus(status, reply);
+}
 
 
 void RemoteCrate::StopRun() {
 	EmptyMessage request;
+	RunReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->StopRun(&context, request, &reply);
+
+	CheckStatus(status, reply);
+}
+
+
+/// @brief convert run status reply to run status
+///
+/// @param[in] reply reply from server
+/// @returns run status
+///
+RunInfo RunInfoFromReply(const RunStatusReply &reply) {
+	return RunInfo{
+		static_cast<RunState>(reply.state()),
+		reply.run_number(),
+		static_cast<unsigned short>(reply.module()),
+		reply.seconds(),
+		reply.bytes(),
+		reply.error()
+	};
+}
+
+
+RunInfo RemoteCrate::RunStatus() {
+	EmptyMessage request;
+	RunStatusReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->RunStatus(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	return RunInfoFromReply(reply);
+}
+
+
+RunInfo RemoteCrate::WaitRun(unsigned int milliseconds) {
+	WaitRunRequest request;
+	request.set_milliseconds(milliseconds);
+
+	RunStatusReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->WaitRun(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	return RunInfoFromReply(reply);
+}
+
+
+void RemoteCrate::SetFilter(const std::string &path) {
+	FilterRequest request;
+	request.set_path(path);
+
+	EmptyReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->SetFilter(&context, request, &reply);
+
+	CheckStatus(status, reply);
+}
+
+
+std::vector<FilterCount> RemoteCrate::FilterStats() {
+	EmptyMessage request;
+	FilterStatsReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->FilterStats(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	std::vector<FilterCount> result;
+	for (const auto &count : reply.counts()) {
+		result.push_back(
+			FilterCount{count.name(), count.accepted(), count.rejected()}
+		);
+	}
+	return result;
+}
+
+
+void RemoteCrate::SetTraceReduction(
+	bool enable,
+	const TraceReduction &reduction
+) {
+	TraceReductionRequest request;
+	request.set_enable(enable);
+	request.set_pre(reduction.pre);
+	request.set_post(reduction.post);
+	request.set_trigger(reduction.trigger);
+	request.set_drop_energy(reduction.drop_energy);
+
+	EmptyReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->SetTraceReduction(&context, request, &reply);
+
+	CheckStatus(status, reply);
+}
+
+
+TraceReductionStats RemoteCrate::ReductionStats() {
+	EmptyMessage request;
+	ReductionStatsReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->ReductionStats(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	return TraceReductionStats{
+		reply.events(),
+		reply.dropped(),
+		reply.input_samples(),
+		reply.output_samples()
+	};
+}
+
+
+std::vector<ChannelRate> RemoteCrate::ChannelRates() {
+	EmptyMessage request;
+	ChannelRatesReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->ChannelRates(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	std::vector<ChannelRate> result;
+	for (const auto &rate : reply.rates()) {
+		result.push_back(ChannelRate{
+			static_cast<unsigned short>(rate.module()),
+			static_cast<unsigned short>(rate.channel()),
+			rate.rate(),
+			rate.total()
+		});
+	}
+	return result;
+}
+
+
+std::vector<RpcMethodStats> RemoteCrate::ServerStats() {
+	EmptyMessage request;
+	ServerStatsReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->GetServerStats(&context, request, &reply);
+
+	CheckStatus(status, reply);
+	std::vector<RpcMethodStats> result;
+	for (const auto &method : reply.methods()) {
+		RpcMethodStats stats{
+			method.method(), method.calls(), method.in_flight(), {},
+			method.mean(), method.p50(), method.p90(), method.p99(), method.max()
+		};
+		for (
+			int i = 0;
+			i < method.outcomes_size() && size_t(i) < stats.outcomes.size();
+			++i
+		) {
+			stats.outcomes[i] = method.outcomes(i);
+		}
+		result.push_back(stats);
+	}
+	return result;
+}
+
+
+void RemoteCrate::StartTrace() {
+	EmptyMessage request;
+	EmptyReply reply;
+	grpc::ClientContext context;
 
-	AsyncClientCall *call = new AsyncClientCall;
-	call->type = 2;
+	grpc::Status status = stub_->StartTrace(&context, request, &reply);
 
-	call->reader = stub_->PrepareAsyncStopRun(
-		&call->context, request, &completion_queue_
-	);
-	call->reader->StartCall();
-	call->reader->Finish(&call->reply, &call->status, (void*)call);
+	CheckStatus(status, reply);
 }
 
 
-void RemoteCrate::SigIntHandler(int) {
-	std::cout << "\nYou press Ctrl+C to stop list mode run." << std::endl;
-	instance_->StopRun();
+void RemoteCrate::StopTrace(const std::string &path) {
+	TraceRequest request;
+	request.set_path(path);
+
+	EmptyReply reply;
+	grpc::ClientContext context;
+
+	grpc::Status status = stub_->StopTrace(&context, request, &reply);
+
+	CheckStatus(status, reply);
 }
 
 
@@ -0,0 +1,212 @@
+#include "include/replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include "include/data_writer.h"
+#include "include/error.h"
+#include "include/mapped_file.h"
+#include "include/run_index.h"
+#include "include/trace.h"
+#include "include/trace_codec.h"
+#include "include/verify.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+std::shared_ptr<Pipeline> BuildRunPipeline(
+	std::shared_ptr<RateMonitor> monitor,
+	std::shared_ptr<EventFilter> filter,
+	std::shared_ptr<TraceReducer> reducer,
+	bool packed
+) {
+	// events are always decoded for the index, even without stages
+	auto pipeline = std::make_shared<Pipeline>();
+	// count the input rates before any event is dropped
+	if (monitor) {
+		pipeline->AddStage(monitor);
+	}
+	// filter first so only the kept traces are cut, and encode at last
+	if (filter) {
+		pipeline->AddStage(filter);
+	}
+	if (reducer) {
+		pipeline->AddStage(reducer);
+	}
+	if (packed) {
+		pipeline->AddStage(std::make_shared<TraceEncoder>());
+	}
+	return pipeline;
+}
+
+
+/// replaying state of a data file
+struct ReplayFile {
+	std::unique_ptr<MappedFile> file;
+	unsigned short module;
+	// next word to read
+	uint64_t position;
+	// next event header to read timestamp from, the end of file if the
+	// data can't be framed
+	uint64_t next_event;
+	// end of the next block and the latest timestamp of events in it
+	uint64_t block_end;
+	uint64_t block_time;
+};
+
+
+/// @brief find the end of the next block and its timestamp
+///
+/// @param[in,out] replay replaying state of file
+/// @param[in] block_words words of a block
+///
+static void NextBlock(ReplayFile &replay, size_t block_words) {
+	const uint32_t *words = replay.file->Words();
+	const uint64_t size = replay.file->WordSize();
+	replay.block_end = std::min(replay.position + block_words, size);
+	while (
+		replay.next_event < replay.block_end
+		&& replay.next_event + kMinHeaderLength <= size
+	) {
+		const uint32_t *event = words + replay.next_event;
+		uint32_t header_length = (event[0] >> kHeaderLengthShift) & kHeaderLengthMask;
+		uint32_t event_length = (event[0] >> kEventLengthShift) & kEventLengthMask;
+		if (header_length < kMinHeaderLength || event_length < header_length) {
+			// keep the timing of the last valid event
+			replay.next_event = size;
+			break;
+		}
+		uint64_t time = event[1] | (uint64_t(event[2] & kTimeHighMask) << 32);
+		// timing never goes back
+		replay.block_time = std::max(replay.block_time, time);
+		replay.next_event += event_length;
+	}
+}
+
+
+ReplayResult ReplayRun(
+	const std::vector<std::string> &files,
+	const std::string &output,
+	const ReplayOptions &options
+) {
+	TraceSpan trace_span("ReplayRun");
+	if (options.speed < 0) {
+		throw RXError("Speed of replay should not be negative.");
+	}
+	if (options.speed > 0 && !(options.tick > 0)) {
+		throw RXError("Tick of replay timing should be positive.");
+	}
+	std::filesystem::create_directories(output);
+	const size_t block_words = std::max(options.block_words, size_t(1));
+
+	// map input files and open output files as a run
+	std::vector<ReplayFile> replays;
+	std::vector<std::string> output_paths;
+	uint64_t first_time = std::numeric_limits<uint64_t>::max();
+	for (size_t i = 0; i < files.size(); ++i) {
+		int module = ModuleOfDataFile(files[i]);
+		ReplayFile replay{
+			std::make_unique<MappedFile>(files[i]),
+			static_cast<unsigned short>(module >= 0 ? module : i),
+			0, 0, 0, 0
+		};
+		replay.file->AdviseSequential();
+		std::filesystem::path path = std::filesystem::path(output)
+			/ std::filesystem::path(files[i]).filename();
+		path.replace_extension(options.packed ? ".rxp" : ".bin");
+		if (
+			std::filesystem::exists(path)
+			&& std::filesystem::equivalent(path, files[i])
+		) {
+			throw RXError("Replay output overwrites input " + files[i]);
+		}
+		output_paths.push_back(path.string());
+		// the earliest first event is the beginning of timing
+		if (replay.file->WordSize() >= kMinHeaderLength) {
+			const uint32_t *event = replay.file->Words();
+			first_time = std::min(
+				first_time, event[1] | (uint64_t(event[2] & kTimeHighMask) << 32)
+			);
+		}
+		NextBlock(replay, block_words);
+		replays.push_back(std::move(replay));
+	}
+	std::vector<std::ofstream> streams;
+	for (const auto &path : output_paths) {
+		streams.emplace_back(path, std::ios::binary | std::ios::trunc);
+		if (!streams.back().good()) {
+			throw RXError("Failed to open replay output " + path);
+		}
+	}
+
+	std::shared_ptr<Pipeline> pipeline =
+		BuildRunPipeline(nullptr, options.filter, options.reducer, options.packed);
+	DataWriter writer;
+	writer.SetPipeline(pipeline);
+	for (size_t i = 0; i < streams.size(); ++i) {
+		writer.AttachIndex(
+			&streams[i], std::make_shared<IndexWriter>(IndexPath(output_paths[i]))
+		);
+	}
+	writer.Start();
+
+	// write blocks of all files in order of time, like reading modules
+	ReplayResult result{files.size(), 0, 0, 0.0, 0.0, 0};
+	auto start = std::chrono::steady_clock::now();
+	while (true) {
+		size_t next = replays.size();
+		for (size_t i = 0; i < replays.size(); ++i) {
+			if (replays[i].position >= replays[i].block_end) continue;
+			if (next == replays.size() || replays[i].block_time < replays[next].block_time) {
+				next = i;
+			}
+		}
+		if (next == replays.size()) break;
+		ReplayFile &replay = replays[next];
+
+		if (options.speed > 0) {
+			uint64_t ticks = replay.block_time > first_time ?
+				replay.block_time - first_time : 0;
+			auto target = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double, std::nano>(ticks * options.tick / options.speed)
+			);
+			auto now = std::chrono::steady_clock::now();
+			if (now < target) {
+				std::this_thread::sleep_until(target);
+			} else {
+				result.max_lag = std::max(
+					result.max_lag, std::chrono::duration<double>(now - target).count()
+				);
+			}
+		}
+
+		const uint32_t *words = replay.file->Words();
+		std::vector<uint32_t> data(words + replay.position, words + replay.block_end);
+		result.bytes += data.size() * sizeof(uint32_t);
+		++result.blocks;
+		writer.Write(&streams[next], replay.module, std::move(data));
+		replay.position = replay.block_end;
+		NextBlock(replay, block_words);
+	}
+
+	// write the queued data, close indexes and streams
+	writer.Stop();
+	for (auto &stream : streams) {
+		stream.close();
+		if (stream.fail()) {
+			throw RXError("Failed to write replay output.");
+		}
+	}
+	result.seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start
+	).count();
+	result.invalid_blocks = pipeline->InvalidBlocks();
+	return result;
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,82 @@
+#include "include/rpc_metrics.h"
+
+#include <google/protobuf/message.h>
+
+#include "src/proto/control_crate.pb.h"
+
+namespace rxdaq {
+
+RpcMetricsInterceptor::RpcMetricsInterceptor(
+	grpc::experimental::ServerRpcInfo *info
+)
+: metrics_(Metrics::Instance().Rpc(RpcMethodName(info->method())))
+, start_(std::chrono::steady_clock::now())
+, outcome_(StatusType::UNDEFINED)
+, ended_(false) {
+
+	metrics_.Begin();
+}
+
+
+RpcMetricsInterceptor::~RpcMetricsInterceptor() {
+	if (!ended_) {
+		End(kRpcFailed);
+	}
+}
+
+
+void RpcMetricsInterceptor::Intercept(
+	grpc::experimental::InterceptorBatchMethods *methods
+) {
+	if (methods->QueryInterceptionHookPoint(
+		grpc::experimental::InterceptionHookPoints::PRE_SEND_MESSAGE
+	)) {
+		// every reply has status_type
+		const google::protobuf::Message *reply =
+			static_cast<const google::protobuf::Message*>(methods->GetSendMessage());
+		if (reply) {
+			const google::protobuf::FieldDescriptor *field =
+				reply->GetDescriptor()->FindFieldByName("status_type");
+			if (
+				field
+				&& field->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_ENUM
+			) {
+				int status = reply->GetReflection()->GetEnumValue(*reply, field);
+				outcome_ = status >= 0 && size_t(status) < kRpcFailed ?
+					status : size_t(StatusType::UNDEFINED);
+			}
+		}
+	}
+	if (methods->QueryInterceptionHookPoint(
+		grpc::experimental::InterceptionHookPoints::PRE_SEND_STATUS
+	)) {
+		End(methods->GetSendStatus().ok() ? outcome_ : kRpcFailed);
+	}
+	methods->Proceed();
+}
+
+
+void RpcMetricsInterceptor::End(size_t outcome) noexcept {
+	if (ended_) return;
+	ended_ = true;
+	metrics_.End(
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count(),
+		outcome
+	);
+}
+
+
+grpc::experimental::Interceptor*
+RpcMetricsInterceptorFactory::CreateServerInterceptor(
+	grpc::experimental::ServerRpcInfo *info
+) {
+	return new RpcMetricsInterceptor(info);
+}
+
+
+std::string RpcMethodName(const std::string &method) {
+	size_t slash = method.rfind('/');
+	return slash == std::string::npos ? method : method.substr(slash + 1);
+}
+
+}		// namespace rxdaq
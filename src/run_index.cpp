@@ -0,0 +1,265 @@
+#include "include/run_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+// "RXIX" in little endian
+const uint32_t kIndexMagic = 0x58495852;
+const uint32_t kIndexVersion = 2;
+// "RXIT" in little endian
+const uint32_t kIndexTrailerMagic = 0x54495852;
+
+/// header at the beginning of index file
+struct IndexHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t interval;
+	uint32_t entry_size;
+};
+
+/// trailer at the end of index file, written after the groups on closing,
+/// not present in version 1
+struct IndexTrailer {
+	uint64_t entries;
+	uint32_t group_size;
+	uint32_t magic;
+};
+
+
+/// @brief check whether an entry or a group may contain events matching query
+///
+/// @param[in] range entry or group
+/// @param[in] query conditions of events
+/// @returns true if may match
+///
+template<typename Range>
+bool MayMatch(const Range &range, const IndexQuery &query) {
+	return range.max_time >= query.begin
+		&& range.min_time <= query.end
+		&& (range.channels & query.channels);
+}
+
+
+IndexWriter::IndexWriter(const std::string &path, uint32_t interval)
+: stream_(path, std::ios::out | std::ios::binary | std::ios::trunc)
+, interval_(std::max(interval, 1u))
+, offset_(0)
+, entries_(0) {
+
+	if (!stream_.good()) {
+		throw RXError("Create index file " + path + " failed.");
+	}
+	IndexHeader header{
+		kIndexMagic, kIndexVersion, interval_, uint32_t(sizeof(IndexEntry))
+	};
+	stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+
+bool IndexWriter::Add(const EventBatch &events, size_t words) {
+	for (size_t begin = 0; begin < events.Size(); begin += interval_) {
+		const size_t end = std::min(events.Size(), begin + size_t(interval_));
+		IndexEntry entry{};
+		entry.offset = (offset_ + events.offset[begin]) * sizeof(uint32_t);
+		entry.min_time = events.time[begin];
+		entry.max_time = events.time[begin];
+		entry.words = events.offset[end-1] + events.length[end-1]
+			- events.offset[begin];
+		entry.events = end - begin;
+		for (size_t i = begin; i < end; ++i) {
+			entry.min_time = std::min(entry.min_time, events.time[i]);
+			entry.max_time = std::max(entry.max_time, events.time[i]);
+			entry.channels |= uint16_t(1u << events.channel[i]);
+		}
+		stream_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+		if (entries_ % kIndexGroupSize == 0) {
+			groups_.push_back(IndexGroup{entry.min_time, entry.max_time, 0, 0, 0});
+		}
+		IndexGroup &group = groups_.back();
+		group.min_time = std::min(group.min_time, entry.min_time);
+		group.max_time = std::max(group.max_time, entry.max_time);
+		group.channels |= entry.channels;
+		++group.entries;
+		++entries_;
+	}
+	offset_ += words;
+	return stream_.good();
+}
+
+
+bool IndexWriter::Close() {
+	if (!stream_.is_open()) return true;
+	stream_.write(
+		reinterpret_cast<const char*>(groups_.data()),
+		groups_.size() * sizeof(IndexGroup)
+	);
+	IndexTrailer trailer{entries_, kIndexGroupSize, kIndexTrailerMagic};
+	stream_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+	stream_.flush();
+	bool good = stream_.good();
+	stream_.close();
+	return good;
+}
+
+
+IndexFile::IndexFile(const std::string &path)
+: file_(path)
+, entries_(nullptr)
+, size_(0)
+, groups_(nullptr)
+, group_count_(0)
+, group_size_(0) {
+
+	IndexHeader header;
+	if (file_.Size() < sizeof(header)) {
+		throw RXError("File " + path + " is not a valid index file.");
+	}
+	const char *data = reinterpret_cast<const char*>(file_.Words());
+	memcpy(&header, data, sizeof(header));
+	if (
+		header.magic != kIndexMagic
+		|| header.entry_size != sizeof(IndexEntry)
+	) {
+		throw RXError("File " + path + " is not a valid index file.");
+	}
+	if (header.version != 1 && header.version != kIndexVersion) {
+		throw RXError(
+			"Index version " + std::to_string(header.version)
+			+ " of " + path + " is not supported."
+		);
+	}
+
+	entries_ = reinterpret_cast<const IndexEntry*>(data + sizeof(header));
+	const size_t size = file_.Size() - sizeof(header);
+	// ignore the last entry written partly
+	size_ = size / sizeof(IndexEntry);
+
+	IndexTrailer trailer;
+	if (header.version == 1 || size < sizeof(trailer)) return;
+	memcpy(&trailer, data + file_.Size() - sizeof(trailer), sizeof(trailer));
+	if (trailer.magic != kIndexTrailerMagic || trailer.group_size == 0) return;
+	const uint64_t groups =
+		(trailer.entries + trailer.group_size - 1) / trailer.group_size;
+	if (
+		trailer.entries > size / sizeof(IndexEntry)
+		|| trailer.entries * sizeof(IndexEntry) + groups * sizeof(IndexGroup)
+			+ sizeof(trailer) != size
+	) {
+		// not closed, so the trailer is just some entries
+		return;
+	}
+	size_ = trailer.entries;
+	groups_ = reinterpret_cast<const IndexGroup*>(
+		data + sizeof(header) + size_ * sizeof(IndexEntry)
+	);
+	group_count_ = groups;
+	group_size_ = trailer.group_size;
+}
+
+
+std::vector<size_t> IndexFile::Find(const IndexQuery &query) const {
+	std::vector<size_t> result;
+	if (!groups_) {
+		for (size_t i = 0; i < size_; ++i) {
+			if (MayMatch(entries_[i], query)) result.push_back(i);
+		}
+		return result;
+	}
+	for (size_t g = 0; g < group_count_; ++g) {
+		if (!MayMatch(groups_[g], query)) continue;
+		const size_t begin = g * group_size_;
+		const size_t end = std::min(size_, begin + groups_[g].entries);
+		for (size_t i = begin; i < end; ++i) {
+			if (MayMatch(entries_[i], query)) result.push_back(i);
+		}
+	}
+	return result;
+}
+
+
+std::vector<IndexEntry> ReadIndex(const std::string &path) {
+	IndexFile index(path);
+	std::vector<IndexEntry> entries;
+	entries.reserve(index.Size());
+	for (size_t i = 0; i < index.Size(); ++i) {
+		entries.push_back(index[i]);
+	}
+	return entries;
+}
+
+
+std::vector<size_t> FindEntries(
+	const std::vector<IndexEntry> &entries,
+	const IndexQuery &query
+) {
+	std::vector<size_t> result;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (MayMatch(entries[i], query)) result.push_back(i);
+	}
+	return result;
+}
+
+
+QueryResult QueryRunFile(const std::string &data_path, const IndexQuery &query) {
+	TraceSpan trace_span("QueryRunFile");
+	IndexFile entries(IndexPath(data_path));
+	std::vector<size_t> found = entries.Find(query);
+
+	std::ifstream fin(data_path, std::ios::in | std::ios::binary);
+	if (!fin.good()) {
+		throw RXError("Open data file " + data_path + " failed.");
+	}
+
+	QueryResult result{{}, 0, 0, 0};
+	std::vector<uint32_t> words;
+	EventBatch events;
+	for (size_t i = 0; i < found.size();) {
+		// read adjacent entries together
+		uint64_t offset = entries[found[i]].offset;
+		uint64_t end = offset + uint64_t(entries[found[i]].words) * sizeof(uint32_t);
+		for (++i; i < found.size() && entries[found[i]].offset == end; ++i) {
+			end += uint64_t(entries[found[i]].words) * sizeof(uint32_t);
+		}
+
+		words.resize((end - offset) / sizeof(uint32_t));
+		fin.seekg(offset, std::ios::beg);
+		fin.read(reinterpret_cast<char*>(words.data()), end - offset);
+		if (uint64_t(fin.gcount()) != end - offset) {
+			throw RXError(
+				"Read data file " + data_path + " at "
+				+ std::to_string(offset) + " failed."
+			);
+		}
+		++result.regions;
+		result.bytes_read += end - offset;
+
+		events.Clear();
+		if (DecodeListMode(words.data(), words.size(), events) != words.size()) {
+			throw RXError(
+				"Region at " + std::to_string(offset) + " of " + data_path
+				+ " ends with incomplete event."
+			);
+		}
+		for (size_t j = 0; j < events.Size(); ++j) {
+			if (
+				events.time[j] < query.begin
+				|| events.time[j] > query.end
+				|| !((query.channels >> events.channel[j]) & 1)
+			) {
+				continue;
+			}
+			const uint32_t *event = words.data() + events.offset[j];
+			result.words.insert(result.words.end(), event, event + events.length[j]);
+			++result.events;
+		}
+	}
+	return result;
+}
+
+}		// namespace rxdaq
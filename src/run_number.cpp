@@ -0,0 +1,194 @@
+#include "include/run_number.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace rxdaq {
+
+// record is 10 digits and a newline
+const size_t kRecordSize = 11;
+// compact the log after this number of records
+const size_t kMaxRecords = 1024;
+
+
+/// @brief format the run number as a record
+///
+/// @param[in] number run number
+/// @param[out] record buffer to write, at least kRecordSize+1 bytes
+///
+void FormatRecord(unsigned int number, char *record) {
+	snprintf(record, kRecordSize+1, "%010u\n", number);
+}
+
+
+/// @brief parse record
+///
+/// @param[in] record record to parse, kRecordSize bytes
+/// @param[out] number parsed run number
+/// @returns true if record is valid, false otherwise
+///
+bool ParseRecord(const char *record, unsigned int &number) {
+	if (record[kRecordSize-1] != '\n') return false;
+	unsigned long long value = 0;
+	for (size_t i = 0; i < kRecordSize-1; ++i) {
+		if (record[i] < '0' || record[i] > '9') return false;
+		value = value * 10 + (record[i] - '0');
+	}
+	if (value > 0xffffffffull) return false;
+	number = static_cast<unsigned int>(value);
+	return true;
+}
+
+
+/// @brief write the whole buffer and sync file to disk
+///
+/// @param[in] fd file descriptor
+/// @param[in] buffer buffer to write
+/// @param[in] size size of buffer
+/// @returns true on success, false otherwise
+///
+bool WriteAndSync(int fd, const char *buffer, size_t size) {
+	while (size) {
+		ssize_t written = write(fd, buffer, size);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		buffer += written;
+		size -= written;
+	}
+	return fsync(fd) == 0;
+}
+
+
+/// @brief sync directory of the path, so that renaming is durable
+///
+/// @param[in] path path of file in the directory
+///
+void SyncDirectory(const std::string &path) {
+	size_t pos = path.find_last_of('/');
+	std::string dir = pos == std::string::npos ? "." : path.substr(0, pos+1);
+	int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return;
+	fsync(fd);
+	close(fd);
+}
+
+
+RunNumberStore::RunNumberStore() noexcept
+: fd_(-1), number_(0), records_(0) {
+}
+
+
+RunNumberStore::~RunNumberStore() {
+	Close();
+}
+
+
+void RunNumberStore::Open(const std::string &path, unsigned int initial) {
+	Close();
+	path_ = path;
+	fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd_ < 0) {
+		throw std::runtime_error("Open file \"" + path_ + "\" failed.\n");
+	}
+
+	// drop the torn record written by a crash
+	struct stat status;
+	if (fstat(fd_, &status) != 0) {
+		Close();
+		throw std::runtime_error("Stat file \"" + path_ + "\" failed.\n");
+	}
+	records_ = status.st_size / kRecordSize;
+	if (records_ * kRecordSize != size_t(status.st_size)) {
+		if (ftruncate(fd_, records_ * kRecordSize) != 0) {
+			Close();
+			throw std::runtime_error(
+				"Truncate file \"" + path_ + "\" failed.\n"
+			);
+		}
+	}
+
+	// search for the last valid record
+	bool found = false;
+	unsigned int stored = 0;
+	char record[kRecordSize];
+	for (size_t i = records_; i > 0 && !found; --i) {
+		ssize_t size = pread(fd_, record, kRecordSize, (i-1) * kRecordSize);
+		found = size == ssize_t(kRecordSize) && ParseRecord(record, stored);
+	}
+
+	// number in config is larger if user changed it by hand
+	number_ = found && stored >= initial ? stored : initial;
+	if (!found || stored != number_) {
+		Store(number_);
+	}
+}
+
+
+void RunNumberStore::Close() noexcept {
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+}
+
+
+void RunNumberStore::Store(unsigned int number) {
+	if (fd_ < 0) {
+		throw std::runtime_error("Run number store is not opened.\n");
+	}
+	number_ = number;
+	if (records_ >= kMaxRecords) {
+		Compact();
+	} else {
+		Append(number);
+	}
+}
+
+
+void RunNumberStore::Append(unsigned int number) {
+	char record[kRecordSize+1];
+	FormatRecord(number, record);
+	if (!WriteAndSync(fd_, record, kRecordSize)) {
+		throw std::runtime_error(
+			"Write file \"" + path_ + "\" failed: "
+			+ std::string(strerror(errno)) + ".\n"
+		);
+	}
+	++records_;
+}
+
+
+void RunNumberStore::Compact() {
+	const std::string temp_path = path_ + ".tmp";
+	int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("Open file \"" + temp_path + "\" failed.\n");
+	}
+	char record[kRecordSize+1];
+	FormatRecord(number_, record);
+	bool success = WriteAndSync(fd, record, kRecordSize);
+	close(fd);
+	if (!success || rename(temp_path.c_str(), path_.c_str()) != 0) {
+		unlink(temp_path.c_str());
+		throw std::runtime_error("Compact file \"" + path_ + "\" failed.\n");
+	}
+	SyncDirectory(path_);
+
+	// reopen the renamed file
+	Close();
+	fd_ = open(path_.c_str(), O_RDWR | O_APPEND);
+	if (fd_ < 0) {
+		throw std::runtime_error("Open file \"" + path_ + "\" failed.\n");
+	}
+	records_ = 1;
+}
+
+}		// namespace rxdaq
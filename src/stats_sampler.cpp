@@ -0,0 +1,208 @@
+#include "include/stats_sampler.h"
+
+#include <algorithm>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+std::vector<ChannelSample> ComputeSamples(
+	const ModuleStats &previous,
+	const ModuleStats &current,
+	double time
+) {
+	std::vector<ChannelSample> result;
+	for (size_t i = 0; i < current.channels.size(); ++i) {
+		ChannelStats last = i < previous.channels.size() ?
+			previous.channels[i] : ChannelStats{0.0, 0.0, 0, 0};
+		const ChannelStats &now = current.channels[i];
+		ChannelSample sample{
+			time, current.module, static_cast<unsigned short>(i),
+			now.real_time - last.real_time, now.live_time - last.live_time,
+			0.0, 0.0, 0.0, 0.0
+		};
+		// counters go back only if the module started a new run
+		uint64_t input = now.input_counts >= last.input_counts ?
+			now.input_counts - last.input_counts : now.input_counts;
+		uint64_t output = now.output_counts >= last.output_counts ?
+			now.output_counts - last.output_counts : now.output_counts;
+		if (sample.live_time > 0) {
+			sample.input_rate = input / sample.live_time;
+		}
+		if (sample.real_time > 0) {
+			sample.output_rate = output / sample.real_time;
+			sample.live_fraction = sample.live_time / sample.real_time;
+		}
+		if (sample.input_rate > 0) {
+			sample.dead_fraction = std::max(
+				0.0, 1.0 - sample.output_rate / sample.input_rate
+			);
+		}
+		result.push_back(sample);
+	}
+	return result;
+}
+
+
+StatsSampler::StatsSampler(StatsReader reader) noexcept
+: reader_(reader)
+, running_(false)
+, interval_(0.0)
+, samples_(0)
+, errors_(0) {
+
+	for (auto &due : due_) {
+		due.store(false, std::memory_order_relaxed);
+	}
+}
+
+
+StatsSampler::~StatsSampler() {
+	Stop();
+}
+
+
+void StatsSampler::Start(
+	const std::vector<unsigned short> &modules,
+	double interval,
+	const std::string &path
+) {
+	Stop();
+	if (!(interval > 0)) return;
+
+	std::ofstream output(path, std::ios::trunc);
+	if (!output.good()) {
+		throw RXError("Failed to open run statistics file " + path);
+	}
+	output << "time,module,channel,real_time,live_time,"
+		"input_rate,output_rate,live_fraction,dead_fraction\n";
+
+	std::lock_guard<std::mutex> guard(lock_);
+	output_ = std::move(output);
+	modules_ = modules;
+	interval_ = interval;
+	start_ = std::chrono::steady_clock::now();
+	pending_.clear();
+	for (auto &previous : previous_) {
+		previous.channels.clear();
+	}
+	samples_ = 0;
+	errors_ = 0;
+	running_ = true;
+	thread_ = std::thread(&StatsSampler::Loop, this);
+}
+
+
+void StatsSampler::Read(unsigned short module) {
+	TraceSpan trace_span("StatsSampler::Read");
+	due_[module].store(false, std::memory_order_relaxed);
+	try {
+		ModuleStats stats = reader_(module);
+		stats.module = module;
+		double time = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start_
+		).count();
+		std::lock_guard<std::mutex> guard(lock_);
+		pending_.emplace_back(std::move(stats), time);
+	} catch (const std::exception&) {
+		// statistics are not worth stopping the run
+		std::lock_guard<std::mutex> guard(lock_);
+		++errors_;
+	}
+	cv_.notify_all();
+}
+
+
+void StatsSampler::Finish() {
+	std::vector<unsigned short> modules;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		if (!running_) return;
+		modules = modules_;
+	}
+	for (const auto &m : modules) {
+		Read(m);
+	}
+	Stop();
+}
+
+
+void StatsSampler::Stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		running_ = false;
+	}
+	cv_.notify_all();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+	for (auto &due : due_) {
+		due.store(false, std::memory_order_relaxed);
+	}
+	if (output_.is_open()) {
+		output_.close();
+	}
+}
+
+
+uint64_t StatsSampler::Samples() const {
+	std::lock_guard<std::mutex> guard(lock_);
+	return samples_;
+}
+
+
+uint64_t StatsSampler::Errors() const {
+	std::lock_guard<std::mutex> guard(lock_);
+	return errors_;
+}
+
+
+void StatsSampler::Loop() {
+	auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(interval_)
+	);
+	auto next = start_ + period;
+	std::unique_lock<std::mutex> lock(lock_);
+	while (true) {
+		cv_.wait_until(lock, next, [this]() {
+			return !running_ || !pending_.empty();
+		});
+		// write outside the lock, the readout thread may be queuing
+		while (!pending_.empty()) {
+			auto stats = std::move(pending_.front());
+			pending_.pop_front();
+			lock.unlock();
+			Write(stats.first, stats.second);
+			lock.lock();
+			++samples_;
+		}
+		if (!running_) break;
+		auto now = std::chrono::steady_clock::now();
+		if (now >= next) {
+			for (const auto &m : modules_) {
+				due_[m].store(true, std::memory_order_release);
+			}
+			// skip the missed samples if readout was busy
+			next += period;
+			if (next <= now) {
+				next = now + period;
+			}
+		}
+	}
+	output_.flush();
+}
+
+
+void StatsSampler::Write(const ModuleStats &stats, double time) {
+	for (const auto &sample : ComputeSamples(previous_[stats.module], stats, time)) {
+		output_ << sample.time << "," << sample.module << ","
+			<< sample.channel << "," << sample.real_time << ","
+			<< sample.live_time << "," << sample.input_rate << ","
+			<< sample.output_rate << "," << sample.live_fraction << ","
+			<< sample.dead_fraction << "\n";
+	}
+	previous_[stats.module] = stats;
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,105 @@
+#include "include/timing.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace rxdaq {
+
+//-----------------------------------------------------------------------------
+// 								TimingReport
+//-----------------------------------------------------------------------------
+
+void TimingReport::Record(
+	const std::string &phase,
+	int module,
+	double milliseconds
+) {
+	std::lock_guard<std::mutex> guard(lock_);
+	timings_.push_back({phase, module, milliseconds});
+}
+
+
+void TimingReport::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	timings_.clear();
+}
+
+
+std::vector<PhaseTiming> TimingReport::Timings() const {
+	std::lock_guard<std::mutex> guard(lock_);
+	return timings_;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								ScopedTimer
+//-----------------------------------------------------------------------------
+
+ScopedTimer::ScopedTimer(
+	TimingReport &report,
+	const std::string &phase,
+	int module
+) noexcept
+: report_(report), phase_(phase), module_(module)
+, start_(std::chrono::steady_clock::now()) {
+}
+
+
+ScopedTimer::~ScopedTimer() {
+	std::chrono::duration<double, std::milli> duration =
+		std::chrono::steady_clock::now() - start_;
+	report_.Record(phase_, module_, duration.count());
+}
+
+
+//-----------------------------------------------------------------------------
+// 								related functions
+//-----------------------------------------------------------------------------
+
+std::string TimingInfo(const std::vector<PhaseTiming> &timings) {
+	if (timings.empty()) return "";
+
+	// phases in order of first appearance, columns in order of module
+	std::vector<std::string> phases;
+	std::vector<int> modules;
+	std::map<std::pair<std::string, int>, double> table;
+	for (const auto &timing : timings) {
+		if (std::find(phases.begin(), phases.end(), timing.phase) == phases.end()) {
+			phases.push_back(timing.phase);
+		}
+		if (
+			std::find(modules.begin(), modules.end(), timing.module)
+				== modules.end()
+		) {
+			modules.push_back(timing.module);
+		}
+		// the same phase may run several times
+		table[std::make_pair(timing.phase, timing.module)] += timing.milliseconds;
+	}
+	std::sort(modules.begin(), modules.end());
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << std::left << std::setw(16) << "phase(ms)" << std::right;
+	for (const auto &m : modules) {
+		ss << std::setw(10) << (m == kCratePhase ? "crate" : "m" + std::to_string(m));
+	}
+	ss << "\n";
+	for (const auto &phase : phases) {
+		ss << std::left << std::setw(16) << phase << std::right;
+		for (const auto &m : modules) {
+			auto search = table.find(std::make_pair(phase, m));
+			if (search == table.end()) {
+				ss << std::setw(10) << "-";
+			} else {
+				ss << std::setw(10) << search->second;
+			}
+		}
+		ss << "\n";
+	}
+	return ss.str();
+}
+
+}		// namespace rxdaq
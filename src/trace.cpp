@@ -0,0 +1,198 @@
+#include "include/trace.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "include/error.h"
+
+namespace rxdaq {
+
+uint64_t TraceTicks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+#endif
+}
+
+
+/// Ring and thread id of the current thread, gives the ring back to tracer
+/// when thread exits.
+struct TraceBufferHolder {
+	Tracer::Ring *ring = nullptr;
+	uint32_t thread = 0;
+
+	~TraceBufferHolder() {
+		if (ring) Tracer::Instance().ReleaseRing(ring);
+	}
+};
+
+
+//-----------------------------------------------------------------------------
+// 								Tracer
+//-----------------------------------------------------------------------------
+
+Tracer& Tracer::Instance() {
+	static Tracer tracer;
+	return tracer;
+}
+
+
+Tracer::Tracer() noexcept
+: enabled_(false), next_thread_(0), epoch_(1)
+, start_ticks_(TraceTicks()), start_time_(std::chrono::steady_clock::now()) {
+}
+
+
+void Tracer::Enable() {
+	std::lock_guard<std::mutex> guard(rings_lock_);
+	// rings are cleared by their owners, events of old epoch are not exported
+	epoch_.fetch_add(1, std::memory_order_release);
+	start_time_ = std::chrono::steady_clock::now();
+	start_ticks_ = TraceTicks();
+	enabled_.store(true, std::memory_order_release);
+}
+
+
+void Tracer::Disable() {
+	enabled_.store(false, std::memory_order_release);
+}
+
+
+void Tracer::Record(const char *name, TraceEventType type) noexcept {
+	thread_local TraceBufferHolder holder;
+	if (!holder.ring) {
+		holder.ring = AcquireRing();
+		if (!holder.ring) return;
+		holder.thread = next_thread_.fetch_add(1, std::memory_order_relaxed);
+	}
+	Ring *ring = holder.ring;
+	uint64_t epoch = epoch_.load(std::memory_order_acquire);
+	size_t index = 0;
+	if (ring->epoch.load(std::memory_order_relaxed) == epoch) {
+		index = ring->written.load(std::memory_order_relaxed);
+	} else {
+		ring->written.store(0, std::memory_order_relaxed);
+		ring->epoch.store(epoch, std::memory_order_release);
+	}
+	ring->events[index & (kRingCapacity-1)] =
+		TraceEvent{name, TraceTicks(), holder.thread, type};
+	ring->written.store(index + 1, std::memory_order_release);
+}
+
+
+Tracer::Ring* Tracer::AcquireRing() noexcept {
+	try {
+		std::lock_guard<std::mutex> guard(rings_lock_);
+		if (!free_rings_.empty()) {
+			Ring *ring = free_rings_.back();
+			free_rings_.pop_back();
+			return ring;
+		}
+		rings_.push_back(std::make_unique<Ring>());
+		return rings_.back().get();
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+
+void Tracer::ReleaseRing(Ring *ring) noexcept {
+	try {
+		std::lock_guard<std::mutex> guard(rings_lock_);
+		free_rings_.push_back(ring);
+	} catch (...) {
+		// ring is leaked but still exported
+	}
+}
+
+
+std::vector<TraceEvent> Tracer::Events() const {
+	std::vector<TraceEvent> result;
+	std::lock_guard<std::mutex> guard(rings_lock_);
+	// epoch only changes in Enable, which waits for the lock
+	uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+	for (const auto &ring : rings_) {
+		if (ring->epoch.load(std::memory_order_acquire) != epoch) continue;
+		size_t written = ring->written.load(std::memory_order_acquire);
+		size_t first = written > kRingCapacity ? written - kRingCapacity : 0;
+		size_t begin = result.size();
+		for (size_t i = first; i < written; ++i) {
+			result.push_back(ring->events[i & (kRingCapacity-1)]);
+		}
+		// the owner may have overwritten the oldest slots while copying, the
+		// slot of event index is reused by event index + capacity
+		std::atomic_thread_fence(std::memory_order_acquire);
+		size_t now = ring->written.load(std::memory_order_relaxed);
+		size_t valid = now >= kRingCapacity ? now - kRingCapacity + 1 : 0;
+		if (valid > first) {
+			size_t overwritten = std::min(valid, written) - first;
+			result.erase(
+				result.begin() + begin,
+				result.begin() + begin + overwritten
+			);
+		}
+	}
+	std::stable_sort(
+		result.begin(), result.end(),
+		[](const TraceEvent &a, const TraceEvent &b) {
+			return a.thread < b.thread
+				|| (a.thread == b.thread && a.ticks < b.ticks);
+		}
+	);
+	return result;
+}
+
+
+double Tracer::TicksPerMicrosecond() const {
+	uint64_t ticks = TraceTicks();
+	std::chrono::duration<double, std::micro> duration =
+		std::chrono::steady_clock::now() - start_time_;
+	if (duration.count() <= 0.0 || ticks <= start_ticks_) {
+		return 1.0;
+	}
+	return double(ticks - start_ticks_) / duration.count();
+}
+
+
+std::string Tracer::ChromeTrace() const {
+	std::vector<TraceEvent> events = Events();
+	double ticks_per_us = TicksPerMicrosecond();
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "{\"traceEvents\":[";
+	for (size_t i = 0; i < events.size(); ++i) {
+		const TraceEvent &event = events[i];
+		double timestamp = event.ticks > start_ticks_
+			? double(event.ticks - start_ticks_) / ticks_per_us
+			: 0.0;
+		ss << (i ? ",\n" : "\n")
+			<< "{\"name\":\"" << event.name << "\""
+			<< ",\"ph\":\"" << (event.type == TraceEventType::kBegin ? "B" : "E")
+			<< "\",\"ts\":" << timestamp
+			<< ",\"pid\":0,\"tid\":" << event.thread << "}";
+	}
+	ss << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return ss.str();
+}
+
+
+void Tracer::Export(const std::string &path) const {
+	std::ofstream fout(path);
+	if (!fout.good()) {
+		throw UserError("Open file " + path + " failed.");
+	}
+	fout << ChromeTrace();
+	fout.close();
+}
+
+}		// namespace rxdaq
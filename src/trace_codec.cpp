@@ -0,0 +1,286 @@
+#include "include/trace_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+// values packed in each of the 4 lanes
+const size_t kLaneValues = kTraceBlockSamples / 4;
+// largest width of zigzag encoded 16 bits delta
+const uint32_t kMaxWidth = 17;
+// bits of width in the first word of block
+const uint32_t kWidthShift = 16;
+const uint32_t kWidthMask = 0x1f;
+// reserved bits in the first word of block, between width and flag
+const uint32_t kReservedMask = 0x7fe00000;
+
+
+/// @brief pack 128 values in 4 interleaved lanes, each lane is packed
+/// 	from the lower bits, so the 4 lanes are processed in the same way
+///
+/// @param[in] values values to pack, smaller than 2^width
+/// @param[in] width bits of each value
+/// @param[out] output place to store 4 * width words
+///
+void PackBlock(const uint32_t *values, uint32_t width, uint32_t *output) {
+	uint32_t acc[4] = {0, 0, 0, 0};
+	uint32_t shift = 0;
+	for (size_t i = 0; i < kLaneValues; ++i) {
+		const uint32_t *v = values + i * 4;
+		for (size_t j = 0; j < 4; ++j) {
+			acc[j] |= v[j] << shift;
+		}
+		shift += width;
+		if (shift >= 32) {
+			shift -= 32;
+			for (size_t j = 0; j < 4; ++j) {
+				output[j] = acc[j];
+			}
+			output += 4;
+			for (size_t j = 0; j < 4; ++j) {
+				acc[j] = shift ? v[j] >> (width - shift) : 0;
+			}
+		}
+	}
+}
+
+
+/// @brief unpack 128 values packed by PackBlock
+///
+/// @param[in] words packed words
+/// @param[in] width bits of each value
+/// @param[out] values place to store 128 values
+///
+void UnpackBlock(const uint32_t *words, uint32_t width, uint32_t *values) {
+	const uint32_t mask = (1u << width) - 1;
+	uint32_t shift = 0;
+	for (size_t i = 0; i < kLaneValues; ++i) {
+		uint32_t *v = values + i * 4;
+		for (size_t j = 0; j < 4; ++j) {
+			v[j] = words[j] >> shift;
+		}
+		if (shift + width > 32) {
+			for (size_t j = 0; j < 4; ++j) {
+				v[j] |= words[4+j] << (32 - shift);
+			}
+		}
+		for (size_t j = 0; j < 4; ++j) {
+			v[j] &= mask;
+		}
+		shift += width;
+		if (shift >= 32) {
+			shift -= 32;
+			words += 4;
+		}
+	}
+}
+
+
+size_t EncodeTrace(
+	const uint16_t *samples,
+	size_t size,
+	std::vector<uint32_t> &output
+) {
+	const size_t start = output.size();
+	uint32_t values[kTraceBlockSamples];
+	for (size_t begin = 0; begin < size; begin += kTraceBlockSamples) {
+		const size_t count = std::min(kTraceBlockSamples, size - begin);
+		const uint16_t *block = samples + begin;
+
+		// zigzag encoded delta, the first one is always 0
+		values[0] = 0;
+		uint32_t bits = 0;
+		for (size_t i = 1; i < count; ++i) {
+			int32_t delta = int32_t(block[i]) - int32_t(block[i-1]);
+			values[i] = (uint32_t(delta) << 1) ^ uint32_t(delta >> 31);
+			bits |= values[i];
+		}
+		std::fill(values + count, values + kTraceBlockSamples, 0);
+		uint32_t width = 0;
+		while (bits >> width) ++width;
+
+		output.push_back(uint32_t(block[0]) | (width << kWidthShift) | kTraceEncodedFlag);
+		size_t offset = output.size();
+		output.resize(offset + width * 4);
+		PackBlock(values, width, output.data() + offset);
+	}
+	return output.size() - start;
+}
+
+
+size_t DecodeTraceBlock(
+	const uint32_t *words,
+	size_t size,
+	size_t samples,
+	uint16_t *output
+) {
+	if (size == 0 || samples == 0 || samples > kTraceBlockSamples) {
+		throw RXError("Invalid trace block to decode.");
+	}
+	if (!(words[0] & kTraceEncodedFlag) || (words[0] & kReservedMask)) {
+		throw RXError("Trace block without encoded flag or with reserved bits.");
+	}
+	uint32_t width = (words[0] >> kWidthShift) & kWidthMask;
+	if (width > kMaxWidth) {
+		throw RXError("Invalid bit width " + std::to_string(width) + " of trace block.");
+	}
+	size_t length = 1 + width * 4;
+	if (length > size) {
+		throw RXError("Trace block is truncated.");
+	}
+
+	uint32_t values[kTraceBlockSamples];
+	UnpackBlock(words + 1, width, values);
+	uint16_t sample = words[0] & 0xffff;
+	for (size_t i = 0; i < samples; ++i) {
+		int32_t delta = int32_t(values[i] >> 1) ^ -int32_t(values[i] & 1);
+		sample += delta;
+		output[i] = sample;
+	}
+	return length;
+}
+
+
+size_t DecodeTrace(
+	const uint32_t *words,
+	size_t size,
+	size_t samples,
+	uint16_t *output
+) {
+	size_t position = 0;
+	for (size_t begin = 0; begin < samples; begin += kTraceBlockSamples) {
+		position += DecodeTraceBlock(
+			words + position,
+			size - position,
+			std::min(kTraceBlockSamples, samples - begin),
+			output + begin
+		);
+	}
+	return position;
+}
+
+
+bool IsEncodedTrace(
+	const uint32_t *event,
+	uint32_t length,
+	uint32_t header_length,
+	uint32_t trace_length
+) {
+	return trace_length > 0
+		&& trace_length % 2 == 0
+		&& length > header_length
+		&& length < header_length + trace_length / 2
+		&& (event[header_length] & kTraceEncodedFlag);
+}
+
+
+std::vector<uint32_t> UnpackListMode(const std::vector<uint32_t> &packed) {
+	EventBatch events;
+	if (DecodeListMode(packed.data(), packed.size(), events) != packed.size()) {
+		throw RXError("Packed data ends with incomplete event.");
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(packed.size() * 2);
+	std::vector<uint16_t> samples;
+	for (size_t i = 0; i < events.Size(); ++i) {
+		const uint32_t *event = packed.data() + events.offset[i];
+		const uint32_t header_length = events.header_length[i];
+		const uint32_t trace_length = events.trace_length[i];
+		const uint32_t encoded = events.length[i] - header_length;
+		const size_t offset = result.size();
+		result.insert(result.end(), event, event + events.length[i]);
+		// events not encoded are kept as they are
+		if (!IsEncodedTrace(event, events.length[i], header_length, trace_length)) {
+			continue;
+		}
+
+		samples.resize(trace_length);
+		if (
+			DecodeTrace(event + header_length, encoded, trace_length, samples.data())
+			!= encoded
+		) {
+			throw RXError(
+				"Encoded trace of event at word " + std::to_string(events.offset[i])
+				+ " doesn't match the event length."
+			);
+		}
+		uint32_t length = header_length + trace_length / 2;
+		result.resize(offset + length);
+		uint32_t *header = result.data() + offset;
+		header[0] = (header[0] & ~(kEventLengthMask << kEventLengthShift))
+			| (length << kEventLengthShift);
+		memcpy(header + header_length, samples.data(), trace_length * sizeof(uint16_t));
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								TraceEncoder
+//-----------------------------------------------------------------------------
+
+void TraceEncoder::Process(DataBlock &block) {
+	TraceSpan trace_span("TraceEncoder::Process");
+	EventBatch &events = block.events;
+	output_.clear();
+	output_.reserve(block.words.size());
+
+	for (size_t i = 0; i < events.Size(); ++i) {
+		const uint32_t *event = block.words.data() + events.offset[i];
+		const uint32_t header_length = events.header_length[i];
+		const uint32_t trace_length = events.trace_length[i];
+		const uint32_t offset = output_.size();
+		events.offset[i] = offset;
+
+		if (!block.keep[i]) {
+			// dropped later, no need to copy
+			events.length[i] = 0;
+			continue;
+		}
+		if (
+			trace_length == 0
+			|| trace_length % 2
+			|| events.length[i] != header_length + trace_length / 2
+		) {
+			if (IsEncodedTrace(event, events.length[i], header_length, trace_length)) {
+				// shorter than its trace and would be read as encoded, the
+				// event is broken and can't be written unambiguously
+				block.keep[i] = 0;
+				events.length[i] = 0;
+				continue;
+			}
+			// nothing to encode, or unknown words after header
+			output_.insert(output_.end(), event, event + events.length[i]);
+			continue;
+		}
+
+		output_.insert(output_.end(), event, event + header_length);
+		samples_.resize(trace_length);
+		memcpy(
+			samples_.data(), event + header_length,
+			trace_length * sizeof(uint16_t)
+		);
+		uint32_t length = header_length
+			+ EncodeTrace(samples_.data(), trace_length, output_);
+		if (length >= events.length[i]) {
+			// not shorter, keep the raw trace so it's never taken as encoded
+			output_.resize(offset);
+			output_.insert(output_.end(), event, event + events.length[i]);
+			continue;
+		}
+		uint32_t *header = output_.data() + offset;
+		header[0] = (header[0] & ~(kEventLengthMask << kEventLengthShift))
+			| (length << kEventLengthShift);
+		events.length[i] = length;
+	}
+	block.words.swap(output_);
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,258 @@
+#include "include/trace_reducer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "include/error.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+TraceReducer::TraceReducer(const TraceReduction &reduction) noexcept
+: reduction_(reduction), stats_{0, 0, 0, 0} {
+}
+
+
+void TraceReducer::Process(DataBlock &block) {
+	TraceSpan trace_span("TraceReducer::Process");
+	EventBatch &events = block.events;
+	TraceReductionStats stats{0, 0, 0, 0};
+	output_.clear();
+	output_.reserve(block.words.size());
+
+	for (size_t i = 0; i < events.Size(); ++i) {
+		const uint32_t *event = block.words.data() + events.offset[i];
+		const uint32_t header_length = events.header_length[i];
+		const uint32_t trace_length = events.trace_length[i];
+		const uint32_t offset = output_.size();
+
+		if (!block.keep[i]) {
+			// dropped later, no need to copy
+			events.offset[i] = offset;
+			events.length[i] = 0;
+			continue;
+		}
+		++stats.events;
+		stats.input_samples += trace_length;
+
+		if (
+			trace_length == 0
+			|| events.length[i] != header_length + trace_length / 2
+		) {
+			// nothing to cut, or unknown words after header
+			output_.insert(output_.end(), event, event + events.length[i]);
+			events.offset[i] = offset;
+			stats.output_samples += trace_length;
+			continue;
+		}
+
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		if (!Window(event + header_length, trace_length, events.energy[i], begin, end)) {
+			++stats.dropped;
+		}
+
+		output_.insert(output_.end(), event, event + header_length);
+		output_.insert(
+			output_.end(),
+			event + header_length + begin / 2,
+			event + header_length + end / 2
+		);
+
+		// rewrite header
+		uint32_t kept = end - begin;
+		uint32_t length = header_length + kept / 2;
+		uint32_t *header = output_.data() + offset;
+		header[0] = (header[0] & ~(kEventLengthMask << kEventLengthShift))
+			| (length << kEventLengthShift);
+		header[3] = (header[3] & ~(kTraceLengthMask << kTraceLengthShift))
+			| (kept << kTraceLengthShift);
+
+		events.offset[i] = offset;
+		events.length[i] = length;
+		events.trace_length[i] = kept;
+		stats.output_samples += kept;
+	}
+	block.words.swap(output_);
+
+	std::lock_guard<std::mutex> guard(stats_lock_);
+	stats_.events += stats.events;
+	stats_.dropped += stats.dropped;
+	stats_.input_samples += stats.input_samples;
+	stats_.output_samples += stats.output_samples;
+}
+
+
+void TraceReducer::Reset() {
+	std::lock_guard<std::mutex> guard(stats_lock_);
+	stats_ = TraceReductionStats{0, 0, 0, 0};
+}
+
+
+TraceReductionStats TraceReducer::Stats() const {
+	std::lock_guard<std::mutex> guard(stats_lock_);
+	return stats_;
+}
+
+
+bool TraceReducer::Window(
+	const uint32_t *trace,
+	uint32_t length,
+	uint16_t energy,
+	uint32_t &begin,
+	uint32_t &end
+) {
+	begin = 0;
+	end = 0;
+	if (reduction_.drop_energy && energy >= reduction_.drop_energy) {
+		return false;
+	}
+	uint32_t trigger = reduction_.trigger >= 0 ?
+		std::min(uint32_t(reduction_.trigger), length) :
+		FindLeadingEdge(trace, length);
+	begin = trigger > reduction_.pre ? trigger - reduction_.pre : 0;
+	begin &= ~1u;
+	end = trigger + reduction_.post;
+	end = std::min(end + (end & 1), length & ~1u);
+	begin = std::min(begin, end);
+	return true;
+}
+
+
+unsigned int TraceReducer::FindLeadingEdge(
+	const uint32_t *trace,
+	unsigned int length
+) {
+	if (length < 2) return 0;
+	// samples are little endian, the first sample in the lower half
+	samples_.resize(length);
+	memcpy(samples_.data(), trace, length * sizeof(uint16_t));
+
+	// rises between neighbour samples, and the largest one
+	const uint16_t *samples = samples_.data();
+	rises_.resize(length - 1);
+	int32_t *rises = rises_.data();
+	int32_t largest = std::numeric_limits<int32_t>::min();
+	for (unsigned int i = 0; i < length - 1; ++i) {
+		rises[i] = int32_t(samples[i+1]) - int32_t(samples[i]);
+		largest = std::max(largest, rises[i]);
+	}
+	unsigned int edge = 0;
+	while (rises[edge] != largest) ++edge;
+	return edge + 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// 								check traces
+//-----------------------------------------------------------------------------
+
+/// @brief check whether two events are the same event
+///
+/// @param[in] a batch of event a
+/// @param[in] i index of event a
+/// @param[in] b batch of event b
+/// @param[in] j index of event b
+/// @returns true if same
+///
+bool SameEvent(const EventBatch &a, size_t i, const EventBatch &b, size_t j) {
+	return a.time[i] == b.time[j]
+		&& a.channel[i] == b.channel[j]
+		&& a.slot[i] == b.slot[j]
+		&& a.crate[i] == b.crate[j];
+}
+
+
+TraceCheck CheckReducedTraces(
+	const std::vector<uint32_t> &raw,
+	const std::vector<uint32_t> &reduced,
+	const TraceReduction &reduction
+) {
+	EventBatch raw_events;
+	EventBatch reduced_events;
+	if (DecodeListMode(raw.data(), raw.size(), raw_events) != raw.size()) {
+		throw RXError("Raw data ends with incomplete event.");
+	}
+	if (
+		DecodeListMode(reduced.data(), reduced.size(), reduced_events)
+		!= reduced.size()
+	) {
+		throw RXError("Reduced data ends with incomplete event.");
+	}
+
+	TraceReducer reducer(reduction);
+	TraceCheck result{0, 0, 0, 0};
+	const uint32_t length_mask = kEventLengthMask << kEventLengthShift;
+	const uint32_t trace_mask = kTraceLengthMask << kTraceLengthShift;
+	size_t j = 0;
+	for (size_t i = 0; i < reduced_events.Size(); ++i) {
+		while (j < raw_events.Size() && !SameEvent(reduced_events, i, raw_events, j)) {
+			++j;
+		}
+		if (j == raw_events.Size()) {
+			throw RXError(
+				"Event " + std::to_string(i) + " of reduced data is not found"
+				" in raw data."
+			);
+		}
+
+		++result.events;
+		const uint32_t *event = reduced.data() + reduced_events.offset[i];
+		const uint32_t *raw_event = raw.data() + raw_events.offset[j];
+		const uint32_t header_length = reduced_events.header_length[i];
+		const uint32_t words = reduced_events.trace_length[i] / 2;
+		const uint32_t raw_header_length = raw_events.header_length[j];
+		const uint32_t raw_length = raw_events.length[j];
+		const uint32_t raw_trace_length = raw_events.trace_length[j];
+		const uint16_t energy = raw_events.energy[j];
+		++j;
+
+		if (
+			raw_trace_length == 0
+			|| raw_length != raw_header_length + raw_trace_length / 2
+		) {
+			// not cut, the whole event is kept
+			if (
+				reduced_events.length[i] != raw_length
+				|| !std::equal(event, event + raw_length, raw_event)
+			) {
+				++result.mismatches;
+			}
+			continue;
+		}
+
+		// headers are the same except lengths
+		bool match = header_length == raw_header_length;
+		match = match && (event[0] & ~length_mask) == (raw_event[0] & ~length_mask);
+		match = match && (event[3] & ~trace_mask) == (raw_event[3] & ~trace_mask);
+		match = match && std::equal(
+			event + 4, event + header_length, raw_event + 4
+		);
+
+		// trace is the window of raw trace derived from the settings
+		if (match) {
+			const uint32_t *raw_trace = raw_event + header_length;
+			uint32_t begin = 0;
+			uint32_t end = 0;
+			reducer.Window(raw_trace, raw_trace_length, energy, begin, end);
+			match = reduced_events.trace_length[i] == end - begin
+				&& std::equal(
+					event + header_length, event + header_length + words,
+					raw_trace + begin / 2
+				);
+		}
+		if (words) {
+			++result.traces;
+			result.samples += words * 2;
+		}
+		if (!match) {
+			++result.mismatches;
+		}
+	}
+	return result;
+}
+
+}		// namespace rxdaq
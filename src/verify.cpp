@@ -0,0 +1,423 @@
+#include "include/verify.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <limits>
+#include <memory>
+
+#include "include/columnar.h"
+#include "include/error.h"
+#include "include/mapped_file.h"
+#include "include/parallel.h"
+#include "include/trace.h"
+
+namespace rxdaq {
+
+using namespace list_mode;
+
+// timestamps are checked for each channel indexed by 4 bits crate, slot and
+// channel
+const size_t kChannelKeys = size_t(1) << 12;
+const uint64_t kNoOffset = std::numeric_limits<uint64_t>::max();
+
+
+std::string VerifyProblemName(VerifyProblem problem) noexcept {
+	switch (problem) {
+		case VerifyProblem::kNone:
+			return "none";
+		case VerifyProblem::kFraming:
+			return "framing";
+		case VerifyProblem::kTruncated:
+			return "truncated";
+		case VerifyProblem::kTraceLength:
+			return "trace length";
+		case VerifyProblem::kCrate:
+			return "crate";
+		case VerifyProblem::kSlot:
+			return "slot";
+		case VerifyProblem::kTimestamp:
+			return "timestamp";
+	}
+	return "unknown";
+}
+
+
+int ModuleOfDataFile(const std::string &path) noexcept {
+	std::string stem = std::filesystem::path(path).stem().string();
+	size_t position = stem.rfind("_M");
+	if (position == std::string::npos || position + 2 == stem.size()) {
+		return -1;
+	}
+	int module = 0;
+	for (size_t i = position + 2; i < stem.size(); ++i) {
+		if (!std::isdigit(static_cast<unsigned char>(stem[i])) || module > 9999) {
+			return -1;
+		}
+		module = module * 10 + (stem[i] - '0');
+	}
+	return module;
+}
+
+
+/// the problem at the smallest offset
+struct FirstProblem {
+	VerifyProblem problem;
+	// offset in words
+	uint64_t offset;
+	std::string message;
+
+
+	/// @brief record problem if it's before the current one
+	///
+	/// @param[in] new_problem problem found
+	/// @param[in] new_offset offset of problem in words
+	/// @param[in] new_message description of problem
+	///
+	void Update(
+		VerifyProblem new_problem,
+		uint64_t new_offset,
+		const std::string &new_message
+	) {
+		if (
+			new_offset < offset
+			|| (new_offset == offset && new_problem < problem)
+		) {
+			problem = new_problem;
+			offset = new_offset;
+			message = new_message;
+		}
+	}
+};
+
+
+/// the first and last event of a channel in a chunk
+struct ChannelSpan {
+	size_t key;
+	uint64_t first_time;
+	uint64_t first_offset;
+	uint64_t last_time;
+};
+
+
+/// result of checking a chunk
+struct ChunkResult {
+	uint64_t events;
+	uint64_t trace_length_errors;
+	uint64_t crate_errors;
+	uint64_t slot_errors;
+	uint64_t timestamp_errors;
+	FirstProblem first;
+	std::vector<ChannelSpan> channels;
+};
+
+
+/// chunk of a data file to check
+struct VerifyTask {
+	size_t file;
+	FileChunk chunk;
+	ChunkResult result;
+};
+
+
+/// @brief frame events by headers and split them into chunks, stop at the
+/// 	first invalid header or partial event
+///
+/// @param[in] file mapped data file
+/// @param[in] chunk_words words in a chunk
+/// @param[out] chunks chunks of framed events
+/// @param[out] report report to record the framing problem
+///
+static void FrameFile(
+	const MappedFile &file,
+	size_t chunk_words,
+	std::vector<FileChunk> &chunks,
+	VerifyReport &report
+) {
+	const uint32_t *words = file.Words();
+	const uint64_t size = file.WordSize();
+	// offsets of decoded events are 32 bits
+	chunk_words = std::clamp(chunk_words, size_t(1), size_t(1) << 30);
+	uint64_t begin = 0;
+	uint64_t position = 0;
+	while (position < size) {
+		if (position + kMinHeaderLength > size) {
+			report.first_problem = VerifyProblem::kTruncated;
+			report.message = "partial header of "
+				+ std::to_string(size - position) + " words";
+			break;
+		}
+		const uint32_t header = words[position];
+		uint32_t header_length = (header >> kHeaderLengthShift) & kHeaderLengthMask;
+		uint32_t event_length = (header >> kEventLengthShift) & kEventLengthMask;
+		if (header_length < kMinHeaderLength || event_length < header_length) {
+			report.first_problem = VerifyProblem::kFraming;
+			report.message = "invalid header, header length "
+				+ std::to_string(header_length) + ", event length "
+				+ std::to_string(event_length);
+			break;
+		}
+		if (position + event_length > size) {
+			report.first_problem = VerifyProblem::kTruncated;
+			report.message = "partial event of "
+				+ std::to_string(size - position) + " words, event length "
+				+ std::to_string(event_length);
+			break;
+		}
+		position += event_length;
+		if (position - begin >= chunk_words) {
+			chunks.push_back(FileChunk{begin, position});
+			begin = position;
+		}
+	}
+	if (position > begin) {
+		chunks.push_back(FileChunk{begin, position});
+	}
+
+	// bytes after the last whole word
+	if (report.first_problem == VerifyProblem::kNone && file.Size() % sizeof(uint32_t)) {
+		report.first_problem = VerifyProblem::kTruncated;
+		report.message = "partial word of "
+			+ std::to_string(file.Size() % sizeof(uint32_t)) + " bytes";
+	}
+	if (report.first_problem != VerifyProblem::kNone) {
+		report.first_offset = position * sizeof(uint32_t);
+	}
+	report.unverified_bytes = file.Size() - position * sizeof(uint32_t);
+}
+
+
+/// @brief count values of column different from the expected value, written
+/// 	without branch so it's vectorized by compiler
+///
+/// @param[in] column column of events
+/// @param[in] value expected value
+/// @returns number of different values
+///
+static size_t CountDifferent(const std::vector<uint8_t> &column, uint8_t value) {
+	const uint8_t *data = column.data();
+	const size_t size = column.size();
+	size_t count = 0;
+	for (size_t i = 0; i < size; ++i) {
+		count += data[i] != value;
+	}
+	return count;
+}
+
+
+/// @brief check events of chunk
+///
+/// @param[in] words words of data file
+/// @param[in] chunk chunk of framed events
+/// @param[in] crate expected crate, negative to skip
+/// @param[in] slot expected slot, negative to skip
+/// @param[in] packed whether traces are encoded
+/// @param[out] result result of checking
+///
+static void CheckChunk(
+	const uint32_t *words,
+	const FileChunk &chunk,
+	int crate,
+	int slot,
+	bool packed,
+	ChunkResult &result
+) {
+	EventBatch events;
+	DecodeListMode(words + chunk.begin, chunk.end - chunk.begin, events);
+	const size_t size = events.Size();
+	result.events = size;
+	auto offset = [&](size_t i) {
+		return chunk.begin + events.offset[i];
+	};
+
+	// event length of raw data is header length and 2 samples a word
+	if (!packed) {
+		const uint32_t *length = events.length.data();
+		const uint8_t *header_length = events.header_length.data();
+		const uint16_t *trace_length = events.trace_length.data();
+		size_t count = 0;
+		for (size_t i = 0; i < size; ++i) {
+			count += length[i] != header_length[i] + (trace_length[i] + 1u) / 2;
+		}
+		result.trace_length_errors = count;
+		for (size_t i = 0; count && i < size; ++i) {
+			if (length[i] != header_length[i] + (trace_length[i] + 1u) / 2) {
+				result.first.Update(
+					VerifyProblem::kTraceLength, offset(i),
+					"event length " + std::to_string(length[i])
+					+ ", header length " + std::to_string(header_length[i])
+					+ ", trace length " + std::to_string(trace_length[i])
+				);
+				break;
+			}
+		}
+	}
+
+	if (crate >= 0) {
+		result.crate_errors = CountDifferent(events.crate, crate);
+		if (result.crate_errors) {
+			size_t i = std::find_if(
+				events.crate.begin(), events.crate.end(),
+				[crate](uint8_t value) { return value != crate; }
+			) - events.crate.begin();
+			result.first.Update(
+				VerifyProblem::kCrate, offset(i),
+				"crate " + std::to_string(events.crate[i])
+				+ ", expected " + std::to_string(crate)
+			);
+		}
+	}
+
+	if (slot >= 0) {
+		result.slot_errors = CountDifferent(events.slot, slot);
+		if (result.slot_errors) {
+			size_t i = std::find_if(
+				events.slot.begin(), events.slot.end(),
+				[slot](uint8_t value) { return value != slot; }
+			) - events.slot.begin();
+			result.first.Update(
+				VerifyProblem::kSlot, offset(i),
+				"slot " + std::to_string(events.slot[i])
+				+ ", expected " + std::to_string(slot)
+			);
+		}
+	}
+
+	// compare timestamp with the previous event of the same channel
+	std::vector<uint64_t> last(kChannelKeys);
+	std::vector<uint32_t> first(kChannelKeys, std::numeric_limits<uint32_t>::max());
+	for (size_t i = 0; i < size; ++i) {
+		size_t key = (size_t(events.crate[i]) << 8)
+			| (size_t(events.slot[i]) << 4) | events.channel[i];
+		if (first[key] == std::numeric_limits<uint32_t>::max()) {
+			first[key] = i;
+		} else if (events.time[i] < last[key]) {
+			if (!result.timestamp_errors) {
+				result.first.Update(
+					VerifyProblem::kTimestamp, offset(i),
+					"timestamp " + std::to_string(events.time[i])
+					+ " of crate " + std::to_string(events.crate[i])
+					+ " slot " + std::to_string(events.slot[i])
+					+ " channel " + std::to_string(events.channel[i])
+					+ " is less than the previous " + std::to_string(last[key])
+				);
+			}
+			++result.timestamp_errors;
+		}
+		last[key] = events.time[i];
+	}
+	for (size_t key = 0; key < kChannelKeys; ++key) {
+		if (first[key] == std::numeric_limits<uint32_t>::max()) continue;
+		result.channels.push_back(ChannelSpan{
+			key, events.time[first[key]], offset(first[key]), last[key]
+		});
+	}
+}
+
+
+std::vector<VerifyReport> VerifyRun(
+	const std::vector<std::string> &files,
+	const VerifyOptions &options
+) {
+	TraceSpan trace_span("VerifyRun");
+
+	// map and frame files in parallel, framing of a file is sequential
+	std::vector<std::unique_ptr<MappedFile>> mapped(files.size());
+	std::vector<std::vector<FileChunk>> chunks(files.size());
+	std::vector<VerifyReport> reports(files.size());
+	ParallelFor(files.size(), options.threads, [&](size_t f) {
+		TraceSpan frame_span("verify frame");
+		mapped[f] = std::make_unique<MappedFile>(files[f]);
+		mapped[f]->AdviseSequential();
+		reports[f] = VerifyReport{
+			files[f], mapped[f]->Size(), 0, 0, 0, 0, 0, 0,
+			VerifyProblem::kNone, 0, ""
+		};
+		FrameFile(*mapped[f], options.chunk_words, chunks[f], reports[f]);
+	});
+
+	// check chunks of all files in parallel
+	std::vector<VerifyTask> tasks;
+	for (size_t f = 0; f < files.size(); ++f) {
+		for (const auto &chunk : chunks[f]) {
+			tasks.push_back(VerifyTask{
+				f, chunk,
+				ChunkResult{0, 0, 0, 0, 0, {VerifyProblem::kNone, kNoOffset, ""}, {}}
+			});
+		}
+	}
+	ParallelFor(tasks.size(), options.threads, [&](size_t t) {
+		TraceSpan chunk_span("verify chunk");
+		VerifyTask &task = tasks[t];
+		const std::string &path = files[task.file];
+		int slot = -1;
+		int module = ModuleOfDataFile(path);
+		if (module >= 0 && size_t(module) < options.slots.size()) {
+			slot = options.slots[module];
+		}
+		bool packed = std::filesystem::path(path).extension() == ".rxp";
+		CheckChunk(
+			mapped[task.file]->Words(), task.chunk, options.crate, slot,
+			packed, task.result
+		);
+	});
+
+	// merge results of chunks in order, and check timestamps across chunks
+	std::vector<FirstProblem> first(files.size());
+	for (size_t f = 0; f < files.size(); ++f) {
+		if (reports[f].first_problem == VerifyProblem::kNone) {
+			first[f] = FirstProblem{VerifyProblem::kNone, kNoOffset, ""};
+		} else {
+			first[f] = FirstProblem{
+				reports[f].first_problem,
+				reports[f].first_offset / sizeof(uint32_t),
+				reports[f].message
+			};
+		}
+	}
+	std::vector<uint64_t> last(kChannelKeys);
+	std::vector<bool> seen(kChannelKeys);
+	size_t file = files.size();
+	for (const auto &task : tasks) {
+		if (task.file != file) {
+			file = task.file;
+			std::fill(seen.begin(), seen.end(), false);
+		}
+		const ChunkResult &result = task.result;
+		VerifyReport &report = reports[file];
+		report.events += result.events;
+		report.trace_length_errors += result.trace_length_errors;
+		report.crate_errors += result.crate_errors;
+		report.slot_errors += result.slot_errors;
+		report.timestamp_errors += result.timestamp_errors;
+		if (result.first.problem != VerifyProblem::kNone) {
+			first[file].Update(
+				result.first.problem, result.first.offset, result.first.message
+			);
+		}
+		for (const auto &span : result.channels) {
+			if (seen[span.key] && span.first_time < last[span.key]) {
+				++report.timestamp_errors;
+				first[file].Update(
+					VerifyProblem::kTimestamp, span.first_offset,
+					"timestamp " + std::to_string(span.first_time)
+					+ " of crate " + std::to_string(span.key >> 8)
+					+ " slot " + std::to_string((span.key >> 4) & 0xf)
+					+ " channel " + std::to_string(span.key & 0xf)
+					+ " is less than the previous " + std::to_string(last[span.key])
+				);
+			}
+			seen[span.key] = true;
+			last[span.key] = span.last_time;
+		}
+	}
+	for (size_t f = 0; f < files.size(); ++f) {
+		if (first[f].problem == VerifyProblem::kNone) continue;
+		reports[f].first_problem = first[f].problem;
+		reports[f].first_offset = first[f].offset * sizeof(uint32_t);
+		reports[f].message = first[f].message;
+	}
+	return reports;
+}
+
+}		// namespace rxdaq
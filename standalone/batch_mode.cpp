@@ -2,23 +2,40 @@
 #include <string>
 #include <iostream>
 
+#include "include/batch.h"
 #include "include/config.h"
 #include "include/frame.h"
 
 
 class BatchProcessor : public rxdaq::Interactor {
 public:
+	BatchProcessor(const std::string &plan_path)
+	: plan_path_(plan_path) {
+	}
+
 	virtual void Run(std::shared_ptr<rxdaq::Crate> crate) override {
+		rxdaq::BatchPlan plan = rxdaq::ReadBatchPlan(plan_path_);
 		crate->Initialize("config.json");
-		crate->Boot(kModuleNum, false);
-		crate->StartRun(kModuleNum, 1, 500);
+		rxdaq::BatchRunner runner(crate);
+		size_t failed = runner.Run(plan);
+		std::cout << "Batch finished " << runner.FinishedRuns() << " runs.\n";
+		if (failed) {
+			throw rxdaq::UserError(std::to_string(failed) + " batch steps failed");
+		}
 	}
+
+private:
+	std::string plan_path_;
 };
 
-int main() {
+int main(int argc, char **argv) {
+	if (argc > 2) {
+		std::cerr << "Usage: " << argv[0] << " [plan.json]" << std::endl;
+		return -2;
+	}
 	rxdaq::Frame frame;
 	std::unique_ptr<rxdaq::Interactor> interactor =
-		std::make_unique<BatchProcessor>();
+		std::make_unique<BatchProcessor>(argc == 2 ? argv[1] : "batch.json");
 	frame.SetInteractor(interactor);
 	frame.Run();
 
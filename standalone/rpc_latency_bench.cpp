@@ -0,0 +1,130 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grpcpp/grpcpp.h"
+
+#include "include/control_crate_service.h"
+#include "include/crate.h"
+#include "include/endpoint.h"
+#include "include/metrics.h"
+#include "include/remote_crate.h"
+
+using namespace rxdaq;
+
+// calls of each endpoint by default
+const size_t kDefaultCalls = 10000;
+// calls before timing, to set up the connection
+const size_t kWarmupCalls = 100;
+
+
+/// @brief time RunStatus calls over an endpoint
+///
+/// @param[in] endpoint endpoint to connect
+/// @param[in] calls number of calls to time
+/// @returns histogram of latencies
+///
+std::unique_ptr<HdrHistogram> Measure(const std::string &endpoint, size_t calls) {
+	RemoteCrate crate(
+		grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials())
+	);
+	for (size_t i = 0; i < kWarmupCalls; ++i) {
+		crate.RunStatus();
+	}
+	auto histogram = std::make_unique<HdrHistogram>();
+	for (size_t i = 0; i < calls; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		crate.RunStatus();
+		histogram->Record(std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start
+		).count());
+	}
+	return histogram;
+}
+
+
+/// @brief print latencies of an endpoint in microseconds
+///
+/// @param[in] endpoint endpoint measured
+/// @param[in] histogram latencies
+///
+void Print(const std::string &endpoint, const HdrHistogram &histogram) {
+	std::cout << std::left << std::setw(32) << endpoint << std::right
+		<< std::fixed << std::setprecision(1)
+		<< std::setw(10) << histogram.Mean() * 1e6
+		<< std::setw(10) << histogram.Percentile(0.5) * 1e6
+		<< std::setw(10) << histogram.Percentile(0.99) * 1e6
+		<< std::setw(10) << histogram.Max() * 1e6 << "\n";
+}
+
+
+int main(int argc, char **argv) {
+	size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : kDefaultCalls;
+	if (calls == 0) {
+		std::cerr << "Usage: rpc_latency_bench [calls] [endpoint ...]\n"
+			<< "  Time RunStatus over the endpoints, or over an in-process server\n"
+			<< "  on TCP loopback and unix domain socket if no endpoint is given.\n";
+		return -1;
+	}
+
+	std::vector<std::string> endpoints;
+	for (int i = 2; i < argc; ++i) {
+		if (!CheckEndpoint(argv[i])) {
+			std::cerr << "Error: invalid endpoint " << argv[i] << "\n";
+			return -1;
+		}
+		endpoints.push_back(argv[i]);
+	}
+
+	std::unique_ptr<ControlCrateService> service;
+	std::unique_ptr<grpc::Server> server;
+	std::string socket_path;
+	if (endpoints.empty()) {
+		// in-process server, the crate isn't initialized and only answers
+		// the run status
+		service = std::make_unique<ControlCrateService>(std::make_shared<Crate>());
+		socket_path = "/tmp/rxdaq_bench_" + std::to_string(getpid()) + ".sock";
+		int port = 0;
+		grpc::ServerBuilder builder;
+		builder.AddListeningPort(
+			"127.0.0.1:0", grpc::InsecureServerCredentials(), &port
+		);
+		builder.AddListeningPort(
+			kUnixPrefix + socket_path, grpc::InsecureServerCredentials()
+		);
+		builder.RegisterService(service.get());
+		server = builder.BuildAndStart();
+		if (!server || port == 0) {
+			std::cerr << "Error: failed to start server.\n";
+			return -1;
+		}
+		endpoints.push_back("127.0.0.1:" + std::to_string(port));
+		endpoints.push_back(kUnixPrefix + socket_path);
+	}
+
+	int result = 0;
+	std::cout << std::left << std::setw(32) << "endpoint" << std::right
+		<< std::setw(10) << "mean(us)" << std::setw(10) << "p50(us)"
+		<< std::setw(10) << "p99(us)" << std::setw(10) << "max(us)" << "\n";
+	for (const auto &endpoint : endpoints) {
+		try {
+			Print(endpoint, *Measure(endpoint, calls));
+		} catch (const std::exception &e) {
+			std::cerr << "Error: " << endpoint << ": " << e.what() << "\n";
+			result = -1;
+		}
+	}
+
+	if (server) {
+		server->Shutdown();
+		unlink(socket_path.c_str());
+	}
+	return result;
+}
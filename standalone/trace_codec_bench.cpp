@@ -0,0 +1,159 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/list_mode.h"
+#include "include/trace_codec.h"
+
+
+/// traces to benchmark, samples of all traces are stored together
+struct Traces {
+	std::vector<uint16_t> samples;
+	std::vector<size_t> lengths;
+};
+
+
+/// @brief generate 14 bits traces with noisy baseline and a pulse
+///
+/// @param[in] number number of traces
+/// @param[in] length samples of each trace
+/// @returns traces
+///
+Traces SyntheticTraces(size_t number, size_t length) {
+	std::mt19937 engine(1234);
+	std::normal_distribution<double> noise(0.0, 3.0);
+	std::uniform_real_distribution<double> amplitude(100.0, 12000.0);
+	Traces traces;
+	for (size_t n = 0; n < number; ++n) {
+		double height = amplitude(engine);
+		size_t edge = length / 4;
+		for (size_t i = 0; i < length; ++i) {
+			double value = 1000.0 + noise(engine);
+			if (i >= edge) {
+				double t = double(i - edge);
+				value += height * (1.0 - std::exp(-t / 4.0)) * std::exp(-t / 200.0);
+			}
+			traces.samples.push_back(uint16_t(std::min(value, 16383.0)));
+		}
+		traces.lengths.push_back(length);
+	}
+	return traces;
+}
+
+
+/// @brief read traces from raw list mode file
+///
+/// @param[in] path path of file
+/// @returns traces
+///
+Traces RecordedTraces(const std::string &path) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin.good()) {
+		throw std::runtime_error("Open file " + path + " failed.");
+	}
+	std::vector<uint32_t> words(fin.tellg() / sizeof(uint32_t));
+	fin.seekg(0);
+	fin.read(reinterpret_cast<char*>(words.data()), words.size()*sizeof(uint32_t));
+
+	rxdaq::EventBatch events;
+	rxdaq::DecodeListMode(words.data(), words.size(), events);
+	Traces traces;
+	for (size_t i = 0; i < events.Size(); ++i) {
+		size_t length = events.trace_length[i];
+		if (!length || events.length[i] != events.header_length[i] + length / 2) {
+			continue;
+		}
+		size_t offset = traces.samples.size();
+		traces.samples.resize(offset + length);
+		memcpy(
+			traces.samples.data() + offset,
+			words.data() + events.offset[i] + events.header_length[i],
+			length * sizeof(uint16_t)
+		);
+		traces.lengths.push_back(length);
+	}
+	return traces;
+}
+
+
+/// @brief encode and decode traces, print speed and ratio
+///
+/// @param[in] name name of data
+/// @param[in] traces traces to benchmark
+/// @param[in] repeat times to repeat
+///
+void Benchmark(const std::string &name, const Traces &traces, int repeat) {
+	if (traces.lengths.empty()) {
+		std::cout << name << ": no traces.\n";
+		return;
+	}
+	std::vector<uint32_t> encoded;
+	encoded.reserve(traces.samples.size());
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeat; ++r) {
+		encoded.clear();
+		const uint16_t *samples = traces.samples.data();
+		for (const auto &length : traces.lengths) {
+			rxdaq::EncodeTrace(samples, length, encoded);
+			samples += length;
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	std::vector<uint16_t> decoded(traces.samples.size());
+	for (int r = 0; r < repeat; ++r) {
+		const uint32_t *words = encoded.data();
+		const uint32_t *end = encoded.data() + encoded.size();
+		uint16_t *samples = decoded.data();
+		for (const auto &length : traces.lengths) {
+			words += rxdaq::DecodeTrace(words, end - words, length, samples);
+			samples += length;
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	double bytes = double(traces.samples.size() * sizeof(uint16_t)) * repeat;
+	double encode_seconds = std::chrono::duration<double>(middle - start).count();
+	double decode_seconds = std::chrono::duration<double>(stop - middle).count();
+	double ratio = double(traces.samples.size() * sizeof(uint16_t))
+		/ double(encoded.size() * sizeof(uint32_t));
+	std::cout << name << ": " << traces.lengths.size() << " traces, "
+		<< traces.samples.size() << " samples\n"
+		<< "  encode " << bytes / encode_seconds / 1e9 << " GB/s\n"
+		<< "  decode " << bytes / decode_seconds / 1e9 << " GB/s\n"
+		<< "  ratio  " << ratio << "\n"
+		<< "  lossless " << (decoded == traces.samples ? "yes" : "NO") << "\n";
+}
+
+
+int main(int argc, char **argv) {
+	if (argc > 3) {
+		std::cerr << "Usage: " << argv[0] << " [data.bin [traces.raw]]\n"
+			<< "Benchmark trace codec on synthetic traces and traces in data.bin.\n"
+			<< "The synthetic traces are written to traces.raw if given, so general\n"
+			<< "purpose compressors can be compared on the same samples.\n";
+		return -2;
+	}
+	try {
+		Traces synthetic = SyntheticTraces(20000, 1000);
+		Benchmark("synthetic", synthetic, 10);
+		if (argc >= 2) {
+			Benchmark(argv[1], RecordedTraces(argv[1]), 10);
+		}
+		if (argc == 3) {
+			std::ofstream fout(argv[2], std::ios::binary);
+			fout.write(
+				reinterpret_cast<const char*>(synthetic.samples.data()),
+				synthetic.samples.size() * sizeof(uint16_t)
+			);
+		}
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/error.h"
+#include "include/trace_reducer.h"
+
+
+std::vector<uint32_t> ReadWords(const std::string &path) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin.good()) {
+		throw rxdaq::UserError("Open file " + path + " failed.");
+	}
+	std::vector<uint32_t> words(fin.tellg() / sizeof(uint32_t));
+	fin.seekg(0);
+	fin.read(reinterpret_cast<char*>(words.data()), words.size()*sizeof(uint32_t));
+	return words;
+}
+
+
+int main(int argc, char **argv) {
+	if (argc != 5 && argc != 6 && argc != 7) {
+		std::cerr << "Usage: " << argv[0]
+			<< " raw.bin reduced.bin pre post [trigger] [drop_energy]\n"
+			<< "Check the reduced traces are the raw samples in the window of\n"
+			<< "the reduction settings, trigger -1 for the leading edge.\n";
+		return -2;
+	}
+	try {
+		rxdaq::TraceReduction reduction{
+			unsigned(std::stoul(argv[3])),
+			unsigned(std::stoul(argv[4])),
+			argc > 5 ? std::stoi(argv[5]) : -1,
+			uint16_t(argc > 6 ? std::stoul(argv[6]) : 0)
+		};
+		rxdaq::TraceCheck check = rxdaq::CheckReducedTraces(
+			ReadWords(argv[1]), ReadWords(argv[2]), reduction
+		);
+		std::cout << "Events " << check.events << ", traces " << check.traces
+			<< ", samples " << check.samples << ", mismatches "
+			<< check.mismatches << ".\n";
+		return check.mismatches ? 1 : 0;
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << "\n";
+		return -1;
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ * This is the test of batch runner. Runner should check the plan, execute
+ * the steps in order and prepare the next run in advance.
+ */
+
+#include "include/batch.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "include/error.h"
+#include "test/test_crate.h"
+
+using namespace rxdaq;
+
+
+TEST(BatchTest, ParsePlan) {
+	BatchPlan plan = ParseBatchPlan(nlohmann::json::parse(R"({
+		"stop": {"file": "stop", "runs": 5},
+		"steps": [
+			{"type": "boot", "fast": false},
+			{"type": "write", "name": "TAU", "value": 1.5, "module": 2, "channel": 3},
+			{"type": "run", "seconds": 10, "run": 7, "repeat": 2}
+		]
+	})"));
+	ASSERT_EQ(plan.steps.size(), 3u);
+	EXPECT_EQ(plan.stop_file, "stop");
+	EXPECT_EQ(plan.max_runs, 5u);
+	EXPECT_EQ(plan.max_seconds, 0u);
+	EXPECT_FALSE(plan.keep_going);
+	EXPECT_EQ(plan.steps[0].type, BatchStepType::kBoot);
+	EXPECT_EQ(plan.steps[0].module, kModuleNum);
+	EXPECT_FALSE(plan.steps[0].fast);
+	EXPECT_EQ(plan.steps[1].name, "TAU");
+	EXPECT_EQ(plan.steps[1].channel, 3);
+	EXPECT_DOUBLE_EQ(plan.steps[1].value, 1.5);
+	EXPECT_EQ(plan.steps[2].run, 7);
+	EXPECT_EQ(plan.steps[2].repeat, 2u);
+
+	const std::vector<std::string> invalid_plans = {
+		R"({})",
+		R"({"steps": [{"module": 0}]})",
+		R"({"steps": [{"type": "sleep"}]})",
+		R"({"steps": [{"type": "write", "name": "TAU"}]})",
+		R"({"steps": [{"type": "import"}]})",
+		R"({"steps": [{"type": "run", "module": 14}]})",
+		R"({"steps": [{"type": "run", "repeat": 0}]})",
+		R"({"steps": [{"type": "task", "name": 3}]})"
+	};
+	for (size_t i = 0; i < invalid_plans.size(); ++i) {
+		EXPECT_THROW(
+			ParseBatchPlan(nlohmann::json::parse(invalid_plans[i])),
+			UserError
+		) << "Error: plan " << i;
+	}
+	EXPECT_THROW(ReadBatchPlan("not-exist.json"), UserError);
+}
+
+
+TEST(BatchTest, Run) {
+	BatchPlan plan = ParseBatchPlan(nlohmann::json::parse(R"({
+		"steps": [
+			{"type": "boot", "module": 1},
+			{"type": "run", "seconds": 10, "run": 7, "repeat": 2},
+			{"type": "write", "name": "TAU", "value": 1.5, "module": 1, "channel": 3},
+			{"type": "task", "name": "adjust_offsets", "module": 1},
+			{"type": "run", "seconds": 20},
+			{"type": "export", "path": "final.json"}
+		]
+	})"));
+	auto crate = std::make_shared<TestCrate>();
+	BatchRunner runner(crate);
+	EXPECT_EQ(runner.Run(plan), 0u);
+
+	EXPECT_EQ(runner.FinishedRuns(), 3u);
+	EXPECT_EQ(crate->runs_, std::vector<unsigned int>({7, 8, 9}));
+	// every run after the first one is prepared in advance
+	EXPECT_EQ(crate->prepared_runs_, std::vector<unsigned int>({8, 9}));
+	// and started with the prepared run number instead of the crate's one
+	EXPECT_EQ(crate->run_number_, 9);
+	EXPECT_EQ(crate->run_time_, 20u);
+	EXPECT_EQ(crate->modules_[1].status, TestCrate::ModuleStatus::kExported);
+	EXPECT_DOUBLE_EQ(crate->ReadParameter("TAU", 1, 3), 1.5);
+	EXPECT_EQ(crate->tasks_, std::vector<std::string>({"adjust_offsets"}));
+}
+
+
+TEST(BatchTest, StopConditions) {
+	auto crate = std::make_shared<TestCrate>();
+	BatchRunner runner(crate);
+
+	// stop after runs
+	BatchPlan plan = ParseBatchPlan(nlohmann::json::parse(R"({
+		"stop": {"runs": 2},
+		"steps": [{"type": "run", "repeat": 5}]
+	})"));
+	runner.Run(plan);
+	EXPECT_EQ(runner.FinishedRuns(), 2u);
+	EXPECT_EQ(crate->prepared_runs_.size(), 1u);
+
+	// stop if file exists
+	const std::string stop_file = "batch_test_stop";
+	std::ofstream fout(stop_file);
+	fout.close();
+	plan = ParseBatchPlan(nlohmann::json::parse(R"({
+		"stop": {"file": "batch_test_stop"},
+		"steps": [{"type": "run", "repeat": 5}]
+	})"));
+	runner.Run(plan);
+	EXPECT_EQ(runner.FinishedRuns(), 0u);
+	std::remove(stop_file.c_str());
+}
@@ -0,0 +1,145 @@
+/*
+ * This is the test of boot planner. Planner should only boot or import the
+ * modules differ from the target states, or whose parameters are unknown.
+ */
+
+#include "include/boot_plan.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+
+const std::vector<ModuleBootState> kTargetStates = {
+	{true, "fw-a", 1},
+	{true, "fw-a", 2},
+	{true, "fw-b", 3},
+	{true, "fw-b", 4}
+};
+
+
+TEST(BootPlanTest, Plan) {
+	std::vector<ModuleBootState> current = {
+		{false, "", 0},
+		{true, "fw-a", 2},
+		{true, "fw-a", 3},
+		{true, "fw-b", 5}
+	};
+	const std::vector<BootAction> expected_actions = {
+		BootAction::kBoot,
+		BootAction::kNone,
+		BootAction::kBoot,
+		BootAction::kImport
+	};
+
+	BootPlan plan = PlanBoot(current, kTargetStates, {0, 1, 2, 3}, false);
+	ASSERT_EQ(plan.size(), expected_actions.size());
+	for (size_t i = 0; i < plan.size(); ++i) {
+		EXPECT_EQ(plan[i].module, i) << "Error: module " << i;
+		EXPECT_EQ(plan[i].action, expected_actions[i])
+			<< "Error: action of module " << i;
+	}
+
+	EXPECT_EQ(
+		PlannedModules(plan, BootAction::kBoot),
+		std::vector<unsigned short>({0, 2})
+	);
+	EXPECT_EQ(
+		PlannedModules(plan, BootAction::kImport),
+		std::vector<unsigned short>({0, 2, 3})
+	);
+	EXPECT_EQ(
+		PlannedModules(plan, BootAction::kNone),
+		std::vector<unsigned short>({1})
+	);
+}
+
+
+TEST(BootPlanTest, Force) {
+	BootPlan plan = PlanBoot(kTargetStates, kTargetStates, {1, 3}, true);
+	ASSERT_EQ(plan.size(), 2u);
+	EXPECT_EQ(plan[0].module, 1);
+	EXPECT_EQ(plan[0].action, BootAction::kBoot);
+	EXPECT_EQ(plan[1].module, 3);
+	EXPECT_EQ(plan[1].action, BootAction::kBoot);
+
+	plan = PlanBoot(kTargetStates, kTargetStates, {1, 3}, false);
+	EXPECT_TRUE(PlannedModules(plan, BootAction::kImport).empty());
+}
+
+
+TEST(BootPlanTest, MissingParameters) {
+	// parameters without hash are never up to date, even if both sides match
+	const std::vector<ModuleBootState> target = {
+		{true, "fw-a", kMissingParameterHash},
+		{true, "fw-a", 5},
+		{true, "fw-a", 6}
+	};
+	const std::vector<ModuleBootState> current = {
+		{true, "fw-a", kMissingParameterHash},
+		{true, "fw-a", kUnknownParameterHash},
+		{true, "fw-a", 6}
+	};
+	BootPlan plan = PlanBoot(current, target, {0, 1, 2}, false);
+	ASSERT_EQ(plan.size(), 3u);
+	EXPECT_EQ(plan[0].action, BootAction::kImport);
+	EXPECT_EQ(plan[1].action, BootAction::kImport);
+	EXPECT_EQ(plan[2].action, BootAction::kNone);
+
+	plan = PlanBoot(
+		{{true, "fw-a", kUnknownParameterHash}},
+		{{true, "fw-a", kUnknownParameterHash}},
+		{0},
+		false
+	);
+	EXPECT_EQ(plan[0].action, BootAction::kImport);
+}
+
+
+TEST(BootPlanTest, InvalidModule) {
+	EXPECT_THROW(
+		PlanBoot(kTargetStates, kTargetStates, {4}, false),
+		UserError
+	);
+	EXPECT_THROW(
+		PlanBoot({}, kTargetStates, {0}, false),
+		RXError
+	);
+}
+
+
+TEST(BootPlanTest, ParameterHashes) {
+	const std::string path = "boot_plan_test_parameters.json";
+
+	// module parameters are hashed separately
+	std::ofstream fout(path);
+	fout << "[{\"slot\": 2, \"tau\": 1}, {\"slot\": 3, \"tau\": 2}]";
+	fout.close();
+	std::vector<uint64_t> hashes = ParameterHashes(path, 3);
+	ASSERT_EQ(hashes.size(), 3u);
+	EXPECT_NE(hashes[0], kUnknownParameterHash);
+	EXPECT_NE(hashes[0], kMissingParameterHash);
+	EXPECT_NE(hashes[0], hashes[1]);
+	// module without parameters is never up to date
+	EXPECT_EQ(hashes[2], kMissingParameterHash);
+
+	// changing one module doesn't affect the others
+	fout.open(path);
+	fout << "[{\"slot\": 2, \"tau\": 1}, {\"slot\": 3, \"tau\": 5}]";
+	fout.close();
+	std::vector<uint64_t> new_hashes = ParameterHashes(path, 3);
+	EXPECT_EQ(new_hashes[0], hashes[0]);
+	EXPECT_NE(new_hashes[1], hashes[1]);
+
+	std::remove(path.c_str());
+	EXPECT_EQ(
+		ParameterHashes(path, 2),
+		std::vector<uint64_t>(2, kMissingParameterHash)
+	);
+}
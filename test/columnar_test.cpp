@@ -0,0 +1,177 @@
+/*
+ * This is the test of columnar conversion. Columns should be encoded
+ * losslessly, files should be split at event boundaries, and the converted
+ * chunks should hold the same events as decoding the whole file.
+ */
+
+#include "include/columnar.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "include/error.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kOutputPath = "columnar_test_output";
+
+
+/// @brief get options of events with increasing time and traces of some events
+///
+/// @param[in] seed seed of random generator
+/// @returns options of generated data
+///
+GenerateOptions DataOptions(unsigned int seed) {
+	GenerateOptions options;
+	options.seed = seed;
+	options.crate = 1;
+	options.slots = 13;
+	options.time = 0x100000000ull;
+	options.step = 1000;
+	options.trace_ratio = 4;
+	options.trace_words = 50;
+	options.cfd = true;
+	return options;
+}
+
+
+TEST(ColumnarTest, EncodeColumn) {
+	std::mt19937_64 engine(1);
+	std::vector<std::vector<uint64_t>> cases = {
+		{},
+		{5},
+		std::vector<uint64_t>(300, 42),
+	};
+	// increasing timestamps, small values, and full 64 bits values
+	std::vector<uint64_t> values;
+	for (uint64_t i = 0; i < 1000; ++i) values.push_back(0xffff00000000ull + i * 37);
+	cases.push_back(values);
+	values.clear();
+	for (size_t i = 0; i < 777; ++i) values.push_back(engine() % 16);
+	cases.push_back(values);
+	values.clear();
+	for (size_t i = 0; i < 333; ++i) values.push_back(engine());
+	values.push_back(0);
+	values.push_back(~0ull);
+	cases.push_back(values);
+
+	for (const auto &input : cases) {
+		std::vector<uint32_t> words;
+		size_t size = EncodeColumn(input.data(), input.size(), words);
+		EXPECT_EQ(size, words.size());
+		std::vector<uint64_t> output(input.size());
+		EXPECT_EQ(DecodeColumn(words.data(), words.size(), input.size(), output.data()), size);
+		EXPECT_EQ(output, input);
+		if (input.size() > 1) {
+			EXPECT_THROW(
+				DecodeColumn(words.data(), words.size() - 1, input.size(), output.data()),
+				RXError
+			);
+		}
+	}
+
+	// timestamps are packed in fewer bits
+	std::vector<uint32_t> words;
+	EncodeColumn(cases[3].data(), cases[3].size(), words);
+	EXPECT_LT(words.size(), cases[3].size() / 2);
+}
+
+
+TEST(ColumnarTest, SplitChunks) {
+	std::vector<uint32_t> words = GenerateListMode(1000, DataOptions(2));
+	std::vector<FileChunk> chunks = SplitChunks(words.data(), words.size(), 500);
+	ASSERT_GT(chunks.size(), 3u);
+	EXPECT_EQ(chunks.front().begin, 0u);
+	EXPECT_EQ(chunks.back().end, words.size());
+	size_t events = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		if (i) {
+			EXPECT_EQ(chunks[i].begin, chunks[i-1].end);
+		}
+		EventColumns columns = DecodeChunk(words.data(), chunks[i]);
+		events += columns.Size();
+	}
+	EXPECT_EQ(events, 1000u);
+
+	// incomplete event at the end is excluded
+	std::vector<FileChunk> truncated =
+		SplitChunks(words.data(), words.size() - 1, 500);
+	EXPECT_LT(truncated.back().end, words.size());
+
+	// invalid header right after an event
+	std::vector<uint32_t> invalid(words.begin(), words.begin() + chunks[0].end);
+	invalid.insert(invalid.end(), 8, 0);
+	EXPECT_THROW(SplitChunks(invalid.data(), invalid.size(), 50), RXError);
+}
+
+
+TEST(ColumnarTest, ConvertRun) {
+	std::vector<std::string> files = {"columnar_test_0.bin", "columnar_test_1.bin"};
+	std::vector<std::vector<uint32_t>> data;
+	for (size_t i = 0; i < files.size(); ++i) {
+		data.push_back(GenerateListMode(5000 + i * 1000, DataOptions(i + 10)));
+		WriteWords(files[i], data[i]);
+	}
+
+	ConvertResult result = ConvertRun(files, kOutputPath, 3, 4096);
+	EXPECT_EQ(result.files, 2u);
+	EXPECT_EQ(result.events, 11000u);
+	EXPECT_GT(result.chunks, 4u);
+	EXPECT_LT(result.output_bytes, result.input_bytes);
+
+	std::ifstream fin(kOutputPath + "/manifest.json");
+	nlohmann::json manifest = nlohmann::json::parse(fin);
+	ASSERT_EQ(manifest["chunks"].size(), result.chunks);
+
+	// events of chunks in order are the events of files
+	std::vector<EventBatch> expected(files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		DecodeListMode(data[i].data(), data[i].size(), expected[i]);
+	}
+	std::vector<size_t> position(files.size(), 0);
+	for (const auto &chunk : manifest["chunks"]) {
+		size_t f = chunk["source"] == "columnar_test_0.bin" ? 0 : 1;
+		std::string path = kOutputPath + "/" + chunk["file"].get<std::string>();
+		EventColumns columns = ReadColumnChunk(path);
+		ASSERT_EQ(columns.Size(), chunk["events"].get<size_t>());
+
+		std::vector<ColumnStats> stats = ReadChunkStats(path);
+		EXPECT_EQ(stats[size_t(Column::kTime)].min, chunk["min"]["time"].get<uint64_t>());
+		EXPECT_EQ(stats[size_t(Column::kTime)].max, chunk["max"]["time"].get<uint64_t>());
+		EXPECT_EQ(stats[size_t(Column::kTime)].min, columns.time.front());
+
+		const EventBatch &events = expected[f];
+		for (size_t i = 0; i < columns.Size(); ++i) {
+			size_t j = position[f]++;
+			EXPECT_EQ(columns.time[i], events.time[j]);
+			EXPECT_EQ(columns.slot[i], events.slot[j]);
+			EXPECT_EQ(columns.channel[i], events.channel[j]);
+			EXPECT_EQ(columns.energy[i], events.energy[j]);
+			EXPECT_EQ(columns.cfd[i], events.cfd[j]);
+			EXPECT_EQ(columns.trace_length[i], events.trace_length[j]);
+			EXPECT_EQ(
+				columns.trace_offset[i],
+				(events.offset[j] + events.header_length[j]) * sizeof(uint32_t)
+			);
+		}
+	}
+	EXPECT_EQ(position[0], 5000u);
+	EXPECT_EQ(position[1], 6000u);
+
+	EXPECT_THROW(ReadColumnChunk(files[0]), RXError);
+	EXPECT_THROW(ConvertRun({"columnar_test_not_exist.bin"}, kOutputPath), RXError);
+
+	for (const auto &file : files) {
+		std::remove(file.c_str());
+	}
+	std::filesystem::remove_all(kOutputPath);
+}
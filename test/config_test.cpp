@@ -8,6 +8,7 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <iostream>
 #include <vector>
 
@@ -40,7 +41,11 @@ const std::vector<std::string> kIncompletionTestDataFiles = {
 	"modules-size-over-range.json",
 	"slot-conflict.json",
 	"run-lack-data-path.json",
-	"run-lack-number.json"
+	"run-lack-number.json",
+	"run-invalid-format.json",
+	"run-invalid-stats-interval.json",
+	"run-invalid-fifo-marks.json",
+	"invalid-rpc-endpoint.json"
 };
 const std::vector<std::string> kIncompletionTestErrorMessages = {
 	"Open file \"" + kTestDataDir + "completion/not-exist.json\" failed.\n",
@@ -62,7 +67,11 @@ const std::vector<std::string> kIncompletionTestErrorMessages = {
 	"Modules size over range(1-13).\n",
 	"Module 0 and module 1 share the same slot 2.\n",
 	"Run lack of parameter \"dataPath\".\n",
-	"Run lack of parameter \"number\".\n"
+	"Run lack of parameter \"number\".\n",
+	"Run format \"zip\" is invalid(raw or packed).\n",
+	"Run stats interval -1 is invalid(0 or positive seconds).\n",
+	"Run FIFO marks [0.8,0.5] are invalid(1 - 4 ascending fractions in (0, 1]).\n",
+	"rpcEndpoint \"localhost\" is invalid(unix:<path> or <host>:<port>).\n"
 };
 const std::vector<std::string> kCompletionTestDataFiles = {
 	"completion.json",
@@ -164,6 +173,12 @@ TEST(ConfigTest, Completion) {
 			+ kCompletionTestDataFiles[i]
 		))
 			<< "Error: completion case didn't pass " << i;
+		// format, stats interval and FIFO marks are optional
+		EXPECT_EQ(config.RunFormat(), "raw");
+		EXPECT_DOUBLE_EQ(config.RunStatsInterval(), kStatsInterval);
+		EXPECT_EQ(config.RunFifoMarks(), std::vector<double>({0.5, 0.8, 0.95}));
+		// rpc endpoint is optional
+		EXPECT_EQ(config.RpcEndpoint(), "");
 	}
 }
 
@@ -184,9 +199,17 @@ TEST(ConfigTest, Correction) {
 
 	EXPECT_STREQ(config.XiaLogLevel().c_str(), "warning");
 
+	EXPECT_EQ(config.RpcEndpoint(), "unix:/tmp/rxdaq.sock");
+
 	EXPECT_STREQ(config.RunDataPath().c_str(), "./");
 
 	EXPECT_STREQ(config.RunDataFile().c_str(), "data");
+
+	EXPECT_STREQ(config.RunFormat().c_str(), "packed");
+
+	EXPECT_DOUBLE_EQ(config.RunStatsInterval(), 0.5);
+
+	EXPECT_EQ(config.RunFifoMarks(), std::vector<double>({0.6, 0.9}));
 	
 	for (unsigned short i = 0; i < config.ModuleNum(); ++i) {
 		EXPECT_EQ(config.Slot(i), kModules[i].slot)
@@ -216,4 +239,23 @@ TEST(ConfigTest, Correction) {
 		EXPECT_EQ(config.Version(i), kModules[i].version)	
 			<< "Error: version " << i;
 	}
-}
\ No newline at end of file
+}
+
+TEST(ConfigTest, WriteRunSettings) {
+	const std::string path = "config_test_write.json";
+	Config config;
+	ASSERT_NO_THROW(config.ReadFromFile(kTestDataDir + "correction/config.json"));
+	config.SetRunNumber(11);
+	config.SetRunDataFile("next");
+	config.WriteToFile(path);
+
+	Config written;
+	ASSERT_NO_THROW(written.ReadFromFile(path));
+	EXPECT_EQ(written.RunNumber(), 11);
+	EXPECT_EQ(written.RunDataFile(), "next");
+	EXPECT_EQ(written.ModuleNum(), config.ModuleNum());
+	for (unsigned short i = 0; i < config.ModuleNum(); ++i) {
+		EXPECT_EQ(written.Ldr(i), config.Ldr(i)) << "Error: ldr " << i;
+	}
+	std::remove(path.c_str());
+}
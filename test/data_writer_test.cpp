@@ -0,0 +1,141 @@
+/*
+ * This is the test of data writer. Data should be written in order, and
+ * flushed before returning from Flush and Stop. The incomplete event left in
+ * pipeline should be written at the end of stream.
+ */
+
+#include "include/data_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/error.h"
+#include "include/list_mode.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kDataPath = "data_writer_test.bin";
+
+
+TEST(DataWriterTest, Order) {
+	std::ofstream fout(kDataPath, std::ios::binary | std::ios::trunc);
+	// small queue so the producer is blocked
+	DataWriter writer(2);
+	EXPECT_THROW(writer.Write(&fout, 0, {0}), RXError);
+
+	writer.Start();
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < 100; ++i) {
+		std::vector<uint32_t> words(i % 7 + 1, i);
+		expected.insert(expected.end(), words.begin(), words.end());
+		writer.Write(&fout, 0, std::move(words));
+	}
+	writer.Flush();
+	EXPECT_EQ(writer.Pending(), 0u);
+	fout.flush();
+	EXPECT_EQ(ReadWords(kDataPath), expected);
+
+	writer.Write(&fout, 0, {100, 101});
+	writer.Stop();
+	fout.close();
+	expected.push_back(100);
+	expected.push_back(101);
+	EXPECT_EQ(ReadWords(kDataPath), expected);
+
+	// stop again does nothing
+	EXPECT_NO_THROW(writer.Stop());
+	std::remove(kDataPath.c_str());
+}
+
+
+TEST(DataWriterTest, MultipleStreams) {
+	const std::string path[2] = {"data_writer_test_0.bin", "data_writer_test_1.bin"};
+	std::ofstream fout[2];
+	for (int i = 0; i < 2; ++i) {
+		fout[i].open(path[i], std::ios::binary | std::ios::trunc);
+	}
+
+	DataWriter writer;
+	writer.Start();
+	std::thread producer([&]() {
+		for (uint32_t i = 0; i < 1000; ++i) {
+			writer.Write(&fout[i % 2], i % 2, {i});
+		}
+	});
+	producer.join();
+	writer.Stop();
+
+	for (int i = 0; i < 2; ++i) {
+		fout[i].close();
+		auto words = ReadWords(path[i]);
+		ASSERT_EQ(words.size(), 500u);
+		for (size_t j = 0; j < words.size(); ++j) {
+			EXPECT_EQ(words[j], j * 2 + i);
+		}
+		std::remove(path[i].c_str());
+	}
+}
+
+
+TEST(DataWriterTest, WriteFailed) {
+	// writing to closed stream fails
+	std::ofstream fout;
+	DataWriter writer;
+	writer.Start();
+	writer.Write(&fout, 0, {1, 2, 3});
+	EXPECT_THROW(writer.Flush(), RXError);
+	EXPECT_THROW(writer.Write(&fout, 0, {4}), RXError);
+	EXPECT_THROW(writer.Stop(), RXError);
+
+	// restart clears the error
+	std::ofstream good(kDataPath, std::ios::binary | std::ios::trunc);
+	writer.Start();
+	EXPECT_NO_THROW(writer.Write(&good, 0, {5}));
+	EXPECT_NO_THROW(writer.Stop());
+	good.close();
+	std::remove(kDataPath.c_str());
+}
+
+
+TEST(DataWriterTest, IncompleteEvent) {
+	const std::string path[2] = {"data_writer_test_0.bin", "data_writer_test_1.bin"};
+	std::ofstream fout[2];
+	for (int i = 0; i < 2; ++i) {
+		fout[i].open(path[i], std::ios::binary | std::ios::trunc);
+	}
+	std::vector<uint32_t> words;
+	for (uint64_t time = 0; time < 3; ++time) {
+		auto header = EncodeListModeHeader(0, 2, 1, time, 100);
+		words.insert(words.end(), header.begin(), header.end());
+	}
+	// run ends in the middle of the last event
+	std::vector<uint32_t> expected(words.begin(), words.end() - 2);
+
+	DataWriter writer;
+	writer.SetPipeline(std::make_shared<Pipeline>());
+	writer.Start();
+	writer.Write(&fout[0], 0, std::vector<uint32_t>(expected));
+	writer.EndStream(&fout[0], 0);
+	// the next stream doesn't start with the rest of last stream
+	writer.Write(&fout[1], 0, std::vector<uint32_t>(words));
+	writer.Flush();
+	fout[0].close();
+	EXPECT_EQ(ReadWords(path[0]), expected);
+
+	// stopping writes the incomplete event as well
+	writer.Write(&fout[1], 0, std::vector<uint32_t>(expected));
+	writer.Stop();
+	fout[1].close();
+	std::vector<uint32_t> second = words;
+	second.insert(second.end(), expected.begin(), expected.end());
+	EXPECT_EQ(ReadWords(path[1]), second);
+	for (int i = 0; i < 2; ++i) {
+		std::remove(path[i].c_str());
+	}
+}
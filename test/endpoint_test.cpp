@@ -0,0 +1,82 @@
+/*
+ * This is the test of rpc endpoint. Unix domain socket and TCP endpoints
+ * should be checked, and the endpoint should be chosen from the environment
+ * variable first, then the config, then the default.
+ */
+
+#include "include/endpoint.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+const std::string kConfigPath = "endpoint_test.json";
+
+
+TEST(EndpointTest, Check) {
+	EXPECT_TRUE(IsUnixEndpoint("unix:/tmp/rxdaq.sock"));
+	EXPECT_FALSE(IsUnixEndpoint("localhost:12300"));
+
+	EXPECT_TRUE(CheckEndpoint("unix:/tmp/rxdaq.sock"));
+	EXPECT_TRUE(CheckEndpoint("unix:rxdaq.sock"));
+	EXPECT_TRUE(CheckEndpoint("unix:///tmp/rxdaq.sock"));
+	EXPECT_TRUE(CheckEndpoint("localhost:12300"));
+	EXPECT_TRUE(CheckEndpoint("0.0.0.0:1"));
+	EXPECT_TRUE(CheckEndpoint("[::1]:65535"));
+	EXPECT_FALSE(CheckEndpoint("unix:"));
+	EXPECT_FALSE(CheckEndpoint("unix://"));
+	EXPECT_FALSE(CheckEndpoint("localhost"));
+	EXPECT_FALSE(CheckEndpoint(":12300"));
+	EXPECT_FALSE(CheckEndpoint("localhost:0"));
+	EXPECT_FALSE(CheckEndpoint("localhost:65536"));
+	EXPECT_FALSE(CheckEndpoint("localhost:12a"));
+	EXPECT_FALSE(CheckEndpoint(""));
+}
+
+
+TEST(EndpointTest, Connect) {
+	EXPECT_EQ(ConnectEndpoint("0.0.0.0:12300"), "localhost:12300");
+	EXPECT_EQ(ConnectEndpoint("[::]:12300"), "localhost:12300");
+	EXPECT_EQ(ConnectEndpoint("192.168.1.2:12300"), "192.168.1.2:12300");
+	EXPECT_EQ(ConnectEndpoint("unix:/tmp/rxdaq.sock"), "unix:/tmp/rxdaq.sock");
+	EXPECT_EQ(ConnectEndpoint(""), "");
+}
+
+
+TEST(EndpointTest, Choose) {
+	unsetenv(kEndpointVariable);
+	EXPECT_EQ(EnvironmentEndpoint(), "");
+	EXPECT_EQ(ChooseEndpoint("", kClientEndpoint), kClientEndpoint);
+	EXPECT_EQ(ChooseEndpoint("unix:/tmp/a.sock", kClientEndpoint), "unix:/tmp/a.sock");
+
+	// environment overrides config
+	setenv(kEndpointVariable, "unix:/tmp/b.sock", 1);
+	EXPECT_EQ(ChooseEndpoint("unix:/tmp/a.sock", kClientEndpoint), "unix:/tmp/b.sock");
+	setenv(kEndpointVariable, "", 1);
+	EXPECT_EQ(ChooseEndpoint("unix:/tmp/a.sock", kClientEndpoint), "unix:/tmp/a.sock");
+	setenv(kEndpointVariable, "nothing", 1);
+	EXPECT_THROW(ChooseEndpoint("", kClientEndpoint), UserError);
+	unsetenv(kEndpointVariable);
+}
+
+
+TEST(EndpointTest, Configured) {
+	EXPECT_EQ(ConfiguredEndpoint("endpoint_test_not_exist.json"), "");
+
+	std::ofstream(kConfigPath) << "{\"crateId\": 0, \"rpcEndpoint\": \"unix:/tmp/a.sock\"}";
+	EXPECT_EQ(ConfiguredEndpoint(kConfigPath), "unix:/tmp/a.sock");
+	std::ofstream(kConfigPath) << "{\"crateId\": 0}";
+	EXPECT_EQ(ConfiguredEndpoint(kConfigPath), "");
+	std::ofstream(kConfigPath) << "{\"rpcEndpoint\": 12300}";
+	EXPECT_EQ(ConfiguredEndpoint(kConfigPath), "");
+	std::ofstream(kConfigPath) << "not json";
+	EXPECT_EQ(ConfiguredEndpoint(kConfigPath), "");
+	std::remove(kConfigPath.c_str());
+}
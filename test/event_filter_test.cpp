@@ -0,0 +1,297 @@
+/*
+ * This is the test of event filter and pipeline. Only the raw events accepted
+ * by all rules should be left, and the counts of each rule should be correct.
+ * The result shouldn't depend on how the data is split into blocks.
+ */
+
+#include "include/event_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "include/error.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+
+/// @brief append an event without trace to words
+///
+/// @param[in,out] words words to append
+/// @param[in] channel channel of event
+/// @param[in] time timestamp of event
+/// @param[in] energy energy of event
+///
+void AppendEvent(
+	std::vector<uint32_t> &words,
+	uint8_t channel,
+	uint64_t time,
+	uint16_t energy
+) {
+	auto header = EncodeListModeHeader(0, 2, channel, time, energy);
+	words.insert(words.end(), header.begin(), header.end());
+}
+
+
+/// @brief run words through pipeline with filter of rules
+///
+/// @param[in] json json of rules
+/// @param[in,out] words data to filter
+/// @returns counts of rules
+///
+std::vector<FilterCount> Filter(
+	const nlohmann::json &json,
+	std::vector<uint32_t> &words
+) {
+	auto filter = std::make_shared<EventFilter>(ParseFilterRules(json));
+	Pipeline pipeline;
+	pipeline.AddStage(filter);
+	pipeline.Process(0, words);
+	std::vector<uint32_t> rest;
+	pipeline.Flush(0, rest);
+	words.insert(words.end(), rest.begin(), rest.end());
+	return filter->Counts();
+}
+
+
+/// @brief get channels of events in words
+///
+/// @param[in] words list mode data
+/// @returns channels of events
+///
+std::vector<uint8_t> Channels(const std::vector<uint32_t> &words) {
+	EventBatch batch;
+	DecodeListMode(words.data(), words.size(), batch);
+	return batch.channel;
+}
+
+
+TEST(EventFilterTest, ParseRules) {
+	auto rules = ParseFilterRules(nlohmann::json::parse(R"({"rules": [
+		{"type": "channel", "module": 1, "mask": 3},
+		{"type": "energy", "channel": 2, "min": 10, "max": 20, "name": "e2"},
+		{"type": "multiplicity", "window": 50, "min": 3}
+	]})"));
+	ASSERT_EQ(rules.size(), 3u);
+	EXPECT_EQ(rules[0].type, FilterRuleType::kChannel);
+	EXPECT_EQ(rules[0].name, "channel_0");
+	EXPECT_EQ(rules[0].module, 1);
+	EXPECT_EQ(rules[0].channel, kChannelNum);
+	EXPECT_EQ(rules[0].mask, 3);
+	EXPECT_EQ(rules[1].name, "e2");
+	EXPECT_EQ(rules[1].module, kModuleNum);
+	EXPECT_EQ(rules[1].min_energy, 10);
+	EXPECT_EQ(rules[1].max_energy, 20);
+	EXPECT_EQ(rules[2].window, 50u);
+	EXPECT_EQ(rules[2].multiplicity, 3u);
+
+	std::vector<std::string> errors = {
+		R"({})",
+		R"({"rules": [{"mask": 3}]})",
+		R"({"rules": [{"type": "time"}]})",
+		R"({"rules": [{"type": "channel"}]})",
+		R"({"rules": [{"type": "channel", "mask": 1, "module": 14}]})",
+		R"({"rules": [{"type": "energy", "min": 20, "max": 10}]})",
+		R"({"rules": [{"type": "multiplicity", "window": 10}]})",
+		R"({"rules": [{"type": "multiplicity", "window": 10, "min": 0}]})",
+		R"({"rules": [{"type": "downscale", "window": 10, "factor": 0}]})",
+		R"({"rules": [{"type": "energy", "min": "low"}]})",
+		R"({"rules": [{"type": "energy", "min": -1}]})",
+		R"({"rules": [{"type": "energy", "max": 65536}]})",
+		R"({"rules": [{"type": "channel", "mask": 65536}]})",
+		R"({"rules": [{"type": "multiplicity", "window": 10, "min": -1}]})"
+	};
+	for (const auto &error : errors) {
+		EXPECT_THROW(
+			ParseFilterRules(nlohmann::json::parse(error)), UserError
+		) << error;
+	}
+}
+
+
+TEST(EventFilterTest, ChannelAndEnergy) {
+	std::vector<uint32_t> words;
+	for (uint8_t i = 0; i < 8; ++i) {
+		AppendEvent(words, i % 4, i * 1000, i * 100);
+	}
+	auto counts = Filter(nlohmann::json::parse(R"({"rules": [
+		{"type": "channel", "mask": 7},
+		{"type": "energy", "channel": 1, "min": 200}
+	]})"), words);
+
+	// channel 3 is masked, channel 1 with energy 100 is out of window
+	EXPECT_EQ(Channels(words), std::vector<uint8_t>({0, 2, 0, 1, 2}));
+	ASSERT_EQ(counts.size(), 2u);
+	EXPECT_EQ(counts[0].accepted, 6u);
+	EXPECT_EQ(counts[0].rejected, 2u);
+	EXPECT_EQ(counts[1].accepted, 5u);
+	EXPECT_EQ(counts[1].rejected, 1u);
+}
+
+
+TEST(EventFilterTest, MultiplicityAndDownscale) {
+	std::vector<uint32_t> words;
+	// coincidence of 3 events, not in time order
+	AppendEvent(words, 0, 1005, 1);
+	AppendEvent(words, 1, 1000, 1);
+	AppendEvent(words, 2, 1010, 1);
+	// singles
+	for (uint8_t i = 0; i < 6; ++i) {
+		AppendEvent(words, 3, 2000 + i * 1000, 1);
+	}
+
+	std::vector<uint32_t> multiplicity = words;
+	auto counts = Filter(nlohmann::json::parse(R"({"rules": [
+		{"type": "multiplicity", "window": 10, "min": 3}
+	]})"), multiplicity);
+	EXPECT_EQ(Channels(multiplicity), std::vector<uint8_t>({0, 1, 2}));
+	EXPECT_EQ(counts[0].accepted, 3u);
+	EXPECT_EQ(counts[0].rejected, 6u);
+
+	// keep 1 of 4 singles, and all coincident events
+	counts = Filter(nlohmann::json::parse(R"({"rules": [
+		{"type": "downscale", "window": 10, "factor": 4}
+	]})"), words);
+	EXPECT_EQ(Channels(words), std::vector<uint8_t>({0, 1, 2, 3, 3}));
+	EXPECT_EQ(counts[0].accepted, 5u);
+	EXPECT_EQ(counts[0].rejected, 4u);
+}
+
+
+TEST(EventFilterTest, PipelineCarry) {
+	std::vector<uint32_t> words;
+	for (uint8_t i = 0; i < 4; ++i) {
+		AppendEvent(words, i, i * 1000, 100);
+	}
+	auto filter = std::make_shared<EventFilter>(
+		ParseFilterRules(nlohmann::json::parse(
+			R"({"rules": [{"type": "channel", "module": 0, "mask": 10}]})"
+		))
+	);
+	Pipeline pipeline;
+	pipeline.AddStage(filter);
+	EXPECT_EQ(pipeline.Stages().size(), 1u);
+
+	// the event split between reads is kept until complete
+	std::vector<uint32_t> first(words.begin(), words.begin() + 6);
+	std::vector<uint32_t> second(words.begin() + 6, words.end());
+	pipeline.Process(0, first);
+	EXPECT_EQ(first.size(), 0u);
+	pipeline.Process(0, second);
+	EXPECT_EQ(Channels(second), std::vector<uint8_t>({1, 3}));
+
+	// rule of module 0 doesn't apply to module 1
+	std::vector<uint32_t> other = words;
+	pipeline.Process(1, other);
+	EXPECT_EQ(other, words);
+
+	// invalid data is written as it is
+	std::vector<uint32_t> invalid = {0, 0, 0, 0, 0};
+	pipeline.Process(0, invalid);
+	EXPECT_EQ(invalid.size(), 5u);
+	EXPECT_EQ(pipeline.InvalidBlocks(), 1u);
+
+	auto counts = filter->Counts();
+	EXPECT_EQ(counts[0].accepted, 2u);
+	EXPECT_EQ(counts[0].rejected, 2u);
+	pipeline.Reset();
+	counts = filter->Counts();
+	EXPECT_EQ(counts[0].accepted, 0u);
+	EXPECT_EQ(counts[0].rejected, 0u);
+}
+
+
+TEST(EventFilterTest, AcrossBlocks) {
+	std::vector<uint32_t> words;
+	// coincidences of 2 and 3 events, and singles in between
+	for (uint64_t i = 0; i < 20; ++i) {
+		uint64_t time = i * 100;
+		AppendEvent(words, i % 2, time, 1);
+		if (i % 3 == 0) AppendEvent(words, 2, time + 5, 1);
+		if (i % 6 == 0) AppendEvent(words, 3, time + 8, 1);
+	}
+	const auto rules = nlohmann::json::parse(R"({"rules": [
+		{"type": "downscale", "window": 10, "factor": 3},
+		{"type": "multiplicity", "channel": 0, "window": 10, "min": 2}
+	]})");
+	std::vector<uint32_t> expected = words;
+	auto expected_counts = Filter(rules, expected);
+	// singles of channel 0 are dropped by multiplicity, 1 of 3 singles are
+	// kept by downscale
+	EXPECT_EQ(Channels(expected), std::vector<uint8_t>({
+		0, 2, 3, 1, 1, 2, 1, 0, 2, 3, 1, 2, 0, 2, 3, 1, 2, 0, 2, 3, 1
+	}));
+
+	// split into two blocks at each event boundary and in the middle of event
+	for (size_t split = 0; split <= words.size(); ++split) {
+		auto filter = std::make_shared<EventFilter>(ParseFilterRules(rules));
+		Pipeline pipeline;
+		pipeline.AddStage(filter);
+		std::vector<uint32_t> first(words.begin(), words.begin() + split);
+		std::vector<uint32_t> second(words.begin() + split, words.end());
+		std::vector<uint32_t> rest;
+		pipeline.Process(0, first);
+		pipeline.Process(0, second);
+		pipeline.Flush(0, rest);
+		first.insert(first.end(), second.begin(), second.end());
+		first.insert(first.end(), rest.begin(), rest.end());
+		EXPECT_EQ(first, expected) << split;
+		auto counts = filter->Counts();
+		for (size_t r = 0; r < counts.size(); ++r) {
+			EXPECT_EQ(counts[r].accepted, expected_counts[r].accepted) << split;
+			EXPECT_EQ(counts[r].rejected, expected_counts[r].rejected) << split;
+		}
+	}
+}
+
+
+TEST(EventFilterTest, DownscaleOutOfOrder) {
+	// events are read out of order by more than the window
+	GenerateOptions options;
+	options.step = 60;
+	options.jitter = 200;
+	options.trace_ratio = 0;
+	const std::vector<uint32_t> words = GenerateListMode(5000, options);
+
+	// singles have no other event in the window
+	const uint64_t window = 10;
+	EventBatch events;
+	DecodeListMode(words.data(), words.size(), events);
+	std::vector<uint64_t> time = events.time;
+	std::sort(time.begin(), time.end());
+	uint64_t singles = 0;
+	for (size_t i = 0; i < time.size(); ++i) {
+		bool before = i && time[i] - time[i-1] <= window;
+		bool after = i + 1 < time.size() && time[i+1] - time[i] <= window;
+		singles += !before && !after;
+	}
+	ASSERT_GT(singles, 1000u);
+
+	const auto rules = nlohmann::json::parse(R"({"rules": [
+		{"type": "downscale", "window": 10, "factor": 3}
+	]})");
+	for (size_t block : {size_t(97), size_t(1000), words.size()}) {
+		auto filter = std::make_shared<EventFilter>(ParseFilterRules(rules));
+		Pipeline pipeline;
+		pipeline.AddStage(filter);
+		std::vector<uint32_t> result;
+		for (size_t begin = 0; begin < words.size(); begin += block) {
+			std::vector<uint32_t> part(
+				words.begin() + begin,
+				words.begin() + std::min(words.size(), begin + block)
+			);
+			pipeline.Process(0, part);
+			result.insert(result.end(), part.begin(), part.end());
+		}
+		std::vector<uint32_t> rest;
+		pipeline.Flush(0, rest);
+		result.insert(result.end(), rest.begin(), rest.end());
+
+		// exactly one of 3 singles is kept
+		const uint64_t kept = (singles + 2) / 3;
+		EXPECT_EQ(Channels(result).size(), events.Size() - singles + kept) << block;
+		EXPECT_EQ(filter->Counts()[0].rejected, singles - kept) << block;
+	}
+}
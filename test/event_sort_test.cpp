@@ -0,0 +1,111 @@
+/*
+ * This is the test of sorting events by timestamp. The sorted file should
+ * hold all events of the input files in time order, the same events with
+ * the same timestamp in order of files, with any memory budget.
+ */
+
+#include "include/event_sort.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/error.h"
+#include "include/list_mode.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kTempPath = "event_sort_test_temp";
+
+
+TEST(EventSortTest, RadixSort) {
+	std::mt19937_64 engine(3);
+	std::vector<SortKey> keys;
+	for (uint64_t i = 0; i < 100000; ++i) {
+		// duplicated timestamps to check stability
+		keys.push_back(SortKey{(engine() % 50000) << (i % 3 * 16), i, 4});
+	}
+	std::vector<SortKey> expected(keys);
+	std::stable_sort(
+		expected.begin(), expected.end(),
+		[](const SortKey &a, const SortKey &b) { return a.time < b.time; }
+	);
+	RadixSortKeys(keys);
+	ASSERT_EQ(keys.size(), expected.size());
+	for (size_t i = 0; i < keys.size(); ++i) {
+		EXPECT_EQ(keys[i].time, expected[i].time);
+		EXPECT_EQ(keys[i].offset, expected[i].offset);
+	}
+
+	std::vector<SortKey> empty;
+	EXPECT_NO_THROW(RadixSortKeys(empty));
+}
+
+
+TEST(EventSortTest, SortRun) {
+	std::vector<std::string> files = {"event_sort_test_0.bin", "event_sort_test_1.bin"};
+	std::vector<uint32_t> all;
+	for (size_t i = 0; i < files.size(); ++i) {
+		// channels are read out of order in a short window
+		GenerateOptions options;
+		options.seed = i;
+		options.slot = i + 2;
+		options.time = 0xfff0000;
+		options.jitter = 500;
+		std::vector<uint32_t> words = GenerateListMode(20000, options);
+		all.insert(all.end(), words.begin(), words.end());
+		WriteWords(files[i], words);
+	}
+	// expected order, stable sort of events of all files
+	EventBatch events;
+	ASSERT_EQ(DecodeListMode(all.data(), all.size(), events), all.size());
+	std::vector<size_t> order(events.Size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return events.time[a] < events.time[b];
+	});
+	std::vector<uint32_t> expected;
+	for (const auto &i : order) {
+		const uint32_t *event = all.data() + events.offset[i];
+		expected.insert(expected.end(), event, event + events.length[i]);
+	}
+
+	// single pass with large memory, and several passes with small memory
+	const std::string output = "event_sort_test_output.bin";
+	std::vector<SortOptions> options = {
+		SortOptions{kDefaultSortMemory, "", 0},
+		SortOptions{kMinMergeBuffer * 4, kTempPath, 3},
+		SortOptions{0, kTempPath, 1}
+	};
+	for (const auto &option : options) {
+		SortResult result = SortRun(files, output, option);
+		EXPECT_EQ(result.files, 2u);
+		EXPECT_EQ(result.events, 40000u);
+		EXPECT_EQ(result.bytes, all.size() * sizeof(uint32_t));
+		EXPECT_EQ(ReadWords(output), expected);
+		if (option.memory < kMinMergeBuffer * 4) {
+			EXPECT_GT(result.passes, 1u);
+		}
+	}
+
+	// temporary files are removed
+	EXPECT_TRUE(std::filesystem::is_empty(kTempPath));
+
+	EXPECT_THROW(SortRun(files, files[0], options[0]), RXError);
+	EXPECT_THROW(
+		SortRun({"event_sort_test_not_exist.bin"}, output, options[0]),
+		RXError
+	);
+
+	for (const auto &file : files) {
+		std::remove(file.c_str());
+	}
+	std::remove(output.c_str());
+	std::filesystem::remove_all(kTempPath);
+}
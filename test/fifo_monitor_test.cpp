@@ -0,0 +1,64 @@
+/*
+ * This is the test of FIFO level monitor. Polls should be counted by fill
+ * level, the time at or above the marks should be counted until the next
+ * poll, and crossing a mark upward should warn unless warned recently.
+ */
+
+#include "include/fifo_monitor.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace rxdaq;
+
+
+TEST(FifoMonitorTest, Levels) {
+	FifoMonitor monitor(1000);
+	monitor.Reset({0.5, 0.8});
+	EXPECT_TRUE(monitor.Stats().empty());
+
+	EXPECT_EQ(monitor.Record(0, 100, 0.0), -1);
+	// cross marks upward
+	EXPECT_EQ(monitor.Record(0, 600, 1.0), 0);
+	EXPECT_EQ(monitor.Record(0, 850, 2.0), 1);
+	EXPECT_EQ(monitor.Record(0, 200, 3.0), -1);
+	// warned recently
+	EXPECT_EQ(monitor.Record(0, 900, 4.0), -1);
+	EXPECT_EQ(monitor.Record(0, 100, 13.0), -1);
+	EXPECT_EQ(monitor.Record(0, 1000, 14.0), 1);
+	// staying above doesn't warn
+	EXPECT_EQ(monitor.Record(0, 1000, 15.0), -1);
+	EXPECT_EQ(monitor.Record(5, 0, 1.0), -1);
+	// out of modules
+	EXPECT_EQ(monitor.Record(kModuleNum, 1000, 1.0), -1);
+
+	std::vector<FifoLevelStats> stats = monitor.Stats();
+	ASSERT_EQ(stats.size(), 2u);
+	EXPECT_EQ(stats[0].module, 0);
+	std::array<uint64_t, kFifoLevelBins> polls{0, 2, 1, 0, 0, 0, 1, 0, 1, 3};
+	EXPECT_EQ(stats[0].polls, polls);
+	EXPECT_DOUBLE_EQ(stats[0].max_fill, 1.0);
+	ASSERT_EQ(stats[0].seconds_above.size(), 2u);
+	// [1, 3), [4, 13) and [14, 15)
+	EXPECT_NEAR(stats[0].seconds_above[0], 12.0, 1e-6);
+	// [2, 3), [4, 13) and [14, 15)
+	EXPECT_NEAR(stats[0].seconds_above[1], 11.0, 1e-6);
+	EXPECT_EQ(stats[1].module, 5);
+	EXPECT_EQ(stats[1].polls[0], 1u);
+	EXPECT_DOUBLE_EQ(stats[1].max_fill, 0.0);
+
+	std::string info = FifoLevelInfo(stats, monitor.Marks());
+	EXPECT_NE(info.find(">50%"), std::string::npos) << info;
+	EXPECT_NE(info.find(">80%"), std::string::npos) << info;
+	EXPECT_NE(info.find("module  0"), std::string::npos) << info;
+	EXPECT_NE(info.find("module  5"), std::string::npos) << info;
+	EXPECT_EQ(FifoLevelInfo({}, monitor.Marks()), "");
+
+	// at most kMaxFifoMarks marks
+	monitor.Reset({0.1, 0.2, 0.3, 0.4, 0.5});
+	EXPECT_EQ(monitor.Marks().size(), kMaxFifoMarks);
+	EXPECT_TRUE(monitor.Stats().empty());
+	EXPECT_EQ(monitor.Record(0, 450, 0.0), 3);
+}
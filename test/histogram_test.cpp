@@ -0,0 +1,192 @@
+/*
+ * This is the test of histograms. Values should fall into the right bins,
+ * histograms filled in parallel should be the same as filling all events in
+ * one thread, and histograms should be kept through the binary file.
+ */
+
+#include "include/histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "include/columnar.h"
+#include "include/error.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+
+/// @brief get options of events in time order, some with QDC sums
+///
+/// @param[in] seed seed of random generator
+/// @returns options of generated data
+///
+GenerateOptions DataOptions(unsigned int seed) {
+	GenerateOptions options;
+	options.seed = seed;
+	options.slots = 4;
+	options.time = 0x10000000;
+	options.step = 200;
+	options.trace_words = 20;
+	options.qdc = true;
+	return options;
+}
+
+
+/// @brief check two lists of histograms are the same
+///
+/// @param[in] a first list
+/// @param[in] b second list
+///
+void ExpectSame(
+	const std::vector<const Histogram*> &a,
+	const std::vector<const Histogram*> &b
+) {
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		EXPECT_EQ(a[i]->Name(), b[i]->Name());
+		EXPECT_EQ(a[i]->Counts(), b[i]->Counts()) << a[i]->Name();
+	}
+}
+
+
+TEST(HistogramTest, Fill) {
+	Histogram histogram("test", 10, 0.0, 100.0);
+	histogram.Fill(-1.0);
+	histogram.Fill(0.0);
+	histogram.Fill(9.99);
+	histogram.Fill(55.0);
+	histogram.Fill(100.0);
+	EXPECT_EQ(histogram.Count(0), 1u);
+	EXPECT_EQ(histogram.Count(1), 2u);
+	EXPECT_EQ(histogram.Count(6), 1u);
+	EXPECT_EQ(histogram.Count(11), 1u);
+
+	Histogram other("test", 10, 0.0, 100.0);
+	other.Fill(55.0);
+	histogram.Add(other);
+	EXPECT_EQ(histogram.Count(6), 2u);
+	EXPECT_THROW(histogram.Add(Histogram("test", 20, 0.0, 100.0)), RXError);
+
+	Histogram two("two", 4, 0.0, 4.0, 2, 0.0, 2.0);
+	two.Fill(1.5, 1.5);
+	two.Fill(1.5, 5.0);
+	EXPECT_EQ(two.Count(2, 2), 1u);
+	EXPECT_EQ(two.Count(2, 3), 1u);
+
+	EXPECT_THROW(Histogram("bad", 0, 0.0, 1.0), RXError);
+	EXPECT_THROW(Histogram("bad", 10, 1.0, 1.0), RXError);
+}
+
+
+TEST(HistogramTest, FillEvents) {
+	HistogramOptions options = DefaultHistogramOptions();
+	options.window = 10;
+	options.time_bins = 20;
+	std::vector<uint32_t> words;
+	for (uint64_t time : {100, 105, 200, 198}) {
+		auto header = EncodeListModeHeader(0, 2, time % 16, time, 1000, 0, 12);
+		header[4 + options.qdc_gate] = 5000;
+		words.insert(words.end(), header.begin(), header.end());
+	}
+	EventBatch events;
+	ASSERT_EQ(DecodeListMode(words.data(), words.size(), events), words.size());
+
+	HistogramSet set(options);
+	set.Fill(events, words.data());
+	EXPECT_EQ(set.Events(), 4u);
+	std::vector<const Histogram*> histograms = set.Histograms();
+	// 4 channels of energy and QDC, time difference and energy-energy
+	ASSERT_EQ(histograms.size(), 10u);
+	const Histogram &qdc = *histograms[4];
+	EXPECT_EQ(qdc.Name(), "qdc_C0_S2_CH04");
+	EXPECT_EQ(qdc.Count(5000 * 4096 / 1048576 + 1), 1u);
+	// pairs of 100-105 and 200-198
+	const Histogram &difference = *histograms[8];
+	EXPECT_EQ(difference.Count(5 + 10 + 1), 1u);
+	EXPECT_EQ(difference.Count(-2 + 10 + 1), 1u);
+	const Histogram &coincidence = *histograms[9];
+	EXPECT_EQ(coincidence.Count(1000 * 512 / 65536 + 1, 1000 * 512 / 65536 + 1), 2u);
+
+	options.qdc_gate = 8;
+	EXPECT_THROW(HistogramSet{options}, RXError);
+}
+
+
+TEST(HistogramTest, FillHistograms) {
+	std::vector<std::string> files = {"histogram_test_0.bin", "histogram_test_1.bin"};
+	HistogramOptions options = DefaultHistogramOptions();
+	HistogramSet expected(options);
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::vector<uint32_t> words = GenerateListMode(20000, DataOptions(i));
+		WriteWords(files[i], words);
+		// fill with the same chunks in one thread
+		options.chunk_words = 1000;
+		for (const auto &chunk : SplitChunks(words.data(), words.size(), 1000)) {
+			EventBatch events;
+			const uint32_t *data = words.data() + chunk.begin;
+			DecodeListMode(data, chunk.end - chunk.begin, events);
+			expected.Fill(events, data);
+		}
+	}
+
+	for (unsigned int threads : {1, 4}) {
+		options.threads = threads;
+		HistogramSet result = FillHistograms(files, options);
+		EXPECT_EQ(result.Events(), 40000u);
+		ExpectSame(result.Histograms(), expected.Histograms());
+	}
+
+	EXPECT_THROW(
+		FillHistograms({"histogram_test_not_exist.bin"}, options), RXError
+	);
+	for (const auto &file : files) {
+		std::remove(file.c_str());
+	}
+}
+
+
+TEST(HistogramTest, WriteHistograms) {
+	std::vector<uint32_t> words = GenerateListMode(5000, DataOptions(7));
+	EventBatch events;
+	DecodeListMode(words.data(), words.size(), events);
+	HistogramSet set(DefaultHistogramOptions());
+	set.Fill(events, words.data());
+
+	const std::string path = "histogram_test.rxh";
+	WriteHistograms(path, set.Histograms());
+	std::vector<Histogram> histograms = ReadHistograms(path);
+	std::vector<const Histogram*> read;
+	for (const auto &histogram : histograms) {
+		read.push_back(&histogram);
+	}
+	ExpectSame(read, set.Histograms());
+	EXPECT_EQ(read.back()->YBins(), 512u);
+
+	// CSV has header and one line for each non-empty bin
+	const std::string csv = "histogram_test.csv";
+	WriteHistogramsCsv(csv, {read[0]});
+	std::ifstream fin(csv);
+	std::string line;
+	std::getline(fin, line);
+	EXPECT_EQ(line, "name,x,y,count");
+	uint64_t total = 0;
+	while (std::getline(fin, line)) {
+		EXPECT_EQ(line.substr(0, line.find(',')), read[0]->Name());
+		total += std::stoull(line.substr(line.rfind(',') + 1));
+	}
+	uint64_t expected = 0;
+	for (uint32_t x = 1; x <= read[0]->XBins(); ++x) {
+		expected += read[0]->Count(x);
+	}
+	EXPECT_EQ(total, expected);
+	EXPECT_GT(total, 0u);
+
+	EXPECT_THROW(ReadHistograms(csv), RXError);
+	std::remove(path.c_str());
+	std::remove(csv.c_str());
+}
@@ -1,5 +1,7 @@
+#include <cstdio>
 #include <cstring>
 
+#include <fstream>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -7,6 +9,7 @@
 #include <gtest/gtest.h>
 
 #include "include/crate.h"
+#include "include/endpoint.h"
 #include "include/error.h"
 #include "include/interactor.h"
 #include "include/parser.h"
@@ -21,8 +24,45 @@ vector<string> kErrorArgs = {
 	"help help help",
 	"help boot help",
 	"help nothing",
+	"rpc --metrics 70000",
+	"rpc -e unix:",
+	"rpc -e localhost",
+	"rpc -e unix:/tmp/rxdaq.sock -p 12301",
 	"boot 20",
-	"boot 0 2"
+	"boot 0 2",
+	"trace",
+	"trace pause",
+	"run --runs 3",
+	"run -t 10 --roll-time 5",
+	"run --roll-size -1",
+	"run --rates -1",
+	"status 3",
+	"stop now",
+	"stats now",
+	"filter rules.json --off",
+	"filter a.json b.json",
+	"reduce --pre -1",
+	"reduce --off --post 10",
+	"reduce --drop-energy 70000",
+	"query",
+	"query a.bin -c 16",
+	"query a.bin -c 1,x",
+	"query a.bin -b 10 -e 5",
+	"query a.bin b.bin",
+	"convert",
+	"convert a.bin",
+	"convert a.bin -o out --chunk-size 0",
+	"sort",
+	"sort a.bin",
+	"sort a.bin -o b.bin -m 0",
+	"hist",
+	"hist a.bin",
+	"hist a.bin -o h -w 0",
+	"hist a.bin -o h --qdc-gate 8",
+	"verify",
+	"replay a.bin",
+	"replay a.bin -o out -s -1",
+	"replay a.bin -o out --block 0"
 };
 
 
@@ -41,15 +81,21 @@ vector<HelpData> kHelpCommands = {
 struct BootData {
 	string input;
 	unsigned short module;
+	bool fast;
+	bool dry_run;
 };
 vector<BootData> kBootCommands = {
-	{"boot", 13},
-	{"boot 13", 13},
-	{"boot 4", 4},
-	{"boot -m 2", 2},
-	{"boot --module 10", 10},
-	{"boot -m 13", 13},
-	{"boot -m 0 2", 0}
+	{"boot", 13, true, false},
+	{"boot 13", 13, true, false},
+	{"boot 4", 4, true, false},
+	{"boot -m 2", 2, true, false},
+	{"boot --module 10", 10, true, false},
+	{"boot -m 13", 13, true, false},
+	{"boot -m 0 2", 0, true, false},
+	{"boot -f", 13, false, false},
+	{"boot --force 3", 3, false, false},
+	{"boot --dry-run", 13, true, true},
+	{"boot --dry-run -f 5", 5, false, true}
 };
 
 struct WriteData {
@@ -208,20 +254,24 @@ TEST(InteractorTest, ParseBootCommand) {
 
 
 		EXPECT_NO_THROW(interactor->Run(crate));
+
+		TestCrate::ModuleStatus status = kBootCommands[i].dry_run ?
+			TestCrate::ModuleStatus::kInitial :
+			TestCrate::ModuleStatus::kBooted;
 		
 		if (kBootCommands[i].module == kModuleNum) {
 			for (unsigned short j = 0; j < crate->ModuleNum(); ++j) {
-				EXPECT_EQ(crate->modules_[j].status, TestCrate::ModuleStatus::kBooted)
-					<< "Error: module didn't boot " << j;
-				EXPECT_EQ(crate->modules_[j].boot_mode, false)
-					<< "Error: module didn't boot entirely " << j;
+				EXPECT_EQ(crate->modules_[j].status, status)
+					<< "Error: module boot status " << j;
+				EXPECT_EQ(crate->modules_[j].boot_mode, kBootCommands[i].fast)
+					<< "Error: module boot mode " << j;
 			}
 		} else {
 			unsigned short index = kBootCommands[i].module;
-			EXPECT_EQ(crate->modules_[index].status, TestCrate::ModuleStatus::kBooted)
-				<< "Error: module didn't boot " << index;
-			EXPECT_EQ(crate->modules_[index].boot_mode, false)
-				<< "Error: module didn't boot entirely " << index;
+			EXPECT_EQ(crate->modules_[index].status, status)
+				<< "Error: module boot status " << index;
+			EXPECT_EQ(crate->modules_[index].boot_mode, kBootCommands[i].fast)
+				<< "Error: module boot mode " << index;
 		}
 	}
 
@@ -393,4 +443,259 @@ TEST(InteractorTest, RunCommand) {
 	}
 
 	FreeArgs(argv);
-}
\ No newline at end of file
+}
+
+
+TEST(InteractorTest, ContinuousRunCommand) {
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	auto crate = std::make_shared<TestCrate>();
+
+	Parser parser;
+	SeperateArguments("run 2 --roll-time 600 --runs 5 -r 7", argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->roll_.seconds, 600u);
+	EXPECT_EQ(crate->roll_.bytes, 0u);
+	EXPECT_EQ(crate->roll_.runs, 5u);
+	EXPECT_EQ(crate->run_number_, 7);
+	EXPECT_EQ(crate->modules_[2].status, TestCrate::ModuleStatus::kRunning);
+
+	SeperateArguments("run --roll-size 2048", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->roll_.seconds, 0u);
+	EXPECT_EQ(crate->roll_.bytes, 2048ull << 20);
+	EXPECT_EQ(crate->roll_.runs, 0u);
+	EXPECT_EQ(crate->run_number_, -1);
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, RunControlCommand) {
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	auto crate = std::make_shared<TestCrate>();
+
+	Parser parser;
+	SeperateArguments("status", argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "status");
+	EXPECT_NO_THROW(interactor->Run(crate));
+
+	SeperateArguments("run -d -r 3 -t 60", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->runs_, vector<unsigned int>({3}));
+
+	SeperateArguments("status --wait", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+
+	SeperateArguments("stop -w", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "stop");
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->stopped_, 1u);
+
+	SeperateArguments("stats -m Boot", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "stats");
+	EXPECT_NO_THROW(interactor->Run(crate));
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, FilterCommand) {
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	auto crate = std::make_shared<TestCrate>();
+
+	Parser parser;
+	SeperateArguments("filter", argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "filter");
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->filter_path_, "");
+
+	SeperateArguments("filter rules.json", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->filter_path_, "rules.json");
+
+	SeperateArguments("filter", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->filter_path_, "rules.json");
+
+	SeperateArguments("filter --off", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_EQ(crate->filter_path_, "");
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, ReduceCommand) {
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	auto crate = std::make_shared<TestCrate>();
+
+	Parser parser;
+	SeperateArguments("reduce", argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "reduce");
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_FALSE(crate->reduce_);
+
+	SeperateArguments("reduce --pre 40 --post 160", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_TRUE(crate->reduce_);
+	EXPECT_EQ(crate->reduction_.pre, 40u);
+	EXPECT_EQ(crate->reduction_.post, 160u);
+	EXPECT_EQ(crate->reduction_.trigger, -1);
+	EXPECT_EQ(crate->reduction_.drop_energy, 0);
+
+	SeperateArguments("reduce --drop-energy 20000 --trigger 100", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_TRUE(crate->reduce_);
+	EXPECT_GT(crate->reduction_.pre, 100u);
+	EXPECT_EQ(crate->reduction_.trigger, 100);
+	EXPECT_EQ(crate->reduction_.drop_energy, 20000);
+
+	SeperateArguments("reduce --off", argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_FALSE(crate->reduce_);
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, TraceCommand) {
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	auto crate = std::make_shared<TestCrate>();
+	const std::string path = "interactor_test_trace.json";
+
+	Parser parser;
+	SeperateArguments("trace start", argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	EXPECT_EQ(interactor->CommandName(), "trace");
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_TRUE(Tracer::Instance().Enabled());
+
+	SeperateArguments("trace stop -o " + path, argc, argv);
+	interactor = parser.Parse(argc, argv);
+	EXPECT_NO_THROW(interactor->Run(crate));
+	EXPECT_FALSE(Tracer::Instance().Enabled());
+	std::ifstream fin(path);
+	EXPECT_TRUE(fin.good());
+	fin.close();
+	std::remove(path.c_str());
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, ShellCommand) {
+	EXPECT_EQ(
+		SplitCommandLine("  export  'my params.json' \"\" "),
+		vector<string>({"export", "my params.json", ""})
+	);
+	EXPECT_THROW(SplitCommandLine("export 'params.json"), UserError);
+
+	// commands share the same crate
+	auto crate = std::make_shared<TestCrate>();
+	ShellCommandParser shell;
+	EXPECT_NO_THROW(shell.RunCommand("boot 2", crate));
+	EXPECT_NO_THROW(shell.RunCommand("export params.json", crate));
+	EXPECT_EQ(crate->modules_[2].status, TestCrate::ModuleStatus::kExported);
+	EXPECT_EQ(crate->modules_[3].config_file, "params.json");
+	EXPECT_THROW(shell.RunCommand("nothing", crate), UserError);
+	EXPECT_THROW(shell.RunCommand("shell", crate), UserError);
+	EXPECT_THROW(shell.RunCommand("boot 20", crate), UserError);
+
+	// run commands in file, and report failed commands
+	const std::string path = "interactor_test_shell.txt";
+	std::ofstream fout(path);
+	fout << "# comment\n\nboot 1\nboot 20\nexport \"shell params.json\"\n"
+		<< "exit\nboot 30\n";
+	fout.close();
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	Parser parser;
+	SeperateArguments("shell " + path, argc, argv);
+	auto interactor = parser.Parse(argc, argv);
+	crate = std::make_shared<TestCrate>();
+	EXPECT_THROW(interactor->Run(crate), UserError);
+	EXPECT_EQ(crate->modules_[1].config_file, "shell params.json");
+	std::remove(path.c_str());
+
+	FreeArgs(argv);
+}
+
+
+TEST(InteractorTest, ConfigEndpoint) {
+	// clients find the server from the config given to the command
+	const std::string path = "interactor_test_rpc.json";
+	std::ofstream(path) << "{\"rpcEndpoint\": \"unix:/tmp/rxdaq_test.sock\"}";
+	int argc;
+	char **argv;
+	argv = new char*[kArgSize];
+	for (size_t i = 0; i < kArgSize; ++i) {
+		argv[i] = new char[kArgMaxLength];
+	}
+	const vector<string> commands = {
+		"boot --config " + path,
+		"run --config " + path,
+		"export params.json --config " + path
+	};
+	for (const auto &command : commands) {
+		Parser parser;
+		SeperateArguments(command, argc, argv);
+		auto interactor = parser.Parse(argc, argv);
+		EXPECT_EQ(interactor->ConfigPath(), path) << command;
+		EXPECT_EQ(
+			ConfiguredEndpoint(interactor->ConfigPath()),
+			"unix:/tmp/rxdaq_test.sock"
+		) << command;
+	}
+
+	// default config without the option
+	Parser parser;
+	SeperateArguments("status", argc, argv);
+	EXPECT_EQ(parser.Parse(argc, argv)->ConfigPath(), "config.json");
+	std::remove(path.c_str());
+
+	FreeArgs(argv);
+}
@@ -0,0 +1,75 @@
+/*
+ * This is the test of list mode decoding. Events encoded should be decoded
+ * to the same fields, and the incomplete event at the end should be left.
+ */
+
+#include "include/list_mode.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+
+TEST(ListModeTest, DecodeEncoded) {
+	std::vector<uint32_t> words;
+	auto first = EncodeListModeHeader(1, 2, 3, 0x123456789abcull, 1000);
+	auto second = EncodeListModeHeader(0, 15, 15, 100, 65535, 4, 6);
+	words.insert(words.end(), first.begin(), first.end());
+	words.insert(words.end(), second.begin(), second.end());
+	// CFD of first event
+	words[2] |= 0x1234u << list_mode::kCfdShift;
+	// trace of second event
+	words.push_back(0x00020001);
+	words.push_back(0x00040003);
+
+	EventBatch batch;
+	EXPECT_EQ(DecodeListMode(words.data(), words.size(), batch), words.size());
+	ASSERT_EQ(batch.Size(), 2u);
+	EXPECT_EQ(batch.offset, std::vector<uint32_t>({0, 4}));
+	EXPECT_EQ(batch.length, std::vector<uint32_t>({4, 8}));
+	EXPECT_EQ(batch.header_length, std::vector<uint8_t>({4, 6}));
+	EXPECT_EQ(batch.crate, std::vector<uint8_t>({1, 0}));
+	EXPECT_EQ(batch.slot, std::vector<uint8_t>({2, 15}));
+	EXPECT_EQ(batch.channel, std::vector<uint8_t>({3, 15}));
+	EXPECT_EQ(batch.finish_code, std::vector<uint8_t>({0, 0}));
+	EXPECT_EQ(batch.time, std::vector<uint64_t>({0x123456789abcull, 100}));
+	EXPECT_EQ(batch.cfd, std::vector<uint16_t>({0x1234, 0}));
+	EXPECT_EQ(batch.energy, std::vector<uint16_t>({1000, 65535}));
+	EXPECT_EQ(batch.trace_length, std::vector<uint16_t>({0, 4}));
+
+	batch.Clear();
+	EXPECT_EQ(batch.Size(), 0u);
+}
+
+
+TEST(ListModeTest, IncompleteEvent) {
+	std::vector<uint32_t> words = EncodeListModeHeader(0, 2, 0, 10, 20);
+	auto traced = EncodeListModeHeader(0, 2, 1, 11, 21, 8);
+	words.insert(words.end(), traced.begin(), traced.end());
+	words.push_back(0);
+
+	EventBatch batch;
+	// the second event lacks 3 words of trace
+	EXPECT_EQ(DecodeListMode(words.data(), words.size(), batch), 4u);
+	EXPECT_EQ(batch.Size(), 1u);
+
+	// the header is not complete
+	batch.Clear();
+	EXPECT_EQ(DecodeListMode(words.data(), 3, batch), 0u);
+	EXPECT_EQ(batch.Size(), 0u);
+}
+
+
+TEST(ListModeTest, InvalidHeader) {
+	std::vector<uint32_t> words = EncodeListModeHeader(0, 2, 0, 10, 20);
+	words.push_back(0);
+	words.push_back(0);
+	words.push_back(0);
+	words.push_back(0);
+	EventBatch batch;
+	EXPECT_THROW(DecodeListMode(words.data(), words.size(), batch), RXError);
+}
@@ -93,4 +93,73 @@ TEST(MessageTest, MultiThread) {
 		output += output;
 	}
 	EXPECT_EQ(ss.str(), output);
-}
\ No newline at end of file
+}
+
+TEST(MessageTest, Async) {
+	Message message(Message::Level::kInfo);
+	message.SetAsync();
+	stringstream ss;
+	vector<thread> threads;
+	for (size_t i = 0; i < 8; ++i) {
+		threads.emplace_back([&ss, &message]() {
+			for (size_t j = 0; j < 16; ++j) {
+				ss << message(Message::Level::kInfo) << "info-" << j << "\n";
+				ss << message(Message::Level::kDebug) << "debug\n";
+			}
+		});
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+	Message::Flush();
+
+	// every message is complete, and filtered messages are not written
+	string line;
+	size_t lines = 0;
+	while (getline(ss, line)) {
+		EXPECT_EQ(line.substr(0, 5), "info-");
+		++lines;
+	}
+	EXPECT_EQ(lines, 128u);
+}
+
+
+TEST(MessageTest, AsyncThreadExit) {
+	Message message(Message::Level::kInfo);
+	message.SetAsync();
+	stringstream ss;
+	// threads come and go like run threads, the queue of an exited thread
+	// is reused with its records kept in order
+	for (size_t i = 0; i < 200; ++i) {
+		thread t([&ss, &message, i]() {
+			ss << message(Message::Level::kInfo) << "thread-" << i << "\n";
+		});
+		t.join();
+	}
+	Message::Flush();
+
+	string line;
+	size_t lines = 0;
+	while (getline(ss, line)) {
+		EXPECT_EQ(line, "thread-" + to_string(lines));
+		++lines;
+	}
+	EXPECT_EQ(lines, 200u);
+}
+
+
+TEST(MessageTest, Timestamp) {
+	Message message(Message::Level::kInfo);
+	message.SetPrefix();
+	message.SetTimestamp();
+	stringstream ss;
+	ss << message(Message::Level::kInfo) << "Info";
+	ss << message(Message::Level::kDebug) << "Debug";
+
+	// HH:MM:SS.mmm INFO: Info
+	string output = ss.str();
+	ASSERT_EQ(output.size(), 23u);
+	EXPECT_EQ(output[2], ':');
+	EXPECT_EQ(output[8], '.');
+	EXPECT_EQ(output.substr(12), " INFO: Info");
+}
@@ -0,0 +1,208 @@
+/*
+ * This is the test of metrics. Latencies should be counted in the right
+ * buckets, the metrics should be exported in Prometheus text format, and the
+ * server should answer GET /metrics over HTTP.
+ */
+
+#include "include/metrics.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+
+/// @brief get a page from the local metrics server
+///
+/// @param[in] port port of server
+/// @param[in] target target of GET request
+/// @returns response, empty if failed
+///
+std::string Get(unsigned short port, const std::string &target) {
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	if (client < 0) return "";
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	std::string response;
+	if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+		std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+		send(client, request.data(), request.size(), 0);
+		char buffer[4096];
+		ssize_t size;
+		while ((size = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+			response.append(buffer, size);
+		}
+	}
+	close(client);
+	return response;
+}
+
+
+TEST(MetricsTest, LatencyHistogram) {
+	LatencyHistogram histogram;
+	histogram.Observe(0.0001);
+	histogram.Observe(0.0005);
+	histogram.Observe(0.003);
+	histogram.Observe(100.0);
+	auto counts = histogram.Counts();
+	EXPECT_EQ(counts[0], 2u);
+	EXPECT_EQ(counts[3], 1u);
+	EXPECT_EQ(counts.back(), 1u);
+	EXPECT_EQ(histogram.Count(), 4u);
+	EXPECT_NEAR(histogram.Sum(), 100.0036, 1e-6);
+}
+
+
+TEST(MetricsTest, HdrHistogram) {
+	// exact below 16 microseconds, then 16 buckets in each power of 2
+	EXPECT_EQ(HdrHistogram::BucketIndex(0), 0u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(15), 15u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(16), 16u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(31), 31u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(32), 32u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(33), 32u);
+	EXPECT_EQ(HdrHistogram::BucketIndex(uint64_t(1) << 40), kHdrBuckets - 1);
+	for (uint64_t value : {1ul, 17ul, 1000ul, 123456ul, 987654321ul}) {
+		size_t index = HdrHistogram::BucketIndex(value);
+		EXPECT_GT(HdrHistogram::BucketUpper(index), value);
+		EXPECT_LE(HdrHistogram::BucketUpper(index), value + value / 16 + 1);
+		if (index) {
+			EXPECT_LE(HdrHistogram::BucketUpper(index - 1), value);
+		}
+	}
+
+	HdrHistogram histogram;
+	EXPECT_DOUBLE_EQ(histogram.Percentile(0.5), 0.0);
+	// 1 to 1000 milliseconds
+	for (int i = 1; i <= 1000; ++i) {
+		histogram.Record(i * 1e-3);
+	}
+	EXPECT_EQ(histogram.Count(), 1000u);
+	EXPECT_NEAR(histogram.Mean(), 0.5005, 1e-6);
+	EXPECT_DOUBLE_EQ(histogram.Max(), 1.0);
+	EXPECT_NEAR(histogram.Percentile(0.5), 0.5, 0.5 / 16);
+	EXPECT_GE(histogram.Percentile(0.5), 0.5);
+	EXPECT_NEAR(histogram.Percentile(0.99), 0.99, 0.99 / 16);
+	EXPECT_DOUBLE_EQ(histogram.Percentile(1.0), 1.0);
+	EXPECT_NEAR(histogram.Percentile(0.0), 0.001, 0.001 / 16);
+}
+
+
+TEST(MetricsTest, RpcStats) {
+	RpcMetrics metrics;
+	metrics.Begin();
+	metrics.Begin();
+	metrics.End(0.01, 0);
+	metrics.Begin();
+	metrics.End(0.03, 3);
+	RpcMethodStats stats = metrics.Stats("ReadParameter");
+	EXPECT_EQ(stats.method, "ReadParameter");
+	EXPECT_EQ(stats.calls, 2u);
+	EXPECT_EQ(stats.in_flight, 1u);
+	EXPECT_EQ(stats.outcomes, (std::array<uint64_t, 5>{1, 0, 0, 1, 0}));
+	EXPECT_NEAR(stats.mean, 0.02, 1e-6);
+	EXPECT_NEAR(stats.p50, 0.01, 0.01 / 16);
+	EXPECT_NEAR(stats.max, 0.03, 1e-6);
+
+	std::string info = RpcStatsInfo({stats});
+	EXPECT_NE(info.find("ReadParameter"), std::string::npos) << info;
+	EXPECT_NE(info.find("warning"), std::string::npos) << info;
+	EXPECT_EQ(RpcStatsInfo({}), "No RPC handled.\n");
+}
+
+
+TEST(MetricsTest, Export) {
+	Metrics &metrics = Metrics::Instance();
+	metrics.AddRead(3, 100);
+	metrics.AddRead(3, 28);
+	metrics.SetFifoLevel(3, 65536);
+	metrics.AddWriteBacklog(2, 512);
+	metrics.AddWriteBacklog(-1, -256);
+	metrics.SetRunState(2);
+	metrics.SetBootTimings({{"total", kCratePhase, 1500.0}, {"boot fpga", 3, 250.0}});
+	RpcMetrics &boot = metrics.Rpc("Boot");
+	boot.Begin();
+	boot.End(0.002, 0);
+	boot.Begin();
+	boot.End(20.0, kRpcFailed);
+	// still handling
+	boot.Begin();
+	// out of modules
+	metrics.AddRead(kModuleNum, 100);
+
+	std::string text = metrics.Export();
+	for (const char *line : {
+		"# TYPE rxdaq_read_words_total counter\n",
+		"rxdaq_read_words_total{module=\"3\"} 128\n",
+		"rxdaq_read_bytes_total{module=\"3\"} 512\n",
+		"rxdaq_fifo_words{module=\"3\"} 65536\n",
+		"rxdaq_fifo_fill_ratio{module=\"3\"} 0.5\n",
+		"rxdaq_write_backlog_chunks 1\n",
+		"rxdaq_write_backlog_bytes 256\n",
+		"rxdaq_run_state 2\n",
+		"rxdaq_boot_phase_seconds{phase=\"total\",module=\"crate\"} 1.5\n",
+		"rxdaq_boot_phase_seconds{phase=\"boot fpga\",module=\"3\"} 0.25\n",
+		"# TYPE rxdaq_rpc_duration_seconds histogram\n",
+		"rxdaq_rpc_duration_seconds_bucket{method=\"Boot\",le=\"0.001\"} 0\n",
+		"rxdaq_rpc_duration_seconds_bucket{method=\"Boot\",le=\"0.0025\"} 1\n",
+		"rxdaq_rpc_duration_seconds_bucket{method=\"Boot\",le=\"10\"} 1\n",
+		"rxdaq_rpc_duration_seconds_bucket{method=\"Boot\",le=\"+Inf\"} 2\n",
+		"rxdaq_rpc_duration_seconds_count{method=\"Boot\"} 2\n",
+		"rxdaq_rpc_in_flight{method=\"Boot\"} 1\n",
+		"rxdaq_rpc_outcomes_total{method=\"Boot\",status=\"success\"} 1\n",
+		"rxdaq_rpc_outcomes_total{method=\"Boot\",status=\"warning\"} 0\n",
+		"rxdaq_rpc_outcomes_total{method=\"Boot\",status=\"rpc_failed\"} 1\n"
+	}) {
+		EXPECT_NE(text.find(line), std::string::npos) << line << text;
+	}
+	// modules never read are not exported
+	EXPECT_EQ(text.find("module=\"0\""), std::string::npos) << text;
+}
+
+
+TEST(MetricsTest, Response) {
+	std::string response = MetricsResponse("GET /metrics HTTP/1.1\r\nHost: a\r\n\r\n");
+	EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << response;
+	EXPECT_NE(response.find("text/plain; version=0.0.4"), std::string::npos);
+	EXPECT_NE(response.find("rxdaq_run_state"), std::string::npos);
+
+	response = MetricsResponse("GET /metrics?x=1 HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << response;
+	response = MetricsResponse("HEAD /metrics HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.find("rxdaq_run_state"), std::string::npos);
+	response = MetricsResponse("GET / HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.rfind("HTTP/1.1 404 Not Found\r\n", 0), 0u) << response;
+	response = MetricsResponse("POST /metrics HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(response.rfind("HTTP/1.1 405 Method Not Allowed\r\n", 0), 0u) << response;
+}
+
+
+TEST(MetricsTest, Server) {
+	MetricsServer server;
+	EXPECT_EQ(server.Port(), 0);
+	server.Start("127.0.0.1", 0);
+	unsigned short port = server.Port();
+	ASSERT_NE(port, 0);
+
+	std::string response = Get(port, "/metrics");
+	EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << response;
+	EXPECT_NE(response.find("# TYPE rxdaq_run_state gauge\n"), std::string::npos);
+	EXPECT_EQ(Get(port, "/other").rfind("HTTP/1.1 404", 0), 0u);
+
+	// the port is taken
+	MetricsServer another;
+	EXPECT_THROW(another.Start("127.0.0.1", port), RXError);
+
+	server.Stop();
+	EXPECT_EQ(server.Port(), 0);
+	EXPECT_EQ(Get(port, "/metrics"), "");
+}
@@ -0,0 +1,126 @@
+/*
+ * This is the test of the rate monitor stage. Counts of channels should
+ * slide out of the window with time, the rates are the counts in the window
+ * divided by the time it covers, and the rates can be read while counting.
+ */
+
+#include "include/rate_monitor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace rxdaq;
+
+
+/// @brief make block of events
+///
+/// @param[in] module module of block
+/// @param[in] channels channel of each event
+/// @returns block with raw words and decoded events
+///
+DataBlock MakeBlock(unsigned short module, const std::vector<uint8_t> &channels) {
+	DataBlock block;
+	block.module = module;
+	uint64_t time = 1000;
+	for (uint8_t channel : channels) {
+		auto header = EncodeListModeHeader(0, module + 2, channel, time++, 100);
+		block.words.insert(block.words.end(), header.begin(), header.end());
+	}
+	DecodeListMode(block.words.data(), block.words.size(), block.events);
+	return block;
+}
+
+
+TEST(RateMonitorTest, SlidingWindow) {
+	RateMonitor monitor(10.0);
+	EXPECT_DOUBLE_EQ(monitor.Window(), 10.0);
+	EXPECT_TRUE(monitor.Rates(0.0).empty());
+
+	// module 2 channel 3 and 5, module 12 channel 15
+	DataBlock block = MakeBlock(2, std::vector<uint8_t>(100, 3));
+	DataBlock other = MakeBlock(2, {5, 3, 5});
+	DataBlock last = MakeBlock(12, {15});
+	for (int second = 0; second < 10; ++second) {
+		monitor.Count(block, second + 0.5);
+	}
+	monitor.Count(other, 2.0);
+	monitor.Count(last, 9.0);
+	// not changed by counting
+	EXPECT_EQ(block.events.Size(), 100u);
+
+	// the window covers [1, 10)
+	std::vector<ChannelRate> rates = monitor.Rates(10.0);
+	ASSERT_EQ(rates.size(), 3u);
+	EXPECT_EQ(rates[0].module, 2);
+	EXPECT_EQ(rates[0].channel, 3);
+	EXPECT_DOUBLE_EQ(rates[0].rate, 901.0 / 9.0);
+	EXPECT_EQ(rates[0].total, 1001u);
+	EXPECT_EQ(rates[1].channel, 5);
+	EXPECT_DOUBLE_EQ(rates[1].rate, 2.0 / 9.0);
+	EXPECT_EQ(rates[2].module, 12);
+	EXPECT_EQ(rates[2].channel, 15);
+	EXPECT_DOUBLE_EQ(rates[2].rate, 1.0 / 9.0);
+
+	// before the window is full, the rate is over the time since reset
+	EXPECT_DOUBLE_EQ(monitor.Rates(4.75).at(0).rate, 501.0 / 4.75);
+
+	// the first 3 seconds slide out, the window covers [3, 12.5)
+	rates = monitor.Rates(12.5);
+	EXPECT_DOUBLE_EQ(rates[0].rate, 700.0 / 9.5);
+	EXPECT_DOUBLE_EQ(rates[1].rate, 0.0);
+	EXPECT_EQ(rates[1].total, 2u);
+
+	// a new period reuses the bucket of the old one
+	monitor.Count(block, 12.5);
+	EXPECT_DOUBLE_EQ(monitor.Rates(12.5)[0].rate, 800.0 / 9.5);
+
+	// all slide out but totals are kept until reset
+	rates = monitor.Rates(100.0);
+	EXPECT_DOUBLE_EQ(rates[0].rate, 0.0);
+	EXPECT_EQ(rates[0].total, 1101u);
+	monitor.Reset();
+	EXPECT_TRUE(monitor.Rates(100.0).empty());
+
+	// blocks out of modules are ignored
+	monitor.Count(MakeBlock(kModuleNum, {0}), 1.0);
+	EXPECT_TRUE(monitor.Rates(1.0).empty());
+}
+
+
+TEST(RateMonitorTest, ReadWhileCounting) {
+	RateMonitor monitor;
+	std::vector<DataBlock> blocks;
+	for (unsigned short module = 0; module < kModuleNum; ++module) {
+		std::vector<uint8_t> channels;
+		for (uint8_t channel = 0; channel < kChannelNum; ++channel) {
+			channels.insert(channels.end(), channel + 1, channel);
+		}
+		blocks.push_back(MakeBlock(module, channels));
+	}
+
+	std::atomic<bool> done(false);
+	std::thread reader([&]() {
+		while (!done) {
+			for (const auto &rate : monitor.Rates()) {
+				EXPECT_GE(rate.rate, 0.0);
+			}
+		}
+	});
+	for (int i = 0; i < 1000; ++i) {
+		monitor.Process(blocks[i % kModuleNum]);
+	}
+	done = true;
+	reader.join();
+
+	std::vector<ChannelRate> rates = monitor.Rates();
+	ASSERT_EQ(rates.size(), kRateChannels);
+	uint64_t total = 0;
+	for (const auto &rate : rates) {
+		EXPECT_GT(rate.rate, 0.0);
+		total += rate.total;
+	}
+	EXPECT_EQ(total, 1000u * 136);
+}
@@ -0,0 +1,130 @@
+/*
+ * This is the test of replaying recorded runs. The replayed files should be
+ * the same as written by the run pipeline, with any block size, and the
+ * timing should follow the timestamps scaled by the speed.
+ */
+
+#include "include/replay.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "include/error.h"
+#include "include/run_index.h"
+#include "include/trace_codec.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kInputPath = "replay_test_input";
+const std::string kOutputPath = "replay_test_output";
+
+
+/// @brief write recorded run of two modules
+///
+/// @param[in] step largest step of timestamp
+/// @returns data of modules
+///
+std::vector<std::vector<uint32_t>> WriteRun(unsigned int step) {
+	std::filesystem::create_directories(kInputPath);
+	std::vector<std::vector<uint32_t>> data;
+	for (unsigned short m = 0; m < 2; ++m) {
+		GenerateOptions options;
+		options.seed = m + 2;
+		options.slot = m + 2;
+		options.time = 0x200000000ull;
+		options.step = step;
+		options.trace_ratio = 2;
+		options.trace_words = 60;
+		options.baseline = true;
+		data.push_back(GenerateListMode(3000, options));
+		WriteWords(kInputPath + "/data_R0001_M0" + std::to_string(m) + ".bin", data[m]);
+	}
+	return data;
+}
+
+
+/// @brief get input files of run
+///
+/// @returns input files
+///
+std::vector<std::string> InputFiles() {
+	return {
+		kInputPath + "/data_R0001_M00.bin",
+		kInputPath + "/data_R0001_M01.bin"
+	};
+}
+
+
+TEST(ReplayTest, AsFastAsPossible) {
+	std::vector<std::vector<uint32_t>> data = WriteRun(1000);
+	size_t total = data[0].size() + data[1].size();
+
+	// blocks end inside events
+	for (size_t block : {size_t(333), kReplayBlockWords}) {
+		ReplayOptions options{0.0, 10.0, block, nullptr, nullptr, false};
+		ReplayResult result = ReplayRun(InputFiles(), kOutputPath, options);
+		EXPECT_EQ(result.files, 2u);
+		EXPECT_EQ(result.bytes, total * sizeof(uint32_t));
+		EXPECT_EQ(result.blocks, (data[0].size() + block - 1) / block + (data[1].size() + block - 1) / block);
+		EXPECT_EQ(result.invalid_blocks, 0u);
+		for (unsigned short m = 0; m < 2; ++m) {
+			std::string path = kOutputPath + "/data_R0001_M0" + std::to_string(m) + ".bin";
+			EXPECT_EQ(ReadWords(path), data[m]);
+			uint64_t events = 0;
+			for (const auto &entry : ReadIndex(IndexPath(path))) {
+				events += entry.events;
+			}
+			EXPECT_EQ(events, 3000u);
+		}
+	}
+
+	// traces are encoded by the same pipeline as run
+	ReplayOptions options{0.0, 10.0, 1000, nullptr, nullptr, true};
+	ReplayRun(InputFiles(), kOutputPath, options);
+	for (unsigned short m = 0; m < 2; ++m) {
+		std::string path = kOutputPath + "/data_R0001_M0" + std::to_string(m) + ".rxp";
+		EXPECT_EQ(UnpackListMode(ReadWords(path)), data[m]);
+	}
+
+	EXPECT_THROW(ReplayRun(InputFiles(), kInputPath, ReplayOptions{0.0, 10.0, 1000, nullptr, nullptr, false}), RXError);
+	EXPECT_THROW(ReplayRun({"replay_test_not_exist.bin"}, kOutputPath, options), RXError);
+
+	std::filesystem::remove_all(kInputPath);
+	std::filesystem::remove_all(kOutputPath);
+}
+
+
+TEST(ReplayTest, Timing) {
+	// about 3000 * 50 ticks of 10 ns, 1.5 ms
+	std::vector<std::vector<uint32_t>> data = WriteRun(100);
+	uint64_t first = std::min(
+		data[0][1] | (uint64_t(data[0][2] & 0xffff) << 32),
+		data[1][1] | (uint64_t(data[1][2] & 0xffff) << 32)
+	);
+	EventBatch events;
+	DecodeListMode(data[0].data(), data[0].size(), events);
+	double expected = (events.time.back() - first) * 10e-9;
+	events.Clear();
+	DecodeListMode(data[1].data(), data[1].size(), events);
+	expected = std::max(expected, (events.time.back() - first) * 10e-9);
+
+	// slow down to about 0.15 s
+	ReplayOptions options{0.01, 10.0, 1000, nullptr, nullptr, false};
+	ReplayResult result = ReplayRun(InputFiles(), kOutputPath, options);
+	EXPECT_GE(result.seconds, expected / 0.01);
+	EXPECT_LT(result.seconds, expected / 0.01 + 1.0);
+	for (unsigned short m = 0; m < 2; ++m) {
+		std::string path = kOutputPath + "/data_R0001_M0" + std::to_string(m) + ".bin";
+		EXPECT_EQ(ReadWords(path), data[m]);
+	}
+
+	options.speed = -1.0;
+	EXPECT_THROW(ReplayRun(InputFiles(), kOutputPath, options), RXError);
+
+	std::filesystem::remove_all(kInputPath);
+	std::filesystem::remove_all(kOutputPath);
+}
@@ -0,0 +1,221 @@
+/*
+ * This is the test of run index. The index entries should cover all the
+ * decoded events written to data file, and querying through the index
+ * should find the same events as scanning the whole file.
+ */
+
+#include "include/run_index.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/data_writer.h"
+#include "include/error.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kDataPath = "run_index_test.bin";
+
+
+/// @brief generate events in regular time steps, some with traces
+///
+/// @param[in] events number of events
+/// @param[in] first time of the first event
+/// @returns list mode data
+///
+std::vector<uint32_t> GenerateEvents(size_t events, uint64_t first) {
+	GenerateOptions options;
+	options.time = first;
+	options.step = 10;
+	options.trace_words = 10;
+	options.regular = true;
+	return GenerateListMode(events, options);
+}
+
+
+/// @brief find events matching query by scanning all data
+///
+/// @param[in] words list mode data
+/// @param[in] query conditions of events
+/// @returns words of matching events
+///
+std::vector<uint32_t> ScanEvents(
+	const std::vector<uint32_t> &words,
+	const IndexQuery &query
+) {
+	EventBatch events;
+	DecodeListMode(words.data(), words.size(), events);
+	std::vector<uint32_t> result;
+	for (size_t i = 0; i < events.Size(); ++i) {
+		if (
+			events.time[i] >= query.begin
+			&& events.time[i] <= query.end
+			&& ((query.channels >> events.channel[i]) & 1)
+		) {
+			const uint32_t *event = words.data() + events.offset[i];
+			result.insert(result.end(), event, event + events.length[i]);
+		}
+	}
+	return result;
+}
+
+
+TEST(RunIndexTest, WriteAndRead) {
+	std::vector<uint32_t> words = GenerateEvents(1000, 100);
+	EventBatch events;
+	ASSERT_EQ(DecodeListMode(words.data(), words.size(), events), words.size());
+
+	{
+		IndexWriter writer(IndexPath(kDataPath), 300);
+		// two blocks, entries never cross blocks
+		EXPECT_TRUE(writer.Add(events, words.size()));
+		EXPECT_TRUE(writer.Add(events, words.size()));
+		EXPECT_TRUE(writer.Close());
+	}
+
+	std::vector<IndexEntry> entries = ReadIndex(IndexPath(kDataPath));
+	ASSERT_EQ(entries.size(), 8u);
+	uint64_t offset = 0;
+	uint64_t total = 0;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		EXPECT_EQ(entries[i].offset, offset);
+		offset += entries[i].words * sizeof(uint32_t);
+		total += entries[i].events;
+		EXPECT_EQ(entries[i].channels, 0x7f);
+	}
+	EXPECT_EQ(offset, words.size() * 2 * sizeof(uint32_t));
+	EXPECT_EQ(total, 2000u);
+	EXPECT_EQ(entries[0].events, 300u);
+	EXPECT_EQ(entries[3].events, 100u);
+	EXPECT_EQ(entries[0].min_time, 100u);
+	EXPECT_EQ(entries[0].max_time, 100u + 299 * 10);
+	EXPECT_EQ(entries[4].min_time, 100u);
+
+	// query by time and channel
+	std::vector<size_t> found = FindEntries(entries, IndexQuery{3100, 3200, 0xffff});
+	EXPECT_EQ(found, (std::vector<size_t>{1, 5}));
+	found = FindEntries(entries, IndexQuery{0, 99, 0xffff});
+	EXPECT_TRUE(found.empty());
+	found = FindEntries(entries, IndexQuery{0, 100000, 0x80});
+	EXPECT_TRUE(found.empty());
+
+	std::remove(IndexPath(kDataPath).c_str());
+}
+
+
+TEST(RunIndexTest, TopLevelTable) {
+	// two blocks in different time, so groups of the second block are skipped
+	std::vector<uint32_t> first = GenerateEvents(3000, 100);
+	std::vector<uint32_t> second = GenerateEvents(3000, 1000000);
+	EventBatch first_events;
+	EventBatch second_events;
+	DecodeListMode(first.data(), first.size(), first_events);
+	DecodeListMode(second.data(), second.size(), second_events);
+
+	std::vector<IndexQuery> queries = {
+		IndexQuery{0, std::numeric_limits<uint64_t>::max(), 0xffff},
+		IndexQuery{5000, 5100, 0xffff},
+		IndexQuery{1010000, 1020000, 0x4},
+		IndexQuery{500000, 600000, 0xffff}
+	};
+	for (bool close : {true, false}) {
+		{
+			IndexWriter writer(IndexPath(kDataPath), 2);
+			EXPECT_TRUE(writer.Add(first_events, first.size()));
+			EXPECT_TRUE(writer.Add(second_events, second.size()));
+			// the file without top level table is still readable
+			if (close) {
+				EXPECT_TRUE(writer.Close());
+			}
+		}
+		IndexFile index(IndexPath(kDataPath));
+		ASSERT_EQ(index.Size(), 3000u);
+		std::vector<IndexEntry> entries = ReadIndex(IndexPath(kDataPath));
+		ASSERT_EQ(entries.size(), 3000u);
+		EXPECT_EQ(index[1500].min_time, 1000000u);
+		for (const auto &query : queries) {
+			EXPECT_EQ(index.Find(query), FindEntries(entries, query));
+		}
+		EXPECT_EQ(
+			index.Find(queries[1]),
+			(std::vector<size_t>{245, 246, 247, 248, 249, 250})
+		);
+	}
+	std::remove(IndexPath(kDataPath).c_str());
+}
+
+
+TEST(RunIndexTest, InvalidFile) {
+	EXPECT_THROW(ReadIndex("run_index_test_not_exist.idx"), RXError);
+	{
+		std::ofstream fout(kDataPath, std::ios::binary | std::ios::trunc);
+		fout << "not an index file";
+	}
+	EXPECT_THROW(ReadIndex(kDataPath), RXError);
+	std::remove(kDataPath.c_str());
+}
+
+
+TEST(RunIndexTest, QueryDataWriter) {
+	std::ofstream fout(kDataPath, std::ios::binary | std::ios::trunc);
+	DataWriter writer;
+	writer.SetPipeline(std::make_shared<Pipeline>());
+	writer.AttachIndex(
+		&fout, std::make_shared<IndexWriter>(IndexPath(kDataPath), 64)
+	);
+	writer.Start();
+
+	std::vector<uint32_t> data;
+	for (uint64_t block = 0; block < 20; ++block) {
+		std::vector<uint32_t> words = GenerateEvents(500, block * 5000);
+		data.insert(data.end(), words.begin(), words.end());
+		// events split between chunks
+		std::vector<uint32_t> first(words.begin(), words.begin() + 1001);
+		std::vector<uint32_t> second(words.begin() + 1001, words.end());
+		writer.Write(&fout, 0, std::move(first));
+		writer.Write(&fout, 0, std::move(second));
+		if (block == 10) {
+			// data can't be decoded is written but not indexed
+			std::vector<uint32_t> invalid(8, 0);
+			data.insert(data.end(), invalid.begin(), invalid.end());
+			writer.Write(&fout, 0, std::move(invalid));
+		}
+	}
+	writer.Stop();
+	fout.close();
+
+	std::vector<IndexQuery> queries = {
+		IndexQuery{0, std::numeric_limits<uint64_t>::max(), 0xffff},
+		IndexQuery{52000, 53000, 0xffff},
+		IndexQuery{60000, 70000, 0x5},
+		IndexQuery{1000000, 2000000, 0xffff}
+	};
+	// the invalid words follow the first 11 blocks
+	const size_t split = GenerateEvents(500, 0).size() * 11;
+	std::vector<uint32_t> head(data.begin(), data.begin() + split);
+	std::vector<uint32_t> tail(data.begin() + split + 8, data.end());
+	for (const auto &query : queries) {
+		QueryResult result = QueryRunFile(kDataPath, query);
+		std::vector<uint32_t> expected = ScanEvents(head, query);
+		std::vector<uint32_t> rest = ScanEvents(tail, query);
+		expected.insert(expected.end(), rest.begin(), rest.end());
+		EXPECT_EQ(result.words, expected);
+		EXPECT_LE(result.bytes_read, data.size() * sizeof(uint32_t));
+	}
+
+	// narrow query reads small part of file
+	QueryResult result = QueryRunFile(kDataPath, queries[1]);
+	EXPECT_EQ(result.events, 101u);
+	EXPECT_EQ(result.regions, 1u);
+	EXPECT_LT(result.bytes_read * 20, data.size() * sizeof(uint32_t));
+
+	std::remove(kDataPath.c_str());
+	std::remove(IndexPath(kDataPath).c_str());
+}
@@ -0,0 +1,91 @@
+/*
+ * This is the test of run number store. Store should keep the last run number
+ * across reopening, and survive the torn record.
+ */
+
+#include "include/run_number.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace rxdaq;
+
+const std::string kStorePath = "run_number_test.run";
+
+
+TEST(RunNumberTest, Reopen) {
+	std::remove(kStorePath.c_str());
+	{
+		RunNumberStore store;
+		store.Open(kStorePath, 10);
+		EXPECT_EQ(store.Current(), 10u);
+		store.Store(11);
+		store.Store(12);
+		EXPECT_EQ(store.Current(), 12u);
+	}
+
+	// stored number is used if config is older
+	RunNumberStore store;
+	store.Open(kStorePath, 10);
+	EXPECT_EQ(store.Current(), 12u);
+
+	// config is used if user changed it
+	store.Open(kStorePath, 20);
+	EXPECT_EQ(store.Current(), 20u);
+	store.Close();
+	store.Open(kStorePath, 0);
+	EXPECT_EQ(store.Current(), 20u);
+
+	store.Close();
+	std::remove(kStorePath.c_str());
+}
+
+
+TEST(RunNumberTest, TornRecord) {
+	std::remove(kStorePath.c_str());
+	{
+		RunNumberStore store;
+		store.Open(kStorePath, 5);
+		store.Store(6);
+	}
+	// crash while writing the next record
+	{
+		std::ofstream fout(kStorePath, std::ios::app);
+		fout << "00000";
+	}
+
+	RunNumberStore store;
+	store.Open(kStorePath, 0);
+	EXPECT_EQ(store.Current(), 6u);
+	store.Store(7);
+	store.Close();
+	store.Open(kStorePath, 0);
+	EXPECT_EQ(store.Current(), 7u);
+
+	store.Close();
+	std::remove(kStorePath.c_str());
+}
+
+
+TEST(RunNumberTest, Compact) {
+	std::remove(kStorePath.c_str());
+	RunNumberStore store;
+	store.Open(kStorePath, 0);
+	for (unsigned int i = 1; i <= 3000; ++i) {
+		store.Store(i);
+	}
+	store.Close();
+
+	// log is compacted rather than growing
+	std::ifstream fin(kStorePath, std::ios::ate);
+	EXPECT_LT(size_t(fin.tellg()), 1024u * 11u);
+	fin.close();
+
+	store.Open(kStorePath, 0);
+	EXPECT_EQ(store.Current(), 3000u);
+	store.Close();
+	std::remove(kStorePath.c_str());
+}
@@ -0,0 +1,148 @@
+/*
+ * This is the test of sampling run statistics. The rates and fractions
+ * should be computed in the interval between two reads, and the statistics
+ * should be read only by the readout thread at the interval and written to
+ * the csv file.
+ */
+
+#include "include/stats_sampler.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+const std::string kStatsPath = "stats_sampler_test.csv";
+
+
+/// @brief read lines of file
+///
+/// @param[in] path path of file
+/// @returns lines
+///
+std::vector<std::string> ReadLines(const std::string &path) {
+	std::ifstream fin(path);
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(fin, line)) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+
+TEST(StatsSamplerTest, ComputeSamples) {
+	ModuleStats previous{3, {{1.0, 0.8, 1000, 900}, {1.0, 1.0, 0, 0}}};
+	ModuleStats current{3, {{3.0, 2.4, 3000, 2500}, {3.0, 3.0, 0, 0}}};
+
+	// from the beginning of run
+	std::vector<ChannelSample> samples = ComputeSamples(ModuleStats{3, {}}, previous, 1.0);
+	ASSERT_EQ(samples.size(), 2u);
+	EXPECT_DOUBLE_EQ(samples[0].input_rate, 1000 / 0.8);
+	EXPECT_DOUBLE_EQ(samples[0].output_rate, 900.0);
+	EXPECT_DOUBLE_EQ(samples[0].live_fraction, 0.8);
+	EXPECT_DOUBLE_EQ(samples[0].dead_fraction, 1.0 - 900 / 1250.0);
+
+	// in the interval
+	samples = ComputeSamples(previous, current, 3.0);
+	ASSERT_EQ(samples.size(), 2u);
+	EXPECT_DOUBLE_EQ(samples[0].time, 3.0);
+	EXPECT_EQ(samples[0].module, 3);
+	EXPECT_EQ(samples[0].channel, 0);
+	EXPECT_DOUBLE_EQ(samples[0].real_time, 2.0);
+	EXPECT_DOUBLE_EQ(samples[0].live_time, 1.6);
+	EXPECT_DOUBLE_EQ(samples[0].input_rate, 2000 / 1.6);
+	EXPECT_DOUBLE_EQ(samples[0].output_rate, 800.0);
+	EXPECT_DOUBLE_EQ(samples[0].live_fraction, 0.8);
+	EXPECT_DOUBLE_EQ(samples[0].dead_fraction, 1.0 - 800 / 1250.0);
+	// no counts
+	EXPECT_EQ(samples[1].channel, 1);
+	EXPECT_DOUBLE_EQ(samples[1].input_rate, 0.0);
+	EXPECT_DOUBLE_EQ(samples[1].live_fraction, 1.0);
+	EXPECT_DOUBLE_EQ(samples[1].dead_fraction, 0.0);
+
+	// empty interval
+	samples = ComputeSamples(current, current, 3.0);
+	EXPECT_DOUBLE_EQ(samples[0].input_rate, 0.0);
+	EXPECT_DOUBLE_EQ(samples[0].output_rate, 0.0);
+	EXPECT_DOUBLE_EQ(samples[0].live_fraction, 0.0);
+}
+
+
+TEST(StatsSamplerTest, SampleInReadoutThread) {
+	std::thread::id readout_id;
+	std::vector<unsigned int> reads(kModuleNum, 0);
+	bool wrong_thread = false;
+	StatsSampler sampler([&](unsigned short module) {
+		if (std::this_thread::get_id() != readout_id) wrong_thread = true;
+		++reads[module];
+		double time = reads[module] * 0.01;
+		uint64_t counts = reads[module] * 100;
+		return ModuleStats{
+			module, std::vector<ChannelStats>(kChannelNum, {time, time, counts, counts})
+		};
+	});
+
+	std::thread readout([&]() {
+		readout_id = std::this_thread::get_id();
+		sampler.Start({0, 2}, 0.02, kStatsPath);
+		auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+		while (std::chrono::steady_clock::now() < stop) {
+			for (unsigned short module : {0, 2}) {
+				sampler.Sample(module);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		sampler.Finish();
+	});
+	readout.join();
+	EXPECT_FALSE(wrong_thread);
+
+	// about 15 samples and the last one of each module
+	EXPECT_GE(reads[0], 5u);
+	EXPECT_LE(reads[0], 17u);
+	EXPECT_EQ(reads[0], reads[2]);
+	EXPECT_EQ(reads[1], 0u);
+	EXPECT_EQ(sampler.Samples(), reads[0] + reads[2]);
+	EXPECT_EQ(sampler.Errors(), 0u);
+
+	std::vector<std::string> lines = ReadLines(kStatsPath);
+	ASSERT_EQ(lines.size(), 1 + sampler.Samples() * kChannelNum);
+	EXPECT_EQ(lines[0].rfind("time,module,channel,", 0), 0u);
+	// every interval has 100 counts in 0.01 seconds
+	EXPECT_NE(lines.back().find(",10000,10000,1,0"), std::string::npos)
+		<< lines.back();
+
+	// not sampled until started again
+	unsigned int last = reads[0];
+	sampler.Sample(0);
+	EXPECT_EQ(reads[0], last);
+	std::remove(kStatsPath.c_str());
+}
+
+
+TEST(StatsSamplerTest, Errors) {
+	StatsSampler sampler([](unsigned short) -> ModuleStats {
+		throw RXError("read stats failed");
+	});
+	sampler.Start({1}, 1.0, kStatsPath);
+	sampler.Finish();
+	EXPECT_EQ(sampler.Errors(), 1u);
+	EXPECT_EQ(sampler.Samples(), 0u);
+	EXPECT_EQ(ReadLines(kStatsPath).size(), 1u);
+
+	// not sampling with zero interval, and no file
+	std::remove(kStatsPath.c_str());
+	sampler.Start({1}, 0.0, kStatsPath);
+	sampler.Finish();
+	EXPECT_FALSE(std::ifstream(kStatsPath).good());
+
+	EXPECT_THROW(sampler.Start({1}, 1.0, "stats_sampler_not_exist/stats.csv"), RXError);
+}
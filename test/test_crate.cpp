@@ -6,7 +6,8 @@ namespace rxdaq {
 
 
 TestCrate::TestCrate() noexcept
-: list_(false), run_time_(0), run_number_(0) {
+: list_(false), run_time_(0), run_number_(0), next_run_(0), roll_{0, 0, 0}
+, stopped_(0), reduce_(false), reduction_{0, 0, -1, 0} {
 	// initialize virtual modules
 	for (unsigned short i = 0; i < kModuleNum; ++i) {
 		modules_[i].status = ModuleStatus::kInitial;
@@ -22,6 +23,23 @@ void TestCrate::Initialize(const std::string&) noexcept {
 }
 
 
+BootPlan TestCrate::PlanBoot(unsigned short module, bool fast) noexcept {
+	BootPlan result;
+	for (auto m : CreateRequestIndexes(kModuleNum, ModuleNum(), module)) {
+		// record the boot mode even it's not booted
+		modules_[m].boot_mode = fast;
+		if (!fast) {
+			result.push_back({m, BootAction::kBoot, "forced"});
+		} else if (modules_[m].status == ModuleStatus::kInitial) {
+			result.push_back({m, BootAction::kBoot, "offline"});
+		} else {
+			result.push_back({m, BootAction::kNone, "up to date"});
+		}
+	}
+	return result;
+}
+
+
 void TestCrate::Boot(unsigned short module, bool fast) noexcept {
 	if (module == kModuleNum) {
 		for (unsigned short i = 0; i < ModuleNum(); ++i) {
@@ -102,9 +120,15 @@ void TestCrate::ExportParameters(const std::string &path) {
 
 
 
-void TestCrate::StartRun(unsigned short module, unsigned int seconds, int run) {
+unsigned int TestCrate::StartRun(
+	unsigned short module,
+	unsigned int seconds,
+	int run
+) {
 	run_time_ = seconds;
 	run_number_ = run;
+	runs_.push_back(run == -1 ? next_run_ : run);
+	next_run_ = runs_.back() + 1;
 	if (module == kModuleNum) {
 		for (unsigned short m = 0; m < ModuleNum(); ++m) {
 			modules_[m].status = ModuleStatus::kRunning;
@@ -112,10 +136,78 @@ void TestCrate::StartRun(unsigned short module, unsigned int seconds, int run) {
 	} else {
 		modules_[module].status = ModuleStatus::kRunning;
 	}
-	return;
+	return runs_.back();
+}
+
+
+
+void TestCrate::PrepareRun(unsigned short, int run) noexcept {
+	prepared_runs_.push_back(run == -1 ? next_run_ : run);
+}
+
+
+unsigned int TestCrate::ContinuousRun(
+	unsigned short module,
+	const RollPolicy &policy,
+	int run
+) noexcept {
+	roll_ = policy;
+	return StartRun(module, 0, run);
+}
+
+
+void TestCrate::StopRun() noexcept {
+	++stopped_;
+}
+
+
+RunInfo TestCrate::RunStatus() noexcept {
+	if (runs_.empty()) {
+		return RunInfo{RunState::kIdle, -1, kModuleNum, 0, 0, ""};
+	}
+	return RunInfo{
+		RunState::kFinished, static_cast<int>(runs_.back()), kModuleNum,
+		run_time_, 0, ""
+	};
+}
+
+
+RunInfo TestCrate::WaitRun(unsigned int) noexcept {
+	return RunStatus();
 }
 
 
+void TestCrate::SetFilter(const std::string &path) noexcept {
+	filter_path_ = path;
+}
+
+
+std::vector<FilterCount> TestCrate::FilterStats() noexcept {
+	if (filter_path_.empty()) {
+		return std::vector<FilterCount>();
+	}
+	return std::vector<FilterCount>{FilterCount{"channel_0", 90, 10}};
+}
+
+
+void TestCrate::SetTraceReduction(
+	bool enable,
+	const TraceReduction &reduction
+) noexcept {
+	reduce_ = enable;
+	reduction_ = reduction;
+}
+
+
+TraceReductionStats TestCrate::ReductionStats() noexcept {
+	return TraceReductionStats{10, 1, 4000, 1800};
+}
+
+
+void TestCrate::Task(const std::string &task_name, unsigned short) noexcept {
+	tasks_.push_back(task_name);
+}
+
 
 // void TestCrate::EndRun(unsigned short module_) {
 // 	std::stringstream ss;
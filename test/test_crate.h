@@ -2,6 +2,7 @@
 #define __TEST_CRATE_H__
 
 
+#include <string>
 #include <vector>
 
 #include "include/crate.h"
@@ -65,6 +66,18 @@ public:
 	virtual void Initialize(const std::string &config_path) noexcept override;
 
 
+	/// @brief plan the boot without booting
+	///
+	/// @param[in] module module to plan, 13 for all modules
+	/// @param[in] fast true for incremental boot
+	/// @returns boot plan of modules
+	///
+	virtual BootPlan PlanBoot(
+		unsigned short module,
+		bool fast = true
+	) noexcept override;
+
+
 	/// @brief boot modules
 	///
 	/// @param module module to boot, 16 for all modules
@@ -164,19 +177,129 @@ public:
 	/// @param[in] module module to run in list mode 
 	/// @param[in] seconds seconds to run, 0 for infinite time
 	/// @param[in] run run number, -1 to read from config file
+	/// @returns run number of the started run
 	///
-	virtual void StartRun(
+	virtual unsigned int StartRun(
 		unsigned short module,
 		unsigned int seconds,
 		int run
 	) override;
 
+	/// @brief prepare list mode run
+	///
+	/// @param[in] module module to run in list mode
+	/// @param[in] run run number, -1 to read from config file
+	///
+	virtual void PrepareRun(unsigned short module, int run) noexcept override;
+
+
+	/// @brief run in list mode continuously
+	///
+	/// @param[in] module module to run in list mode
+	/// @param[in] policy conditions to roll to the next run
+	/// @param[in] run run number of the first run, -1 to read from config file
+	/// @returns run number of the first run
+	///
+	virtual unsigned int ContinuousRun(
+		unsigned short module,
+		const RollPolicy &policy,
+		int run
+	) noexcept override;
+
+
+	/// @brief stop list mode run
+	///
+	virtual void StopRun() noexcept override;
+
+
+	/// @brief get status of the last run, which finishes at once
+	///
+	/// @returns run status
+	///
+	virtual RunInfo RunStatus() noexcept override;
+
+
+	/// @brief wait for the last run, which finishes at once
+	///
+	/// @param[in] milliseconds maximum time to wait
+	/// @returns run status
+	///
+	virtual RunInfo WaitRun(unsigned int milliseconds = 0) noexcept override;
+
+
+	/// @brief record the path of filter rules
+	///
+	/// @param[in] path path of rules file, empty to turn off
+	///
+	virtual void SetFilter(const std::string &path) noexcept override;
+
+
+	/// @brief get counts of a virtual rule if the filter is set
+	///
+	/// @returns counts of rules
+	///
+	virtual std::vector<FilterCount> FilterStats() noexcept override;
+
+
+	/// @brief record the trace reduction
+	///
+	/// @param[in] enable false to turn off
+	/// @param[in] reduction settings of reduction
+	///
+	virtual void SetTraceReduction(
+		bool enable,
+		const TraceReduction &reduction
+	) noexcept override;
+
+
+	/// @brief get statistics of a virtual reduction
+	///
+	/// @returns statistics
+	///
+	virtual TraceReductionStats ReductionStats() noexcept override;
+
+
+	/// @brief get the run number of next run
+	///
+	/// @returns run number
+	///
+	virtual inline unsigned int RunNumber() const noexcept override {
+		return next_run_;
+	}
+
+
+	/// @brief run task
+	///
+	/// @param[in] task_name name of task
+	/// @param[in] module module to run task
+	///
+	virtual void Task(
+		const std::string &task_name,
+		unsigned short module
+	) noexcept override;
+
 	// virtual void EndRun(unsigned short module_) override;
 
 	TestModule modules_[kModuleNum];
 	bool list_;
 	unsigned int run_time_;
 	int run_number_;
+	// run numbers of finished runs
+	std::vector<unsigned int> runs_;
+	// run numbers of prepared runs
+	std::vector<unsigned int> prepared_runs_;
+	// name of tasks
+	std::vector<std::string> tasks_;
+	unsigned int next_run_;
+	// conditions to roll in last continuous run
+	RollPolicy roll_;
+	// number of stop requests
+	unsigned int stopped_;
+	// path of filter rules
+	std::string filter_path_;
+	// last trace reduction
+	bool reduce_;
+	TraceReduction reduction_;
 };
 
 }	// namespace rxdaq
@@ -0,0 +1,90 @@
+#include "test_list_mode.h"
+
+#include <fstream>
+#include <random>
+
+#include "include/list_mode.h"
+
+namespace rxdaq {
+
+std::vector<uint32_t> GenerateListMode(
+	size_t events,
+	const GenerateOptions &options
+) {
+	std::mt19937 engine(options.seed);
+	std::vector<uint32_t> result;
+	uint64_t time = options.time;
+	for (size_t i = 0; i < events; ++i) {
+		uint8_t slot = options.slot;
+		uint8_t channel = i % 7;
+		uint16_t trace_length = 0;
+		if (options.regular) {
+			time = options.time + i * options.step;
+			if (options.trace_ratio && i % options.trace_ratio == 0) {
+				trace_length = options.trace_words * 2;
+			}
+		} else {
+			time += engine() % options.step;
+			slot += engine() % options.slots;
+			channel = engine() % 16;
+			if (options.trace_ratio && engine() % options.trace_ratio == 0) {
+				trace_length = 2 * (engine() % options.trace_words + 1);
+			}
+		}
+		uint64_t jitter = options.jitter ? engine() % options.jitter : 0;
+		uint8_t header_length = list_mode::kMinHeaderLength;
+		if (options.qdc && engine() % 2) {
+			header_length = list_mode::kMinHeaderLength + 8;
+		}
+		auto header = EncodeListModeHeader(
+			options.crate, slot, channel, time + jitter,
+			options.regular ? i % 1000 : engine() % 65536,
+			trace_length, header_length
+		);
+		for (uint8_t j = list_mode::kMinHeaderLength; j < header_length; ++j) {
+			header[j] = engine() % 1000000;
+		}
+		if (options.cfd) {
+			header[2] |= (engine() % 65536) << list_mode::kCfdShift;
+		}
+		result.insert(result.end(), header.begin(), header.end());
+
+		for (uint16_t j = 0; j < trace_length / 2; ++j) {
+			if (options.regular) {
+				result.push_back(i);
+			} else if (options.baseline) {
+				uint32_t sample = 1000 + engine() % 16;
+				result.push_back(sample | ((sample + 1) << 16));
+			} else {
+				result.push_back(engine());
+			}
+		}
+	}
+	return result;
+}
+
+
+void WriteWords(
+	const std::string &path,
+	const std::vector<uint32_t> &words,
+	size_t extra
+) {
+	std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+	fout.write(
+		reinterpret_cast<const char*>(words.data()),
+		words.size() * sizeof(uint32_t)
+	);
+	const std::vector<char> zeros(extra, 0);
+	fout.write(zeros.data(), zeros.size());
+}
+
+
+std::vector<uint32_t> ReadWords(const std::string &path) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	std::vector<uint32_t> words(fin.tellg() / sizeof(uint32_t));
+	fin.seekg(0);
+	fin.read(reinterpret_cast<char*>(words.data()), words.size()*sizeof(uint32_t));
+	return words;
+}
+
+}		// namespace rxdaq
@@ -0,0 +1,75 @@
+#ifndef __TEST_LIST_MODE_H__
+#define __TEST_LIST_MODE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rxdaq {
+
+/// options of list mode data generated in test
+struct GenerateOptions {
+	// seed of random generator
+	unsigned int seed = 0;
+	uint8_t crate = 0;
+	// slots are chosen in [slot, slot + slots)
+	uint8_t slot = 2;
+	uint8_t slots = 1;
+	// timestamp before the first event
+	uint64_t time = 0x100000;
+	// largest step of timestamp between events
+	unsigned int step = 100;
+	// largest delay of single event, so events are read out of order
+	unsigned int jitter = 0;
+	// one of trace_ratio events has trace, 0 for no traces
+	unsigned int trace_ratio = 3;
+	// largest words of trace
+	unsigned int trace_words = 30;
+	// samples of traces are near baseline, otherwise random words
+	bool baseline = false;
+	// half of the events have QDC sums
+	bool qdc = false;
+	// events have CFD fraction
+	bool cfd = false;
+	// events are regular instead of random, so the expectations can be
+	// worked out by hand: event i is at time + i * step in channel i % 7,
+	// and every trace_ratio events from the first have trace of trace_words
+	bool regular = false;
+};
+
+
+/// @brief generate list mode data of events in time order
+///
+/// @param[in] events number of events
+/// @param[in] options options of data
+/// @returns list mode data
+///
+std::vector<uint32_t> GenerateListMode(
+	size_t events,
+	const GenerateOptions &options = GenerateOptions()
+);
+
+
+/// @brief write words to file
+///
+/// @param[in] path path of file
+/// @param[in] words words to write
+/// @param[in] extra zero bytes appended after words
+///
+void WriteWords(
+	const std::string &path,
+	const std::vector<uint32_t> &words,
+	size_t extra = 0
+);
+
+
+/// @brief read words from file
+///
+/// @param[in] path path of file
+/// @returns words, the bytes after the last whole word are ignored
+///
+std::vector<uint32_t> ReadWords(const std::string &path);
+
+}		// namespace rxdaq
+
+#endif		// __TEST_LIST_MODE_H__
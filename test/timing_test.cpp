@@ -0,0 +1,65 @@
+#include "include/timing.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rxdaq;
+
+
+TEST(TimingTest, ScopedTimer) {
+	TimingReport report;
+	{
+		ScopedTimer timer(report, "sleep", 2);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	{
+		ScopedTimer timer(report, "crate");
+	}
+
+	auto timings = report.Timings();
+	ASSERT_EQ(timings.size(), 2u);
+	EXPECT_EQ(timings[0].phase, "sleep");
+	EXPECT_EQ(timings[0].module, 2);
+	EXPECT_GE(timings[0].milliseconds, 20.0);
+	EXPECT_EQ(timings[1].phase, "crate");
+	EXPECT_EQ(timings[1].module, kCratePhase);
+
+	report.Clear();
+	EXPECT_TRUE(report.Timings().empty());
+}
+
+
+TEST(TimingTest, MultiThread) {
+	TimingReport report;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 13; ++i) {
+		threads.emplace_back([&report, i]() {
+			ScopedTimer timer(report, "boot", i);
+		});
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+	EXPECT_EQ(report.Timings().size(), 13u);
+}
+
+
+TEST(TimingTest, Info) {
+	EXPECT_EQ(TimingInfo({}), "");
+
+	std::string info = TimingInfo({
+		{"load", 1, 2.0},
+		{"set", kCratePhase, 3.0},
+		{"load", 0, 1.0},
+		{"load", 1, 0.5}
+	});
+	EXPECT_EQ(
+		info,
+		"phase(ms)            crate        m0        m1\n"
+		"load                     -       1.0       2.5\n"
+		"set                    3.0         -         -\n"
+	);
+}
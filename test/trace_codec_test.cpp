@@ -0,0 +1,155 @@
+/*
+ * This is the test of trace codec. Traces should be decoded to the same
+ * samples, block by block, and packed list mode data should be unpacked to
+ * the raw data.
+ */
+
+#include "include/trace_codec.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+
+/// @brief generate trace with random deltas
+///
+/// @param[in] length samples of trace
+/// @param[in] range maximum delta between samples
+/// @returns trace
+///
+std::vector<uint16_t> RandomTrace(size_t length, int range) {
+	static std::mt19937 engine(42);
+	std::uniform_int_distribution<int> delta(-range, range);
+	std::vector<uint16_t> trace(length);
+	int sample = 8000;
+	for (auto &s : trace) {
+		sample = std::max(0, std::min(65535, sample + delta(engine)));
+		s = sample;
+	}
+	return trace;
+}
+
+
+TEST(TraceCodecTest, RoundTrip) {
+	const std::vector<size_t> lengths = {1, 2, 127, 128, 129, 1000};
+	const std::vector<int> ranges = {0, 1, 7, 300, 65535};
+	for (const auto &length : lengths) {
+		for (const auto &range : ranges) {
+			std::vector<uint16_t> trace = RandomTrace(length, range);
+			std::vector<uint32_t> words = {0xdeadbeef};
+			size_t size = EncodeTrace(trace.data(), trace.size(), words);
+			EXPECT_EQ(words.size(), size + 1);
+
+			std::vector<uint16_t> decoded(length);
+			EXPECT_EQ(
+				DecodeTrace(words.data()+1, size, length, decoded.data()),
+				size
+			);
+			EXPECT_EQ(decoded, trace) << length << " " << range;
+		}
+	}
+
+	// constant trace needs only the block headers
+	std::vector<uint16_t> flat(256, 100);
+	std::vector<uint32_t> words;
+	EXPECT_EQ(EncodeTrace(flat.data(), flat.size(), words), 2u);
+}
+
+
+TEST(TraceCodecTest, Blocks) {
+	std::vector<uint16_t> trace = RandomTrace(300, 20);
+	std::vector<uint32_t> words;
+	size_t size = EncodeTrace(trace.data(), trace.size(), words);
+
+	// skip to the third block and decode it alone
+	std::vector<uint16_t> block(128);
+	size_t offset = 0;
+	offset += DecodeTraceBlock(words.data(), size, 128, block.data());
+	offset += DecodeTraceBlock(words.data()+offset, size-offset, 128, block.data());
+	size_t last = DecodeTraceBlock(
+		words.data()+offset, size-offset, 44, block.data()
+	);
+	EXPECT_EQ(offset + last, size);
+	EXPECT_TRUE(std::equal(trace.begin()+256, trace.end(), block.begin()));
+
+	// truncated and invalid
+	std::vector<uint16_t> decoded(300);
+	EXPECT_THROW(DecodeTrace(words.data(), size-1, 300, decoded.data()), RXError);
+	words[0] ^= kTraceEncodedFlag;
+	EXPECT_THROW(DecodeTrace(words.data(), size, 300, decoded.data()), RXError);
+	words[0] ^= kTraceEncodedFlag | (1u << 25);
+	EXPECT_THROW(DecodeTrace(words.data(), size, 300, decoded.data()), RXError);
+	words[0] &= ~(1u << 25);
+	words[0] |= 31 << 16;
+	EXPECT_THROW(DecodeTrace(words.data(), size, 300, decoded.data()), RXError);
+}
+
+
+TEST(TraceCodecTest, PackListMode) {
+	std::vector<uint32_t> raw;
+	for (uint16_t n = 0; n < 5; ++n) {
+		std::vector<uint16_t> trace = RandomTrace(n * 100, 10);
+		auto header = EncodeListModeHeader(0, 2, n, n * 10, 100, trace.size());
+		raw.insert(raw.end(), header.begin(), header.end());
+		for (size_t i = 0; i < trace.size(); i += 2) {
+			raw.push_back(trace[i] | (uint32_t(trace[i+1]) << 16));
+		}
+	}
+
+	Pipeline pipeline;
+	pipeline.AddStage(std::make_shared<TraceEncoder>());
+	std::vector<uint32_t> packed = raw;
+	pipeline.Process(0, packed);
+	EXPECT_LT(packed.size(), raw.size());
+
+	// events are still framed by headers
+	EventBatch events;
+	EXPECT_EQ(DecodeListMode(packed.data(), packed.size(), events), packed.size());
+	EXPECT_EQ(events.Size(), 5u);
+	EXPECT_EQ(events.trace_length[4], 400);
+
+	EXPECT_EQ(UnpackListMode(packed), raw);
+	packed.pop_back();
+	EXPECT_THROW(UnpackListMode(packed), RXError);
+}
+
+
+TEST(TraceCodecTest, EncodedFlag) {
+	// noisy trace with large samples, not shorter after encoding
+	std::mt19937 engine(7);
+	std::vector<uint16_t> trace(256);
+	for (auto &sample : trace) sample = 0x8000 | engine();
+	std::vector<uint32_t> raw = EncodeListModeHeader(0, 2, 0, 10, 100, trace.size());
+	for (size_t i = 0; i < trace.size(); i += 2) {
+		raw.push_back(trace[i] | (uint32_t(trace[i+1]) << 16));
+	}
+	// event shorter than its trace, without the encoded flag
+	std::vector<uint32_t> broken = EncodeListModeHeader(0, 2, 1, 20, 100, 100);
+	broken[0] &= ~(list_mode::kEventLengthMask << list_mode::kEventLengthShift);
+	broken[0] |= 7 << list_mode::kEventLengthShift;
+	broken.insert(broken.end(), 3, 0x1234);
+	raw.insert(raw.end(), broken.begin(), broken.end());
+
+	Pipeline pipeline;
+	pipeline.AddStage(std::make_shared<TraceEncoder>());
+	std::vector<uint32_t> packed = raw;
+	pipeline.Process(0, packed);
+	// both are kept raw and read back as raw
+	EXPECT_EQ(packed, raw);
+	EXPECT_EQ(UnpackListMode(packed), raw);
+
+	// broken event with the flag can't be written unambiguously
+	raw.back() |= kTraceEncodedFlag;
+	raw[raw.size() - 3] |= kTraceEncodedFlag;
+	packed = raw;
+	pipeline.Process(0, packed);
+	EXPECT_EQ(packed.size(), raw.size() - broken.size());
+	// and is rejected when read
+	EXPECT_THROW(UnpackListMode(raw), RXError);
+}
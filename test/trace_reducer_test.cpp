@@ -0,0 +1,131 @@
+/*
+ * This is the test of trace reducer. Traces should be cut around the trigger
+ * with headers rewritten, and the kept samples should be the same as raw.
+ */
+
+#include "include/trace_reducer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "include/error.h"
+
+using namespace rxdaq;
+
+
+/// @brief append an event with a step pulse
+///
+/// @param[in,out] words words to append
+/// @param[in] time timestamp of event
+/// @param[in] energy energy of event
+/// @param[in] length samples of trace
+/// @param[in] edge sample index of the pulse rising edge
+///
+void AppendPulse(
+	std::vector<uint32_t> &words,
+	uint64_t time,
+	uint16_t energy,
+	uint16_t length,
+	uint16_t edge
+) {
+	auto header = EncodeListModeHeader(0, 2, 1, time, energy, length);
+	words.insert(words.end(), header.begin(), header.end());
+	for (uint16_t i = 0; i < length; i += 2) {
+		// baseline with noise, then the pulse
+		uint32_t low = i < edge ? 100 + i % 3 : 1000 + i;
+		uint32_t high = i + 1 < edge ? 100 + (i + 1) % 3 : 1000 + i + 1;
+		words.push_back(low | (high << 16));
+	}
+}
+
+
+TEST(TraceReducerTest, CutAroundEdge) {
+	std::vector<uint32_t> raw;
+	AppendPulse(raw, 100, 500, 100, 41);
+	AppendPulse(raw, 200, 30000, 100, 60);
+	AppendPulse(raw, 300, 500, 20, 3);
+
+	const TraceReduction reduction{10, 20, -1, 20000};
+	auto reducer = std::make_shared<TraceReducer>(reduction);
+	Pipeline pipeline;
+	pipeline.AddStage(reducer);
+	std::vector<uint32_t> reduced = raw;
+	pipeline.Process(0, reduced);
+
+	EventBatch events;
+	ASSERT_EQ(DecodeListMode(reduced.data(), reduced.size(), events), reduced.size());
+	ASSERT_EQ(events.Size(), 3u);
+	// edge 41, keep [30, 62)
+	EXPECT_EQ(events.trace_length[0], 32);
+	EXPECT_EQ(reduced[events.offset[0]+4] & 0xffff, 100u + 30 % 3);
+	// trace dropped by energy
+	EXPECT_EQ(events.trace_length[1], 0);
+	EXPECT_EQ(events.length[1], 4u);
+	EXPECT_EQ(events.energy[1], 30000);
+	// edge 3 near the beginning, keep [0, 20)
+	EXPECT_EQ(events.trace_length[2], 20);
+
+	auto stats = reducer->Stats();
+	EXPECT_EQ(stats.events, 3u);
+	EXPECT_EQ(stats.dropped, 1u);
+	EXPECT_EQ(stats.input_samples, 220u);
+	EXPECT_EQ(stats.output_samples, 52u);
+
+	auto check = CheckReducedTraces(raw, reduced, reduction);
+	EXPECT_EQ(check.events, 3u);
+	EXPECT_EQ(check.traces, 2u);
+	EXPECT_EQ(check.samples, 52u);
+	EXPECT_EQ(check.mismatches, 0u);
+}
+
+
+TEST(TraceReducerTest, FixedTrigger) {
+	std::vector<uint32_t> raw;
+	AppendPulse(raw, 100, 500, 100, 41);
+	auto header = EncodeListModeHeader(0, 2, 2, 150, 800);
+	raw.insert(raw.end(), header.begin(), header.end());
+
+	const TraceReduction reduction{5, 10, 50, 0};
+	auto reducer = std::make_shared<TraceReducer>(reduction);
+	Pipeline pipeline;
+	pipeline.AddStage(reducer);
+	std::vector<uint32_t> reduced = raw;
+	pipeline.Process(0, reduced);
+
+	EventBatch events;
+	DecodeListMode(reduced.data(), reduced.size(), events);
+	ASSERT_EQ(events.Size(), 2u);
+	// trigger 50, keep [44, 60)
+	EXPECT_EQ(events.trace_length[0], 16);
+	EXPECT_EQ(reduced[events.offset[0]+4] & 0xffff, 1044u);
+	// event without trace is not changed
+	EXPECT_EQ(events.length[1], 4u);
+	EXPECT_EQ(events.time[1], 150u);
+	EXPECT_EQ(CheckReducedTraces(raw, reduced, reduction).mismatches, 0u);
+
+	// corrupted sample and header are found
+	reduced[events.offset[0]+5] ^= 1;
+	EXPECT_EQ(CheckReducedTraces(raw, reduced, reduction).mismatches, 1u);
+	reduced[events.offset[0]+5] ^= 1;
+	reduced[events.offset[1]+3] += 1;
+	EXPECT_EQ(CheckReducedTraces(raw, reduced, reduction).mismatches, 1u);
+	reduced[events.offset[1]+3] -= 1;
+
+	// samples found in raw trace but not at the window of the settings
+	std::vector<uint32_t> shifted = reduced;
+	std::copy(
+		raw.begin() + 4 + 44 / 2 + 1, raw.begin() + 4 + 60 / 2 + 1,
+		shifted.begin() + events.offset[0] + 4
+	);
+	EXPECT_EQ(CheckReducedTraces(raw, shifted, reduction).mismatches, 1u);
+	EXPECT_EQ(
+		CheckReducedTraces(raw, reduced, TraceReduction{5, 10, 52, 0}).mismatches,
+		1u
+	);
+
+	// event not in raw data
+	std::vector<uint32_t> other = EncodeListModeHeader(0, 2, 2, 999, 800);
+	EXPECT_THROW(CheckReducedTraces(raw, other, reduction), RXError);
+}
@@ -0,0 +1,142 @@
+/*
+ * This is the test of tracer. Spans should be recorded only when tracing is
+ * enabled, and exported in Chrome trace format, even while other threads are
+ * recording.
+ */
+
+#include "include/trace.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+using namespace rxdaq;
+
+
+TEST(TraceTest, Span) {
+	Tracer &tracer = Tracer::Instance();
+	tracer.Disable();
+	{
+		TraceSpan span("disabled");
+	}
+
+	tracer.Enable();
+	{
+		TraceSpan outer("outer");
+		TraceSpan inner("inner");
+	}
+	tracer.Disable();
+
+	auto events = tracer.Events();
+	ASSERT_EQ(events.size(), 4u);
+	EXPECT_STREQ(events[0].name, "outer");
+	EXPECT_EQ(events[0].type, TraceEventType::kBegin);
+	EXPECT_STREQ(events[1].name, "inner");
+	EXPECT_EQ(events[1].type, TraceEventType::kBegin);
+	EXPECT_STREQ(events[2].name, "inner");
+	EXPECT_EQ(events[2].type, TraceEventType::kEnd);
+	EXPECT_STREQ(events[3].name, "outer");
+	EXPECT_EQ(events[3].type, TraceEventType::kEnd);
+	EXPECT_LE(events[0].ticks, events[3].ticks);
+
+	// enabling again clears the events
+	tracer.Enable();
+	tracer.Disable();
+	EXPECT_TRUE(tracer.Events().empty());
+}
+
+
+TEST(TraceTest, MultiThread) {
+	Tracer &tracer = Tracer::Instance();
+	tracer.Enable();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([]() {
+			for (int j = 0; j < 100; ++j) {
+				TraceSpan span("loop");
+			}
+		});
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+	tracer.Disable();
+
+	auto events = tracer.Events();
+	ASSERT_EQ(events.size(), 800u);
+	// events of a thread are in pairs
+	for (size_t i = 0; i < events.size(); i += 2) {
+		EXPECT_EQ(events[i].thread, events[i+1].thread);
+		EXPECT_EQ(events[i].type, TraceEventType::kBegin);
+		EXPECT_EQ(events[i+1].type, TraceEventType::kEnd);
+	}
+}
+
+
+TEST(TraceTest, ChromeTrace) {
+	Tracer &tracer = Tracer::Instance();
+	tracer.Enable();
+	{
+		TraceSpan span("sleep");
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	tracer.Disable();
+
+	nlohmann::json trace = nlohmann::json::parse(tracer.ChromeTrace());
+	ASSERT_EQ(trace["traceEvents"].size(), 2u);
+	EXPECT_EQ(trace["traceEvents"][0]["name"], "sleep");
+	EXPECT_EQ(trace["traceEvents"][0]["ph"], "B");
+	EXPECT_EQ(trace["traceEvents"][1]["ph"], "E");
+	double duration = double(trace["traceEvents"][1]["ts"])
+		- double(trace["traceEvents"][0]["ts"]);
+	EXPECT_GE(duration, 9000.0);
+	EXPECT_LT(duration, 1000000.0);
+}
+
+
+TEST(TraceTest, ExportWhileRecording) {
+	Tracer &tracer = Tracer::Instance();
+	tracer.Enable();
+	std::atomic<bool> stop{false};
+	std::thread recorder([&stop]() {
+		while (!stop.load(std::memory_order_relaxed)) {
+			TraceSpan span("busy");
+			std::this_thread::yield();
+		}
+	});
+
+	uint64_t restart = 0;
+	for (int round = 0; round < 200; ++round) {
+		// restart tracing while the spans are open, the events before are
+		// cleared
+		if (round % 2) {
+			restart = TraceTicks();
+			tracer.Enable();
+		}
+		std::vector<TraceEvent> events;
+		while (events.empty()) {
+			std::this_thread::yield();
+			events = tracer.Events();
+		}
+		for (size_t i = 0; i < events.size(); ++i) {
+			ASSERT_STREQ(events[i].name, "busy");
+			ASSERT_GE(events[i].ticks, restart);
+			// begin and end alternate in a thread, the ring may start at end
+			if (i && events[i].thread == events[i-1].thread) {
+				ASSERT_NE(events[i].type, events[i-1].type) << i;
+			}
+		}
+		nlohmann::json trace = nlohmann::json::parse(tracer.ChromeTrace());
+		EXPECT_TRUE(trace["traceEvents"].is_array());
+	}
+
+	stop.store(true, std::memory_order_relaxed);
+	recorder.join();
+	tracer.Disable();
+	EXPECT_FALSE(tracer.Events().empty());
+}
@@ -0,0 +1,136 @@
+/*
+ * This is the test of verifying data files. Good files should pass, and
+ * each kind of corruption should be reported at the offset of the first bad
+ * event, no matter how the file is split into chunks.
+ */
+
+#include "include/verify.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "include/columnar.h"
+#include "include/error.h"
+#include "test/test_list_mode.h"
+
+using namespace rxdaq;
+
+const std::string kFile = "verify_test_R0001_M01.bin";
+
+
+/// @brief get word offset of event
+///
+/// @param[in] words list mode data
+/// @param[in] index index of event
+/// @returns offset in words
+///
+size_t EventOffset(const std::vector<uint32_t> &words, size_t index) {
+	EventBatch events;
+	DecodeListMode(words.data(), words.size(), events);
+	return events.offset[index];
+}
+
+
+TEST(VerifyTest, ModuleOfDataFile) {
+	EXPECT_EQ(ModuleOfDataFile("run/data_R0001_M02.bin"), 2);
+	EXPECT_EQ(ModuleOfDataFile("data_R0012_M11.rxp"), 11);
+	EXPECT_EQ(ModuleOfDataFile("sorted.bin"), -1);
+	EXPECT_EQ(ModuleOfDataFile("data_M.bin"), -1);
+	EXPECT_EQ(ModuleOfDataFile("data_M2x.bin"), -1);
+}
+
+
+TEST(VerifyTest, Problems) {
+	GenerateOptions generate;
+	generate.seed = 5;
+	generate.crate = 1;
+	generate.slot = 3;
+	const std::vector<uint32_t> good = GenerateListMode(20000, generate);
+	VerifyOptions options{1, {2, 3}, 3, 1000};
+
+	// good file with every chunk size
+	WriteWords(kFile, good);
+	for (size_t chunk_words : {size_t(100), size_t(1000), kDefaultChunkWords}) {
+		options.chunk_words = chunk_words;
+		std::vector<VerifyReport> reports = VerifyRun({kFile}, options);
+		ASSERT_EQ(reports.size(), 1u);
+		EXPECT_TRUE(reports[0].Good()) << reports[0].message;
+		EXPECT_EQ(reports[0].events, 20000u);
+		EXPECT_EQ(reports[0].bytes, good.size() * sizeof(uint32_t));
+		EXPECT_EQ(reports[0].unverified_bytes, 0u);
+	}
+	options.chunk_words = 1000;
+
+	struct Case {
+		VerifyProblem problem;
+		size_t event;
+	};
+	std::vector<Case> cases = {
+		{VerifyProblem::kFraming, 5000},
+		{VerifyProblem::kTraceLength, 7000},
+		{VerifyProblem::kCrate, 123},
+		{VerifyProblem::kSlot, 15000},
+		{VerifyProblem::kTimestamp, 9999}
+	};
+	for (const auto &c : cases) {
+		std::vector<uint32_t> words(good);
+		size_t offset = EventOffset(words, c.event);
+		switch (c.problem) {
+			case VerifyProblem::kFraming:
+				words[offset] &= ~(list_mode::kHeaderLengthMask << list_mode::kHeaderLengthShift);
+				break;
+			case VerifyProblem::kTraceLength:
+				words[offset+3] += 2 << list_mode::kTraceLengthShift;
+				break;
+			case VerifyProblem::kCrate:
+				words[offset] ^= 3 << list_mode::kCrateShift;
+				break;
+			case VerifyProblem::kSlot:
+				words[offset] ^= 1 << list_mode::kSlotShift;
+				break;
+			default:
+				// back to the beginning for the channel
+				words[offset+1] = 0;
+				words[offset+2] &= ~list_mode::kTimeHighMask;
+				break;
+		}
+		WriteWords(kFile, words);
+		VerifyReport report = VerifyRun({kFile}, options)[0];
+		EXPECT_EQ(report.first_problem, c.problem)
+			<< VerifyProblemName(c.problem) << " " << report.message;
+		EXPECT_EQ(report.first_offset, offset * sizeof(uint32_t))
+			<< VerifyProblemName(c.problem);
+		if (c.problem == VerifyProblem::kFraming) {
+			EXPECT_EQ(report.events, c.event);
+			EXPECT_EQ(report.unverified_bytes, (words.size() - offset) * sizeof(uint32_t));
+		} else {
+			EXPECT_EQ(report.events, 20000u);
+		}
+	}
+
+	// partial event and partial word at the end
+	std::vector<uint32_t> truncated(good.begin(), good.end() - 1);
+	WriteWords(kFile, truncated);
+	VerifyReport report = VerifyRun({kFile}, options)[0];
+	EXPECT_EQ(report.first_problem, VerifyProblem::kTruncated);
+	EXPECT_EQ(report.events, 19999u);
+	EXPECT_EQ(report.first_offset, EventOffset(good, 19999) * sizeof(uint32_t));
+	WriteWords(kFile, good, 2);
+	report = VerifyRun({kFile}, options)[0];
+	EXPECT_EQ(report.first_problem, VerifyProblem::kTruncated);
+	EXPECT_EQ(report.unverified_bytes, 2u);
+
+	// crate is skipped if negative, and slot is skipped without slots
+	WriteWords(kFile, good);
+	options.crate = -1;
+	options.slots = {7, 7};
+	EXPECT_EQ(VerifyRun({kFile}, options)[0].first_problem, VerifyProblem::kSlot);
+	options.slots.clear();
+	EXPECT_TRUE(VerifyRun({kFile}, options)[0].Good());
+
+	EXPECT_THROW(VerifyRun({"verify_test_not_exist.bin"}, options), RXError);
+	std::remove(kFile.c_str());
+}